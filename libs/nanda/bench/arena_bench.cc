@@ -0,0 +1,86 @@
+#include <benchmark/benchmark.h>
+
+#include <memory_resource>
+
+#include "nanda/arena.hh"
+#include "nanda/ndarray.hh"
+
+using namespace nanda;
+
+namespace {
+
+using matrix = dextents<index_type, 2>;
+
+///@brief One step of a computation with a few temporaries of 'side' x 'side'
+/// floats, all from the current resource
+float
+step(const ndarray<float, matrix>& x, index_type side)
+{
+  scratch_ndarray<float, matrix> a(x * 2.0f + 1.0f);
+  scratch_ndarray<float, matrix> b(a * a - x);
+  scratch_ndarray<float, matrix> c(matrix{ side, side / 2 });
+  for (index_type i = 0; i < side; ++i)
+    for (index_type j = 0; j < side / 2; ++j)
+      c(i, j) = b(i, 2 * j) + b(i, 2 * j + 1);
+  scratch_ndarray<float, matrix> d(c * 0.5f);
+  return d(side - 1, side / 2 - 1);
+}
+
+void
+report(benchmark::State& state, const allocation_stats& stats)
+{
+  const auto per_iteration = benchmark::Counter::kAvgIterations;
+  state.counters["allocs"] = { double(stats.allocations), per_iteration };
+  state.counters["bytes"] = { double(stats.bytes), per_iteration };
+  state.counters["upstream_allocs"] = { double(stats.upstream_allocations),
+                                        per_iteration };
+  state.counters["upstream_bytes"] = { double(stats.upstream_bytes),
+                                       per_iteration };
+}
+
+///@brief Temporaries from the global operator new, counted
+void
+BM_DefaultAllocator(benchmark::State& state)
+{
+  const auto side = index_type(state.range(0));
+  const ndarray<float, matrix> x(matrix{ side, side }, 1.5f);
+  counting_resource counting;
+  scoped_resource scope(counting);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(step(x, side));
+  report(state, counting.stats());
+}
+
+///@brief Temporaries carved out of an arena rewound after every step
+void
+BM_Arena(benchmark::State& state)
+{
+  const auto side = index_type(state.range(0));
+  const ndarray<float, matrix> x(matrix{ side, side }, 1.5f);
+  arena_resource arena;
+  scoped_resource scope(arena);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(step(x, side));
+    arena.rewind();
+  }
+  report(state, arena.stats());
+}
+
+///@brief Temporaries from the free lists of a pool
+void
+BM_Pool(benchmark::State& state)
+{
+  const auto side = index_type(state.range(0));
+  const ndarray<float, matrix> x(matrix{ side, side }, 1.5f);
+  pool_resource pool(std::size_t(1) << 22);
+  scoped_resource scope(pool);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(step(x, side));
+  report(state, pool.stats());
+}
+
+} // namespace
+
+BENCHMARK(BM_DefaultAllocator)->Arg(8)->Arg(64)->Arg(512);
+BENCHMARK(BM_Arena)->Arg(8)->Arg(64)->Arg(512);
+BENCHMARK(BM_Pool)->Arg(8)->Arg(64)->Arg(512);
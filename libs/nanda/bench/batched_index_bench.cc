@@ -0,0 +1,162 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "nanda/batched_index.hh"
+
+using namespace nanda;
+
+namespace {
+
+using dimension = std::array<index_type, 3>;
+
+// a 256 x 200 x 300 grid, not a power of two in any direction
+constexpr dimension dims{ 256, 200, 300 };
+
+///@brief Particle coordinates of the grid as structure of arrays, about one
+/// in a hundred outside of it
+struct particles
+{
+  explicit particles(std::size_t n)
+  {
+    std::uint64_t state = 12345;
+    for (std::size_t d = 0; d < 3; ++d) {
+      coords[d].resize(n);
+      for (auto& x : coords[d]) {
+        state = state * 6364136223846793005u + 1442695040888963407u;
+        x = index_type((state >> 33) % std::uint64_t(dims[d] + 1));
+      }
+    }
+    flat.resize(n);
+    valid.resize(n);
+  }
+
+  std::array<span<const index_type>, 3> in() const
+  {
+    std::array<span<const index_type>, 3> out;
+    for (std::size_t d = 0; d < 3; ++d)
+      out[d] = { coords[d].data(), coords[d].size() };
+    return out;
+  }
+
+  std::array<span<index_type>, 3> out()
+  {
+    std::array<span<index_type>, 3> spans;
+    for (std::size_t d = 0; d < 3; ++d)
+      spans[d] = { coords[d].data(), coords[d].size() };
+    return spans;
+  }
+
+  std::array<std::vector<index_type>, 3> coords;
+  std::vector<index_type> flat;
+  std::vector<std::uint8_t> valid;
+};
+
+bool
+select_isa(benchmark::State& state, simd_isa isa)
+{
+  if (!simd_isa_supported(isa)) {
+    state.SkipWithError("instruction set not supported");
+    return false;
+  }
+  return true;
+}
+
+///@brief The loop the batch replaces: a bounds check and a flatten call, with
+/// the index gathered into an array, per point
+void
+BM_FlattenLoop(benchmark::State& state)
+{
+  particles p(state.range(0));
+  const auto shifts = get_shifts<StorageOrder::RowMajor>(dims);
+  for (auto _ : state) {
+    for (std::size_t k = 0; k < p.flat.size(); ++k) {
+      const dimension idx{ p.coords[0][k], p.coords[1][k], p.coords[2][k] };
+      bool ok = true;
+      for (std::size_t d = 0; d < 3; ++d)
+        ok = ok && idx[d] >= 0 && idx[d] < dims[d];
+      p.flat[k] = ok ? fast_flatten(idx, dims, shifts) : -1;
+      p.valid[k] = ok;
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template<simd_isa Isa>
+void
+BM_FlattenBatch(benchmark::State& state)
+{
+  if (!select_isa(state, Isa))
+    return;
+  particles p(state.range(0));
+  for (auto _ : state) {
+    flatten_batch<StorageOrder::RowMajor>(
+      p.in(),
+      dims,
+      span<index_type>(p.flat.data(), p.flat.size()),
+      span<std::uint8_t>(p.valid.data(), p.valid.size()),
+      Isa);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+///@brief One unflatten call per point, the divisions by the runtime shifts
+void
+BM_UnflattenLoop(benchmark::State& state)
+{
+  particles p(state.range(0));
+  flatten_batch<StorageOrder::RowMajor>(
+    p.in(), dims, span<index_type>(p.flat.data(), p.flat.size()));
+  const auto size = index_type(detail::dims_size(dims));
+  for (auto _ : state) {
+    for (std::size_t k = 0; k < p.flat.size(); ++k) {
+      const index_type x = p.flat[k];
+      const bool ok = x >= 0 && x < size;
+      const auto idx =
+        ok ? unflatten<StorageOrder::RowMajor>(x, dims) : dimension{};
+      for (std::size_t d = 0; d < 3; ++d)
+        p.coords[d][k] = ok ? idx[d] : -1;
+      p.valid[k] = ok;
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template<simd_isa Isa>
+void
+BM_UnflattenBatch(benchmark::State& state)
+{
+  if (!select_isa(state, Isa))
+    return;
+  particles p(state.range(0));
+  flatten_batch<StorageOrder::RowMajor>(
+    p.in(), dims, span<index_type>(p.flat.data(), p.flat.size()));
+  for (auto _ : state) {
+    unflatten_batch<StorageOrder::RowMajor>(
+      span<const index_type>(p.flat.data(), p.flat.size()),
+      dims,
+      p.out(),
+      span<std::uint8_t>(p.valid.data(), p.valid.size()),
+      Isa);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+} // namespace
+
+// 4K points stay in the caches, 4M go to memory
+#define NANDA_BATCHED_INDEX_BENCHMARK(kernel)                                  \
+  BENCHMARK_TEMPLATE(kernel, simd_isa::scalar)->Arg(1 << 12)->Arg(1 << 22);    \
+  BENCHMARK_TEMPLATE(kernel, simd_isa::sse2)->Arg(1 << 12)->Arg(1 << 22);      \
+  BENCHMARK_TEMPLATE(kernel, simd_isa::avx2)->Arg(1 << 12)->Arg(1 << 22);      \
+  BENCHMARK_TEMPLATE(kernel, simd_isa::avx512)->Arg(1 << 12)->Arg(1 << 22)
+
+BENCHMARK(BM_FlattenLoop)->Arg(1 << 12)->Arg(1 << 22);
+NANDA_BATCHED_INDEX_BENCHMARK(BM_FlattenBatch);
+BENCHMARK(BM_UnflattenLoop)->Arg(1 << 12)->Arg(1 << 22);
+NANDA_BATCHED_INDEX_BENCHMARK(BM_UnflattenBatch);
@@ -0,0 +1,35 @@
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+///@brief BENCHMARK_MAIN, with the results also written as JSON so runs of
+/// two commits can be compared, by Google Benchmark's tools/compare.py for
+/// example. The file is <executable>.json in the working directory unless
+/// --benchmark_out names another.
+int
+main(int argc, char** argv)
+{
+  std::vector<char*> args(argv, argv + argc);
+  bool has_out = false;
+  for (int i = 1; i < argc; ++i)
+    has_out = has_out || std::strncmp(argv[i], "--benchmark_out=", 16) == 0;
+
+  std::string program = argv[0];
+  program = program.substr(program.find_last_of('/') + 1);
+  std::string out = "--benchmark_out=" + program + ".json";
+  std::string format = "--benchmark_out_format=json";
+  if (!has_out) {
+    args.push_back(out.data());
+    args.push_back(format.data());
+  }
+
+  int count = int(args.size());
+  benchmark::Initialize(&count, args.data());
+  if (benchmark::ReportUnrecognizedArguments(count, args.data()))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
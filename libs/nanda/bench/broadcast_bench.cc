@@ -0,0 +1,95 @@
+#include <benchmark/benchmark.h>
+
+#include "nanda/broadcast.hh"
+#include "nanda/ndarray.hh"
+#include "nanda/simd.hh"
+
+using namespace nanda;
+
+namespace {
+
+using matrix = dextents<index_type, 2>;
+
+matrix
+square(benchmark::State& state)
+{
+  const auto n = index_type(state.range(0));
+  return matrix{ n, n };
+}
+
+///@brief The operand of extents 'small' expanded to a full array first, the
+/// pattern broadcasting replaces
+void
+expanded(benchmark::State& state, const matrix& small)
+{
+  const auto ext = square(state);
+  ndarray<float, matrix> a(ext, 1.0f), b(small, 2.0f), out(ext);
+
+  for (auto _ : state) {
+    ndarray<float, matrix> full(ext);
+    copy(broadcast_to(b, ext), full.view());
+    simd::add(a, full, out);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(ext.size()));
+}
+
+void
+broadcast(benchmark::State& state, const matrix& small)
+{
+  const auto ext = square(state);
+  ndarray<float, matrix> a(ext, 1.0f), b(small, 2.0f), out(ext);
+
+  for (auto _ : state) {
+    simd::add(a, b, out);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(ext.size()));
+}
+
+void
+BM_ExpandedRow(benchmark::State& state)
+{
+  expanded(state, matrix{ 1, index_type(state.range(0)) });
+}
+
+void
+BM_BroadcastRow(benchmark::State& state)
+{
+  broadcast(state, matrix{ 1, index_type(state.range(0)) });
+}
+
+void
+BM_ExpandedColumn(benchmark::State& state)
+{
+  expanded(state, matrix{ index_type(state.range(0)), 1 });
+}
+
+void
+BM_BroadcastColumn(benchmark::State& state)
+{
+  broadcast(state, matrix{ index_type(state.range(0)), 1 });
+}
+
+///@brief The same through the expression templates, evaluated index by index
+void
+BM_ExpressionRow(benchmark::State& state)
+{
+  const auto ext = square(state);
+  ndarray<float, matrix> a(ext, 1.0f), b(matrix{ 1, ext.extent(1) }, 2.0f),
+    out(ext);
+
+  for (auto _ : state) {
+    out = a + b;
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(ext.size()));
+}
+
+} // namespace
+
+BENCHMARK(BM_ExpandedRow)->Arg(256)->Arg(2048);
+BENCHMARK(BM_BroadcastRow)->Arg(256)->Arg(2048);
+BENCHMARK(BM_ExpandedColumn)->Arg(256)->Arg(2048);
+BENCHMARK(BM_BroadcastColumn)->Arg(256)->Arg(2048);
+BENCHMARK(BM_ExpressionRow)->Arg(256)->Arg(2048);
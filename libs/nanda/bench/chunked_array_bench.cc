@@ -0,0 +1,153 @@
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <filesystem>
+#include <random>
+#include <string>
+
+#include "nanda/chunked_array.hh"
+#include "nanda/ndarray.hh"
+
+using namespace nanda;
+
+namespace {
+
+using cube = dextents<index_type, 3>;
+
+constexpr index_type side = 256;
+constexpr index_type chunk_side = 64;
+
+std::filesystem::path
+temp_dir(const std::string& name)
+{
+  const auto dir = std::filesystem::temp_directory_path() /
+                   ("nanda_chunked_bench_" + std::to_string(::getpid()) +
+                    "_" + name);
+  std::filesystem::remove_all(dir);
+  return dir;
+}
+
+///@brief 64 MiB of a smooth field, compressible as simulation output is
+const ndarray<float, cube>&
+field()
+{
+  static const ndarray<float, cube> arr = [] {
+    ndarray<float, cube> a(cube{ side, side, side });
+    detail::for_each_index(a.extents(), [&](const auto& idx) {
+      a(idx) = std::sin(0.05f * float(idx[0])) *
+                 std::cos(0.03f * float(idx[1])) +
+               0.001f * float(idx[2]);
+    });
+    return a;
+  }();
+  return arr;
+}
+
+chunk_options
+options_of(benchmark::State& state)
+{
+  return { chunk_codec(state.range(0)), 1, false, state.range(1) != 0 };
+}
+
+std::uintmax_t
+directory_bytes(const std::filesystem::path& dir)
+{
+  std::uintmax_t bytes = 0;
+  for (const auto& entry : std::filesystem::directory_iterator(dir))
+    bytes += entry.file_size();
+  return bytes;
+}
+
+///@brief The whole field written chunk by chunk, codec and shuffle of the
+/// arguments
+void
+BM_WriteChunked(benchmark::State& state)
+{
+  if (!codec_available(chunk_codec(state.range(0)))) {
+    state.SkipWithError("codec not built");
+    return;
+  }
+  const auto& arr = field();
+  const auto dir = temp_dir("write");
+  double ratio = 0;
+  for (auto _ : state) {
+    std::filesystem::remove_all(dir);
+    chunked_array<float, 3> store(dir,
+                                  arr.extents(),
+                                  cube{ chunk_side, chunk_side, chunk_side },
+                                  options_of(state));
+    store.write({ 0, 0, 0 }, arr);
+    store.flush();
+    ratio = double(arr.size() * sizeof(float)) / double(directory_bytes(dir));
+  }
+  std::filesystem::remove_all(dir);
+  state.counters["ratio"] = ratio;
+  state.SetBytesProcessed(state.iterations() * int64_t(arr.size()) * 4);
+}
+
+///@brief The whole field read back from a cold cache
+void
+BM_ReadChunked(benchmark::State& state)
+{
+  if (!codec_available(chunk_codec(state.range(0)))) {
+    state.SkipWithError("codec not built");
+    return;
+  }
+  const auto& arr = field();
+  const auto dir = temp_dir("read");
+  {
+    chunked_array<float, 3> store(dir,
+                                  arr.extents(),
+                                  cube{ chunk_side, chunk_side, chunk_side },
+                                  options_of(state));
+    store.write({ 0, 0, 0 }, arr);
+  }
+  ndarray<float, cube> out(arr.extents());
+  for (auto _ : state) {
+    chunked_array<float, 3> store(dir, 0);
+    store.read({ 0, 0, 0 }, out);
+    benchmark::DoNotOptimize(out(side - 1, side - 1, side - 1));
+  }
+  std::filesystem::remove_all(dir);
+  state.SetBytesProcessed(state.iterations() * int64_t(arr.size()) * 4);
+}
+
+///@brief Random 32^3 boxes, from the files or from a cache holding the field
+void
+BM_RandomBoxes(benchmark::State& state)
+{
+  const auto& arr = field();
+  const auto dir = temp_dir("boxes");
+  const std::size_t cache = state.range(0) ? default_chunk_cache : 0;
+  chunked_array<float, 3> store(dir,
+                                arr.extents(),
+                                cube{ chunk_side, chunk_side, chunk_side },
+                                {},
+                                cache);
+  store.write({ 0, 0, 0 }, arr);
+  store.flush();
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<index_type> pick(0, side - 32);
+  ndarray<float, cube> box(cube{ 32, 32, 32 });
+  for (auto _ : state) {
+    store.read({ pick(rng), pick(rng), pick(rng) }, box);
+    benchmark::DoNotOptimize(box(0, 0, 0));
+  }
+  std::filesystem::remove_all(dir);
+  state.SetBytesProcessed(state.iterations() * int64_t(box.size()) * 4);
+}
+
+} // namespace
+
+BENCHMARK(BM_WriteChunked)
+  ->Args({ int(chunk_codec::none), 0 })
+  ->Args({ int(chunk_codec::lz4), 0 })
+  ->Args({ int(chunk_codec::lz4), 1 })
+  ->Args({ int(chunk_codec::zstd), 1 })
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ReadChunked)
+  ->Args({ int(chunk_codec::none), 0 })
+  ->Args({ int(chunk_codec::lz4), 1 })
+  ->Args({ int(chunk_codec::zstd), 1 })
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_RandomBoxes)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
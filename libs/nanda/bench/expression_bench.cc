@@ -0,0 +1,82 @@
+#include <benchmark/benchmark.h>
+
+#include "nanda/ndarray.hh"
+
+using namespace nanda;
+
+namespace {
+
+using vector = dextents<index_type, 1>;
+using array = ndarray<float, vector>;
+
+struct operands
+{
+  explicit operands(index_type n)
+    : a(vector{ n }, 1.5f)
+    , b(vector{ n }, 2.0f)
+    , c(vector{ n }, 0.5f)
+    , d(vector{ n }, 3.0f)
+    , e(vector{ n }, 1.0f)
+    , out(vector{ n })
+  {}
+
+  array a, b, c, d, e, out;
+};
+
+///@brief out = a*b + c*d - e written as one loop by hand, the reference
+void
+BM_HandLoop(benchmark::State& state)
+{
+  operands x(index_type(state.range(0)));
+  const float *a = x.a.data(), *b = x.b.data(), *c = x.c.data(),
+              *d = x.d.data(), *e = x.e.data();
+  float* out = x.out.data();
+  const std::size_t n = x.out.size();
+
+  for (auto _ : state) {
+    for (std::size_t k = 0; k < n; ++k)
+      out[k] = a[k] * b[k] + c[k] * d[k] - e[k];
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(n));
+}
+
+///@brief One loop and one temporary array per operation
+void
+BM_Temporaries(benchmark::State& state)
+{
+  operands x(index_type(state.range(0)));
+  const std::size_t n = x.out.size();
+
+  for (auto _ : state) {
+    array ab(x.a.extents()), cd(x.a.extents());
+    for (std::size_t k = 0; k < n; ++k)
+      ab[index_type(k)] = x.a[index_type(k)] * x.b[index_type(k)];
+    for (std::size_t k = 0; k < n; ++k)
+      cd[index_type(k)] = x.c[index_type(k)] * x.d[index_type(k)];
+    for (std::size_t k = 0; k < n; ++k)
+      ab[index_type(k)] += cd[index_type(k)];
+    for (std::size_t k = 0; k < n; ++k)
+      x.out[index_type(k)] = ab[index_type(k)] - x.e[index_type(k)];
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(n));
+}
+
+void
+BM_Expression(benchmark::State& state)
+{
+  operands x(index_type(state.range(0)));
+
+  for (auto _ : state) {
+    x.out = x.a * x.b + x.c * x.d - x.e;
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(x.out.size()));
+}
+
+} // namespace
+
+BENCHMARK(BM_HandLoop)->RangeMultiplier(16)->Range(1 << 12, 1 << 24);
+BENCHMARK(BM_Temporaries)->RangeMultiplier(16)->Range(1 << 12, 1 << 24);
+BENCHMARK(BM_Expression)->RangeMultiplier(16)->Range(1 << 12, 1 << 24);
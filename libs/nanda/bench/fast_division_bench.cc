@@ -0,0 +1,93 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+#include "nanda/fast_division.hh"
+
+using namespace nanda;
+
+namespace {
+
+using dimension = std::array<size_type, 3>;
+using position = std::array<index_type, 3>;
+
+// taken from the benchmark arguments so the shifts are not compile time
+// constants, which would let the compiler replace the division itself
+dimension
+shape(benchmark::State& state)
+{
+  return { size_type(state.range(1)),
+           size_type(state.range(2)),
+           size_type(state.range(3)) };
+}
+
+std::vector<index_type>
+random_indices(std::size_t n, const dimension& dim)
+{
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<index_type> dist(
+    0, index_type(dim[0] * dim[1] * dim[2]) - 1);
+  std::vector<index_type> idx(n);
+  for (auto& i : idx)
+    i = dist(gen);
+  return idx;
+}
+
+void
+BM_RandomUnflatten(benchmark::State& state)
+{
+  auto dim = shape(state);
+  auto idx = random_indices(std::size_t(state.range(0)), dim);
+  auto shifts = get_shifts<StorageOrder::RowMajor>(dim);
+
+  for (auto _ : state) {
+    index_type sum = 0;
+    for (auto i : idx) {
+      auto md = fast_unflatten<StorageOrder::RowMajor>(i, dim, shifts);
+      sum += md[0] + md[1] + md[2];
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(idx.size()));
+}
+
+void
+BM_RandomUnflattener(benchmark::State& state)
+{
+  auto dim = shape(state);
+  auto idx = random_indices(std::size_t(state.range(0)), dim);
+  auto fast = make_unflattener<StorageOrder::RowMajor>(dim);
+
+  for (auto _ : state) {
+    index_type sum = 0;
+    for (auto i : idx) {
+      auto md = fast(i);
+      sum += md[0] + md[1] + md[2];
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(idx.size()));
+}
+
+void
+BM_BatchedUnflattener(benchmark::State& state)
+{
+  auto dim = shape(state);
+  auto idx = random_indices(std::size_t(state.range(0)), dim);
+  std::vector<position> out(idx.size());
+  auto fast = make_unflattener<StorageOrder::RowMajor>(dim);
+
+  for (auto _ : state) {
+    fast(span<const index_type>(idx), span<position>(out));
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(idx.size()));
+}
+
+} // namespace
+
+BENCHMARK(BM_RandomUnflatten)->Args({ 1 << 16, 97, 113, 127 });
+BENCHMARK(BM_RandomUnflattener)->Args({ 1 << 16, 97, 113, 127 });
+BENCHMARK(BM_BatchedUnflattener)->Args({ 1 << 16, 97, 113, 127 });
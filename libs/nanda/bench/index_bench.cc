@@ -0,0 +1,330 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <vector>
+
+#include "nanda/index_algos.hh"
+#include "nanda/layouts.hh"
+#include "nanda/ndspan.hh"
+#include "nanda/span.hh"
+
+using namespace nanda;
+
+namespace {
+
+template<std::size_t N>
+using dimension = std::array<index_type, N>;
+
+///@brief About 2^18 points for every rank, 2 MiB of doubles, so the index
+/// arithmetic rather than the memory decides
+template<std::size_t N>
+constexpr dimension<N>
+dims_of_rank()
+{
+  constexpr index_type sides[] = { 0, 262144, 512, 64, 24, 12, 8 };
+  dimension<N> dims{};
+  for (auto& d : dims)
+    d = sides[N];
+  return dims;
+}
+
+template<std::size_t N>
+index_type
+points(const dimension<N>& dims)
+{
+  index_type size = 1;
+  for (auto d : dims)
+    size *= d;
+  return size;
+}
+
+///@brief Steps 'idx' to the next point in the storage order, false past the
+/// last
+template<StorageOrder storage, std::size_t N>
+bool
+next_index(dimension<N>& idx, const dimension<N>& dims)
+{
+  for (std::size_t r = 0; r < N; ++r) {
+    const std::size_t d = storage == StorageOrder::RowMajor ? N - 1 - r : r;
+    if (++idx[d] < dims[d])
+      return true;
+    idx[d] = 0;
+  }
+  return false;
+}
+
+template<StorageOrder storage>
+using layout_of = std::conditional_t<storage == StorageOrder::RowMajor,
+                                     layout_right,
+                                     layout_left>;
+
+///@brief The baseline of the flatten cases: the walk over the points alone
+template<std::size_t N, StorageOrder storage>
+void
+BM_Walk(benchmark::State& state)
+{
+  const auto dims = dims_of_rank<N>();
+  for (auto _ : state) {
+    dimension<N> idx{};
+    index_type sum = 0;
+    do
+      sum += idx[0];
+    while (next_index<storage>(idx, dims));
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * points(dims));
+}
+
+template<std::size_t N, StorageOrder storage>
+void
+BM_GetShifts(benchmark::State& state)
+{
+  auto dims = dims_of_rank<N>();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(dims);
+    benchmark::DoNotOptimize(get_shifts<storage>(dims));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+template<std::size_t N, StorageOrder storage>
+void
+BM_Flatten(benchmark::State& state)
+{
+  const auto dims = dims_of_rank<N>();
+  for (auto _ : state) {
+    dimension<N> idx{};
+    index_type sum = 0;
+    do
+      sum += flatten<storage>(idx, dims);
+    while (next_index<storage>(idx, dims));
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * points(dims));
+}
+
+template<std::size_t N, StorageOrder storage>
+void
+BM_FastFlatten(benchmark::State& state)
+{
+  const auto dims = dims_of_rank<N>();
+  const auto shifts = get_shifts<storage>(dims);
+  for (auto _ : state) {
+    dimension<N> idx{};
+    index_type sum = 0;
+    do
+      sum += fast_flatten(idx, dims, shifts);
+    while (next_index<storage>(idx, dims));
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * points(dims));
+}
+
+template<std::size_t N, StorageOrder storage>
+void
+BM_Unflatten(benchmark::State& state)
+{
+  const auto dims = dims_of_rank<N>();
+  const index_type size = points(dims);
+  for (auto _ : state) {
+    index_type sum = 0;
+    for (index_type i = 0; i < size; ++i)
+      sum += unflatten<storage>(i, dims)[N - 1];
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * size);
+}
+
+template<std::size_t N, StorageOrder storage>
+void
+BM_FastUnflatten(benchmark::State& state)
+{
+  const auto dims = dims_of_rank<N>();
+  const auto shifts = get_shifts<storage>(dims);
+  const index_type size = points(dims);
+  for (auto _ : state) {
+    index_type sum = 0;
+    for (index_type i = 0; i < size; ++i)
+      sum += fast_unflatten<storage>(i, dims, shifts)[N - 1];
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * size);
+}
+
+///@brief A gather over a D0 x D1 x D2 row-major volume, the index arithmetic
+/// written out by hand
+template<index_type D0, index_type D1, index_type D2>
+void
+BM_HandWrittenIndex(benchmark::State& state)
+{
+  std::vector<index_type> data(D0 * D1 * D2, 1);
+  const index_type* p = data.data();
+  for (auto _ : state) {
+    index_type sum = 0;
+    for (index_type i = 0; i < D0; ++i)
+      for (index_type j = 0; j < D1; ++j)
+        for (index_type k = 0; k < D2; ++k)
+          sum += p[(i * D1 + j) * D2 + k];
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * D0 * D1 * D2);
+}
+
+///@brief The same gather through flatten of the runtime shape
+template<index_type D0, index_type D1, index_type D2>
+void
+BM_RuntimeShapeIndex(benchmark::State& state)
+{
+  std::vector<index_type> data(D0 * D1 * D2, 1);
+  const index_type* p = data.data();
+  std::array<size_type, 3> dims{ D0, D1, D2 };
+  benchmark::DoNotOptimize(dims);
+  for (auto _ : state) {
+    index_type sum = 0;
+    for (index_type i = 0; i < D0; ++i)
+      for (index_type j = 0; j < D1; ++j)
+        for (index_type k = 0; k < D2; ++k)
+          sum += p[flatten<StorageOrder::RowMajor>(std::array{ i, j, k },
+                                                   dims)];
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * D0 * D1 * D2);
+}
+
+///@brief The same gather through flatten of the compile-time shape
+template<index_type D0, index_type D1, index_type D2>
+void
+BM_StaticShapeIndex(benchmark::State& state)
+{
+  std::vector<index_type> data(D0 * D1 * D2, 1);
+  const index_type* p = data.data();
+  for (auto _ : state) {
+    index_type sum = 0;
+    for (index_type i = 0; i < D0; ++i)
+      for (index_type j = 0; j < D1; ++j)
+        for (index_type k = 0; k < D2; ++k)
+          sum += p[flatten<StorageOrder::RowMajor, D0, D1, D2>(
+            std::array{ i, j, k })];
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * D0 * D1 * D2);
+}
+
+///@brief Every element read through the view, in its storage order
+template<std::size_t N, StorageOrder storage>
+void
+BM_NdspanAccess(benchmark::State& state)
+{
+  const auto dims = dims_of_rank<N>();
+  std::vector<double> data(points(dims), 1.0);
+  const ndspan<const double, dextents<index_type, N>, layout_of<storage>>
+    view(data.data(), dextents<index_type, N>(dims));
+  for (auto _ : state) {
+    dimension<N> idx{};
+    double sum = 0;
+    do
+      sum += view(idx);
+    while (next_index<storage>(idx, dims));
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * points(dims));
+}
+
+///@brief The baseline of the view cases: one pass over a raw pointer
+void
+BM_RawPointerAccess(benchmark::State& state)
+{
+  std::vector<double> data(state.range(0), 1.0);
+  const double* p = data.data();
+  for (auto _ : state) {
+    double sum = 0;
+    for (std::size_t i = 0; i < data.size(); ++i)
+      sum += p[i];
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void
+BM_SpanAccess(benchmark::State& state)
+{
+  std::vector<double> data(state.range(0), 1.0);
+  const span<const double> s(data.data(), data.size());
+  for (auto _ : state) {
+    double sum = 0;
+    for (std::size_t i = 0; i < s.size(); ++i)
+      sum += s[i];
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+///@brief Windows of 16 elements over the data, the baseline of subspan
+void
+BM_RawPointerWindows(benchmark::State& state)
+{
+  std::vector<double> data(state.range(0), 1.0);
+  const double* p = data.data();
+  for (auto _ : state) {
+    double sum = 0;
+    for (std::size_t i = 0; i + 16 <= data.size(); ++i) {
+      const double* window = p + i;
+      sum += window[0] + window[15];
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void
+BM_Subspan(benchmark::State& state)
+{
+  std::vector<double> data(state.range(0), 1.0);
+  const span<const double> s(data.data(), data.size());
+  for (auto _ : state) {
+    double sum = 0;
+    for (std::size_t i = 0; i + 16 <= s.size(); ++i) {
+      const auto window = s.subspan(i, 16);
+      sum += window[0] + window[15];
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+} // namespace
+
+#define NANDA_INDEX_BENCHMARK(name)                                            \
+  BENCHMARK_TEMPLATE(name, 1, StorageOrder::RowMajor);                         \
+  BENCHMARK_TEMPLATE(name, 1, StorageOrder::ColMajor);                         \
+  BENCHMARK_TEMPLATE(name, 2, StorageOrder::RowMajor);                         \
+  BENCHMARK_TEMPLATE(name, 2, StorageOrder::ColMajor);                         \
+  BENCHMARK_TEMPLATE(name, 3, StorageOrder::RowMajor);                         \
+  BENCHMARK_TEMPLATE(name, 3, StorageOrder::ColMajor);                         \
+  BENCHMARK_TEMPLATE(name, 4, StorageOrder::RowMajor);                         \
+  BENCHMARK_TEMPLATE(name, 4, StorageOrder::ColMajor);                         \
+  BENCHMARK_TEMPLATE(name, 5, StorageOrder::RowMajor);                         \
+  BENCHMARK_TEMPLATE(name, 5, StorageOrder::ColMajor);                         \
+  BENCHMARK_TEMPLATE(name, 6, StorageOrder::RowMajor);                         \
+  BENCHMARK_TEMPLATE(name, 6, StorageOrder::ColMajor)
+
+NANDA_INDEX_BENCHMARK(BM_Walk);
+NANDA_INDEX_BENCHMARK(BM_GetShifts);
+NANDA_INDEX_BENCHMARK(BM_Flatten);
+NANDA_INDEX_BENCHMARK(BM_FastFlatten);
+NANDA_INDEX_BENCHMARK(BM_Unflatten);
+NANDA_INDEX_BENCHMARK(BM_FastUnflatten);
+NANDA_INDEX_BENCHMARK(BM_NdspanAccess);
+
+// a power of two shape, where the multiplies become shifts, and another
+BENCHMARK_TEMPLATE(BM_HandWrittenIndex, 64, 64, 64);
+BENCHMARK_TEMPLATE(BM_RuntimeShapeIndex, 64, 64, 64);
+BENCHMARK_TEMPLATE(BM_StaticShapeIndex, 64, 64, 64);
+BENCHMARK_TEMPLATE(BM_HandWrittenIndex, 60, 60, 60);
+BENCHMARK_TEMPLATE(BM_RuntimeShapeIndex, 60, 60, 60);
+BENCHMARK_TEMPLATE(BM_StaticShapeIndex, 60, 60, 60);
+
+BENCHMARK(BM_RawPointerAccess)->Arg(1 << 18);
+BENCHMARK(BM_SpanAccess)->Arg(1 << 18);
+BENCHMARK(BM_RawPointerWindows)->Arg(1 << 18);
+BENCHMARK(BM_Subspan)->Arg(1 << 18);
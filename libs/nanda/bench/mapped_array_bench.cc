@@ -0,0 +1,85 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <string>
+
+#include "nanda/mapped_array.hh"
+#include "nanda/ndarray.hh"
+
+using namespace nanda;
+
+namespace {
+
+using matrix = dextents<index_type, 2>;
+
+constexpr index_type side = 8192;
+
+///@brief A 256 MiB file of floats, written once
+const std::string&
+data_file()
+{
+  static const std::string path = [] {
+    const auto p = std::filesystem::temp_directory_path() /
+                   ("nanda_mapped_bench_" + std::to_string(::getpid()));
+    ndarray<float, matrix> arr(matrix{ side, side }, 1.0f);
+    std::ofstream out(p, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(arr.data()),
+              std::streamsize(arr.size() * sizeof(float)));
+    std::atexit([] { std::filesystem::remove(data_file()); });
+    return p.string();
+  }();
+  return path;
+}
+
+///@brief Reading the whole file into an array, the startup this replaces
+void
+BM_ReadIntoHeap(benchmark::State& state)
+{
+  const auto& path = data_file();
+  for (auto _ : state) {
+    ndarray<float, matrix> arr(matrix{ side, side });
+    std::ifstream in(path, std::ios::binary);
+    in.read(reinterpret_cast<char*>(arr.data()),
+            std::streamsize(arr.size() * sizeof(float)));
+    benchmark::DoNotOptimize(arr(side - 1, side - 1));
+  }
+  state.SetBytesProcessed(state.iterations() * int64_t(side) * side * 4);
+}
+
+///@brief Mapping the file and reading one element
+void
+BM_MapOpen(benchmark::State& state)
+{
+  const auto& path = data_file();
+  for (auto _ : state) {
+    const mapped_ndarray<const float, matrix> arr(path, matrix{ side, side });
+    benchmark::DoNotOptimize(arr(side - 1, side - 1));
+  }
+}
+
+///@brief Mapping and summing every element, sequential read-ahead or none
+void
+BM_MapSum(benchmark::State& state)
+{
+  const auto& path = data_file();
+  const auto advice = access_advice(state.range(0));
+  for (auto _ : state) {
+    const mapped_ndarray<const float, matrix> arr(path, matrix{ side, side });
+    arr.advise(advice);
+    benchmark::DoNotOptimize(
+      std::accumulate(arr.begin(), arr.end(), 0.0f));
+  }
+  state.SetBytesProcessed(state.iterations() * int64_t(side) * side * 4);
+}
+
+} // namespace
+
+BENCHMARK(BM_ReadIntoHeap)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_MapOpen)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_MapSum)
+  ->Arg(int(access_advice::sequential))
+  ->Arg(int(access_advice::random))
+  ->Unit(benchmark::kMillisecond);
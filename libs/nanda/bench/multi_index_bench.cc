@@ -0,0 +1,54 @@
+#include <benchmark/benchmark.h>
+
+#include "nanda/multi_index.hh"
+
+using namespace nanda;
+
+namespace {
+
+using dimension = std::array<size_type, 3>;
+
+dimension
+cube(benchmark::State& state)
+{
+  auto n = size_type(state.range(0));
+  return { n, n, n };
+}
+
+void
+BM_UnflattenLoop(benchmark::State& state)
+{
+  auto dim = cube(state);
+  auto size = index_type(dim[0] * dim[1] * dim[2]);
+  auto shifts = get_shifts<StorageOrder::RowMajor>(dim);
+
+  for (auto _ : state) {
+    index_type sum = 0;
+    for (index_type i = 0; i < size; ++i) {
+      auto idx = fast_unflatten<StorageOrder::RowMajor>(i, dim, shifts);
+      sum += idx[0] + idx[1] + idx[2];
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(size));
+}
+
+void
+BM_MultiIndexRange(benchmark::State& state)
+{
+  auto dim = cube(state);
+  auto range = multi_indices<StorageOrder::RowMajor>(dim);
+
+  for (auto _ : state) {
+    index_type sum = 0;
+    for (const auto& md : range)
+      sum += md.index[0] + md.index[1] + md.index[2];
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(range.size()));
+}
+
+} // namespace
+
+BENCHMARK(BM_UnflattenLoop)->RangeMultiplier(4)->Range(16, 256);
+BENCHMARK(BM_MultiIndexRange)->RangeMultiplier(4)->Range(16, 256);
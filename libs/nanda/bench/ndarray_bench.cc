@@ -0,0 +1,104 @@
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "nanda/ndarray.hh"
+
+using namespace nanda;
+
+namespace {
+
+using dimension = dextents<index_type, 3>;
+
+dimension
+cube(benchmark::State& state)
+{
+  auto n = index_type(state.range(0));
+  return dimension{ n, n, n };
+}
+
+void
+BM_RawPointer3D(benchmark::State& state)
+{
+  auto dim = cube(state);
+  auto n = dim.extent(0);
+  ndarray<double, dimension> arr(dim, 1.0);
+  const double* p = arr.data();
+
+  for (auto _ : state) {
+    double sum = 0.0;
+    for (index_type k = 0; k < n; ++k)
+      for (index_type j = 0; j < n; ++j)
+        for (index_type i = 0; i < n; ++i)
+          sum += p[(k * n + j) * n + i];
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(arr.size()));
+}
+
+void
+BM_NdarrayAccess3D(benchmark::State& state)
+{
+  auto dim = cube(state);
+  auto n = dim.extent(0);
+  const ndarray<double, dimension> arr(dim, 1.0);
+
+  for (auto _ : state) {
+    double sum = 0.0;
+    for (index_type k = 0; k < n; ++k)
+      for (index_type j = 0; j < n; ++j)
+        for (index_type i = 0; i < n; ++i)
+          sum += arr(k, j, i);
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(arr.size()));
+}
+
+void
+BM_NdarrayAllocate(benchmark::State& state)
+{
+  auto dim = cube(state);
+  for (auto _ : state) {
+    ndarray<double, dimension> arr(dim);
+    benchmark::DoNotOptimize(arr.data());
+  }
+}
+
+///@brief Column sums of a square matrix, walking down each column. With a
+/// power of two row length every row of a column maps onto the same cache
+/// sets, the anti-aliasing pad of the padded layout spreads them out.
+template<class Layout>
+void
+BM_ColumnSum(benchmark::State& state)
+{
+  using matrix = dextents<index_type, 2>;
+  const auto n = index_type(state.range(0));
+  ndarray<float, matrix, Layout> arr(matrix{ n, n }, 1.0f);
+  const float* p = arr.data();
+  const index_type pitch = arr.mapping().stride(0);
+  std::vector<float> sums(std::size_t(n), 0.0f);
+
+  for (auto _ : state) {
+    for (index_type j = 0; j < n; ++j) {
+      float sum = 0.0f;
+      for (index_type i = 0; i < n; ++i)
+        sum += p[i * pitch + j];
+      sums[std::size_t(j)] = sum;
+    }
+    benchmark::DoNotOptimize(sums.data());
+  }
+  state.SetItemsProcessed(state.iterations() * n * n);
+}
+
+} // namespace
+
+BENCHMARK(BM_RawPointer3D)->RangeMultiplier(2)->Range(16, 128);
+BENCHMARK(BM_NdarrayAccess3D)->RangeMultiplier(2)->Range(16, 128);
+BENCHMARK(BM_NdarrayAllocate)->RangeMultiplier(2)->Range(16, 128);
+BENCHMARK_TEMPLATE(BM_ColumnSum, layout_right)->Arg(1024)->Arg(2048);
+BENCHMARK_TEMPLATE(BM_ColumnSum, layout_aligned_rows<float>)
+  ->Arg(1024)
+  ->Arg(2048);
+BENCHMARK_TEMPLATE(BM_ColumnSum, layout_aligned_rows<float, 64, 1>)
+  ->Arg(1024)
+  ->Arg(2048);
@@ -0,0 +1,137 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <string>
+
+#include "nanda/ndarray.hh"
+#include "nanda/npy.hh"
+
+using namespace nanda;
+
+namespace {
+
+using matrix = dextents<index_type, 2>;
+
+constexpr index_type side = 8192;
+
+std::string
+temp_name(const std::string& name)
+{
+  return (std::filesystem::temp_directory_path() /
+          ("nanda_npy_bench_" + std::to_string(::getpid()) + "_" + name))
+    .string();
+}
+
+///@brief A 256 MiB NPY file of floats, written once
+const std::string&
+data_file()
+{
+  static const std::string path = [] {
+    const auto p = temp_name("data.npy");
+    write_npy(p, ndarray<float, matrix>(matrix{ side, side }, 1.0f));
+    std::atexit([] { std::filesystem::remove(data_file()); });
+    return p;
+  }();
+  return path;
+}
+
+///@brief The elements read with one ifstream read, the bound for a reader
+void
+BM_IfstreamRead(benchmark::State& state)
+{
+  const auto& path = data_file();
+  const auto offset = read_npy_header(path).data_offset;
+  ndarray<float, matrix> arr(matrix{ side, side });
+  for (auto _ : state) {
+    std::ifstream in(path, std::ios::binary);
+    in.seekg(std::streamoff(offset));
+    in.read(reinterpret_cast<char*>(arr.data()),
+            std::streamsize(arr.size() * sizeof(float)));
+    benchmark::DoNotOptimize(arr(side - 1, side - 1));
+  }
+  state.SetBytesProcessed(state.iterations() * int64_t(side) * side * 4);
+}
+
+///@brief The whole file read straight into an array, in chunks of the
+/// argument in KiB
+void
+BM_ReadNpy(benchmark::State& state)
+{
+  const auto& path = data_file();
+  const auto chunk = std::size_t(state.range(0)) << 10;
+  ndarray<float, matrix> arr(matrix{ side, side });
+  for (auto _ : state) {
+    read_npy(path, arr, chunk);
+    benchmark::DoNotOptimize(arr(side - 1, side - 1));
+  }
+  state.SetBytesProcessed(state.iterations() * int64_t(side) * side * 4);
+}
+
+///@brief A box of a quarter of the columns, rows through the staging buffer
+void
+BM_ReadHyperslab(benchmark::State& state)
+{
+  const auto& path = data_file();
+  ndarray<float, matrix> box(matrix{ side, side / 4 });
+  for (auto _ : state) {
+    read_npy(path, { 0, side / 2 }, box);
+    benchmark::DoNotOptimize(box(side - 1, 0));
+  }
+  state.SetBytesProcessed(state.iterations() * int64_t(side) * side);
+}
+
+///@brief Reading and summing the file, slab after slab or overlapped
+void
+BM_SumSerial(benchmark::State& state)
+{
+  const auto& path = data_file();
+  constexpr index_type rows = 256;
+  ndarray<float, matrix> slab(matrix{ rows, side });
+  for (auto _ : state) {
+    double sum = 0;
+    for (index_type first = 0; first < side; first += rows) {
+      read_npy(path, { std::size_t(first), 0 }, slab);
+      sum += std::accumulate(slab.begin(), slab.end(), 0.0);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetBytesProcessed(state.iterations() * int64_t(side) * side * 4);
+}
+
+void
+BM_SumStreamed(benchmark::State& state)
+{
+  const auto& path = data_file();
+  for (auto _ : state) {
+    double sum = 0;
+    for_each_npy_slab<float, 2>(path, 256, [&](index_type, const auto& slab) {
+      const auto* p = slab.data();
+      sum += std::accumulate(p, p + slab.size(), 0.0);
+    });
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetBytesProcessed(state.iterations() * int64_t(side) * side * 4);
+}
+
+void
+BM_WriteNpy(benchmark::State& state)
+{
+  const auto path = temp_name("out.npy");
+  const ndarray<float, matrix> arr(matrix{ side, side }, 2.0f);
+  for (auto _ : state)
+    write_npy(path, arr);
+  std::filesystem::remove(path);
+  state.SetBytesProcessed(state.iterations() * int64_t(side) * side * 4);
+}
+
+} // namespace
+
+BENCHMARK(BM_IfstreamRead)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ReadNpy)->Arg(64)->Arg(1 << 12)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ReadHyperslab)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SumSerial)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SumStreamed)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_WriteNpy)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,115 @@
+#include <benchmark/benchmark.h>
+
+#include <thread>
+
+#include "nanda/arena.hh"
+#include "nanda/ndarray.hh"
+#include "nanda/numa.hh"
+#include "nanda/parallel_for.hh"
+
+using namespace nanda;
+
+namespace {
+
+using matrix = dextents<index_type, 2>;
+using paged_array =
+  ndarray<double, matrix, layout_right, resource_allocator<double>>;
+
+// three arrays of 128 MiB, far past the last level cache as STREAM asks
+constexpr index_type rows = 4096;
+constexpr index_type cols = 4096;
+
+enum placement
+{
+  ///@brief operator new, filled on the calling thread
+  serial,
+  ///@brief operator new, filled by the threads of the kernels
+  first_touch,
+  ///@brief Transparent huge pages, filled by the threads of the kernels
+  huge_first_touch
+};
+
+thread_pool&
+pool()
+{
+  static thread_pool threads(std::max(1u, std::thread::hardware_concurrency()));
+  return threads;
+}
+
+page_resource&
+resource_of(placement p)
+{
+  static page_resource base(huge_pages::none, std::size_t(1) << 20);
+  static page_resource huge(huge_pages::transparent, std::size_t(1) << 20);
+  return p == huge_first_touch ? huge : base;
+}
+
+///@brief Serial placement runs over the same mapped pages, so only the
+/// placement and the page size differ between the three
+paged_array
+make_array(placement p, double value)
+{
+  const resource_allocator<double> alloc(&resource_of(p));
+  if (p == serial)
+    return paged_array(matrix{ rows, cols }, value, alloc);
+  return make_first_touch(pool(), matrix{ rows, cols }, value, alloc);
+}
+
+void
+report(benchmark::State& state, const paged_array& arr)
+{
+  const auto pages = page_placement(arr);
+  state.counters["nodes"] = double(pages.pages_per_node.size());
+  state.counters["huge_MiB"] = double(pages.huge_bytes >> 20);
+  state.SetLabel(pages.to_string());
+}
+
+///@brief Allocation and first touch of one array, the page faults
+void
+BM_Allocate(benchmark::State& state)
+{
+  const auto p = placement(state.range(0));
+  for (auto _ : state) {
+    const auto arr = make_array(p, 1.0);
+    benchmark::DoNotOptimize(arr.data());
+  }
+  state.SetBytesProcessed(state.iterations() * rows * cols * 8);
+}
+
+///@brief STREAM triad a = b + s * c on the pool, blocked as parallel_for
+/// blocks the arrays
+void
+BM_Triad(benchmark::State& state)
+{
+  const auto p = placement(state.range(0));
+  auto a = make_array(p, 0.0);
+  const auto b = make_array(p, 1.0);
+  const auto c = make_array(p, 2.0);
+  double* pa = a.data();
+  const double* pb = b.data();
+  const double* pc = c.data();
+  const double s = 3.0;
+
+  for (auto _ : state) {
+    parallel_for(pool(), a.extents(), [&](const auto&, index_type offset) {
+      pa[offset] = pb[offset] + s * pc[offset];
+    });
+    benchmark::ClobberMemory();
+  }
+  report(state, a);
+  // STREAM counts the bytes read and written, not the write allocate
+  state.SetBytesProcessed(state.iterations() * rows * cols * 3 * 8);
+}
+
+} // namespace
+
+BENCHMARK(BM_Allocate)
+  ->Arg(serial)
+  ->Arg(first_touch)
+  ->Arg(huge_first_touch)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Triad)
+  ->Arg(serial)
+  ->Arg(first_touch)
+  ->Arg(huge_first_touch)
+  ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,86 @@
+#include <benchmark/benchmark.h>
+
+#include <thread>
+
+#include "nanda/multi_index.hh"
+#include "nanda/ndarray.hh"
+#include "nanda/parallel_for.hh"
+
+using namespace nanda;
+
+namespace {
+
+using dimension = dextents<index_type, 3>;
+
+constexpr index_type n = 192;
+
+///@brief Memory-light kernel, a few flops per element written
+float
+kernel(const std::array<index_type, 3>& idx)
+{
+  const float x = float(idx[0]) * 0.5f;
+  const float y = float(idx[1]) * 0.25f;
+  const float z = float(idx[2]) * 0.125f;
+  return x * y + y * z + z * x;
+}
+
+///@brief The same traversal on the calling thread only, the reference
+void
+BM_Serial(benchmark::State& state)
+{
+  ndarray<float, dimension> arr(dimension{ n, n, n });
+
+  for (auto _ : state) {
+    for (const auto& [idx, offset] :
+         multi_indices<StorageOrder::RowMajor>(arr.extents()))
+      arr[offset] = kernel(idx);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * n * n * n);
+}
+
+void
+BM_ParallelFor(benchmark::State& state)
+{
+  thread_pool pool(std::size_t(state.range(0)));
+  ndarray<float, dimension> arr(dimension{ n, n, n });
+  float* data = arr.data();
+
+  for (auto _ : state) {
+    parallel_for(pool,
+                 arr.extents(),
+                 [data](const auto& idx, index_type offset) {
+                   data[offset] = kernel(idx);
+                 });
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * n * n * n);
+}
+
+///@brief Hand-off cost, one empty block per thread and loop
+void
+BM_PoolOverhead(benchmark::State& state)
+{
+  thread_pool pool(std::size_t(state.range(0)));
+
+  for (auto _ : state)
+    pool.run(pool.size(), [](std::size_t task) {
+      benchmark::DoNotOptimize(task);
+    });
+  state.SetItemsProcessed(state.iterations());
+}
+
+void
+thread_counts(benchmark::internal::Benchmark* b)
+{
+  const int hardware = int(std::max(1u, std::thread::hardware_concurrency()));
+  for (int threads = 1; threads < hardware; threads *= 2)
+    b->Arg(threads);
+  b->Arg(hardware);
+}
+
+} // namespace
+
+BENCHMARK(BM_Serial)->UseRealTime();
+BENCHMARK(BM_ParallelFor)->Apply(thread_counts)->UseRealTime();
+BENCHMARK(BM_PoolOverhead)->Apply(thread_counts)->UseRealTime();
@@ -0,0 +1,124 @@
+#include <benchmark/benchmark.h>
+
+#include "nanda/ndarray.hh"
+#include "nanda/reduction.hh"
+
+using namespace nanda;
+
+namespace {
+
+using matrix = dextents<index_type, 2>;
+
+constexpr index_type n = 2048;
+
+ndarray<float, matrix>
+make_matrix()
+{
+  ndarray<float, matrix> arr(matrix{ n, n });
+  float x = 0.5f;
+  for (auto& v : arr) {
+    v = x;
+    x = x * 1.7f - float(int(x * 1.7f));
+  }
+  return arr;
+}
+
+///@brief Row sums written as the obvious nested loop, the reference
+void
+BM_RowSumLoop(benchmark::State& state)
+{
+  const auto arr = make_matrix();
+  ndarray<float, dextents<index_type, 1>> out(dextents<index_type, 1>{ n });
+
+  for (auto _ : state) {
+    for (index_type i = 0; i < n; ++i) {
+      float s = 0;
+      for (index_type j = 0; j < n; ++j)
+        s += arr(i, j);
+      out(i) = s;
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * n * n);
+}
+
+///@brief Column sums as the obvious nested loop, strided reads
+void
+BM_ColumnSumLoop(benchmark::State& state)
+{
+  const auto arr = make_matrix();
+  ndarray<float, dextents<index_type, 1>> out(dextents<index_type, 1>{ n });
+
+  for (auto _ : state) {
+    for (index_type j = 0; j < n; ++j) {
+      float s = 0;
+      for (index_type i = 0; i < n; ++i)
+        s += arr(i, j);
+      out(j) = s;
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * n * n);
+}
+
+///@brief sum() along axis 0 (column-wise), 1 (contiguous runs) or both
+template<std::size_t... Axes>
+void
+BM_Sum(benchmark::State& state)
+{
+  const auto arr = make_matrix();
+  const auto mode = summation(state.range(0));
+
+  for (auto _ : state) {
+    auto out = sum(arr, axes<Axes...>, mode);
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * n * n);
+}
+
+template<std::size_t Axis>
+void
+BM_Max(benchmark::State& state)
+{
+  const auto arr = make_matrix();
+
+  for (auto _ : state) {
+    auto out = amax(arr, Axis);
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * n * n);
+}
+
+template<std::size_t Axis>
+void
+BM_Argmax(benchmark::State& state)
+{
+  const auto arr = make_matrix();
+
+  for (auto _ : state) {
+    auto out = argmax(arr, Axis);
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * n * n);
+}
+
+void
+modes(benchmark::internal::Benchmark* b)
+{
+  b->ArgName("mode");
+  for (auto mode :
+       { summation::naive, summation::pairwise, summation::kahan })
+    b->Arg(int(mode));
+}
+
+} // namespace
+
+BENCHMARK(BM_RowSumLoop);
+BENCHMARK(BM_ColumnSumLoop);
+BENCHMARK_TEMPLATE(BM_Sum, 1)->Apply(modes)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Sum, 0)->Apply(modes)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Sum, 0, 1)->Apply(modes)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Max, 1)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Max, 0)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Argmax, 1)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Argmax, 0)->UseRealTime();
@@ -0,0 +1,144 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+#include "nanda/memory.hh"
+#include "nanda/simd.hh"
+
+using namespace nanda;
+
+namespace {
+
+// one element off the alignment of the buffers, so that every kernel also
+// runs its head and tail
+constexpr std::size_t offset = 1;
+
+template<class T>
+struct operand
+{
+  explicit operand(std::size_t n, T value)
+    : buffer(n + offset, value)
+  {}
+
+  span<T> elements()
+  {
+    return { buffer.data() + offset, buffer.size() - offset };
+  }
+
+  aligned_buffer<T> buffer;
+};
+
+bool
+select_isa(benchmark::State& state, simd_isa isa)
+{
+  if (!simd_isa_supported(isa)) {
+    state.SkipWithError("instruction set not supported");
+    return false;
+  }
+  return true;
+}
+
+///@brief The loop the kernels replace: span::operator[] and whatever the
+/// compiler makes of it
+void
+BM_AddLoop(benchmark::State& state)
+{
+  const auto n = std::size_t(state.range(0));
+  operand<float> a(n, 1.0f), b(n, 2.0f), out(n, 0.0f);
+  span<float> sa = a.elements(), sb = b.elements(), so = out.elements();
+
+  for (auto _ : state) {
+    for (std::size_t k = 0; k < n; ++k)
+      so[k] = sa[k] + sb[k];
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(n));
+}
+
+template<simd_isa Isa>
+void
+BM_Add(benchmark::State& state)
+{
+  if (!select_isa(state, Isa))
+    return;
+  const auto n = std::size_t(state.range(0));
+  operand<float> a(n, 1.0f), b(n, 2.0f), out(n, 0.0f);
+
+  for (auto _ : state) {
+    simd::add(a.elements(), b.elements(), out.elements(), Isa);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(n));
+}
+
+template<simd_isa Isa>
+void
+BM_Fma(benchmark::State& state)
+{
+  if (!select_isa(state, Isa))
+    return;
+  const auto n = std::size_t(state.range(0));
+  operand<double> a(n, 1.0), b(n, 2.0), c(n, 0.5), out(n, 0.0);
+
+  for (auto _ : state) {
+    simd::fma(a.elements(), b.elements(), c.elements(), out.elements(), Isa);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(n));
+}
+
+template<simd_isa Isa>
+void
+BM_Select(benchmark::State& state)
+{
+  if (!select_isa(state, Isa))
+    return;
+  const auto n = std::size_t(state.range(0));
+  operand<std::int32_t> a(n, 1), b(n, 2), out(n, 0);
+  // alternate the outcome so that a branchy loop cannot predict it
+  for (std::size_t k = 0; k < n; k += 3)
+    a.elements()[k] = 5;
+
+  for (auto _ : state) {
+    simd::select<simd_cmp::lt>(a.elements(),
+                               b.elements(),
+                               a.elements(),
+                               b.elements(),
+                               out.elements(),
+                               Isa);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(n));
+}
+
+template<simd_isa Isa>
+void
+BM_Cast(benchmark::State& state)
+{
+  if (!select_isa(state, Isa))
+    return;
+  const auto n = std::size_t(state.range(0));
+  operand<float> in(n, 3.7f);
+  operand<std::int32_t> out(n, 0);
+
+  for (auto _ : state) {
+    simd::cast(in.elements(), out.elements(), Isa);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(n));
+}
+
+} // namespace
+
+// 4K elements stay in L1, 4M go to memory
+#define NANDA_SIMD_BENCHMARK(kernel)                                           \
+  BENCHMARK_TEMPLATE(kernel, simd_isa::scalar)->Arg(1 << 12)->Arg(1 << 22);    \
+  BENCHMARK_TEMPLATE(kernel, simd_isa::sse2)->Arg(1 << 12)->Arg(1 << 22);      \
+  BENCHMARK_TEMPLATE(kernel, simd_isa::avx2)->Arg(1 << 12)->Arg(1 << 22);      \
+  BENCHMARK_TEMPLATE(kernel, simd_isa::avx512)->Arg(1 << 12)->Arg(1 << 22)
+
+BENCHMARK(BM_AddLoop)->Arg(1 << 12)->Arg(1 << 22);
+NANDA_SIMD_BENCHMARK(BM_Add);
+NANDA_SIMD_BENCHMARK(BM_Fma);
+NANDA_SIMD_BENCHMARK(BM_Select);
+NANDA_SIMD_BENCHMARK(BM_Cast);
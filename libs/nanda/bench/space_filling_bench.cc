@@ -0,0 +1,132 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+#include "nanda/ndarray.hh"
+#include "nanda/space_filling.hh"
+
+using namespace nanda;
+
+namespace {
+
+using dimension = dextents<index_type, 3>;
+using position = std::array<index_type, 3>;
+
+dimension
+cube(benchmark::State& state)
+{
+  auto n = index_type(state.range(0));
+  return dimension{ n, n, n };
+}
+
+// row-major neighbours are plain stride steps, the curve layouts use their
+// step helpers
+template<class Mapping>
+index_type
+neighbour(const Mapping& map, index_type offset, std::size_t r, index_type d)
+{
+  if constexpr (std::is_same_v<typename Mapping::layout_type, layout_right>)
+    return offset + d * map.stride(r);
+  else
+    return map.step(offset, r, d);
+}
+
+///@brief Sum of the six face neighbours of every interior cell, the cells
+/// visited in the memory order of the layout
+template<class Layout>
+void
+BM_NeighbourGather(benchmark::State& state)
+{
+  ndarray<float, dimension, Layout> arr(cube(state), 1.0f);
+  const auto& map = arr.mapping();
+  const float* data = arr.data();
+  const index_type n = arr.extent(0);
+
+  // interior cells in memory order, with their offsets
+  std::vector<index_type> cells;
+  for (index_type offset = 0; offset < map.required_span_size(); ++offset) {
+    position idx;
+    if constexpr (std::is_same_v<Layout, layout_right>) {
+      idx = unflatten<StorageOrder::RowMajor>(offset, arr.extents());
+    } else {
+      idx = map.unflatten(offset);
+    }
+    bool interior = true;
+    for (auto i : idx)
+      interior = interior && i > 0 && i < n - 1;
+    if (interior)
+      cells.push_back(offset);
+  }
+
+  for (auto _ : state) {
+    float sum = 0;
+    for (auto offset : cells)
+      for (std::size_t r = 0; r < 3; ++r)
+        sum += data[neighbour(map, offset, r, 1)] +
+               data[neighbour(map, offset, r, -1)];
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(cells.size()) * 6);
+}
+
+///@brief Independent random walks through the volume, one face neighbour
+/// per step like a ray marcher or particle tracer
+template<class Layout>
+void
+BM_RandomWalk(benchmark::State& state)
+{
+  ndarray<float, dimension, Layout> arr(cube(state), 1.0f);
+  const auto& map = arr.mapping();
+  const float* data = arr.data();
+  const index_type n = arr.extent(0);
+
+  constexpr int walkers = 256;
+  constexpr int steps = 1024;
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> dir(0, 5);
+  std::uniform_int_distribution<index_type> coord(0, n - 1);
+  std::vector<int> moves(walkers * steps);
+  for (auto& m : moves)
+    m = dir(rng);
+  std::array<position, walkers> start;
+  for (auto& s : start)
+    s = { coord(rng), coord(rng), coord(rng) };
+
+  for (auto _ : state) {
+    std::array<position, walkers> idx = start;
+    std::array<index_type, walkers> offset;
+    for (int w = 0; w < walkers; ++w)
+      offset[w] = map(idx[w]);
+
+    float sum = 0;
+    for (int s = 0; s < steps; ++s) {
+      for (int w = 0; w < walkers; ++w) {
+        const int m = moves[s * walkers + w];
+        const std::size_t r = std::size_t(m >> 1);
+        // computed rather than selected, a branch on the random sign would
+        // dominate the step
+        const index_type d = 2 * (m & 1) - 1;
+        // reflect at the boundary
+        if (idx[w][r] + d < 0 || idx[w][r] + d >= n)
+          continue;
+        idx[w][r] += d;
+        offset[w] = neighbour(map, offset[w], r, d);
+        sum += data[offset[w]];
+      }
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * walkers * steps);
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_NeighbourGather, layout_right)->Arg(64)->Arg(256);
+BENCHMARK_TEMPLATE(BM_NeighbourGather, layout_morton)->Arg(64)->Arg(256);
+// every Hilbert step decodes and encodes, a 256^3 sweep takes seconds
+BENCHMARK_TEMPLATE(BM_NeighbourGather, layout_hilbert)->Arg(64);
+
+BENCHMARK_TEMPLATE(BM_RandomWalk, layout_right)->Arg(64)->Arg(256);
+BENCHMARK_TEMPLATE(BM_RandomWalk, layout_morton)->Arg(64)->Arg(256);
+BENCHMARK_TEMPLATE(BM_RandomWalk, layout_hilbert)->Arg(64)->Arg(256);
@@ -0,0 +1,124 @@
+#include <benchmark/benchmark.h>
+
+#include <utility>
+
+#include "nanda/index_algos.hh"
+#include "nanda/ndarray.hh"
+#include "nanda/stencil.hh"
+
+using namespace nanda;
+
+namespace {
+
+using cube = dextents<index_type, 3>;
+
+// two grids of 128 MiB, far past the last level cache
+constexpr index_type n = 256;
+constexpr int steps = 8;
+
+///@brief Explicit heat equation step, the 7-point Jacobi update
+struct heat
+{
+  template<class P>
+  double operator()(const P& p) const
+  {
+    return 0.4 * p.center() +
+           0.1 * (p(-1, 0, 0) + p(1, 0, 0) + p(0, -1, 0) + p(0, 1, 0) +
+                  p(0, 0, -1) + p(0, 0, 1));
+  }
+};
+
+///@brief 27-point smoothing
+struct smooth
+{
+  template<class P>
+  double operator()(const P& p) const
+  {
+    double sum = 0;
+    for (int i = -1; i <= 1; ++i)
+      for (int j = -1; j <= 1; ++j)
+        for (int k = -1; k <= 1; ++k)
+          sum += p(i, j, k);
+    return sum * (1.0 / 27.0);
+  }
+};
+
+///@brief The same steps written by hand over flat indices: a grid with one
+/// ghost layer, periodic faces copied before every sweep
+void
+BM_HandWritten7(benchmark::State& state)
+{
+  constexpr index_type m = n + 2;
+  const std::array<index_type, 3> dims{ m, m, m };
+  const auto shifts = get_shifts<StorageOrder::RowMajor>(dims);
+  const auto at = [&](index_type i, index_type j, index_type k) {
+    return flatten<StorageOrder::RowMajor>(std::array{ i, j, k }, dims);
+  };
+  ndarray<double, cube> a(cube{ m, m, m }, 1.0);
+  ndarray<double, cube> b(cube{ m, m, m }, 1.0);
+  a(n / 2, n / 2, n / 2) = 1000.0;
+
+  for (auto _ : state) {
+    for (int s = 0; s < steps; ++s) {
+      double* u = a.data();
+      double* v = b.data();
+      for (index_type i = 0; i < m; ++i)
+        for (index_type j = 0; j < m; ++j) {
+          u[at(i, j, 0)] = u[at(i, j, n)];
+          u[at(i, j, n + 1)] = u[at(i, j, 1)];
+          u[at(i, 0, j)] = u[at(i, n, j)];
+          u[at(i, n + 1, j)] = u[at(i, 1, j)];
+          u[at(0, i, j)] = u[at(n, i, j)];
+          u[at(n + 1, i, j)] = u[at(1, i, j)];
+        }
+      for (index_type i = 1; i <= n; ++i)
+        for (index_type j = 1; j <= n; ++j)
+          for (index_type k = 1; k <= n; ++k) {
+            const index_type c =
+              fast_flatten(std::array{ i, j, k }, dims, shifts);
+            v[c] = 0.4 * u[c] +
+                   0.1 * (u[c - shifts[0]] + u[c + shifts[0]] +
+                          u[c - shifts[1]] + u[c + shifts[1]] + u[c - 1] +
+                          u[c + 1]);
+          }
+      std::swap(a, b);
+    }
+    benchmark::DoNotOptimize(a(n / 2, n / 2, n / 2));
+  }
+  state.SetItemsProcessed(state.iterations() * steps * n * n * n);
+}
+
+///@brief The engine, time block of the argument
+template<class Shape, class F>
+void
+BM_Stencil(benchmark::State& state)
+{
+  stencil_grid<double, Shape> grid(cube{ n, n, n },
+                                   boundary::periodic,
+                                   0.0,
+                                   { 0, index_type(state.range(0)) });
+  auto field = grid.field();
+  detail::for_each_index(field.extents(), [&](const auto& idx) {
+    field(idx) = 1.0;
+  });
+  field(n / 2, n / 2, n / 2) = 1000.0;
+
+  for (auto _ : state) {
+    grid.run(steps, F{});
+    benchmark::DoNotOptimize(grid.field()(n / 2, n / 2, n / 2));
+  }
+  state.SetItemsProcessed(state.iterations() * steps * n * n * n);
+}
+
+} // namespace
+
+BENCHMARK(BM_HandWritten7)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Stencil, star_stencil<3>, heat)
+  ->Arg(1)
+  ->Arg(2)
+  ->Arg(4)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Stencil, box_stencil<3>, smooth)
+  ->Arg(1)
+  ->Arg(4)
+  ->Unit(benchmark::kMillisecond);
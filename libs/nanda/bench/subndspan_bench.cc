@@ -0,0 +1,74 @@
+#include <benchmark/benchmark.h>
+
+#include <utility>
+
+#include "nanda/ndarray.hh"
+#include "nanda/reduction.hh"
+#include "nanda/subndspan.hh"
+
+using namespace nanda;
+
+namespace {
+
+using cube = dextents<index_type, 3>;
+
+constexpr index_type side = 128;
+
+///@brief A run of whole planes, contiguous, or the interior of the volume
+template<bool Interior, class Array>
+auto
+sub_block(Array& arr)
+{
+  if constexpr (Interior)
+    return subndspan(arr,
+                     std::pair{ 1, side - 1 },
+                     std::pair{ 1, side - 1 },
+                     std::pair{ 1, side - 1 });
+  else
+    return subndspan(
+      arr, std::pair{ side / 4, 3 * side / 4 }, full_extent, full_extent);
+}
+
+///@brief The sub-block copied to a scratch array before the kernel runs,
+/// the pattern slicing replaces
+template<bool Interior>
+void
+BM_ScratchCopy(benchmark::State& state)
+{
+  thread_pool pool(1);
+  ndarray<float, cube> arr(cube{ side, side, side }, 1.0f);
+  const auto block = sub_block<Interior>(arr);
+  ndarray<float, cube> scratch(cube{
+    block.extent(0), block.extent(1), block.extent(2) });
+
+  for (auto _ : state) {
+    copy(block, scratch.view());
+    benchmark::DoNotOptimize(
+      sum(scratch, axes<0, 1, 2>, summation::naive, pool)());
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(block.size()));
+}
+
+///@brief The kernel on the view of the sub-block
+template<bool Interior>
+void
+BM_Subndspan(benchmark::State& state)
+{
+  thread_pool pool(1);
+  ndarray<float, cube> arr(cube{ side, side, side }, 1.0f);
+
+  for (auto _ : state) {
+    const auto block = sub_block<Interior>(arr);
+    benchmark::DoNotOptimize(
+      sum(block, axes<0, 1, 2>, summation::naive, pool)());
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          int64_t(sub_block<Interior>(arr).size()));
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_ScratchCopy, false);
+BENCHMARK_TEMPLATE(BM_ScratchCopy, true);
+BENCHMARK_TEMPLATE(BM_Subndspan, false);
+BENCHMARK_TEMPLATE(BM_Subndspan, true);
@@ -0,0 +1,121 @@
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+
+#include "nanda/index_algos.hh"
+#include "nanda/ndarray.hh"
+#include "nanda/simd.hh"
+#include "nanda/transpose.hh"
+
+using namespace nanda;
+
+namespace {
+
+using matrix = dextents<index_type, 2>;
+
+matrix
+square(benchmark::State& state)
+{
+  const auto n = index_type(state.range(0));
+  return matrix{ n, n };
+}
+
+template<class T>
+void
+set_bytes(benchmark::State& state, const matrix& ext)
+{
+  // every element is read once and written once
+  state.SetBytesProcessed(state.iterations() * int64_t(ext.size()) * 2 *
+                          int64_t(sizeof(T)));
+}
+
+///@brief Same layout on both sides, the bandwidth ceiling
+template<class T>
+void
+BM_Memcpy(benchmark::State& state)
+{
+  const auto ext = square(state);
+  ndarray<T, matrix> src(ext, T(1)), dst(ext);
+
+  for (auto _ : state) {
+    std::memcpy(dst.data(), src.data(), ext.size() * sizeof(T));
+    benchmark::ClobberMemory();
+  }
+  set_bytes<T>(state, ext);
+}
+
+///@brief Row-major to column-major through unflatten and flatten of every
+/// offset, the loop this replaces
+template<class T>
+void
+BM_FlattenLoop(benchmark::State& state)
+{
+  const auto ext = square(state);
+  ndarray<T, matrix> src(ext, T(1)), dst(ext);
+  const auto dims = ext.to_array();
+
+  for (auto _ : state) {
+    for (index_type k = 0; k < index_type(ext.size()); ++k) {
+      const auto idx = unflatten<StorageOrder::RowMajor>(k, dims);
+      dst[flatten<StorageOrder::ColMajor>(idx, dims)] = src[k];
+    }
+    benchmark::ClobberMemory();
+  }
+  set_bytes<T>(state, ext);
+}
+
+///@brief Row-major to column-major with copy(), blocked and transposed in
+/// registers by the instruction set of the second argument
+template<class T>
+void
+BM_Copy(benchmark::State& state)
+{
+  const simd_isa saved = active_simd_isa();
+  if (set_simd_isa(simd_isa(state.range(1))) != simd_isa(state.range(1))) {
+    set_simd_isa(saved);
+    state.SkipWithError("instruction set not supported");
+    return;
+  }
+  const auto ext = square(state);
+  ndarray<T, matrix> src(ext, T(1));
+  ndarray<T, matrix, layout_left> dst(ext);
+
+  for (auto _ : state) {
+    copy(src.view(), dst.view());
+    benchmark::ClobberMemory();
+  }
+  set_bytes<T>(state, ext);
+  set_simd_isa(saved);
+}
+
+template<class T>
+void
+BM_InPlace(benchmark::State& state)
+{
+  const auto ext = square(state);
+  ndarray<T, matrix> arr(ext, T(1));
+
+  for (auto _ : state) {
+    transpose_in_place(arr);
+    benchmark::ClobberMemory();
+  }
+  set_bytes<T>(state, ext);
+}
+
+void
+copy_args(benchmark::internal::Benchmark* b)
+{
+  b->ArgNames({ "n", "isa" });
+  for (int n : { 1024, 4000, 4096 })
+    for (auto isa : { simd_isa::scalar, simd_isa::sse2, simd_isa::avx2 })
+      b->Args({ n, int(isa) });
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_Memcpy, float)->Arg(1024)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_FlattenLoop, float)->Arg(1024)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_Copy, float)->Apply(copy_args);
+BENCHMARK_TEMPLATE(BM_Copy, double)->Apply(copy_args);
+BENCHMARK_TEMPLATE(BM_InPlace, float)->Arg(1024)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_InPlace, double)->Arg(1024)->Arg(4096);
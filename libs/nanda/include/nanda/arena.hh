@@ -0,0 +1,469 @@
+#ifndef NANDA_ARENA_HEADER
+#define NANDA_ARENA_HEADER
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+
+#include "memory.hh"
+#include "ndarray.hh"
+
+namespace nanda {
+
+///@brief Allocation counts of a memory resource
+struct allocation_stats
+{
+  ///@brief Blocks handed out and given back
+  std::size_t allocations = 0;
+  std::size_t deallocations = 0;
+  ///@brief Bytes of all the blocks handed out
+  std::size_t bytes = 0;
+  ///@brief Bytes handed out and not given back, and their maximum
+  std::size_t bytes_in_use = 0;
+  std::size_t peak_bytes = 0;
+  ///@brief Blocks and bytes requested from the upstream resource
+  std::size_t upstream_allocations = 0;
+  std::size_t upstream_bytes = 0;
+};
+
+///@brief A memory resource which counts the blocks it hands out, and the base
+/// of the nanda resources which count their upstream requests as well
+class counting_resource : public std::pmr::memory_resource
+{
+public:
+  ///@brief Counts the allocations of 'upstream', the global operator new by
+  /// default
+  explicit counting_resource(std::pmr::memory_resource* upstream =
+                               std::pmr::new_delete_resource()) noexcept
+    : upstream_{ upstream }
+  {}
+
+  const allocation_stats& stats() const noexcept { return stats_; }
+  void reset_stats() noexcept { stats_ = {}; }
+
+  std::pmr::memory_resource* upstream_resource() const noexcept
+  {
+    return upstream_;
+  }
+
+protected:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override
+  {
+    void* p = upstream_allocate(bytes, alignment);
+    count_allocate(bytes);
+    return p;
+  }
+
+  void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+  {
+    count_deallocate(bytes);
+    upstream_deallocate(p, bytes, alignment);
+  }
+
+  bool do_is_equal(
+    const std::pmr::memory_resource& other) const noexcept override
+  {
+    return this == &other;
+  }
+
+  void count_allocate(std::size_t bytes) noexcept
+  {
+    ++stats_.allocations;
+    stats_.bytes += bytes;
+    stats_.bytes_in_use += bytes;
+    stats_.peak_bytes = std::max(stats_.peak_bytes, stats_.bytes_in_use);
+  }
+
+  void count_deallocate(std::size_t bytes) noexcept
+  {
+    ++stats_.deallocations;
+    stats_.bytes_in_use -= std::min(bytes, stats_.bytes_in_use);
+  }
+
+  ///@brief Every block handed out is gone at once
+  void count_release() noexcept { stats_.bytes_in_use = 0; }
+
+  void* upstream_allocate(std::size_t bytes, std::size_t alignment)
+  {
+    void* p = upstream_->allocate(bytes, alignment);
+    count_upstream(bytes);
+    return p;
+  }
+
+  ///@brief Memory obtained from elsewhere than the upstream resource
+  void count_upstream(std::size_t bytes) noexcept
+  {
+    ++stats_.upstream_allocations;
+    stats_.upstream_bytes += bytes;
+  }
+
+  void upstream_deallocate(void* p, std::size_t bytes, std::size_t alignment)
+  {
+    upstream_->deallocate(p, bytes, alignment);
+  }
+
+private:
+  std::pmr::memory_resource* upstream_;
+  allocation_stats stats_;
+};
+
+///@brief A monotonic arena: blocks are carved one after the other out of
+/// large upstream buffers, deallocation does nothing and everything is
+/// freed at once by rewind() or release(). The buffers grow geometrically
+/// from 'initial_bytes'.
+///
+/// Not thread-safe: one arena per thread, or per computation.
+class arena_resource : public counting_resource
+{
+public:
+  explicit arena_resource(
+    std::size_t initial_bytes = std::size_t(1) << 16,
+    std::pmr::memory_resource* upstream =
+      std::pmr::new_delete_resource()) noexcept
+    : counting_resource{ upstream }
+    , next_bytes_{ std::max(initial_bytes, header_bytes * 2) }
+  {}
+
+  arena_resource(const arena_resource&) = delete;
+  arena_resource& operator=(const arena_resource&) = delete;
+
+  ~arena_resource() override { release(); }
+
+  ///@brief Frees every buffer
+  void release() noexcept
+  {
+    while (head_ != nullptr) {
+      block* next = head_->next;
+      upstream_deallocate(head_, head_->bytes, buffer_alignment);
+      head_ = next;
+    }
+    current_ = end_ = nullptr;
+    count_release();
+  }
+
+  ///@brief Frees everything carved so far but keeps the last, largest
+  /// buffer, so a loop that rewinds its arena stops allocating upstream once
+  /// the buffer fits one iteration
+  void rewind() noexcept
+  {
+    if (head_ == nullptr)
+      return;
+    block* last = head_;
+    head_ = head_->next;
+    release();
+    head_ = last;
+    head_->next = nullptr;
+    current_ = reinterpret_cast<std::byte*>(head_) + header_bytes;
+    end_ = reinterpret_cast<std::byte*>(head_) + head_->bytes;
+  }
+
+  ///@brief Bytes left in the current buffer
+  std::size_t available() const noexcept
+  {
+    return std::size_t(end_ - current_);
+  }
+
+protected:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override
+  {
+    void* p = carve(bytes, alignment);
+    if (p == nullptr) {
+      grow(bytes + alignment);
+      p = carve(bytes, alignment);
+    }
+    count_allocate(bytes);
+    return p;
+  }
+
+  void do_deallocate(void*, std::size_t bytes, std::size_t) override
+  {
+    count_deallocate(bytes);
+  }
+
+private:
+  struct block
+  {
+    block* next;
+    std::size_t bytes;
+  };
+
+  static constexpr std::size_t buffer_alignment = default_alignment;
+  static constexpr std::size_t header_bytes = default_alignment;
+
+  void* carve(std::size_t bytes, std::size_t alignment) noexcept
+  {
+    if (current_ == nullptr)
+      return nullptr;
+    void* p = current_;
+    std::size_t space = available();
+    if (std::align(alignment, bytes, p, space) == nullptr)
+      return nullptr;
+    current_ = static_cast<std::byte*>(p) + bytes;
+    return p;
+  }
+
+  void grow(std::size_t bytes)
+  {
+    while (next_bytes_ < bytes + header_bytes)
+      next_bytes_ *= 2;
+    void* p = upstream_allocate(next_bytes_, buffer_alignment);
+    head_ = ::new (p) block{ head_, next_bytes_ };
+    current_ = static_cast<std::byte*>(p) + header_bytes;
+    end_ = static_cast<std::byte*>(p) + next_bytes_;
+    next_bytes_ *= 2;
+  }
+
+  std::size_t next_bytes_;
+  block* head_ = nullptr;
+  std::byte* current_ = nullptr;
+  std::byte* end_ = nullptr;
+};
+
+///@brief A pool of blocks in power of two size classes from 64 bytes to
+/// 'max_pooled' bytes. Given back blocks go to a free list of their class
+/// and serve the next requests of that class; the free lists are refilled
+/// from upstream slabs of at least 'slab_bytes'. Larger blocks go straight
+/// to upstream. Everything is freed by release() and the destructor.
+///
+/// Not thread-safe: one pool per thread, or per computation.
+class pool_resource : public counting_resource
+{
+public:
+  explicit pool_resource(
+    std::size_t max_pooled = std::size_t(1) << 20,
+    std::size_t slab_bytes = std::size_t(1) << 18,
+    std::pmr::memory_resource* upstream =
+      std::pmr::new_delete_resource()) noexcept
+    : counting_resource{ upstream }
+    , max_pooled_{ std::min(std::max(max_pooled, min_block),
+                            min_block << (classes - 1)) }
+    , slab_bytes_{ slab_bytes }
+  {}
+
+  pool_resource(const pool_resource&) = delete;
+  pool_resource& operator=(const pool_resource&) = delete;
+
+  ~pool_resource() override { release(); }
+
+  ///@brief Frees every slab, the blocks in use included
+  void release() noexcept
+  {
+    while (slabs_ != nullptr) {
+      slab* next = slabs_->next;
+      upstream_deallocate(slabs_, slabs_->bytes, slabs_->alignment);
+      slabs_ = next;
+    }
+    free_.fill(nullptr);
+    count_release();
+  }
+
+protected:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override
+  {
+    void* p = nullptr;
+    if (pooled(bytes, alignment)) {
+      const auto c = size_class(bytes, alignment);
+      if (free_[c] == nullptr)
+        refill(c);
+      p = std::exchange(free_[c], free_[c]->next);
+    } else {
+      p = upstream_allocate(bytes, alignment);
+    }
+    count_allocate(bytes);
+    return p;
+  }
+
+  void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+  {
+    count_deallocate(bytes);
+    if (pooled(bytes, alignment)) {
+      const auto c = size_class(bytes, alignment);
+      free_[c] = ::new (p) free_block{ free_[c] };
+    } else {
+      upstream_deallocate(p, bytes, alignment);
+    }
+  }
+
+private:
+  struct free_block
+  {
+    free_block* next;
+  };
+
+  struct slab
+  {
+    slab* next;
+    std::size_t bytes;
+    std::size_t alignment;
+  };
+
+  static constexpr std::size_t min_block = 64;
+  static constexpr std::size_t classes = 24;
+  static constexpr std::size_t slab_alignment = 4096;
+
+  bool pooled(std::size_t bytes, std::size_t alignment) const noexcept
+  {
+    return std::max(bytes, alignment) <= max_pooled_ &&
+           alignment <= slab_alignment;
+  }
+
+  ///@brief The class of blocks of at least 'bytes' aligned to 'alignment':
+  /// blocks are aligned to their power of two size, up to the slab alignment
+  static std::size_t size_class(std::size_t bytes,
+                                std::size_t alignment) noexcept
+  {
+    const std::size_t size = std::max({ bytes, alignment, min_block });
+    std::size_t c = 0;
+    while ((min_block << c) < size)
+      ++c;
+    return c;
+  }
+
+  void refill(std::size_t c)
+  {
+    const std::size_t size = min_block << c;
+    // the header takes the first block of the slab
+    const std::size_t count = std::max<std::size_t>(slab_bytes_ / size, 2);
+    const std::size_t bytes = count * size;
+    const std::size_t alignment = std::min(size, slab_alignment);
+    void* p = upstream_allocate(bytes, alignment);
+    slabs_ = ::new (p) slab{ slabs_, bytes, alignment };
+    auto* first = static_cast<std::byte*>(p);
+    for (std::size_t k = count; k-- > 1;)
+      free_[c] = ::new (first + k * size) free_block{ free_[c] };
+  }
+
+  std::size_t max_pooled_;
+  std::size_t slab_bytes_;
+  slab* slabs_ = nullptr;
+  std::array<free_block*, classes> free_{};
+};
+
+namespace detail {
+
+inline std::pmr::memory_resource*&
+current_resource_ref() noexcept
+{
+  thread_local std::pmr::memory_resource* resource =
+    std::pmr::new_delete_resource();
+  return resource;
+}
+
+} // namespace detail
+
+///@brief The resource default constructed resource_allocators of this thread
+/// draw from, the global operator new unless a scoped_resource is alive
+inline std::pmr::memory_resource*
+current_resource() noexcept
+{
+  return detail::current_resource_ref();
+}
+
+///@brief Makes 'resource' the current resource of this thread for its
+/// lifetime, so the scratch arrays of a computation come from an arena or a
+/// pool without passing it down. Scopes nest.
+class scoped_resource
+{
+public:
+  explicit scoped_resource(std::pmr::memory_resource& resource) noexcept
+    : previous_{ std::exchange(detail::current_resource_ref(), &resource) }
+  {}
+
+  scoped_resource(const scoped_resource&) = delete;
+  scoped_resource& operator=(const scoped_resource&) = delete;
+
+  ~scoped_resource() { detail::current_resource_ref() = previous_; }
+
+private:
+  std::pmr::memory_resource* previous_;
+};
+
+///@brief Allocator of over-aligned memory from a memory resource, the
+/// current resource of the thread when default constructed. Containers keep
+/// the resource of their allocator through moves, swaps and copy
+/// assignments.
+template<class T, std::size_t Alignment = default_alignment>
+class resource_allocator
+{
+  static_assert((Alignment & (Alignment - 1)) == 0,
+                "Alignment must be a power of two");
+
+public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  template<class U>
+  struct rebind
+  {
+    using other = resource_allocator<U, Alignment>;
+  };
+
+  resource_allocator() noexcept
+    : resource_{ current_resource() }
+  {}
+
+  resource_allocator(std::pmr::memory_resource* resource) noexcept
+    : resource_{ resource }
+  {}
+
+  template<class U>
+  resource_allocator(const resource_allocator<U, Alignment>& other) noexcept
+    : resource_{ other.resource() }
+  {}
+
+  T* allocate(std::size_t n)
+  {
+    return static_cast<T*>(resource_->allocate(n * sizeof(T), alignment));
+  }
+
+  void deallocate(T* p, std::size_t n) noexcept
+  {
+    resource_->deallocate(p, n * sizeof(T), alignment);
+  }
+
+  ///@brief Copies of a container draw from the current resource, not from
+  /// the one of the copied container
+  resource_allocator select_on_container_copy_construction() const noexcept
+  {
+    return {};
+  }
+
+  std::pmr::memory_resource* resource() const noexcept { return resource_; }
+
+  template<class U>
+  friend bool operator==(const resource_allocator& lhs,
+                         const resource_allocator<U, Alignment>& rhs) noexcept
+  {
+    return lhs.resource() == rhs.resource() ||
+           lhs.resource()->is_equal(*rhs.resource());
+  }
+
+  template<class U>
+  friend bool operator!=(const resource_allocator& lhs,
+                         const resource_allocator<U, Alignment>& rhs) noexcept
+  {
+    return !(lhs == rhs);
+  }
+
+private:
+  static constexpr std::size_t alignment = std::max(Alignment, alignof(T));
+
+  std::pmr::memory_resource* resource_;
+};
+
+///@brief An ndarray drawing its buffer from the current resource of the
+/// thread, for the temporaries of a computation scoped around an arena
+template<class T, class Extents, class Layout = layout_right>
+using scratch_ndarray =
+  ndarray<T, Extents, Layout, resource_allocator<T>>;
+
+} // namespace nanda
+
+#endif // NANDA_ARENA_HEADER
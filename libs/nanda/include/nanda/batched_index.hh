@@ -0,0 +1,460 @@
+#ifndef NANDA_BATCHED_INDEX_HEADER
+#define NANDA_BATCHED_INDEX_HEADER
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "fast_division.hh"
+#include "index_algos.hh"
+#include "simd.hh"
+#include "span.hh"
+
+// the loops are inlined into the entry points of every instruction set, see
+// simd.hh
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+namespace nanda {
+
+namespace detail {
+
+///@brief 32 bit unsigned division by a runtime invariant divisor in a form
+/// that vectorizes: a 32 bit multiply-high, an add-back and a shift (the
+/// branch free scheme of libdivide). Powers of two have a zero multiplier,
+/// division by one is flagged and skipped.
+struct lane_divider
+{
+  std::int32_t magic = 0;
+  int shift = 0;
+  bool one = true;
+
+  constexpr lane_divider() noexcept = default;
+
+  constexpr explicit lane_divider(std::uint32_t d) noexcept
+    : one{ d == 1 }
+  {
+    EXPECTS(d != 0);
+    if (one)
+      return;
+
+    const int log = floor_log2(d);
+    if ((d & (d - 1)) == 0) {
+      shift = log - 1;
+      return;
+    }
+
+    // 2^(32 + log) / d, a 33 bit multiplier whose top bit is added back
+    const std::uint64_t numerator = std::uint64_t(1) << (32 + log);
+    std::uint32_t proposed = std::uint32_t(numerator / d);
+    const std::uint32_t rem = std::uint32_t(numerator % d);
+    proposed += proposed;
+    const std::uint32_t twice_rem = rem + rem;
+    if (twice_rem >= d || twice_rem < rem)
+      proposed += 1;
+    magic = std::int32_t(proposed + 1);
+    shift = log;
+  }
+};
+
+///@brief The shape of a batch conversion in 32 bit lanes
+template<std::size_t N>
+struct lane_shape
+{
+  std::array<std::int32_t, N> extents{};
+  std::array<std::int32_t, N> shifts{};
+  std::array<lane_divider, N> dividers{};
+  std::int32_t size = 0;
+};
+
+template<StorageOrder storage, class Dims>
+lane_shape<Rank<Dims>::value>
+make_lane_shape(const Dims& dims)
+{
+  lane_shape<Rank<Dims>::value> shape;
+  const auto shifts = get_shifts<storage>(dims);
+  for (std::size_t i = 0; i < shape.extents.size(); ++i) {
+    shape.extents[i] = std::int32_t(dims_extent(dims, i));
+    shape.shifts[i] = std::int32_t(shifts[i]);
+    // a zero shift only happens for an empty index space
+    shape.dividers[i] =
+      lane_divider(std::uint32_t(shifts[i] == 0 ? 1 : shifts[i]));
+  }
+  shape.size = std::int32_t(dims_size(dims));
+  return shape;
+}
+
+///@brief q = n / d in every lane
+template<class V>
+NANDA_SIMD_INLINE void
+lane_divide(const typename V::type& n,
+            const lane_divider& d,
+            typename V::type& q) noexcept
+{
+  if (d.one) {
+    q = n;
+    return;
+  }
+  const auto hi = V::mulhi_u32(n, V::broadcast(d.magic));
+  const auto t = V::template binary<simd_op::add>(
+    V::shift_right(V::template binary<simd_op::sub>(n, hi), 1), hi);
+  q = V::shift_right(t, d.shift);
+}
+
+// the validity mask is written from the -1 lanes of the invalid points, which
+// are counted in a vector and summed once at the end of the loop
+
+template<class V>
+NANDA_SIMD_INLINE void
+mark_lanes(const typename V::type& bad,
+           typename V::type& count,
+           std::uint8_t* valid,
+           std::size_t k) noexcept
+{
+  count = V::template binary<simd_op::sub>(count, bad);
+  if (valid != nullptr)
+    V::store_bytes(valid + k,
+                   V::template binary<simd_op::add>(bad, V::broadcast(1)));
+}
+
+template<class V>
+NANDA_SIMD_INLINE std::size_t
+count_lanes(const typename V::type& count) noexcept
+{
+  alignas(64) std::int32_t lanes[V::width];
+  V::storeu(lanes, count);
+  std::size_t sum = 0;
+  for (std::size_t i = 0; i < V::width; ++i)
+    sum += std::size_t(lanes[i]);
+  return sum;
+}
+
+// one vector of points: the flat indices or coordinates are stored, -1 where
+// a point is out of range
+
+template<class V, std::size_t N>
+NANDA_SIMD_INLINE void
+flatten_lanes(const lane_shape<N>& shape,
+              const std::int32_t* const* coords,
+              std::int32_t* flat,
+              std::uint8_t* valid,
+              typename V::type& count,
+              std::size_t k) noexcept
+{
+  const auto zero = V::broadcast(0);
+  const auto none = V::broadcast(-1);
+  auto sum = zero;
+  auto bad = zero;
+  for (std::size_t d = 0; d < N; ++d) {
+    const auto x = V::load(coords[d] + k);
+    bad = V::blend(V::template compare<simd_cmp::lt>(x, zero), none, bad);
+    bad = V::blend(V::template compare<simd_cmp::ge>(
+                     x, V::broadcast(shape.extents[d])),
+                   none,
+                   bad);
+    sum = V::template binary<simd_op::add>(
+      sum,
+      V::template binary<simd_op::mul>(x, V::broadcast(shape.shifts[d])));
+  }
+  const auto ok = V::template compare<simd_cmp::eq>(bad, zero);
+  V::storeu(flat + k, V::blend(ok, sum, none));
+  mark_lanes<V>(bad, count, valid, k);
+}
+
+// the slower directions are divided out one after the other, what is left is
+// the index of the fastest running direction (as unflattener does)
+template<class V, StorageOrder storage, std::size_t N>
+NANDA_SIMD_INLINE void
+unflatten_lanes(const lane_shape<N>& shape,
+                const std::int32_t* flat,
+                std::int32_t* const* coords,
+                std::uint8_t* valid,
+                typename V::type& count,
+                std::size_t k) noexcept
+{
+  const auto zero = V::broadcast(0);
+  const auto none = V::broadcast(-1);
+  auto x = V::load(flat + k);
+  auto bad = V::blend(V::template compare<simd_cmp::lt>(x, zero), none, zero);
+  bad = V::blend(
+    V::template compare<simd_cmp::ge>(x, V::broadcast(shape.size)), none, bad);
+  const auto ok = V::template compare<simd_cmp::eq>(bad, zero);
+
+  for (std::size_t r = 0; r + 1 < N; ++r) {
+    const std::size_t i = storage == StorageOrder::RowMajor ? r : N - 1 - r;
+    auto q = zero;
+    lane_divide<V>(x, shape.dividers[i], q);
+    V::storeu(coords[i] + k, V::blend(ok, q, none));
+    x = V::template binary<simd_op::sub>(
+      x, V::template binary<simd_op::mul>(q, V::broadcast(shape.shifts[i])));
+  }
+  const std::size_t last = storage == StorageOrder::RowMajor ? N - 1 : 0;
+  V::storeu(coords[last] + k, V::blend(ok, x, none));
+  mark_lanes<V>(bad, count, valid, k);
+}
+
+// the tail runs one point at a time
+
+template<class V, std::size_t N>
+NANDA_SIMD_INLINE std::size_t
+flatten_batch_loop(const lane_shape<N>& shape,
+                   const std::int32_t* const* coords,
+                   std::int32_t* flat,
+                   std::uint8_t* valid,
+                   std::size_t n) noexcept
+{
+  using S = simd_vec<simd_isa::scalar, std::int32_t>;
+  std::size_t k = 0;
+  std::size_t invalid = 0;
+  if (n >= V::width) {
+    auto count = V::broadcast(0);
+    for (; k + V::width <= n; k += V::width)
+      flatten_lanes<V>(shape, coords, flat, valid, count, k);
+    invalid = count_lanes<V>(count);
+  }
+  std::int32_t count = 0;
+  for (; k < n; ++k)
+    flatten_lanes<S>(shape, coords, flat, valid, count, k);
+  return n - invalid - std::size_t(count);
+}
+
+template<class V, StorageOrder storage, std::size_t N>
+NANDA_SIMD_INLINE std::size_t
+unflatten_batch_loop(const lane_shape<N>& shape,
+                     const std::int32_t* flat,
+                     std::int32_t* const* coords,
+                     std::uint8_t* valid,
+                     std::size_t n) noexcept
+{
+  using S = simd_vec<simd_isa::scalar, std::int32_t>;
+  std::size_t k = 0;
+  std::size_t invalid = 0;
+  if (n >= V::width) {
+    auto count = V::broadcast(0);
+    for (; k + V::width <= n; k += V::width)
+      unflatten_lanes<V, storage>(shape, flat, coords, valid, count, k);
+    invalid = count_lanes<V>(count);
+  }
+  std::int32_t count = 0;
+  for (; k < n; ++k)
+    unflatten_lanes<S, storage>(shape, flat, coords, valid, count, k);
+  return n - invalid - std::size_t(count);
+}
+
+///@brief Entry points of the batch conversions for one instruction set, the
+/// primary template is the scalar fallback
+template<simd_isa Isa>
+struct batched_index_kernels
+{
+  template<std::size_t N>
+  static std::size_t flatten(const lane_shape<N>& shape,
+                             const std::int32_t* const* coords,
+                             std::int32_t* flat,
+                             std::uint8_t* valid,
+                             std::size_t n) noexcept
+  {
+    using V = simd_vec<Isa, std::int32_t>;
+    return flatten_batch_loop<V>(shape, coords, flat, valid, n);
+  }
+
+  template<StorageOrder storage, std::size_t N>
+  static std::size_t unflatten(const lane_shape<N>& shape,
+                               const std::int32_t* flat,
+                               std::int32_t* const* coords,
+                               std::uint8_t* valid,
+                               std::size_t n) noexcept
+  {
+    using V = simd_vec<Isa, std::int32_t>;
+    return unflatten_batch_loop<V, storage>(shape, flat, coords, valid, n);
+  }
+};
+
+#ifdef NANDA_SIMD_X86
+
+#define NANDA_BATCHED_INDEX_KERNELS(isa, target)                               \
+  template<>                                                                   \
+  struct batched_index_kernels<simd_isa::isa>                                  \
+  {                                                                            \
+    template<std::size_t N>                                                    \
+    target static std::size_t flatten(const lane_shape<N>& shape,              \
+                                      const std::int32_t* const* coords,       \
+                                      std::int32_t* flat,                      \
+                                      std::uint8_t* valid,                     \
+                                      std::size_t n) noexcept                  \
+    {                                                                          \
+      using V = simd_vec<simd_isa::isa, std::int32_t>;                         \
+      return flatten_batch_loop<V>(shape, coords, flat, valid, n);             \
+    }                                                                          \
+                                                                               \
+    template<StorageOrder storage, std::size_t N>                              \
+    target static std::size_t unflatten(const lane_shape<N>& shape,            \
+                                        const std::int32_t* flat,              \
+                                        std::int32_t* const* coords,           \
+                                        std::uint8_t* valid,                   \
+                                        std::size_t n) noexcept                \
+    {                                                                          \
+      using V = simd_vec<simd_isa::isa, std::int32_t>;                         \
+      return unflatten_batch_loop<V, storage>(                                 \
+        shape, flat, coords, valid, n);                                        \
+    }                                                                          \
+  };
+
+NANDA_BATCHED_INDEX_KERNELS(sse2, NANDA_TARGET_SSE2)
+NANDA_BATCHED_INDEX_KERNELS(avx2, NANDA_TARGET_AVX2)
+NANDA_BATCHED_INDEX_KERNELS(avx512, NANDA_TARGET_AVX512)
+
+#undef NANDA_BATCHED_INDEX_KERNELS
+
+#endif // NANDA_SIMD_X86
+
+///@brief Calls f(batched_index_kernels<isa>{})
+template<class F>
+decltype(auto)
+batched_index_dispatch(simd_isa isa, F&& f)
+{
+  switch (isa) {
+#ifdef NANDA_SIMD_X86
+    case simd_isa::avx512:
+      return f(batched_index_kernels<simd_isa::avx512>{});
+    case simd_isa::avx2:
+      return f(batched_index_kernels<simd_isa::avx2>{});
+    case simd_isa::sse2:
+      return f(batched_index_kernels<simd_isa::sse2>{});
+#endif
+    default:
+      return f(batched_index_kernels<simd_isa::scalar>{});
+  }
+}
+
+
+} // namespace detail
+
+///@brief Flattens a batch of points given as structure of arrays, one span of
+/// coordinates per direction. Points with a coordinate outside [0, extent)
+/// get the flat index -1 and, if 'valid' is not empty, a 0 in 'valid' (1 for
+/// the others). std::int32_t indices are converted 'isa' vector lanes at a
+/// time, other index types one point at a time.
+///
+///@tparam storage storage order
+///@param coords the coordinates of the points in each direction
+///@param dims the extents of the index space
+///@param flat the flat indices, as many as points
+///@param valid empty or the validity mask, as many as points
+///@param isa instruction set of the conversion
+///@return the number of valid points
+template<StorageOrder storage, class Dims, class IndexType, std::size_t N>
+std::size_t
+flatten_batch(const std::array<span<const IndexType>, N>& coords,
+              const Dims& dims,
+              span<IndexType> flat,
+              span<std::uint8_t> valid = {},
+              simd_isa isa = active_simd_isa())
+{
+  static_assert(N > 0 && Rank<Dims>::value == N,
+                "The coordinates and the dimensions differ in rank");
+  detail::check_index_range<IndexType>(dims);
+  const std::size_t n = flat.size();
+  for ([[maybe_unused]] const auto& c : coords)
+    EXPECTS(c.size() == n);
+  EXPECTS(valid.empty() || valid.size() == n);
+
+  std::array<const IndexType*, N> in{};
+  for (std::size_t d = 0; d < N; ++d)
+    in[d] = coords[d].data();
+  std::uint8_t* mask = valid.empty() ? nullptr : valid.data();
+
+  if constexpr (std::is_same_v<IndexType, std::int32_t>) {
+    const auto shape = detail::make_lane_shape<storage>(dims);
+    return detail::batched_index_dispatch(isa, [&](auto kernels) {
+      return kernels.flatten(shape, in.data(), flat.data(), mask, n);
+    });
+  } else {
+    const auto ext = detail::dims_array<IndexType>(dims);
+    const auto shifts = get_shifts<storage>(dims);
+    std::size_t count = 0;
+    for (std::size_t k = 0; k < n; ++k) {
+      IndexType sum = 0;
+      bool ok = true;
+      for (std::size_t d = 0; d < N; ++d) {
+        const IndexType x = in[d][k];
+        ok = ok && x >= 0 && x < ext[d];
+        if (ok)
+          sum += x * IndexType(shifts[d]);
+      }
+      flat[k] = ok ? sum : IndexType(-1);
+      if (mask)
+        mask[k] = std::uint8_t(ok);
+      count += ok;
+    }
+    return count;
+  }
+}
+
+///@brief Unflattens a batch of flat indices into structure of arrays, one span
+/// of coordinates per direction. Flat indices outside [0, size) get the
+/// coordinates -1 and, if 'valid' is not empty, a 0 in 'valid' (1 for the
+/// others). std::int32_t indices are converted 'isa' vector lanes at a time,
+/// the divisions by the shifts become a multiply-high and shifts.
+///
+///@tparam storage storage order
+///@param flat the flat indices
+///@param dims the extents of the index space
+///@param coords the coordinates of the points in each direction
+///@param valid empty or the validity mask, as many as points
+///@param isa instruction set of the conversion
+///@return the number of valid points
+template<StorageOrder storage, class Dims, class IndexType, std::size_t N>
+std::size_t
+unflatten_batch(span<const IndexType> flat,
+                const Dims& dims,
+                const std::array<span<IndexType>, N>& coords,
+                span<std::uint8_t> valid = {},
+                simd_isa isa = active_simd_isa())
+{
+  static_assert(N > 0 && Rank<Dims>::value == N,
+                "The coordinates and the dimensions differ in rank");
+  detail::check_index_range<IndexType>(dims);
+  const std::size_t n = flat.size();
+  for ([[maybe_unused]] const auto& c : coords)
+    EXPECTS(c.size() == n);
+  EXPECTS(valid.empty() || valid.size() == n);
+
+  std::array<IndexType*, N> out{};
+  for (std::size_t d = 0; d < N; ++d)
+    out[d] = coords[d].data();
+  std::uint8_t* mask = valid.empty() ? nullptr : valid.data();
+
+  if constexpr (std::is_same_v<IndexType, std::int32_t>) {
+    const auto shape = detail::make_lane_shape<storage>(dims);
+    return detail::batched_index_dispatch(isa, [&](auto kernels) {
+      return kernels.template unflatten<storage>(
+        shape, flat.data(), out.data(), mask, n);
+    });
+  } else {
+    const unflattener<storage, N, IndexType> convert(dims);
+    std::size_t count = 0;
+    for (std::size_t k = 0; k < n; ++k) {
+      const IndexType x = flat[k];
+      const bool ok = x >= 0 && x < convert.size();
+      const auto idx = ok ? convert(x) : std::array<IndexType, N>{};
+      for (std::size_t d = 0; d < N; ++d)
+        out[d][k] = ok ? idx[d] : IndexType(-1);
+      if (mask)
+        mask[k] = std::uint8_t(ok);
+      count += ok;
+    }
+    return count;
+  }
+}
+
+} // namespace nanda
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // NANDA_BATCHED_INDEX_HEADER
@@ -0,0 +1,475 @@
+#ifndef NANDA_BINARY_IO_HEADER
+#define NANDA_BINARY_IO_HEADER
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "extents.hh"
+#include "index_algos.hh"
+#include "ndarray.hh"
+#include "ndspan.hh"
+
+namespace nanda {
+
+///@brief Largest single read or write of the binary readers and writers, in
+/// bytes. Large enough to run at disk bandwidth, small enough to bound the
+/// staging buffer of the strided cases.
+inline constexpr std::size_t default_io_chunk = std::size_t(1) << 22;
+
+namespace detail {
+
+///@brief A file opened for whole-buffer positional reads and writes. Failing
+/// system calls throw std::system_error, reading past the end throws
+/// std::runtime_error.
+class binary_file
+{
+public:
+  binary_file(const std::string& path, int flags)
+    : fd_{ ::open(path.c_str(), flags | O_CLOEXEC, 0644) }
+  {
+    if (fd_ < 0)
+      throw std::system_error(errno, std::generic_category(), "open " + path);
+#ifdef POSIX_FADV_SEQUENTIAL
+    ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+  }
+
+  binary_file(const binary_file&) = delete;
+  binary_file& operator=(const binary_file&) = delete;
+
+  ~binary_file() { ::close(fd_); }
+
+  std::size_t size() const
+  {
+    struct ::stat info;
+    if (::fstat(fd_, &info) != 0)
+      throw std::system_error(errno, std::generic_category(), "fstat");
+    return std::size_t(info.st_size);
+  }
+
+  ///@brief Reads 'bytes' bytes at 'offset' into 'dst', 'chunk' at most per
+  /// call
+  void read_at(void* dst,
+               std::size_t bytes,
+               std::size_t offset,
+               std::size_t chunk = default_io_chunk) const
+  {
+    auto* out = static_cast<char*>(dst);
+    while (bytes > 0) {
+      const auto n = ::pread(fd_, out, std::min(bytes, chunk), ::off_t(offset));
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n < 0)
+        throw std::system_error(errno, std::generic_category(), "pread");
+      if (n == 0)
+        throw std::runtime_error("Unexpected end of file");
+      out += n;
+      offset += std::size_t(n);
+      bytes -= std::size_t(n);
+    }
+  }
+
+  ///@brief Writes 'bytes' bytes of 'src' at 'offset', 'chunk' at most per
+  /// call
+  void write_at(const void* src,
+                std::size_t bytes,
+                std::size_t offset,
+                std::size_t chunk = default_io_chunk) const
+  {
+    const auto* in = static_cast<const char*>(src);
+    while (bytes > 0) {
+      const auto n = ::pwrite(fd_, in, std::min(bytes, chunk), ::off_t(offset));
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n < 0)
+        throw std::system_error(errno, std::generic_category(), "pwrite");
+      in += n;
+      offset += std::size_t(n);
+      bytes -= std::size_t(n);
+    }
+  }
+
+private:
+  int fd_;
+};
+
+///@brief Reverses the bytes of each of 'n' elements of T in place
+template<class T>
+void
+byte_swap(T* data, std::size_t n) noexcept
+{
+  static_assert(std::is_trivially_copyable_v<T>);
+  if constexpr (sizeof(T) > 1) {
+    auto* bytes = reinterpret_cast<unsigned char*>(data);
+    for (std::size_t k = 0; k < n; ++k, bytes += sizeof(T))
+      std::reverse(bytes, bytes + sizeof(T));
+  } else {
+    (void)data;
+    (void)n;
+  }
+}
+
+///@brief The view of an ndspan, ndarray or mapped array
+template<class A>
+auto
+io_view(A&& a)
+{
+  if constexpr (is_ndspan<remove_cvref_t<A>>::value)
+    return a;
+  else
+    return a.view();
+}
+
+template<class A>
+inline constexpr bool is_io_array_v =
+  is_ndspan<remove_cvref_t<A>>::value ||
+  is_ndarray<remove_cvref_t<A>>::value;
+
+///@brief Element strides of packed extents 'dims' in 'order'
+template<std::size_t N>
+std::array<std::size_t, N>
+packed_strides(const std::array<std::size_t, N>& dims, StorageOrder order)
+{
+  std::array<std::size_t, N> strides{};
+  std::size_t stride = 1;
+  for (std::size_t k = 0; k < N; ++k) {
+    const std::size_t r = order == StorageOrder::RowMajor ? N - 1 - k : k;
+    strides[r] = stride;
+    stride *= dims[r];
+  }
+  return strides;
+}
+
+///@brief Reads the box [first, first + dst.extents()) of a file of packed
+/// elements of extents 'dims' in 'order', starting at byte 'data_offset',
+/// into 'dst'.
+///
+/// The box is read as runs of consecutive elements in the file: the extent
+/// along the fastest axis of the file, merged with the next axes while the
+/// box spans them whole. Runs landing contiguously in 'dst' are read
+/// straight into it; the others, and short runs close together in the file,
+/// are read in groups through one staging buffer of 'chunk' bytes and
+/// scattered.
+template<class T, class E, class L>
+void
+read_box(const binary_file& file,
+         std::size_t data_offset,
+         const std::array<std::size_t, E::rank()>& dims,
+         StorageOrder order,
+         const std::array<std::size_t, E::rank()>& first,
+         const ndspan<T, E, L>& dst,
+         bool swap_bytes,
+         std::size_t chunk)
+{
+  static_assert(!std::is_const_v<T>, "The destination must be writable");
+  static_assert(ndspan<T, E, L>::mapping_type::is_always_strided(),
+                "Only views of a strided layout are read into");
+  constexpr std::size_t N = E::rank();
+  using I = std::ptrdiff_t;
+
+  for (std::size_t r = 0; r < N; ++r)
+    if (first[r] + std::size_t(dst.extent(r)) > dims[r])
+      throw std::out_of_range("Box past the extents of the file");
+  if (dst.empty())
+    return;
+  if constexpr (N == 0) {
+    file.read_at(dst.data(), sizeof(T), data_offset);
+    if (swap_bytes)
+      byte_swap(dst.data(), 1);
+    return;
+  } else {
+    const auto file_strides = packed_strides(dims, order);
+    // axes from the fastest in the file to the slowest
+    std::array<std::size_t, N> axes{};
+    for (std::size_t k = 0; k < N; ++k)
+      axes[k] = order == StorageOrder::RowMajor ? N - 1 - k : k;
+
+    // the run, 'merged' fastest axes
+    std::size_t merged = 1;
+    std::size_t run = std::size_t(dst.extent(axes[0]));
+    while (merged < N && std::size_t(dst.extent(axes[merged - 1])) ==
+                           dims[axes[merged - 1]]) {
+      run *= std::size_t(dst.extent(axes[merged]));
+      ++merged;
+    }
+    bool contiguous = true;
+    for (std::size_t k = 0, expected = 1; k < merged; ++k) {
+      const auto r = axes[k];
+      if (dst.extent(r) > 1 && std::size_t(dst.stride(r)) != expected)
+        contiguous = false;
+      expected *= std::size_t(dst.extent(r));
+    }
+    // the elements between consecutive runs, read along in a group of runs
+    const std::size_t gap =
+      merged < N ? file_strides[axes[merged]] - run : std::size_t(0);
+    constexpr std::size_t min_direct = std::size_t(1) << 16;
+    const bool sparse = gap > run;
+    const bool direct =
+      contiguous && (run * sizeof(T) >= min_direct || sparse);
+
+    // element k of a run into dst, the merged axes walked as an odometer
+    const auto scatter = [&](const T* src,
+                             std::size_t n,
+                             T* base,
+                             std::size_t k) {
+      std::array<std::size_t, N> digit{};
+      I off = 0;
+      for (std::size_t j = 0; j < merged; ++j) {
+        const auto count = std::size_t(dst.extent(axes[j]));
+        digit[j] = k % count;
+        k /= count;
+        off += I(digit[j]) * I(dst.stride(axes[j]));
+      }
+      const auto count0 = std::size_t(dst.extent(axes[0]));
+      const I stride0 = I(dst.stride(axes[0]));
+      while (n > 0) {
+        const std::size_t len = std::min(n, count0 - digit[0]);
+        if (stride0 == 1) {
+          std::memcpy(base + off, src, len * sizeof(T));
+        } else {
+          for (std::size_t i = 0; i < len; ++i)
+            base[off + I(i) * stride0] = src[i];
+        }
+        src += len;
+        n -= len;
+        off += I(len) * stride0;
+        digit[0] += len;
+        for (std::size_t j = 0;
+             j + 1 < merged && digit[j] == std::size_t(dst.extent(axes[j]));
+             ++j) {
+          off -= I(digit[j]) * I(dst.stride(axes[j]));
+          digit[j] = 0;
+          ++digit[j + 1];
+          off += I(dst.stride(axes[j + 1]));
+        }
+      }
+    };
+
+    // groups of runs read through the staging buffer
+    const std::size_t capacity = std::max<std::size_t>(chunk / sizeof(T), 1);
+    std::vector<T> staging;
+    std::vector<std::pair<std::size_t, T*>> group;
+    std::size_t group_start = 0, group_end = 0;
+    const auto flush = [&] {
+      if (group.empty())
+        return;
+      file.read_at(staging.data(),
+                   (group_end - group_start) * sizeof(T),
+                   data_offset + group_start * sizeof(T),
+                   chunk);
+      if (swap_bytes)
+        byte_swap(staging.data(), group_end - group_start);
+      for (const auto& [offset, base] : group)
+        scatter(staging.data() + (offset - group_start), run, base, 0);
+      group.clear();
+    };
+
+    // the other axes, the fastest of them first so the file is read forward
+    std::array<std::size_t, N> idx{};
+    for (;;) {
+      std::size_t offset = 0;
+      I dst_offset = 0;
+      for (std::size_t r = 0; r < N; ++r) {
+        offset += (first[r] + idx[r]) * file_strides[r];
+        dst_offset += I(idx[r]) * I(dst.stride(r));
+      }
+      T* base = dst.data() + dst_offset;
+
+      if (direct) {
+        file.read_at(
+          base, run * sizeof(T), data_offset + offset * sizeof(T), chunk);
+        if (swap_bytes)
+          byte_swap(base, run);
+      } else if (run > capacity) {
+        // a long run into a strided destination, piece by piece
+        staging.resize(capacity);
+        for (std::size_t k = 0; k < run; k += capacity) {
+          const std::size_t n = std::min(capacity, run - k);
+          file.read_at(staging.data(),
+                       n * sizeof(T),
+                       data_offset + (offset + k) * sizeof(T),
+                       chunk);
+          if (swap_bytes)
+            byte_swap(staging.data(), n);
+          scatter(staging.data(), n, base, k);
+        }
+      } else {
+        if (!group.empty() &&
+            (sparse || offset + run - group_start > capacity))
+          flush();
+        if (group.empty()) {
+          staging.resize(capacity);
+          group_start = offset;
+        }
+        group.emplace_back(offset, base);
+        group_end = offset + run;
+      }
+
+      std::size_t k = merged;
+      for (; k < N; ++k) {
+        const auto r = axes[k];
+        if (++idx[r] < std::size_t(dst.extent(r)))
+          break;
+        idx[r] = 0;
+      }
+      if (k == N)
+        break;
+    }
+    flush();
+  }
+}
+
+///@brief Writes the elements of 'src' to 'file' at byte 'data_offset',
+/// packed in 'order'. A view packed in that order is written straight from
+/// its memory, any other one is gathered through one staging buffer of
+/// 'chunk' bytes.
+template<class T, class E, class L>
+void
+write_packed(const binary_file& file,
+             std::size_t data_offset,
+             StorageOrder order,
+             const ndspan<T, E, L>& src,
+             std::size_t chunk)
+{
+  using value_type = std::remove_cv_t<T>;
+  constexpr std::size_t N = E::rank();
+  if (src.empty())
+    return;
+
+  using packed = std::conditional_t<std::is_same_v<L, layout_left>,
+                                    layout_left,
+                                    layout_right>;
+  const bool same_order = (order == StorageOrder::ColMajor) ==
+                          std::is_same_v<packed, layout_left>;
+  if (same_order &&
+      same_contiguous_layout(src, ndspan<const value_type, E, packed>(
+                                    src.data(), src.extents()))) {
+    file.write_at(src.data(), src.size() * sizeof(T), data_offset, chunk);
+    return;
+  }
+
+  const std::size_t capacity = std::max<std::size_t>(chunk / sizeof(T), 1);
+  std::vector<value_type> staging;
+  staging.reserve(std::min(capacity, std::size_t(src.size())));
+  std::size_t written = 0;
+  const auto flush = [&] {
+    file.write_at(staging.data(),
+                  staging.size() * sizeof(T),
+                  data_offset + written * sizeof(T),
+                  chunk);
+    written += staging.size();
+    staging.clear();
+  };
+
+  // the index space in 'order', the fastest axis of the file first
+  std::array<typename E::index_type, N> idx{};
+  for (;;) {
+    staging.push_back(src(idx));
+    if (staging.size() == capacity)
+      flush();
+    std::size_t k = 0;
+    for (; k < N; ++k) {
+      const std::size_t r = order == StorageOrder::RowMajor ? N - 1 - k : k;
+      if (++idx[r] < src.extent(r))
+        break;
+      idx[r] = 0;
+    }
+    if (k == N)
+      break;
+  }
+  if (!staging.empty())
+    flush();
+}
+
+template<class E>
+std::array<std::size_t, E::rank()>
+extents_array(const E& ext)
+{
+  std::array<std::size_t, E::rank()> dims{};
+  for (std::size_t r = 0; r < E::rank(); ++r)
+    dims[r] = std::size_t(ext.extent(r));
+  return dims;
+}
+
+} // namespace detail
+
+///@brief Reads a raw binary file holding the packed elements of 'dst', in
+/// storage order 'order', starting at byte 'offset'. Whole runs go straight
+/// into 'dst' when they are contiguous there, in reads of 'chunk' bytes.
+///
+///@param dst an ndarray or a writable ndspan of a strided layout
+template<StorageOrder order = StorageOrder::RowMajor,
+         class Dst,
+         REQUIRES(detail::is_io_array_v<Dst>)>
+void
+read_raw(const std::string& path,
+         Dst&& dst,
+         std::size_t offset = 0,
+         std::size_t chunk = default_io_chunk)
+{
+  const auto view = detail::io_view(dst);
+  const auto dims = detail::extents_array(view.extents());
+  const detail::binary_file file(path, O_RDONLY);
+  detail::read_box(file, offset, dims, order, {}, view, false, chunk);
+}
+
+///@brief Reads the box of a raw binary file starting at index 'first' with
+/// the extents of 'dst'. The file holds packed elements of extents
+/// 'file_extents' in storage order 'order' from byte 'offset' on.
+template<StorageOrder order = StorageOrder::RowMajor,
+         class F,
+         class Dst,
+         REQUIRES(detail::is_io_array_v<Dst>)>
+void
+read_raw(const std::string& path,
+         const F& file_extents,
+         const std::array<std::size_t, F::rank()>& first,
+         Dst&& dst,
+         std::size_t offset = 0,
+         std::size_t chunk = default_io_chunk)
+{
+  const auto view = detail::io_view(dst);
+  static_assert(decltype(view)::rank() == F::rank(),
+                "The box must have the rank of the file");
+  const detail::binary_file file(path, O_RDONLY);
+  detail::read_box(file,
+                   offset,
+                   detail::extents_array(file_extents),
+                   order,
+                   first,
+                   view,
+                   false,
+                   chunk);
+}
+
+///@brief Writes the elements of 'src' packed in storage order 'order' to a
+/// new raw binary file (truncating an existing one)
+template<StorageOrder order = StorageOrder::RowMajor,
+         class Src,
+         REQUIRES(detail::is_io_array_v<Src>)>
+void
+write_raw(const std::string& path,
+          const Src& src,
+          std::size_t chunk = default_io_chunk)
+{
+  const detail::binary_file file(path, O_WRONLY | O_CREAT | O_TRUNC);
+  detail::write_packed(file, 0, order, detail::io_view(src), chunk);
+}
+
+} // namespace nanda
+
+#endif // NANDA_BINARY_IO_HEADER
@@ -0,0 +1,82 @@
+#ifndef NANDA_BROADCAST_HEADER
+#define NANDA_BROADCAST_HEADER
+
+#include <array>
+#include <cstddef>
+#include <utility>
+
+#include "extents.hh"
+#include "layouts.hh"
+#include "ndarray.hh"
+#include "ndspan.hh"
+
+namespace nanda {
+
+///@brief A view of 'view' stretched to the extents 'ext' without copying,
+/// NumPy broadcasting. The leading axes 'view' lacks and its axes of extent 1
+/// get stride 0, every index along them reads the same elements; the other
+/// axes keep the shifts of the mapping (see get_shifts()).
+///
+/// The view is not unique, writing through it writes the same element more
+/// than once. The SIMD elementwise kernels take such operands as they are
+/// and read a stretched row once instead of once per output row.
+///
+///@param ext extents 'view' broadcasts to, see broadcastable()
+template<class T, class E, class L, class F>
+ndspan<T, dextents<typename F::index_type, F::rank()>, layout_stride>
+broadcast_to(const ndspan<T, E, L>& view, const F& ext)
+{
+  static_assert(ndspan<T, E, L>::mapping_type::is_always_strided(),
+                "Only views of a strided layout are broadcast");
+  static_assert(E::rank() <= F::rank(),
+                "A view cannot broadcast to a lower rank");
+  EXPECTS(broadcastable(view.extents(), ext));
+
+  using index_type = typename F::index_type;
+  using result_extents = dextents<index_type, F::rank()>;
+  const auto shifts = get_shifts(view.mapping());
+  std::array<index_type, E::rank()> strides{};
+  for (std::size_t r = 0; r < E::rank(); ++r)
+    strides[r] = index_type(shifts[r]);
+
+  std::array<index_type, F::rank()> dims{};
+  for (std::size_t r = 0; r < F::rank(); ++r)
+    dims[r] = index_type(ext.extent(r));
+  const result_extents target(dims);
+  return { view.data(),
+           layout_stride::mapping<result_extents>(
+             target, detail::broadcast_strides(view.extents(), strides, target)) };
+}
+
+template<class T, class E, class L, class A, class F>
+auto
+broadcast_to(ndarray<T, E, L, A>& arr, const F& ext)
+{
+  return broadcast_to(arr.view(), ext);
+}
+
+template<class T, class E, class L, class A, class F>
+auto
+broadcast_to(const ndarray<T, E, L, A>& arr, const F& ext)
+{
+  return broadcast_to(arr.view(), ext);
+}
+
+///@brief The view would outlive the array
+template<class T, class E, class L, class A, class F>
+void
+broadcast_to(ndarray<T, E, L, A>&& arr, const F& ext) = delete;
+
+///@brief Both operands broadcast to their common extents, see
+/// broadcast_extents()
+template<class A, class B>
+auto
+broadcast_views(const A& a, const B& b)
+{
+  const auto ext = broadcast_extents(a.extents(), b.extents());
+  return std::make_pair(broadcast_to(a, ext), broadcast_to(b, ext));
+}
+
+} // namespace nanda
+
+#endif // NANDA_BROADCAST_HEADER
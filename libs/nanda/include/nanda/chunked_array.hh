@@ -0,0 +1,761 @@
+#ifndef NANDA_CHUNKED_ARRAY_HEADER
+#define NANDA_CHUNKED_ARRAY_HEADER
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <list>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+
+#ifdef NANDA_HAS_LZ4
+#include <lz4.h>
+#endif
+#ifdef NANDA_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+#include "binary_io.hh"
+#include "index_algos.hh"
+#include "layouts.hh"
+#include "ndspan.hh"
+#include "npy.hh"
+
+namespace nanda {
+
+///@brief Compressor of the chunks of a chunked_array. lz4 and zstd are
+/// available when nanda is built with them (NANDA_HAS_LZ4, NANDA_HAS_ZSTD).
+enum class chunk_codec
+{
+  none,
+  lz4,
+  zstd
+};
+
+constexpr bool
+codec_available(chunk_codec codec) noexcept
+{
+  switch (codec) {
+    case chunk_codec::lz4:
+#ifdef NANDA_HAS_LZ4
+      return true;
+#else
+      return false;
+#endif
+    case chunk_codec::zstd:
+#ifdef NANDA_HAS_ZSTD
+      return true;
+#else
+      return false;
+#endif
+    default:
+      return true;
+  }
+}
+
+///@brief How the chunks of a chunked_array are encoded on disk
+struct chunk_options
+{
+  chunk_codec codec = chunk_codec::none;
+  ///@brief The zstd compression level, the lz4 acceleration
+  int level = 1;
+  ///@brief Stores the differences of consecutive elements, for integral
+  /// types only
+  bool delta = false;
+  ///@brief Groups the bytes of equal significance of the elements, which
+  /// compress better than whole elements
+  bool shuffle = false;
+};
+
+///@brief Bytes of decoded chunks a chunked_array keeps by default
+inline constexpr std::size_t default_chunk_cache = std::size_t(1) << 28;
+
+namespace detail {
+
+inline const char*
+codec_name(chunk_codec codec) noexcept
+{
+  switch (codec) {
+    case chunk_codec::lz4:
+      return "lz4";
+    case chunk_codec::zstd:
+      return "zstd";
+    default:
+      return "none";
+  }
+}
+
+inline chunk_codec
+parse_codec(const std::string& name)
+{
+  for (auto codec : { chunk_codec::none, chunk_codec::lz4, chunk_codec::zstd })
+    if (name == codec_name(codec))
+      return codec;
+  throw std::runtime_error("Unknown chunk codec " + name);
+}
+
+inline void
+check_codec(chunk_codec codec)
+{
+  if (!codec_available(codec))
+    throw std::runtime_error(std::string("nanda is built without ") +
+                             codec_name(codec));
+}
+
+///@brief dst[b * n + k] = byte b of element k of the 'n' elements of Size
+/// bytes of src
+template<std::size_t Size>
+void
+byte_shuffle(const char* src, char* dst, std::size_t n) noexcept
+{
+  for (std::size_t k = 0; k < n; ++k)
+    for (std::size_t b = 0; b < Size; ++b)
+      dst[b * n + k] = src[k * Size + b];
+}
+
+template<std::size_t Size>
+void
+byte_unshuffle(const char* src, char* dst, std::size_t n) noexcept
+{
+  for (std::size_t k = 0; k < n; ++k)
+    for (std::size_t b = 0; b < Size; ++b)
+      dst[k * Size + b] = src[b * n + k];
+}
+
+///@brief The differences of consecutive elements, in wrapping unsigned
+/// arithmetic so the round trip is exact
+template<class T>
+void
+delta_encode(T* data, std::size_t n) noexcept
+{
+  using U = std::make_unsigned_t<T>;
+  for (std::size_t k = n; k-- > 1;)
+    data[k] = T(U(data[k]) - U(data[k - 1]));
+}
+
+template<class T>
+void
+delta_decode(T* data, std::size_t n) noexcept
+{
+  using U = std::make_unsigned_t<T>;
+  for (std::size_t k = 1; k < n; ++k)
+    data[k] = T(U(data[k]) + U(data[k - 1]));
+}
+
+///@brief Compressor state reused across the chunks of one array
+class chunk_compressor
+{
+public:
+  ///@brief Compresses 'size' bytes of 'src' into 'out'
+  void compress(chunk_codec codec,
+                int level,
+                const char* src,
+                std::size_t size,
+                std::vector<char>& out)
+  {
+    switch (codec) {
+#ifdef NANDA_HAS_LZ4
+      case chunk_codec::lz4: {
+        check_lz4_size(size);
+        out.resize(std::size_t(LZ4_compressBound(int(size))));
+        const int n = LZ4_compress_fast(
+          src, out.data(), int(size), int(out.size()), std::max(level, 1));
+        if (n <= 0)
+          throw std::runtime_error("lz4 compression failed");
+        out.resize(std::size_t(n));
+        return;
+      }
+#endif
+#ifdef NANDA_HAS_ZSTD
+      case chunk_codec::zstd: {
+        if (!cctx_)
+          cctx_.reset(ZSTD_createCCtx());
+        out.resize(ZSTD_compressBound(size));
+        const auto n = ZSTD_compressCCtx(
+          cctx_.get(), out.data(), out.size(), src, size, level);
+        if (ZSTD_isError(n))
+          throw std::runtime_error(ZSTD_getErrorName(n));
+        out.resize(n);
+        return;
+      }
+#endif
+      case chunk_codec::none:
+        out.assign(src, src + size);
+        return;
+      default:
+        check_codec(codec);
+    }
+  }
+
+  ///@brief Decompresses 'size' bytes of 'src' into the 'expected' bytes of
+  /// 'dst'
+  void decompress(chunk_codec codec,
+                  const char* src,
+                  std::size_t size,
+                  char* dst,
+                  std::size_t expected)
+  {
+    switch (codec) {
+#ifdef NANDA_HAS_LZ4
+      case chunk_codec::lz4: {
+        check_lz4_size(expected);
+        const int n =
+          LZ4_decompress_safe(src, dst, int(size), int(expected));
+        if (n < 0 || std::size_t(n) != expected)
+          throw std::runtime_error("Corrupt lz4 chunk");
+        return;
+      }
+#endif
+#ifdef NANDA_HAS_ZSTD
+      case chunk_codec::zstd: {
+        if (!dctx_)
+          dctx_.reset(ZSTD_createDCtx());
+        const auto n =
+          ZSTD_decompressDCtx(dctx_.get(), dst, expected, src, size);
+        if (ZSTD_isError(n) || n != expected)
+          throw std::runtime_error("Corrupt zstd chunk");
+        return;
+      }
+#endif
+      case chunk_codec::none:
+        if (size != expected)
+          throw std::runtime_error("Corrupt chunk");
+        std::memcpy(dst, src, size);
+        return;
+      default:
+        check_codec(codec);
+    }
+  }
+
+private:
+#ifdef NANDA_HAS_LZ4
+  static void check_lz4_size(std::size_t size)
+  {
+    if (size > std::size_t(LZ4_MAX_INPUT_SIZE))
+      throw std::length_error("Chunk too large for lz4");
+  }
+#endif
+#ifdef NANDA_HAS_ZSTD
+  struct cctx_deleter
+  {
+    void operator()(ZSTD_CCtx* p) const noexcept { ZSTD_freeCCtx(p); }
+  };
+  struct dctx_deleter
+  {
+    void operator()(ZSTD_DCtx* p) const noexcept { ZSTD_freeDCtx(p); }
+  };
+  std::unique_ptr<ZSTD_CCtx, cctx_deleter> cctx_;
+  std::unique_ptr<ZSTD_DCtx, dctx_deleter> dctx_;
+#endif
+};
+
+} // namespace detail
+
+///@brief Chunk traffic of a chunked_array
+struct chunk_stats
+{
+  ///@brief Chunks decoded from their files
+  std::size_t loads = 0;
+  ///@brief Chunks encoded to their files
+  std::size_t stores = 0;
+  ///@brief Chunk accesses served by the cache
+  std::size_t hits = 0;
+  ///@brief Chunk files announced to the kernel ahead of their access
+  std::size_t readaheads = 0;
+};
+
+///@brief An N-d array of T stored in a directory as fixed N-d chunks, each
+/// its own file, for arrays larger than memory.
+///
+/// A chunk at chunk coordinates c is the file "c<k>", k the row-major
+/// flatten of c over the chunk grid; chunks never written are missing and
+/// read as the fill value. Chunks are encoded with 'chunk_options' and
+/// edge chunks are stored whole, padded with the fill value.
+///
+/// Reads and writes of a box go through an LRU cache of decoded chunks of
+/// bounded size and touch only the chunks the box overlaps. Dirty chunks
+/// are written back when evicted, by flush() and by the destructor, which
+/// ignores errors. When consecutive chunk accesses move by the same step,
+/// the files of the next chunks along that step are announced to the
+/// kernel so their reads overlap with the work on the current ones.
+///
+/// An array is not safe to use from several threads at once, nor are two
+/// arrays over one directory.
+template<class T, std::size_t N>
+class chunked_array
+{
+  static_assert(std::is_arithmetic_v<T>,
+                "Chunks hold elements of arithmetic types");
+  static_assert(N > 0, "Chunked arrays have rank 1 or more");
+
+public:
+  using value_type = T;
+  using extents_type = dims<N>;
+  using index_array = std::array<index_type, N>;
+
+  ///@brief Creates an array of extents 'ext' in chunks of 'chunk' in the
+  /// directory 'dir', which is created if missing and must not hold an
+  /// array yet
+  chunked_array(const std::filesystem::path& dir,
+                const extents_type& ext,
+                const extents_type& chunk,
+                const chunk_options& options = {},
+                std::size_t cache_bytes = default_chunk_cache,
+                T fill = T{})
+    : dir_{ dir }
+    , extents_{ ext }
+    , chunk_{ chunk }
+    , options_{ options }
+    , fill_{ fill }
+    , cache_bytes_{ cache_bytes }
+  {
+    detail::check_codec(options.codec);
+    if constexpr (!std::is_integral_v<T> || std::is_same_v<T, bool>)
+      if (options.delta)
+        throw std::invalid_argument("The delta filter takes integral types");
+    for (std::size_t r = 0; r < N; ++r)
+      if (chunk.extent(r) <= 0 || ext.extent(r) < 0)
+        throw std::invalid_argument("Chunk extents must be positive");
+    std::filesystem::create_directories(dir_);
+    if (std::filesystem::exists(metadata_path()))
+      throw std::runtime_error("A chunked array exists in " + dir_.string());
+    init_grid();
+    write_metadata();
+  }
+
+  ///@brief Opens the array of elements T and rank N in 'dir'
+  explicit chunked_array(const std::filesystem::path& dir,
+                         std::size_t cache_bytes = default_chunk_cache)
+    : dir_{ dir }
+    , cache_bytes_{ cache_bytes }
+  {
+    read_metadata();
+    detail::check_codec(options_.codec);
+    init_grid();
+  }
+
+  chunked_array(const chunked_array&) = delete;
+  chunked_array& operator=(const chunked_array&) = delete;
+
+  ~chunked_array()
+  {
+    try {
+      flush();
+    } catch (...) {
+    }
+  }
+
+  const std::filesystem::path& path() const noexcept { return dir_; }
+  const extents_type& extents() const noexcept { return extents_; }
+  index_type extent(std::size_t r) const noexcept { return extents_.extent(r); }
+  const extents_type& chunk_extents() const noexcept { return chunk_; }
+  ///@brief Number of chunks along each axis
+  const extents_type& grid_extents() const noexcept { return grid_; }
+  const chunk_options& options() const noexcept { return options_; }
+  T fill_value() const noexcept { return fill_; }
+  const chunk_stats& stats() const noexcept { return stats_; }
+
+  std::size_t size() const noexcept { return extents_.size(); }
+
+  ///@brief Bytes of the decoded chunks held by the cache
+  std::size_t cached_bytes() const noexcept
+  {
+    return cache_.size() * chunk_elements_ * sizeof(T);
+  }
+
+  ///@brief Chunks announced to the kernel ahead of a repeated step
+  void set_readahead(std::size_t chunks) noexcept { readahead_ = chunks; }
+
+  ///@brief Reads the box starting at 'first' with the extents of 'dst'
+  template<class Dst, REQUIRES(detail::is_io_array_v<Dst>)>
+  void read(const index_array& first, Dst&& dst)
+  {
+    const auto view = detail::io_view(dst);
+    for_each_chunk(first, view, false, [](auto chunk, auto box) {
+      copy(chunk, box);
+    });
+  }
+
+  ///@brief Writes 'src' to the box starting at 'first'
+  template<class Src, REQUIRES(detail::is_io_array_v<Src>)>
+  void write(const index_array& first, const Src& src)
+  {
+    const auto view = detail::io_view(src);
+    for_each_chunk(first, view, true, [](auto chunk, auto box) {
+      copy(box, chunk);
+    });
+  }
+
+  ///@brief Writes the dirty chunks of the cache to their files
+  void flush()
+  {
+    for (auto& entry : cache_)
+      if (entry.dirty) {
+        store(entry.key, entry.data);
+        entry.dirty = false;
+      }
+  }
+
+private:
+  struct cached_chunk
+  {
+    std::size_t key;
+    std::vector<T> data;
+    bool dirty;
+  };
+
+  using chunk_view = ndspan<T, extents_type, layout_stride>;
+
+  std::filesystem::path metadata_path() const { return dir_ / ".nanda_chunks"; }
+
+  std::filesystem::path chunk_path(std::size_t key) const
+  {
+    return dir_ / ("c" + std::to_string(key));
+  }
+
+  void init_grid()
+  {
+    index_array grid{};
+    chunk_elements_ = 1;
+    for (std::size_t r = 0; r < N; ++r) {
+      grid[r] = (extents_.extent(r) + chunk_.extent(r) - 1) / chunk_.extent(r);
+      chunk_elements_ *= std::size_t(chunk_.extent(r));
+    }
+    grid_ = extents_type(grid);
+    chunk_strides_ = get_shifts<StorageOrder::RowMajor>(chunk_);
+  }
+
+  void write_metadata() const
+  {
+    std::ofstream out(metadata_path());
+    out << "nanda_chunks 1\n"
+        << "dtype " << npy_descr<T>() << '\n'
+        << "shape";
+    for (std::size_t r = 0; r < N; ++r)
+      out << ' ' << extents_.extent(r);
+    out << "\nchunks";
+    for (std::size_t r = 0; r < N; ++r)
+      out << ' ' << chunk_.extent(r);
+    out << "\ncodec " << detail::codec_name(options_.codec) << '\n'
+        << "level " << options_.level << '\n'
+        << "delta " << options_.delta << '\n'
+        << "shuffle " << options_.shuffle << '\n'
+        << "fill " << std::setprecision(std::numeric_limits<T>::max_digits10)
+        << +fill_ << '\n';
+    if (!out)
+      throw std::runtime_error("Cannot write " + metadata_path().string());
+  }
+
+  void read_metadata()
+  {
+    std::ifstream in(metadata_path());
+    if (!in)
+      throw std::runtime_error("No chunked array in " + dir_.string());
+    std::string line, key;
+    index_array shape{}, chunk{};
+    const auto expect = [&](const char* name) {
+      if (!std::getline(in, line))
+        throw std::runtime_error("Truncated chunked array metadata");
+      std::istringstream fields(line);
+      fields >> key;
+      if (key != name)
+        throw std::runtime_error("Expected " + std::string(name) +
+                                 " in the chunked array metadata");
+      return fields;
+    };
+    {
+      auto version = expect("nanda_chunks");
+      int v = 0;
+      if (!(version >> v) || v != 1)
+        throw std::runtime_error("Unsupported chunked array version");
+    }
+    {
+      std::string descr;
+      expect("dtype") >> descr;
+      if (descr != npy_descr<T>())
+        throw std::runtime_error("Chunked array of " + descr + ", not " +
+                                 npy_descr<T>());
+    }
+    const auto read_extents = [&](const char* name, index_array& values) {
+      auto fields = expect(name);
+      for (auto& v : values)
+        if (!(fields >> v))
+          throw std::runtime_error("Chunked array rank mismatch");
+      std::string extra;
+      if (fields >> extra)
+        throw std::runtime_error("Chunked array rank mismatch");
+    };
+    read_extents("shape", shape);
+    read_extents("chunks", chunk);
+    extents_ = extents_type(shape);
+    chunk_ = extents_type(chunk);
+    std::string codec;
+    expect("codec") >> codec;
+    options_.codec = detail::parse_codec(codec);
+    expect("level") >> options_.level;
+    expect("delta") >> options_.delta;
+    expect("shuffle") >> options_.shuffle;
+    // strtold, unlike operator>>, reads back the nan and inf written
+    std::string fill;
+    if (!(expect("fill") >> fill))
+      throw std::runtime_error("No fill in the chunked array metadata");
+    char* end = nullptr;
+    errno = 0;
+    if constexpr (std::is_floating_point_v<T>)
+      fill_ = T(std::strtold(fill.c_str(), &end));
+    else if constexpr (std::is_signed_v<T>)
+      fill_ = T(std::strtoll(fill.c_str(), &end, 10));
+    else
+      fill_ = T(std::strtoull(fill.c_str(), &end, 10));
+    if (errno == ERANGE || end != fill.data() + fill.size())
+      throw std::runtime_error("Invalid fill " + fill +
+                               " in the chunked array metadata");
+  }
+
+  ///@brief Calls f(chunk part, box part) on the views of the intersection of
+  /// each chunk the box [first, first + view.extents()) overlaps and the box.
+  /// A written chunk is marked dirty, and not read when the box covers it.
+  template<class V, class F>
+  void for_each_chunk(const index_array& first,
+                      const V& view,
+                      bool writing,
+                      F&& f)
+  {
+    static_assert(V::rank() == N, "The box must have the rank of the array");
+    static_assert(V::mapping_type::is_always_strided(),
+                  "Only views of a strided layout are read and written");
+    index_array lo{}, hi{}, coord{};
+    for (std::size_t r = 0; r < N; ++r) {
+      if (first[r] < 0 || first[r] + view.extent(r) > extents_.extent(r))
+        throw std::out_of_range("Box past the extents of the chunked array");
+      if (view.extent(r) == 0)
+        return;
+      lo[r] = first[r] / chunk_.extent(r);
+      hi[r] = (first[r] + view.extent(r) - 1) / chunk_.extent(r);
+    }
+    coord = lo;
+    for (;;) {
+      // the intersection, in array coordinates
+      index_array begin{}, box{};
+      bool whole = true;
+      for (std::size_t r = 0; r < N; ++r) {
+        const index_type c0 = coord[r] * chunk_.extent(r);
+        const index_type c1 =
+          std::min(c0 + chunk_.extent(r), extents_.extent(r));
+        begin[r] = std::max(first[r], c0);
+        box[r] = std::min(first[r] + view.extent(r), c1) - begin[r];
+        whole = whole && begin[r] == c0 && begin[r] + box[r] == c1;
+      }
+      auto& entry = fetch(coord, writing && whole);
+      entry.dirty = entry.dirty || writing;
+
+      std::array<index_type, N> chunk_strides{}, view_strides{};
+      std::ptrdiff_t chunk_offset = 0, view_offset = 0;
+      for (std::size_t r = 0; r < N; ++r) {
+        chunk_strides[r] = index_type(chunk_strides_[r]);
+        view_strides[r] = index_type(view.stride(r));
+        chunk_offset += std::ptrdiff_t(begin[r] - coord[r] * chunk_.extent(r)) *
+                        std::ptrdiff_t(chunk_strides_[r]);
+        view_offset +=
+          std::ptrdiff_t(begin[r] - first[r]) * std::ptrdiff_t(view.stride(r));
+      }
+      const extents_type box_extents(box);
+      f(chunk_view(entry.data.data() + chunk_offset,
+                   layout_stride::mapping<extents_type>(box_extents,
+                                                        chunk_strides)),
+        ndspan<typename V::element_type, extents_type, layout_stride>(
+          view.data() + view_offset,
+          layout_stride::mapping<extents_type>(box_extents, view_strides)));
+
+      std::size_t r = N;
+      while (r-- > 0) {
+        if (++coord[r] <= hi[r])
+          break;
+        coord[r] = lo[r];
+      }
+      if (r == std::size_t(-1))
+        break;
+    }
+  }
+
+  ///@brief The cached chunk at 'coord', loaded unless 'overwrite'
+  cached_chunk& fetch(const index_array& coord, bool overwrite)
+  {
+    note_access(coord);
+    const auto key = std::size_t(flatten<StorageOrder::RowMajor>(coord, grid_));
+    if (const auto it = index_.find(key); it != index_.end()) {
+      ++stats_.hits;
+      cache_.splice(cache_.begin(), cache_, it->second);
+      return cache_.front();
+    }
+
+    // decoded before it is cached, a chunk that fails to load is not kept
+    std::vector<T> data(chunk_elements_, fill_);
+    if (!overwrite)
+      load(key, data);
+
+    // room for one more, at least the chunk asked for is kept
+    while (!cache_.empty() &&
+           (cache_.size() + 1) * chunk_elements_ * sizeof(T) > cache_bytes_) {
+      auto& last = cache_.back();
+      if (last.dirty)
+        store(last.key, last.data);
+      index_.erase(last.key);
+      cache_.pop_back();
+    }
+    cache_.push_front({ key, std::move(data), false });
+    index_[key] = cache_.begin();
+    return cache_.front();
+  }
+
+  void load(std::size_t key, std::vector<T>& data)
+  {
+    const auto path = chunk_path(key);
+    if (!std::filesystem::exists(path))
+      return;
+    ++stats_.loads;
+    const detail::binary_file file(path.string(), O_RDONLY);
+    const std::size_t bytes = chunk_elements_ * sizeof(T);
+    auto* out = reinterpret_cast<char*>(data.data());
+    if (options_.codec == chunk_codec::none && !options_.shuffle) {
+      if (file.size() != bytes)
+        throw std::runtime_error("Corrupt chunk " + path.string());
+      file.read_at(out, bytes, 0);
+    } else {
+      encoded_.resize(file.size());
+      file.read_at(encoded_.data(), encoded_.size(), 0);
+      if (options_.shuffle) {
+        shuffled_.resize(bytes);
+        compressor_.decompress(options_.codec,
+                               encoded_.data(),
+                               encoded_.size(),
+                               shuffled_.data(),
+                               bytes);
+        detail::byte_unshuffle<sizeof(T)>(
+          shuffled_.data(), out, chunk_elements_);
+      } else {
+        compressor_.decompress(
+          options_.codec, encoded_.data(), encoded_.size(), out, bytes);
+      }
+    }
+    if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>)
+      if (options_.delta)
+        detail::delta_decode(data.data(), data.size());
+  }
+
+  void store(std::size_t key, const std::vector<T>& data)
+  {
+    ++stats_.stores;
+    const std::size_t bytes = chunk_elements_ * sizeof(T);
+    const char* in = reinterpret_cast<const char*>(data.data());
+    std::vector<T> deltas;
+    if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>)
+      if (options_.delta) {
+        deltas = data;
+        detail::delta_encode(deltas.data(), deltas.size());
+        in = reinterpret_cast<const char*>(deltas.data());
+      }
+    if (options_.shuffle) {
+      shuffled_.resize(bytes);
+      detail::byte_shuffle<sizeof(T)>(in, shuffled_.data(), chunk_elements_);
+      in = shuffled_.data();
+    }
+    const char* out = in;
+    std::size_t size = bytes;
+    if (options_.codec != chunk_codec::none) {
+      compressor_.compress(options_.codec, options_.level, in, bytes, encoded_);
+      out = encoded_.data();
+      size = encoded_.size();
+    }
+
+    // a new file renamed over the chunk, which is never seen half written
+    const auto path = chunk_path(key);
+    auto partial = path;
+    partial += ".partial";
+    {
+      const detail::binary_file file(partial.string(),
+                                     O_WRONLY | O_CREAT | O_TRUNC);
+      file.write_at(out, size, 0);
+    }
+    std::filesystem::rename(partial, path);
+  }
+
+  ///@brief Announces the next chunk files when the access repeats its step
+  void note_access(const index_array& coord)
+  {
+    index_array step{};
+    bool moved = false;
+    for (std::size_t r = 0; r < N; ++r) {
+      step[r] = coord[r] - last_[r];
+      moved = moved || step[r] != 0;
+    }
+    const bool repeated = moved && step == step_;
+    last_ = coord;
+    step_ = step;
+    if (!repeated)
+      return;
+    auto next = coord;
+    for (std::size_t k = 0; k < readahead_; ++k) {
+      for (std::size_t r = 0; r < N; ++r) {
+        next[r] += step[r];
+        if (next[r] < 0 || next[r] >= grid_.extent(r))
+          return;
+      }
+      const auto key =
+        std::size_t(flatten<StorageOrder::RowMajor>(next, grid_));
+      if (index_.count(key) != 0)
+        continue;
+      const int fd = ::open(chunk_path(key).c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd < 0)
+        continue;
+#ifdef POSIX_FADV_WILLNEED
+      ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+      ::close(fd);
+      ++stats_.readaheads;
+    }
+  }
+
+  std::filesystem::path dir_;
+  extents_type extents_;
+  extents_type chunk_;
+  extents_type grid_;
+  chunk_options options_;
+  T fill_{};
+  std::size_t chunk_elements_ = 0;
+  std::array<std::size_t, N> chunk_strides_{};
+
+  std::size_t cache_bytes_;
+  std::list<cached_chunk> cache_;
+  std::unordered_map<std::size_t, typename std::list<cached_chunk>::iterator>
+    index_;
+
+  std::size_t readahead_ = 2;
+  index_array last_{};
+  index_array step_{};
+  chunk_stats stats_;
+
+  detail::chunk_compressor compressor_;
+  std::vector<char> encoded_;
+  std::vector<char> shuffled_;
+};
+
+} // namespace nanda
+
+#endif // NANDA_CHUNKED_ARRAY_HEADER
@@ -0,0 +1,536 @@
+#ifndef NANDA_EXPRESSION_HEADER
+#define NANDA_EXPRESSION_HEADER
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "concepts.hh"
+#include "extents.hh"
+#include "ndspan.hh"
+#include "utility.hh"
+
+namespace nanda {
+
+template<class T, class Extents, class Layout, class Allocator>
+class ndarray;
+
+///@brief Base of every lazy elementwise expression. Arithmetic, comparisons
+/// and the math functions below on arrays, views and expressions only build
+/// a tree of these nodes; the tree is evaluated element by element in a single
+/// loop when it is assigned (see assign()), without temporaries.
+///
+/// The nodes hold views, not arrays: the arrays an expression reads from must
+/// outlive it. Like any elementwise loop, the destination may be one of the
+/// operands but not an overlapping view with a different element order.
+template<class Derived>
+struct expression
+{
+  constexpr const Derived& derived() const noexcept
+  {
+    return static_cast<const Derived&>(*this);
+  }
+};
+
+namespace detail {
+
+template<class T>
+struct is_ndarray : std::false_type
+{};
+
+template<class T, class Extents, class Layout, class Allocator>
+struct is_ndarray<ndarray<T, Extents, Layout, Allocator>> : std::true_type
+{};
+
+template<class T>
+struct is_ndspan : std::false_type
+{};
+
+template<class T, class Extents, class Layout>
+struct is_ndspan<ndspan<T, Extents, Layout>> : std::true_type
+{};
+
+template<class T>
+inline constexpr bool is_expression_v =
+  std::is_base_of_v<expression<remove_cvref_t<T>>, remove_cvref_t<T>>;
+
+///@brief Arrays, views and expressions, the operands that have extents
+template<class T>
+inline constexpr bool is_array_operand_v =
+  is_expression_v<T> || is_ndarray<remove_cvref_t<T>>::value ||
+  is_ndspan<remove_cvref_t<T>>::value;
+
+template<class T>
+inline constexpr bool is_scalar_operand_v =
+  std::is_arithmetic_v<remove_cvref_t<T>>;
+
+///@brief At least one array operand, the other one may be a scalar
+template<class L, class R>
+inline constexpr bool is_binary_operands_v =
+  (is_array_operand_v<L> &&
+   (is_array_operand_v<R> || is_scalar_operand_v<R>)) ||
+  (is_scalar_operand_v<L> && is_array_operand_v<R>);
+
+///@brief An array that dies at the end of the full expression, the view an
+/// expression would keep of it dangles
+template<class T>
+inline constexpr bool is_temporary_array_v =
+  is_ndarray<remove_cvref_t<T>>::value && !std::is_lvalue_reference_v<T>;
+
+} // namespace detail
+
+///@brief Leaf reading the elements of a view
+template<class View>
+class view_expr : public expression<view_expr<View>>
+{
+public:
+  using value_type = typename View::value_type;
+  using extents_type = typename View::extents_type;
+
+  constexpr explicit view_expr(const View& view) noexcept
+    : view_{ view }
+  {}
+
+  constexpr const extents_type& extents() const noexcept
+  {
+    return view_.extents();
+  }
+
+  template<class Index>
+  constexpr value_type operator()(const Index& idx) const noexcept
+  {
+    if constexpr (std::is_same_v<Index, typename View::index_array>) {
+      return view_(idx);
+    } else {
+      typename View::index_array own{};
+      for (std::size_t r = 0; r < own.size(); ++r)
+        own[r] = typename View::index_type(idx[r]);
+      return view_(own);
+    }
+  }
+
+  ///@brief The k-th element in memory, see flat_compatible()
+  constexpr value_type operator[](std::size_t k) const noexcept
+  {
+    return view_.data()[k];
+  }
+
+  ///@brief Whether the elements are contiguous in the same order as those of
+  /// 'dst', so that the expression can be evaluated by flat offset
+  template<class Dst>
+  constexpr bool flat_compatible(const Dst& dst) const noexcept
+  {
+    return detail::same_contiguous_layout(view_, dst);
+  }
+
+private:
+  View view_;
+};
+
+///@brief Leaf broadcasting a scalar to every index
+template<class T>
+class scalar_expr : public expression<scalar_expr<T>>
+{
+public:
+  using value_type = T;
+  // a scalar takes the extents of the other operand
+  using extents_type = void;
+
+  constexpr explicit scalar_expr(T value) noexcept
+    : value_{ value }
+  {}
+
+  template<class Index>
+  constexpr value_type operator()(const Index&) const noexcept
+  {
+    return value_;
+  }
+
+  constexpr value_type operator[](std::size_t) const noexcept
+  {
+    return value_;
+  }
+
+  template<class Dst>
+  constexpr bool flat_compatible(const Dst&) const noexcept
+  {
+    return true;
+  }
+
+private:
+  T value_;
+};
+
+namespace detail {
+
+template<class T>
+struct is_scalar_expr : std::false_type
+{};
+
+template<class T>
+struct is_scalar_expr<scalar_expr<T>> : std::true_type
+{};
+
+} // namespace detail
+
+///@brief Applies Op to every element of Arg
+template<class Op, class Arg>
+class unary_expr : public expression<unary_expr<Op, Arg>>
+{
+public:
+  using value_type =
+    std::decay_t<decltype(Op{}(std::declval<typename Arg::value_type>()))>;
+  using extents_type = typename Arg::extents_type;
+
+  constexpr explicit unary_expr(const Arg& arg) noexcept
+    : arg_{ arg }
+  {}
+
+  constexpr const extents_type& extents() const noexcept
+  {
+    return arg_.extents();
+  }
+
+  template<class Index>
+  constexpr value_type operator()(const Index& idx) const
+  {
+    return Op{}(arg_(idx));
+  }
+
+  constexpr value_type operator[](std::size_t k) const
+  {
+    return Op{}(arg_[k]);
+  }
+
+  template<class Dst>
+  constexpr bool flat_compatible(const Dst& dst) const noexcept
+  {
+    return arg_.flat_compatible(dst);
+  }
+
+private:
+  Arg arg_;
+};
+
+namespace detail {
+
+///@brief Extents of a binary expression, the scalar operand has none
+template<class E, class F>
+struct binary_extents
+{
+  using type = broadcast_extents_t<E, F>;
+};
+
+template<class F>
+struct binary_extents<void, F>
+{
+  using type = F;
+};
+
+template<class E>
+struct binary_extents<E, void>
+{
+  using type = E;
+};
+
+///@brief The index of an operand of extents 'ext' read at 'idx' of the
+/// extents it broadcasts to: its axes align with the last ones of 'idx' and
+/// its axes of extent 1 always read index 0
+template<class E, class Index>
+constexpr std::array<typename E::index_type, E::rank()>
+broadcast_index(const Index& idx, const E& ext) noexcept
+{
+  constexpr std::size_t lead = std::tuple_size_v<Index> - E::rank();
+  std::array<typename E::index_type, E::rank()> own{};
+  for (std::size_t r = 0; r < E::rank(); ++r)
+    own[r] =
+      ext.extent(r) == 1 ? 0 : typename E::index_type(idx[r + lead]);
+  return own;
+}
+
+} // namespace detail
+
+///@brief Combines the elements of Lhs and Rhs with Op, one of the two may be
+/// a scalar. Operands of different extents broadcast against each other with
+/// the NumPy rules (see broadcast_extents()): the smaller one is read again
+/// along the axes it lacks or has extent 1 along, it is never expanded.
+template<class Op, class Lhs, class Rhs>
+class binary_expr : public expression<binary_expr<Op, Lhs, Rhs>>
+{
+  static constexpr bool lhs_scalar = detail::is_scalar_expr<Lhs>::value;
+  static constexpr bool rhs_scalar = detail::is_scalar_expr<Rhs>::value;
+
+public:
+  using value_type = std::decay_t<decltype(Op{}(
+    std::declval<typename Lhs::value_type>(),
+    std::declval<typename Rhs::value_type>()))>;
+  using extents_type =
+    typename detail::binary_extents<typename Lhs::extents_type,
+                                    typename Rhs::extents_type>::type;
+
+  constexpr binary_expr(const Lhs& lhs, const Rhs& rhs) noexcept
+    : lhs_{ lhs }
+    , rhs_{ rhs }
+    , extents_{ make_extents(lhs, rhs) }
+    , lhs_whole_{ is_whole(lhs) }
+    , rhs_whole_{ is_whole(rhs) }
+  {}
+
+  constexpr const extents_type& extents() const noexcept { return extents_; }
+
+  template<class Index>
+  constexpr value_type operator()(const Index& idx) const
+  {
+    return Op{}(at(lhs_, lhs_whole_, idx), at(rhs_, rhs_whole_, idx));
+  }
+
+  constexpr value_type operator[](std::size_t k) const
+  {
+    return Op{}(lhs_[k], rhs_[k]);
+  }
+
+  ///@brief Broadcast operands are never read by flat offset
+  template<class Dst>
+  constexpr bool flat_compatible(const Dst& dst) const noexcept
+  {
+    return lhs_whole_ && rhs_whole_ && lhs_.flat_compatible(dst) &&
+           rhs_.flat_compatible(dst);
+  }
+
+private:
+  static constexpr extents_type make_extents(const Lhs& lhs,
+                                             const Rhs& rhs) noexcept
+  {
+    if constexpr (lhs_scalar)
+      return rhs.extents();
+    else if constexpr (rhs_scalar)
+      return lhs.extents();
+    else
+      return broadcast_extents(lhs.extents(), rhs.extents());
+  }
+
+  ///@brief Whether 'arg' has the extents of the expression, it is then read
+  /// at the indices of the expression as they are
+  template<class Arg>
+  constexpr bool is_whole(const Arg& arg) const noexcept
+  {
+    if constexpr (detail::is_scalar_expr<Arg>::value)
+      return true;
+    else if constexpr (Arg::extents_type::rank() != extents_type::rank())
+      return false;
+    else
+      return arg.extents() == extents_;
+  }
+
+  template<class Arg, class Index>
+  static constexpr auto at(const Arg& arg, bool whole, const Index& idx)
+  {
+    if constexpr (detail::is_scalar_expr<Arg>::value) {
+      return arg(idx);
+    } else if constexpr (Arg::extents_type::rank() == extents_type::rank()) {
+      if (whole)
+        return arg(idx);
+      return arg(detail::broadcast_index(idx, arg.extents()));
+    } else {
+      return arg(detail::broadcast_index(idx, arg.extents()));
+    }
+  }
+
+  Lhs lhs_;
+  Rhs rhs_;
+  extents_type extents_;
+  bool lhs_whole_;
+  bool rhs_whole_;
+};
+
+namespace detail {
+
+template<class T>
+constexpr auto
+as_expression(const T& operand) noexcept
+{
+  if constexpr (is_expression_v<T>)
+    return operand;
+  else if constexpr (is_ndarray<T>::value)
+    return view_expr<typename T::const_view_type>(operand.view());
+  else if constexpr (is_ndspan<T>::value)
+    return view_expr<T>(operand);
+  else
+    return scalar_expr<T>(operand);
+}
+
+template<class Op, class Arg>
+constexpr auto
+make_unary(const Arg& arg) noexcept
+{
+  using arg_type = decltype(as_expression(arg));
+  return unary_expr<Op, arg_type>(as_expression(arg));
+}
+
+template<class Op, class L, class R>
+constexpr auto
+make_binary(const L& lhs, const R& rhs) noexcept
+{
+  using lhs_type = decltype(as_expression(lhs));
+  using rhs_type = decltype(as_expression(rhs));
+  return binary_expr<Op, lhs_type, rhs_type>(as_expression(lhs),
+                                             as_expression(rhs));
+}
+
+template<class T>
+constexpr auto
+abs_value(T x) noexcept
+{
+  return x < T(0) ? -x : x;
+}
+
+struct minimum_fn
+{
+  template<class T, class U>
+  constexpr auto operator()(T a, U b) const noexcept
+  {
+    return b < a ? b : a;
+  }
+};
+
+struct maximum_fn
+{
+  template<class T, class U>
+  constexpr auto operator()(T a, U b) const noexcept
+  {
+    return a < b ? b : a;
+  }
+};
+
+} // namespace detail
+
+///@brief Evaluates 'expr' into 'dst' in one loop. When every operand is
+/// contiguous with the element order of 'dst' the loop runs over flat offsets,
+/// otherwise over the multidimensional indices of 'dst'.
+template<class T, class E, class L, class Expr>
+void
+assign(const ndspan<T, E, L>& dst, const expression<Expr>& expr)
+{
+  const Expr& e = expr.derived();
+  static_assert(E::rank() == Expr::extents_type::rank(),
+                "The expression must have the rank of the destination");
+  EXPECTS(dst.extents() == e.extents());
+
+  if (dst.is_contiguous() && e.flat_compatible(dst)) {
+    T* out = dst.data();
+    const std::size_t n = dst.size();
+    for (std::size_t k = 0; k < n; ++k)
+      out[k] = T(e[k]);
+    return;
+  }
+
+  detail::for_each_index(dst.extents(),
+                         [&](const auto& idx) { dst(idx) = T(e(idx)); });
+}
+
+#define NANDA_EXPRESSION_UNARY_OPERATOR(op, functor)                           \
+  template<class A, REQUIRES(detail::is_array_operand_v<A>)>                   \
+  constexpr auto operator op(A&& arg) noexcept                                 \
+  {                                                                            \
+    static_assert(!detail::is_temporary_array_v<A>,                            \
+                  "An expression cannot keep a temporary array alive");        \
+    return detail::make_unary<functor>(arg);                                   \
+  }
+
+#define NANDA_EXPRESSION_BINARY_OPERATOR(op, functor)                          \
+  template<class L, class R, REQUIRES(detail::is_binary_operands_v<L, R>)>     \
+  constexpr auto operator op(L&& lhs, R&& rhs) noexcept                        \
+  {                                                                            \
+    static_assert(!detail::is_temporary_array_v<L> &&                          \
+                    !detail::is_temporary_array_v<R>,                          \
+                  "An expression cannot keep a temporary array alive");        \
+    return detail::make_binary<functor>(lhs, rhs);                             \
+  }
+
+NANDA_EXPRESSION_UNARY_OPERATOR(-, std::negate<>)
+NANDA_EXPRESSION_UNARY_OPERATOR(!, std::logical_not<>)
+
+NANDA_EXPRESSION_BINARY_OPERATOR(+, std::plus<>)
+NANDA_EXPRESSION_BINARY_OPERATOR(-, std::minus<>)
+NANDA_EXPRESSION_BINARY_OPERATOR(*, std::multiplies<>)
+NANDA_EXPRESSION_BINARY_OPERATOR(/, std::divides<>)
+NANDA_EXPRESSION_BINARY_OPERATOR(==, std::equal_to<>)
+NANDA_EXPRESSION_BINARY_OPERATOR(!=, std::not_equal_to<>)
+NANDA_EXPRESSION_BINARY_OPERATOR(<, std::less<>)
+NANDA_EXPRESSION_BINARY_OPERATOR(<=, std::less_equal<>)
+NANDA_EXPRESSION_BINARY_OPERATOR(>, std::greater<>)
+NANDA_EXPRESSION_BINARY_OPERATOR(>=, std::greater_equal<>)
+NANDA_EXPRESSION_BINARY_OPERATOR(&&, std::logical_and<>)
+NANDA_EXPRESSION_BINARY_OPERATOR(||, std::logical_or<>)
+
+#undef NANDA_EXPRESSION_UNARY_OPERATOR
+#undef NANDA_EXPRESSION_BINARY_OPERATOR
+
+// elementwise math functions, 'name'(x) calls std::'name' on every element
+
+#define NANDA_EXPRESSION_UNARY_FUNCTION(name, call)                            \
+  namespace detail {                                                           \
+  struct name##_fn                                                             \
+  {                                                                            \
+    template<class T>                                                          \
+    auto operator()(T x) const                                                 \
+    {                                                                          \
+      return call(x);                                                          \
+    }                                                                          \
+  };                                                                           \
+  }                                                                            \
+  template<class A, REQUIRES(detail::is_array_operand_v<A>)>                   \
+  constexpr auto name(A&& arg) noexcept                                        \
+  {                                                                            \
+    static_assert(!detail::is_temporary_array_v<A>,                            \
+                  "An expression cannot keep a temporary array alive");        \
+    return detail::make_unary<detail::name##_fn>(arg);                         \
+  }
+
+#define NANDA_EXPRESSION_BINARY_FUNCTION(name, functor)                        \
+  template<class L, class R, REQUIRES(detail::is_binary_operands_v<L, R>)>     \
+  constexpr auto name(L&& lhs, R&& rhs) noexcept                               \
+  {                                                                            \
+    static_assert(!detail::is_temporary_array_v<L> &&                          \
+                    !detail::is_temporary_array_v<R>,                          \
+                  "An expression cannot keep a temporary array alive");        \
+    return detail::make_binary<functor>(lhs, rhs);                             \
+  }
+
+NANDA_EXPRESSION_UNARY_FUNCTION(abs, detail::abs_value)
+NANDA_EXPRESSION_UNARY_FUNCTION(sqrt, std::sqrt)
+NANDA_EXPRESSION_UNARY_FUNCTION(cbrt, std::cbrt)
+NANDA_EXPRESSION_UNARY_FUNCTION(exp, std::exp)
+NANDA_EXPRESSION_UNARY_FUNCTION(log, std::log)
+NANDA_EXPRESSION_UNARY_FUNCTION(sin, std::sin)
+NANDA_EXPRESSION_UNARY_FUNCTION(cos, std::cos)
+NANDA_EXPRESSION_UNARY_FUNCTION(tan, std::tan)
+NANDA_EXPRESSION_UNARY_FUNCTION(tanh, std::tanh)
+NANDA_EXPRESSION_UNARY_FUNCTION(floor, std::floor)
+NANDA_EXPRESSION_UNARY_FUNCTION(ceil, std::ceil)
+
+namespace detail {
+struct pow_fn
+{
+  template<class T, class U>
+  auto operator()(T a, U b) const
+  {
+    return std::pow(a, b);
+  }
+};
+} // namespace detail
+
+NANDA_EXPRESSION_BINARY_FUNCTION(pow, detail::pow_fn)
+NANDA_EXPRESSION_BINARY_FUNCTION(minimum, detail::minimum_fn)
+NANDA_EXPRESSION_BINARY_FUNCTION(maximum, detail::maximum_fn)
+
+#undef NANDA_EXPRESSION_UNARY_FUNCTION
+#undef NANDA_EXPRESSION_BINARY_FUNCTION
+
+} // namespace nanda
+
+#endif // NANDA_EXPRESSION_HEADER
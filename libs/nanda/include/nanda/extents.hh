@@ -1,65 +1,425 @@
 #ifndef NANDA_EXTENTS_HEADER
 #define NANDA_EXTENTS_HEADER
 
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include "index_types.hh"
+#include "span.hh"
+
 namespace nanda {
 
+namespace detail {
+
+///@brief Storage for the dynamic extents only; empty when all extents are
+/// static so extents<I, 3, 3> is an empty (zero-overhead base) class
+template<class IndexType, std::size_t NDynamic>
+struct extents_storage
+{
+  std::array<IndexType, NDynamic> dynamic_extents_{};
+};
+
+template<class IndexType>
+struct extents_storage<IndexType, 0>
+{};
+
+template<class To, class From>
+constexpr bool is_narrowing_index_v =
+  std::numeric_limits<To>::max() < std::numeric_limits<From>::max();
+
+} // namespace detail
+
+///@brief Multidimensional index space of rank sizeof...(Extents). Extents known
+/// at compile time take no storage, only the dynamic_extent ones are stored.
+///
+///@tparam IndexType the integral type used for the extents
+///@tparam Extents the static extents, dynamic_extent for runtime ones
 template<class IndexType, std::size_t... Extents>
 class extents
+  : detail::extents_storage<IndexType,
+                            ((Extents == dynamic_extent) + ... + 0)>
 {
+  static_assert(std::is_integral_v<IndexType>,
+                "IndexType must be an integral type");
+
 public:
   using index_type = IndexType;
   using size_type = std::make_unsigned_t<index_type>;
   using rank_type = std::size_t;
 
+private:
+  using storage_type =
+    detail::extents_storage<IndexType,
+                            ((Extents == dynamic_extent) + ... + 0)>;
+
+  static constexpr std::array<std::size_t, sizeof...(Extents)>
+    static_extents_{ Extents... };
+
+public:
   // [mdspan.extents.obs], observers of the multidimensional index space
   static constexpr rank_type rank() noexcept { return sizeof...(Extents); }
   static constexpr rank_type rank_dynamic() noexcept
   {
-    return dynamic - index(rank());
+    return dynamic_index(rank());
+  }
+  static constexpr std::size_t static_extent(rank_type r) noexcept
+  {
+    return static_extents_[r];
+  }
+  constexpr index_type extent(rank_type r) const noexcept
+  {
+    if (static_extent(r) != dynamic_extent)
+      return index_type(static_extent(r));
+    if constexpr (rank_dynamic() == 0)
+      return 0; // unreachable, there is no dynamic extent to return
+    else
+      return this->dynamic_extents_[dynamic_index(r)];
   }
-  static constexpr std::size_t static_extent(rank_type) noexcept;
-  constexpr index_type extent(rank_type) const noexcept;
+
+  ///@brief True when no extent is dynamic_extent
+  static constexpr bool is_static() noexcept { return rank_dynamic() == 0; }
 
   // [mdspan.extents.cons], constructors
   constexpr extents() noexcept = default;
 
-  template<class OtherIndexType, std::size_t... OtherExtents>
-  constexpr explicit(see below)
-    extents(const extents<OtherIndexType, OtherExtents...>&) noexcept;
-  template<class... OtherIndexTypes>
-  constexpr explicit extents(OtherIndexTypes...) noexcept;
-  template<class OtherIndexType, std::size_t N>
-  constexpr explicit(N != rank_dynamic())
-    extents(span<OtherIndexType, N>) noexcept;
-  template<class OtherIndexType, std::size_t N>
-  constexpr explicit(N != rank_dynamic())
-    extents(const array<OtherIndexType, N>&) noexcept;
+  template<class OtherIndexType,
+           std::size_t... OtherExtents,
+           REQUIRES(sizeof...(OtherExtents) == sizeof...(Extents) &&
+                    ((OtherExtents == dynamic_extent ||
+                      Extents == dynamic_extent || OtherExtents == Extents) &&
+                     ...) &&
+                    !(((Extents != dynamic_extent &&
+                        OtherExtents == dynamic_extent) ||
+                       ...) ||
+                      detail::is_narrowing_index_v<index_type, OtherIndexType>))>
+  constexpr extents(const extents<OtherIndexType, OtherExtents...>& other) noexcept
+  {
+    assign_from(other, std::make_index_sequence<rank()>{});
+  }
+
+  template<class OtherIndexType,
+           std::size_t... OtherExtents,
+           REQUIRES(sizeof...(OtherExtents) == sizeof...(Extents) &&
+                    ((OtherExtents == dynamic_extent ||
+                      Extents == dynamic_extent || OtherExtents == Extents) &&
+                     ...) &&
+                    (((Extents != dynamic_extent &&
+                       OtherExtents == dynamic_extent) ||
+                      ...) ||
+                     detail::is_narrowing_index_v<index_type, OtherIndexType>))>
+  constexpr explicit extents(
+    const extents<OtherIndexType, OtherExtents...>& other) noexcept
+  {
+    assign_from(other, std::make_index_sequence<rank()>{});
+  }
+
+  template<class... OtherIndexTypes,
+           REQUIRES((sizeof...(OtherIndexTypes) > 0) &&
+                    (std::is_convertible_v<OtherIndexTypes, index_type> &&
+                     ...) &&
+                    (sizeof...(OtherIndexTypes) == rank_dynamic() ||
+                     sizeof...(OtherIndexTypes) == rank()))>
+  constexpr explicit extents(OtherIndexTypes... exts) noexcept
+  {
+    const std::array<index_type, sizeof...(OtherIndexTypes)> values{
+      index_type(exts)...
+    };
+    assign_from(values.data(), values.size());
+  }
+
+  template<class OtherIndexType,
+           std::size_t N,
+           REQUIRES(std::is_convertible_v<const OtherIndexType&, index_type> &&
+                    N == rank_dynamic())>
+  constexpr extents(const std::array<OtherIndexType, N>& exts) noexcept
+  {
+    assign_from(exts.data(), N);
+  }
+
+  template<class OtherIndexType,
+           std::size_t N,
+           REQUIRES(std::is_convertible_v<const OtherIndexType&, index_type> &&
+                    N != rank_dynamic() && N == rank())>
+  constexpr explicit extents(const std::array<OtherIndexType, N>& exts) noexcept
+  {
+    assign_from(exts.data(), N);
+  }
+
+  template<class OtherIndexType,
+           std::size_t N,
+           REQUIRES(std::is_convertible_v<const OtherIndexType&, index_type> &&
+                    N == rank_dynamic())>
+  constexpr extents(span<OtherIndexType, N> exts) noexcept
+  {
+    assign_from(exts.data(), N);
+  }
+
+  template<class OtherIndexType,
+           std::size_t N,
+           REQUIRES(std::is_convertible_v<const OtherIndexType&, index_type> &&
+                    N != rank_dynamic() && N == rank())>
+  constexpr explicit extents(span<OtherIndexType, N> exts) noexcept
+  {
+    assign_from(exts.data(), N);
+  }
 
   // [mdspan.extents.cmp], comparison operators
   template<class OtherIndexType, std::size_t... OtherExtents>
   friend constexpr bool operator==(
-    const extents&,
-    const extents<OtherIndexType, OtherExtents...>&) noexcept;
-
-  // [mdspan.extents.expo], exposition-only helpers
-  //   constexpr std::size_t fwd - prod - of -
-  //     extents(rank_type) const noexcept; // exposition only
-  //   constexpr std::size_t rev - prod - of -
-  //     extents(rank_type) const noexcept; // exposition only
-  //   template<class OtherIndexType>
-  //     static constexpr auto index -
-  //     cast(OtherIndexType&&) noexcept; // exposition only
+    const extents& lhs,
+    const extents<OtherIndexType, OtherExtents...>& rhs) noexcept
+  {
+    if constexpr (sizeof...(OtherExtents) != rank()) {
+      return false;
+    } else {
+      for (rank_type r = 0; r < rank(); ++r)
+        if (std::size_t(lhs.extent(r)) != std::size_t(rhs.extent(r)))
+          return false;
+      return true;
+    }
+  }
+
+  template<class OtherIndexType, std::size_t... OtherExtents>
+  friend constexpr bool operator!=(
+    const extents& lhs,
+    const extents<OtherIndexType, OtherExtents...>& rhs) noexcept
+  {
+    return !(lhs == rhs);
+  }
+
+  ///@brief Product of the extents [0, r), the shift of direction r in
+  /// column-major (FORTRAN-style) order
+  constexpr size_type fwd_prod_of_extents(rank_type r) const noexcept
+  {
+    if constexpr (is_static()) {
+      return static_fwd_prod(r);
+    } else {
+      size_type prod = 1;
+      for (rank_type i = 0; i < r; ++i)
+        prod *= size_type(extent(i));
+      return prod;
+    }
+  }
+
+  ///@brief Product of the extents (r, rank), the shift of direction r in
+  /// row-major (C-style) order
+  constexpr size_type rev_prod_of_extents(rank_type r) const noexcept
+  {
+    if constexpr (is_static()) {
+      return static_rev_prod(r);
+    } else {
+      size_type prod = 1;
+      for (rank_type i = r + 1; i < rank(); ++i)
+        prod *= size_type(extent(i));
+      return prod;
+    }
+  }
+
+  ///@brief Total number of indices in the index space
+  constexpr size_type size() const noexcept
+  {
+    return fwd_prod_of_extents(rank());
+  }
+
+  ///@brief Converts the extents to a plain array of all rank() extents
+  constexpr std::array<index_type, sizeof...(Extents)> to_array() const noexcept
+  {
+    std::array<index_type, sizeof...(Extents)> out{};
+    for (rank_type r = 0; r < rank(); ++r)
+      out[r] = extent(r);
+    return out;
+  }
+
+  template<class OtherIndexType>
+  static constexpr auto index_cast(OtherIndexType&& i) noexcept
+  {
+    return index_type(std::forward<OtherIndexType>(i));
+  }
 
 private:
-  //   static constexpr rank_type dynamic -
-  //     index(rank_type) noexcept; // exposition only
-  //   static constexpr rank_type dynamic - index -
-  //     inv(rank_type) noexcept;                             // exposition only
-  //   array<index_type, rank_dynamic()> dynamic - extents{}; // exposition only
+  template<class, std::size_t...>
+  friend class extents;
+
+  ///@brief Number of dynamic extents among the first r extents
+  static constexpr rank_type dynamic_index(rank_type r) noexcept
+  {
+    rank_type count = 0;
+    for (rank_type i = 0; i < r; ++i)
+      count += static_extents_[i] == dynamic_extent;
+    return count;
+  }
+
+  ///@brief Position of the i'th dynamic extent among all extents
+  static constexpr rank_type dynamic_index_inv(rank_type i) noexcept
+  {
+    for (rank_type r = 0; r < rank(); ++r)
+      if (static_extents_[r] == dynamic_extent && i-- == 0)
+        return r;
+    return rank();
+  }
+
+  static constexpr size_type static_fwd_prod(rank_type r) noexcept
+  {
+    size_type prod = 1;
+    for (rank_type i = 0; i < r; ++i)
+      prod *= size_type(static_extents_[i]);
+    return prod;
+  }
+
+  static constexpr size_type static_rev_prod(rank_type r) noexcept
+  {
+    size_type prod = 1;
+    for (rank_type i = r + 1; i < rank(); ++i)
+      prod *= size_type(static_extents_[i]);
+    return prod;
+  }
+
+  // 'values' holds either the rank_dynamic() dynamic extents or all rank()
+  // extents
+  template<class OtherIndexType>
+  constexpr void assign_from(const OtherIndexType* values,
+                             [[maybe_unused]] std::size_t n) noexcept
+  {
+    if constexpr (rank_dynamic() > 0) {
+      for (rank_type i = 0; i < rank_dynamic(); ++i)
+        this->dynamic_extents_[i] =
+          index_type(n == rank() ? values[dynamic_index_inv(i)] : values[i]);
+    }
+    if (n == rank()) {
+      for ([[maybe_unused]] rank_type r = 0; r < rank(); ++r)
+        EXPECTS(static_extent(r) == dynamic_extent ||
+                std::size_t(values[r]) == static_extent(r));
+    }
+  }
+
+  template<class Other, std::size_t... Rs>
+  constexpr void assign_from(const Other& other,
+                             std::index_sequence<Rs...>) noexcept
+  {
+    const std::array<index_type, rank()> values{ index_type(
+      other.extent(Rs))... };
+    assign_from(values.data(), values.size());
+  }
 };
 
-// template<class... Integrals>
-// explicit extents(Integrals...)->see below;
+namespace detail {
+
+template<class IndexType, class Seq>
+struct make_dextents;
+
+template<class IndexType, std::size_t... Rs>
+struct make_dextents<IndexType, std::index_sequence<Rs...>>
+{
+  using type = extents<IndexType, ((void)Rs, dynamic_extent)...>;
+};
+
+template<class T>
+struct is_extents : std::false_type
+{};
+
+template<class IndexType, std::size_t... Extents>
+struct is_extents<extents<IndexType, Extents...>> : std::true_type
+{};
+
+} // namespace detail
+
+///@brief Extents of rank 'Rank' with all extents dynamic
+template<class IndexType, std::size_t Rank>
+using dextents =
+  typename detail::make_dextents<IndexType,
+                                 std::make_index_sequence<Rank>>::type;
+
+///@brief Extents of rank 'Rank' with all extents dynamic in the default
+/// (64 bit) index type, see index_type_for_t
+template<std::size_t Rank, class IndexType = index_type>
+using dims = dextents<IndexType, Rank>;
+
+///@brief Extents in the narrowest index type addressing all their elements:
+/// 32 bit when the static size fits, 64 bit once it does not or an extent is
+/// dynamic, see index_type_for_t
+template<std::size_t... Extents>
+using extents_for = extents<index_type_for_t<Extents...>, Extents...>;
+
+template<class T>
+inline constexpr bool is_extents_v = detail::is_extents<remove_cvref_t<T>>::value;
+
+///@brief Whether arrays of extents 'a' and 'b' broadcast against each other
+/// (the NumPy rules): aligned on their last axes, every pair of extents is
+/// equal or one of them is 1, missing leading axes count as 1
+template<class E, class F>
+constexpr bool
+broadcastable(const E& a, const F& b) noexcept
+{
+  constexpr std::size_t rank = E::rank() < F::rank() ? E::rank() : F::rank();
+  for (std::size_t k = 1; k <= rank; ++k) {
+    const auto ea = std::size_t(a.extent(E::rank() - k));
+    const auto eb = std::size_t(b.extent(F::rank() - k));
+    if (ea != eb && ea != 1 && eb != 1)
+      return false;
+  }
+  return true;
+}
+
+///@brief The extents 'a' and 'b' broadcast to: the same type for equal
+/// types, dynamic extents of the larger rank otherwise
+template<class E, class F>
+using broadcast_extents_t = std::conditional_t<
+  std::is_same_v<E, F>,
+  E,
+  dextents<std::common_type_t<typename E::index_type, typename F::index_type>,
+           (E::rank() < F::rank() ? F::rank() : E::rank())>>;
+
+///@brief The extents of the result of an elementwise operation between
+/// arrays of extents 'a' and 'b', see broadcastable()
+template<class E, class F>
+constexpr broadcast_extents_t<E, F>
+broadcast_extents(const E& a, const F& b) noexcept
+{
+  EXPECTS(broadcastable(a, b));
+  using result_type = broadcast_extents_t<E, F>;
+  constexpr std::size_t rank = result_type::rank();
+  std::array<typename result_type::index_type, rank> dims{};
+  for (std::size_t k = 1; k <= rank; ++k) {
+    const auto ea = k <= E::rank() ? a.extent(E::rank() - k) : 1;
+    const auto eb = k <= F::rank() ? b.extent(F::rank() - k) : 1;
+    dims[rank - k] = typename result_type::index_type(ea == 1 ? eb : ea);
+  }
+  return result_type(dims);
+}
+
+namespace detail {
+
+///@brief Strides reading an operand of extents 'from' and strides 'strides'
+/// at the indices of the extents 'to' it broadcasts to: 0 along the leading
+/// axes it lacks and along its axes of extent 1 stretched to more
+template<class Stride, class E, class F>
+constexpr std::array<Stride, F::rank()>
+broadcast_strides(const E& from,
+                  const std::array<Stride, E::rank()>& strides,
+                  const F& to) noexcept
+{
+  static_assert(E::rank() <= F::rank(),
+                "An operand cannot broadcast to a lower rank");
+  constexpr std::size_t lead = F::rank() - E::rank();
+  std::array<Stride, F::rank()> result{};
+  for (std::size_t r = lead; r < F::rank(); ++r) {
+    const auto extent = std::size_t(from.extent(r - lead));
+    EXPECTS(extent == std::size_t(to.extent(r)) || extent == 1);
+    result[r] = extent == std::size_t(to.extent(r)) ? strides[r - lead] : 0;
+  }
+  return result;
+}
+
+} // namespace detail
+
+template<class... Integrals>
+explicit extents(Integrals...)
+  -> extents<index_type_for_t<((void)sizeof(Integrals), dynamic_extent)...>,
+             ((void)sizeof(Integrals), dynamic_extent)...>;
+
 } // namespace nanda
 
-#endif
\ No newline at end of file
+#endif // NANDA_EXTENTS_HEADER
@@ -0,0 +1,246 @@
+#ifndef NANDA_FAST_DIVISION_HEADER
+#define NANDA_FAST_DIVISION_HEADER
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "index_algos.hh"
+#include "rank.hh"
+#include "span.hh"
+
+namespace nanda {
+
+namespace detail {
+
+template<class UInt>
+struct wide_uint;
+
+template<>
+struct wide_uint<std::uint32_t>
+{
+  using type = std::uint64_t;
+};
+
+template<>
+struct wide_uint<std::uint64_t>
+{
+  using type = unsigned __int128;
+};
+
+template<class UInt>
+constexpr int
+floor_log2(UInt d) noexcept
+{
+  int log = -1;
+  for (; d != 0; d >>= 1)
+    ++log;
+  return log;
+}
+
+} // namespace detail
+
+///@brief Unsigned division by a runtime invariant divisor, computed once as a
+/// multiply-high plus shift. The quotient is exact for every numerator of
+/// type UInt.
+///
+/// 32 bit numerators use a 64 bit reciprocal ceil(2^64 / d) and no shift at
+/// all (Lemire, Kaser, Kurz, "Faster remainder by direct computation"), which
+/// is branch free. 64 bit numerators use the libdivide scheme: a 64 bit magic
+/// number, a shift and, for some divisors, an add-back of the 65th bit.
+///
+///@tparam UInt std::uint32_t or std::uint64_t
+template<class UInt>
+class divider
+{
+  static_assert(std::is_same_v<UInt, std::uint32_t> ||
+                  std::is_same_v<UInt, std::uint64_t>,
+                "divider supports 32 and 64 bit unsigned integers");
+
+  using wide_type = typename detail::wide_uint<UInt>::type;
+
+  static constexpr int bits = std::numeric_limits<UInt>::digits;
+  static constexpr std::uint8_t shift_mask = 0x3f;
+  static constexpr std::uint8_t add_marker = 0x40;
+  static constexpr std::uint8_t shift_only = 0x80;
+
+public:
+  using value_type = UInt;
+
+  constexpr divider() noexcept
+    : divider(1)
+  {}
+
+  constexpr explicit divider(UInt d) noexcept
+    : divisor_{ d }
+  {
+    EXPECTS(d != 0);
+
+    if constexpr (bits == 32) {
+      // wraps to 0 for d == 1, the quotient is then or-ed in by 'one_mask_'
+      magic_ = std::numeric_limits<std::uint64_t>::max() / d + 1;
+      one_mask_ = d == 1 ? ~UInt(0) : UInt(0);
+    } else {
+      const int log = detail::floor_log2(d);
+
+      if ((d & (d - 1)) == 0) {
+        // powers of two are a plain shift
+        more_ = std::uint8_t(log) | shift_only;
+        return;
+      }
+
+      // 2^(bits + log) / d, the quotient fits in UInt since d > 2^log
+      const wide_type numerator = wide_type(1) << (bits + log);
+      UInt proposed = UInt(numerator / d);
+      const UInt rem = UInt(numerator % d);
+      const UInt e = d - rem;
+
+      if (e < (UInt(1) << log)) {
+        // 2^log + 1 bits of precision are enough
+        more_ = std::uint8_t(log);
+      } else {
+        // a bits + 1 bit multiplier, the extra bit is added back in divide()
+        proposed += proposed;
+        const UInt twice_rem = rem + rem;
+        if (twice_rem >= d || twice_rem < rem)
+          proposed += 1;
+        more_ = std::uint8_t(log) | add_marker;
+      }
+      magic_ = proposed + 1;
+    }
+  }
+
+  constexpr UInt divisor() const noexcept { return divisor_; }
+
+  ///@brief n / divisor()
+  constexpr UInt divide(UInt n) const noexcept
+  {
+    if constexpr (bits == 32) {
+      using u128 = unsigned __int128;
+      return UInt((u128(magic_) * n) >> 64) | (n & one_mask_);
+    } else {
+      if (more_ & shift_only)
+        return n >> (more_ & shift_mask);
+
+      const UInt q = UInt((wide_type(magic_) * n) >> bits);
+      if (more_ & add_marker) {
+        const UInt t = ((n - q) >> 1) + q;
+        return t >> (more_ & shift_mask);
+      }
+      return q >> more_;
+    }
+  }
+
+  friend constexpr UInt operator/(UInt n, const divider& d) noexcept
+  {
+    return d.divide(n);
+  }
+
+private:
+  UInt divisor_ = 1;
+  std::uint64_t magic_ = 0;
+  UInt one_mask_ = 0;
+  std::uint8_t more_ = 0;
+};
+
+///@brief Flat to multidimensional index conversion for a fixed shape. The
+/// shifts and their reciprocals are computed once, each division of
+/// fast_unflatten becomes a multiply-high plus shift. The result is identical
+/// to unflatten for every valid flat index.
+///
+///@tparam storage storage order
+///@tparam N rank of the index space
+///@tparam IndexType type of the flat and multidimensional indices, 32 bit
+/// types divide with the cheaper branch free scheme
+template<StorageOrder storage, std::size_t N, class IndexType = index_type>
+class unflattener
+{
+  using unsigned_index = std::conditional_t<(sizeof(IndexType) <= 4),
+                                            std::uint32_t,
+                                            std::uint64_t>;
+
+public:
+  using index_type = IndexType;
+  using index_array = std::array<index_type, N>;
+
+  constexpr unflattener() noexcept = default;
+
+  template<class Dims, REQUIRES(Rank<Dims>::value == N)>
+  constexpr explicit unflattener(const Dims& dims)
+    : size_{ index_type(detail::dims_size(dims)) }
+  {
+    detail::check_index_range<index_type>(dims);
+    const auto shifts = get_shifts<storage>(dims);
+    for (std::size_t i = 0; i < N; ++i) {
+      mult_[i] = index_type(shifts[i]);
+      // a zero shift only happens for an empty index space
+      div_[i] = divider<unsigned_index>(
+        unsigned_index(shifts[i] == 0 ? 1 : shifts[i]));
+    }
+  }
+
+  constexpr index_type size() const noexcept { return size_; }
+
+  ///@brief The multidimensional index of flat index 'idx'
+  constexpr index_array operator()(index_type idx) const noexcept
+  {
+    runtime_assert(idx >= 0 && idx < size_, "Index out of bounds");
+
+    // the fastest running direction has a unit shift, what is left of the
+    // flat index after the slower directions is its index
+    index_array md_idx{};
+    if constexpr (N == 0) {
+      return md_idx;
+    } else if constexpr (storage == StorageOrder::RowMajor) {
+      for (std::size_t i = 0; i + 1 < N; ++i)
+        step(i, idx, md_idx);
+      md_idx[N - 1] = idx;
+    } else {
+      for (std::size_t i = N - 1; i > 0; --i)
+        step(i, idx, md_idx);
+      md_idx[0] = idx;
+    }
+    return md_idx;
+  }
+
+  ///@brief Converts every flat index of 'flat' into 'out'
+  void operator()(span<const index_type> flat, span<index_array> out) const
+  {
+    EXPECTS(flat.size() == out.size());
+    const index_type* in = flat.data();
+    index_array* res = out.data();
+    const std::size_t n = flat.size();
+    for (std::size_t k = 0; k < n; ++k)
+      res[k] = (*this)(in[k]);
+  }
+
+private:
+  constexpr void step(std::size_t i,
+                      index_type& idx,
+                      index_array& md_idx) const noexcept
+  {
+    md_idx[i] = index_type(div_[i].divide(unsigned_index(idx)));
+    idx -= md_idx[i] * mult_[i];
+  }
+
+  std::array<divider<unsigned_index>, N> div_{};
+  std::array<index_type, N> mult_{};
+  index_type size_ = 0;
+};
+
+///@brief Builds an unflattener for 'dims', with the index_type of 'dims' if
+/// it is a nanda::extents and nanda::index_type otherwise
+template<StorageOrder storage, class Dims>
+constexpr auto
+make_unflattener(const Dims& dims)
+{
+  return unflattener<storage, Rank<Dims>::value, detail::dims_index_t<Dims>>{
+    dims
+  };
+}
+
+} // namespace nanda
+
+#endif // NANDA_FAST_DIVISION_HEADER
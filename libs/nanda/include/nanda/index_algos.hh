@@ -2,8 +2,12 @@
 #define NANDA_INDEX_ALGOS_HEADER
 
 #include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <numeric>
+#include <type_traits>
 
+#include "extents.hh"
 #include "rank.hh"
 
 namespace nanda {
@@ -28,20 +32,113 @@ get_shift(Dim dim)
 
   static_assert(I < rank(dim), "Shift index out of bounds");
 
-  if constexpr (storage == StorageOrder::RowMajor) {
+  // extents fold the products to constants when they are static
+  if constexpr (is_extents_v<Dim>) {
+    if constexpr (storage == StorageOrder::RowMajor)
+      return dim.rev_prod_of_extents(I);
+    else
+      return dim.fwd_prod_of_extents(I);
+  } else if constexpr (storage == StorageOrder::RowMajor) {
 
     return std::accumulate(std::begin(dim) + I + 1,
                            std::end(dim),
                            std::size_t(1),
                            std::multiplies<std::size_t>{});
+  } else {
+
+    return std::accumulate(std::begin(dim),
+                           std::begin(dim) + I,
+                           std::size_t(1),
+                           std::multiplies<std::size_t>{});
   }
+}
+
+namespace detail {
+
+///@brief Extent of direction i of either a nanda::extents or an array of
+/// dimensions
+template<class Dim>
+constexpr size_type
+dims_extent(const Dim& dim, std::size_t i)
+{
+  if constexpr (is_extents_v<Dim>)
+    return size_type(dim.extent(i));
+  else
+    return size_type(dim[i]);
+}
 
-  return std::accumulate(std::begin(dim),
-                         std::begin(dim) + I,
-                         std::size_t(1),
-                         std::multiplies<std::size_t>{});
+///@brief Total number of elements spanned by the dimensions
+template<class Dim>
+constexpr size_type
+dims_size(const Dim& dim)
+{
+  if constexpr (is_extents_v<Dim>)
+    return size_type(dim.size());
+  else
+    return std::accumulate(std::begin(dim),
+                           std::end(dim),
+                           size_type(1),
+                           std::multiplies<size_type>{});
+}
+
+///@brief The extents of 'dim' as an array of IndexType
+template<class IndexType, class Dim>
+constexpr std::array<IndexType, Rank<Dim>::value>
+dims_array(const Dim& dim)
+{
+  std::array<IndexType, Rank<Dim>::value> out{};
+  for (std::size_t i = 0; i < out.size(); ++i)
+    out[i] = IndexType(dims_extent(dim, i));
+  return out;
 }
 
+///@brief Signed element type of an index array, the type flat indices are
+/// computed in
+template<class Idx>
+using index_value_t =
+  std::make_signed_t<remove_cvref_t<decltype(std::declval<const Idx&>()[0])>>;
+
+///@brief Index type used for the dimensions 'Dim': the index_type of a
+/// nanda::extents, nanda::index_type for plain arrays of dimensions
+template<class Dim, class = void>
+struct dims_index
+{
+  using type = index_type;
+};
+
+template<class Dim>
+struct dims_index<Dim, std::enable_if_t<is_extents_v<Dim>>>
+{
+  using type = typename Dim::index_type;
+};
+
+template<class Dim>
+using dims_index_t = typename dims_index<Dim>::type;
+
+///@brief Debug builds throw if a stride or the size of 'dim' is not
+/// representable in IndexType. The products are formed here since the
+/// size_type of extents is only as wide as its index type and would wrap.
+template<class IndexType, class Dim>
+constexpr void
+check_index_range([[maybe_unused]] const Dim& dim)
+{
+#ifdef DEBUG
+  constexpr auto max = std::uintmax_t(std::numeric_limits<IndexType>::max());
+  std::uintmax_t prod = 1;
+  for (std::size_t i = 0; i < Rank<Dim>::value; ++i) {
+    // the largest stride skips the empty directions
+    const auto extent = std::uintmax_t(dims_extent(dim, i));
+    if (extent == 0)
+      continue;
+    runtime_assert(prod <= max / extent,
+                   "Index type too narrow for the array extents");
+    prod *= extent;
+  }
+#endif
+}
+
+} // namespace detail
+
 template<StorageOrder storage, class Dim, std::size_t... Is>
 static constexpr auto
 get_shifts(Dim dim, std::index_sequence<Is...>)
@@ -66,20 +163,26 @@ get_shifts(Dim dim)
 
 ///@brief Given an array of multidimensional indices ([k,j,i] for example)
 /// computes the flat index based on the storage order, dimensions and
-/// precomputed shifts in each direction
+/// precomputed shifts in each direction. The arithmetic is carried out in the
+/// (signed) element type of 'idx', pass 64 bit indices for arrays with more
+/// than 2^31 elements.
 ///
 ///@tparam storage storage order
 ///@param idx array of indices to flatten
 ///@param dim the maximum extent of the multidimensional array
 ///@param mult precomputed shifts of the dimensions
-///@return constexpr index_type the flat index
+///@return constexpr the flat index, of the index type of 'idx'
 template<class Idx, class Dim, class Mult>
-static constexpr index_type
+static constexpr detail::index_value_t<Idx>
 fast_flatten(Idx idx, Dim dim, Mult mult)
 {
+  using flat_type = detail::index_value_t<Idx>;
   // runtime_assert(indices_in_bounds(idx, dim), "Index out of bounds");
-  return std::inner_product(
-    std::begin(idx), std::end(idx), std::begin(mult), index_type(0));
+  // plain loop rather than std::inner_product, which is not constexpr in C++17
+  flat_type flat = 0;
+  for (std::size_t i = 0; i < std::size(idx); ++i)
+    flat += flat_type(idx[i]) * flat_type(mult[i]);
+  return flat;
 }
 
 ///@brief Given an array of multidimensional indices ([k,j,i] for example)
@@ -88,47 +191,49 @@ fast_flatten(Idx idx, Dim dim, Mult mult)
 ///@tparam storage storage order
 ///@param idx array of indices to flatten
 ///@param dim the maximum extent of the multidimensional array
-///@return constexpr index_type the flat index
+///@return constexpr the flat index, of the index type of 'idx'
 template<StorageOrder storage, class Idx, class Dim>
-static constexpr index_type
+static constexpr detail::index_value_t<Idx>
 flatten(Idx idx, Dim dim)
 {
   return fast_flatten(idx, dim, get_shifts<storage>(dim));
 }
 
 ///@brief Given a flat index 'idx', dimensions 'dims' and precomputed shifts,
-/// computes the unflattened (multidimensional) index.
+/// computes the unflattened (multidimensional) index. The arithmetic is
+/// carried out in the type of 'idx'.
 ///
 ///@tparam storage storage order
 ///@param idx index to unflatten
 ///@param dims maximum extent of the multidimensional indices
-///@return constexpr std::array<index_type, N> array of multidimensional indices
-template<StorageOrder storage, class Dims, class Mult>
+///@return constexpr std::array<IndexType, N> array of multidimensional indices
+template<StorageOrder storage,
+         class IndexType,
+         class Dims,
+         class Mult,
+         REQUIRES(std::is_integral_v<IndexType>)>
 static constexpr auto
-fast_unflatten(index_type idx, Dims dims, Mult mult)
+fast_unflatten(IndexType idx, Dims dims, Mult mult)
 {
 
-  runtime_assert(std::accumulate(std::begin(dims),
-                                 std::end(dims),
-                                 index_type(1),
-                                 std::multiplies<index_type>{}) > idx,
+  runtime_assert(size_type(idx) < detail::dims_size(dims),
                  "Index out of bounds");
 
-  std::array<index_type, rank(dims)> md_idx;
+  std::array<IndexType, rank(dims)> md_idx{};
   // TODO: this is not nice, try to make some sense at some point
   if constexpr (storage == StorageOrder::RowMajor) {
 
     for (size_t i = 0; i < rank(dims); ++i) {
-      md_idx[i] = idx / index_type(mult[i]);
-      idx -= md_idx[i] * index_type(mult[i]);
+      md_idx[i] = idx / IndexType(mult[i]);
+      idx -= md_idx[i] * IndexType(mult[i]);
     }
   }
 
   else {
 
     for (size_t i = rank(dims) - 1; int(i) >= 0; --i) {
-      md_idx[i] = idx / index_type(mult[i]);
-      idx -= md_idx[i] * index_type(mult[i]);
+      md_idx[i] = idx / IndexType(mult[i]);
+      idx -= md_idx[i] * IndexType(mult[i]);
     }
   }
 
@@ -140,14 +245,92 @@ fast_unflatten(index_type idx, Dims dims, Mult mult)
 ///@tparam storage storage order
 ///@param idx index to unflatten
 ///@param dims maximum extent of the multidimensional indices
-///@return constexpr std::array<idx_t, N> array of multidimensional indices
-template<StorageOrder storage, class Dims>
+///@return constexpr std::array<IndexType, N> array of multidimensional indices
+template<StorageOrder storage,
+         class IndexType,
+         class Dims,
+         REQUIRES(std::is_integral_v<IndexType>)>
 static constexpr auto
-unflatten(index_type idx, Dims dims)
+unflatten(IndexType idx, Dims dims)
 {
 
   return fast_unflatten<storage>(idx, dims, get_shifts<storage>(dims));
 }
+
+///@brief The shifts of the compile-time shape Dims..., as constants
+///
+///@tparam storage storage order
+///@tparam Dims the extents of the shape
+template<StorageOrder storage, std::size_t... Dims>
+inline constexpr std::array<std::size_t, sizeof...(Dims)> static_shifts =
+  get_shifts<storage>(extents<size_type, Dims...>{});
+
+namespace detail {
+
+template<std::size_t... Dims, class Idx>
+constexpr bool
+in_static_bounds(const Idx& idx)
+{
+  std::size_t i = 0;
+  const auto in_bounds = [&](std::size_t extent) {
+    const auto x = index_value_t<Idx>(idx[i++]);
+    return x >= 0 && size_type(x) < extent;
+  };
+  return (in_bounds(Dims) && ...);
+}
+
+template<StorageOrder storage,
+         std::size_t... Dims,
+         class Idx,
+         std::size_t... Is>
+constexpr index_value_t<Idx>
+static_flatten(const Idx& idx, std::index_sequence<Is...>)
+{
+  using flat_type = index_value_t<Idx>;
+  constexpr auto& shifts = static_shifts<storage, Dims...>;
+  return (flat_type(0) + ... + (flat_type(idx[Is]) * flat_type(shifts[Is])));
+}
+
+} // namespace detail
+
+///@brief Flattens 'idx' in the compile-time shape Dims...: the shifts are
+/// constants, so the inner product unrolls into multiplies by immediates
+/// (shifts for powers of two). Debug builds throw for indices out of bounds.
+///
+///@tparam storage storage order
+///@tparam Dims the extents of the shape
+///@param idx array of indices to flatten
+///@return constexpr the flat index, of the index type of 'idx'
+template<StorageOrder storage, std::size_t... Dims, class Idx>
+constexpr detail::index_value_t<Idx>
+flatten(const Idx& idx)
+{
+  static_assert(sizeof...(Dims) == Rank<Idx>::value,
+                "Index of another rank than the shape");
+  runtime_assert(detail::in_static_bounds<Dims...>(idx),
+                 "Index out of bounds");
+  return detail::static_flatten<storage, Dims...>(
+    idx, std::make_index_sequence<sizeof...(Dims)>{});
+}
+
+///@brief Unflattens 'idx' in the compile-time shape Dims..., the divisions
+/// are by constants
+///
+///@tparam storage storage order
+///@tparam Dims the extents of the shape
+///@param idx index to unflatten
+///@return constexpr std::array<IndexType, N> array of multidimensional indices
+template<StorageOrder storage,
+         std::size_t... Dims,
+         class IndexType,
+         REQUIRES(std::is_integral_v<IndexType>)>
+constexpr auto
+unflatten(IndexType idx)
+{
+  return fast_unflatten<storage>(
+    idx, extents<size_type, Dims...>{}, static_shifts<storage, Dims...>);
+}
+
 } // namespace nanda
 
 #endif
\ No newline at end of file
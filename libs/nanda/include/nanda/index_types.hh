@@ -3,12 +3,61 @@
 
 #include <array>
 #include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <type_traits>
 
 namespace nanda {
 
-using index_type = int;
 using size_type = std::size_t;
 
+/// @brief 32 bit indices vectorize twice as wide, 64 bit ones are needed once
+/// an array holds more than 2^31 elements
+using index32_type = std::int32_t;
+using index64_type = std::int64_t;
+
+/// @brief Sentinel for an extent that is only known at runtime
+inline constexpr std::size_t dynamic_extent =
+  std::numeric_limits<std::size_t>::max();
+
+namespace detail {
+
+///@brief Whether every stride and the size of an array with the given static
+/// extents is at most 'max', never true if an extent is dynamic
+constexpr bool
+static_size_fits(std::uintmax_t max, std::initializer_list<std::size_t> extents)
+{
+  std::uintmax_t size = 1;
+  for (auto e : extents) {
+    if (e == dynamic_extent)
+      return false;
+    if (e == 0)
+      continue;
+    if (size > max / e)
+      return false;
+    size *= e;
+  }
+  return true;
+}
+
+} // namespace detail
+
+/// @brief The narrowest index type able to address every element of an array
+/// with the given static extents: 32 bit when the static size fits, 64 bit
+/// otherwise (including whenever an extent is dynamic)
+template<std::size_t... Extents>
+using index_type_for_t =
+  std::conditional_t<detail::static_size_fits(
+                       std::numeric_limits<index32_type>::max(),
+                       { Extents... }),
+                     index32_type,
+                     index64_type>;
+
+/// @brief Default index type of arrays whose extents are only known at
+/// runtime, which is 64 bit so large grids cannot overflow it
+using index_type = index_type_for_t<dynamic_extent>;
+
 // template<size_type N>
 // using md_idx = std::array<index_type, N>;
 
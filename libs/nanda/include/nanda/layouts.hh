@@ -0,0 +1,529 @@
+#ifndef NANDA_LAYOUTS_HEADER
+#define NANDA_LAYOUTS_HEADER
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+#include "extents.hh"
+#include "index_algos.hh"
+
+namespace nanda {
+
+///@brief Row-major (C-style) layout, the last index is contiguous
+struct layout_right
+{
+  template<class Extents>
+  class mapping;
+};
+
+///@brief Column-major (FORTRAN-style) layout, the first index is contiguous
+struct layout_left
+{
+  template<class Extents>
+  class mapping;
+};
+
+///@brief Arbitrary per-direction strides, covers non-contiguous views
+struct layout_stride
+{
+  template<class Extents>
+  class mapping;
+};
+
+///@brief Row-major layout whose rows (the last direction) are padded to a
+/// pitch that is a multiple of 'Alignment' elements. If the padded pitch is a
+/// power of two, 'AntiAliasPad' more multiples of 'Alignment' are added so
+/// that the rows do not all fall into the same cache sets. The padding is
+/// never reached by an index.
+///
+///@tparam Alignment the pitch granularity in elements, a power of two
+///@tparam AntiAliasPad the number of extra 'Alignment' blocks appended to a
+/// power of two pitch, zero disables it
+template<std::size_t Alignment, std::size_t AntiAliasPad = 0>
+struct layout_right_padded
+{
+  static_assert(Alignment > 0 && (Alignment & (Alignment - 1)) == 0,
+                "The row alignment must be a power of two");
+
+  template<class Extents>
+  class mapping;
+};
+
+///@brief A padded layout whose rows of T start every 'Bytes' bytes, one
+/// cache line by default
+template<class T, std::size_t Bytes = 64, std::size_t AntiAliasPad = 0>
+using layout_aligned_rows =
+  layout_right_padded<(Bytes / sizeof(T) > 0 ? Bytes / sizeof(T) : 1),
+                      AntiAliasPad>;
+
+///@brief Maps a StorageOrder onto its layout policy
+template<StorageOrder storage>
+struct layout_for;
+
+template<>
+struct layout_for<StorageOrder::RowMajor>
+{
+  using type = layout_right;
+};
+
+template<>
+struct layout_for<StorageOrder::ColMajor>
+{
+  using type = layout_left;
+};
+
+template<StorageOrder storage>
+using layout_for_t = typename layout_for<storage>::type;
+
+namespace detail {
+
+template<class Mapping, class = void>
+struct is_mapping : std::false_type
+{};
+
+template<class Mapping>
+struct is_mapping<Mapping,
+                  std::void_t<typename Mapping::extents_type,
+                              typename Mapping::layout_type,
+                              decltype(std::declval<const Mapping&>().strides())>>
+  : std::true_type
+{};
+
+template<class Extents>
+inline constexpr bool static_extents_fit = false;
+
+///@brief Whether the strides and size of static extents fit their index type
+template<class IndexType, std::size_t... Extents>
+inline constexpr bool static_extents_fit<extents<IndexType, Extents...>> =
+  static_size_fits(std::numeric_limits<IndexType>::max(), { Extents... });
+
+///@brief Common implementation of the two packed (exhaustive) layouts, the
+/// strides are the shifts of the corresponding StorageOrder
+template<class Layout, StorageOrder storage, class Extents>
+class packed_mapping
+{
+  static_assert(is_extents_v<Extents>,
+                "A layout mapping needs nanda::extents as its index space");
+  static_assert(!Extents::is_static() || detail::static_extents_fit<Extents>,
+                "The index type is too narrow for the static extents");
+
+public:
+  using extents_type = Extents;
+  using index_type = typename Extents::index_type;
+  using size_type = typename Extents::size_type;
+  using rank_type = typename Extents::rank_type;
+  using layout_type = Layout;
+  using index_array = std::array<index_type, Extents::rank()>;
+  using strides_type = std::array<index_type, Extents::rank()>;
+
+  static constexpr StorageOrder storage_order = storage;
+
+  constexpr packed_mapping()
+    : packed_mapping(extents_type{})
+  {}
+
+  ///@brief Debug builds throw if the strides of 'ext' overflow index_type
+  constexpr packed_mapping(const extents_type& ext)
+    : extents_{ ext }
+    , strides_{ make_strides(ext, std::make_index_sequence<Extents::rank()>{}) }
+  {
+    detail::check_index_range<index_type>(ext);
+  }
+
+  constexpr const extents_type& extents() const noexcept { return extents_; }
+  constexpr const strides_type& strides() const noexcept { return strides_; }
+  constexpr index_type stride(rank_type r) const noexcept
+  {
+    return strides_[r];
+  }
+
+  constexpr index_type required_span_size() const noexcept
+  {
+    return index_type(extents_.size());
+  }
+
+  template<class... Idx,
+           REQUIRES(sizeof...(Idx) == Extents::rank() &&
+                    std::conjunction_v<std::is_integral<Idx>...>)>
+  constexpr index_type operator()(Idx... idx) const noexcept
+  {
+    return (*this)(index_array{ index_type(idx)... });
+  }
+
+  constexpr index_type operator()(const index_array& idx) const noexcept
+  {
+    return index_type(fast_flatten(idx, extents_, strides_));
+  }
+
+  static constexpr bool is_always_unique() noexcept { return true; }
+  static constexpr bool is_always_exhaustive() noexcept { return true; }
+  static constexpr bool is_always_strided() noexcept { return true; }
+  static constexpr bool is_always_contiguous() noexcept { return true; }
+
+  static constexpr bool is_unique() noexcept { return true; }
+  static constexpr bool is_exhaustive() noexcept { return true; }
+  static constexpr bool is_strided() noexcept { return true; }
+  static constexpr bool is_contiguous() noexcept { return true; }
+
+  friend constexpr bool operator==(const packed_mapping& lhs,
+                                   const packed_mapping& rhs) noexcept
+  {
+    return lhs.extents_ == rhs.extents_;
+  }
+
+  friend constexpr bool operator!=(const packed_mapping& lhs,
+                                   const packed_mapping& rhs) noexcept
+  {
+    return !(lhs == rhs);
+  }
+
+private:
+  template<std::size_t... Is>
+  static constexpr strides_type make_strides(const extents_type& ext,
+                                             std::index_sequence<Is...>)
+  {
+    return { index_type(get_shift<Is, storage>(ext))... };
+  }
+
+  extents_type extents_;
+  strides_type strides_;
+};
+
+} // namespace detail
+
+template<class Extents>
+class layout_right::mapping
+  : public detail::packed_mapping<layout_right, StorageOrder::RowMajor, Extents>
+{
+  using base_type =
+    detail::packed_mapping<layout_right, StorageOrder::RowMajor, Extents>;
+
+public:
+  using base_type::base_type;
+};
+
+template<class Extents>
+class layout_left::mapping
+  : public detail::packed_mapping<layout_left, StorageOrder::ColMajor, Extents>
+{
+  using base_type =
+    detail::packed_mapping<layout_left, StorageOrder::ColMajor, Extents>;
+
+public:
+  using base_type::base_type;
+};
+
+template<class Extents>
+class layout_stride::mapping
+{
+  static_assert(is_extents_v<Extents>,
+                "A layout mapping needs nanda::extents as its index space");
+
+public:
+  using extents_type = Extents;
+  using index_type = typename Extents::index_type;
+  using size_type = typename Extents::size_type;
+  using rank_type = typename Extents::rank_type;
+  using layout_type = layout_stride;
+  using index_array = std::array<index_type, Extents::rank()>;
+  using strides_type = std::array<index_type, Extents::rank()>;
+
+  constexpr mapping()
+    : mapping(layout_right::mapping<Extents>{})
+  {}
+
+  constexpr mapping(const extents_type& ext, const strides_type& strides) noexcept
+    : extents_{ ext }
+    , strides_{ strides }
+  {}
+
+  ///@brief Converts any strided mapping (layout_right, layout_left) of
+  /// compatible extents
+  template<class OtherMapping,
+           REQUIRES(detail::is_mapping<OtherMapping>::value &&
+                    !std::is_same_v<OtherMapping, mapping> &&
+                    std::is_constructible_v<
+                      extents_type,
+                      typename OtherMapping::extents_type>)>
+  constexpr mapping(const OtherMapping& other) noexcept
+    : extents_{ other.extents() }
+    , strides_{}
+  {
+    for (rank_type r = 0; r < extents_type::rank(); ++r)
+      strides_[r] = index_type(other.stride(r));
+  }
+
+  constexpr const extents_type& extents() const noexcept { return extents_; }
+  constexpr const strides_type& strides() const noexcept { return strides_; }
+  constexpr index_type stride(rank_type r) const noexcept
+  {
+    return strides_[r];
+  }
+
+  ///@brief One past the largest offset reachable through the mapping
+  constexpr index_type required_span_size() const noexcept
+  {
+    index_type size = 1;
+    for (rank_type r = 0; r < extents_type::rank(); ++r) {
+      if (extents_.extent(r) == 0)
+        return 0;
+      size += (extents_.extent(r) - 1) * strides_[r];
+    }
+    return size;
+  }
+
+  template<class... Idx,
+           REQUIRES(sizeof...(Idx) == Extents::rank() &&
+                    std::conjunction_v<std::is_integral<Idx>...>)>
+  constexpr index_type operator()(Idx... idx) const noexcept
+  {
+    return (*this)(index_array{ index_type(idx)... });
+  }
+
+  constexpr index_type operator()(const index_array& idx) const noexcept
+  {
+    return index_type(fast_flatten(idx, extents_, strides_));
+  }
+
+  static constexpr bool is_always_unique() noexcept { return false; }
+  static constexpr bool is_always_exhaustive() noexcept { return false; }
+  static constexpr bool is_always_strided() noexcept { return true; }
+  static constexpr bool is_always_contiguous() noexcept { return false; }
+
+  ///@brief No two indices map to the same offset. Directions are visited by
+  /// increasing stride and each stride has to step over the whole range of
+  /// the previous direction (a sufficient condition)
+  constexpr bool is_unique() const noexcept
+  {
+    index_type span = 1;
+    for (auto r : by_increasing_stride()) {
+      if (extents_.extent(r) <= 1)
+        continue;
+      if (strides_[r] < span)
+        return false;
+      span = strides_[r] * extents_.extent(r);
+    }
+    return true;
+  }
+
+  ///@brief Every offset in [0, required_span_size()) is reached, i.e. the
+  /// strides are a permutation of the packed ones
+  constexpr bool is_exhaustive() const noexcept
+  {
+    index_type expected = 1;
+    for (auto r : by_increasing_stride()) {
+      if (extents_.extent(r) == 1)
+        continue;
+      if (strides_[r] != expected)
+        return false;
+      expected *= extents_.extent(r);
+    }
+    return true;
+  }
+
+  static constexpr bool is_strided() noexcept { return true; }
+
+  ///@brief Unique and exhaustive, the elements occupy one contiguous block
+  constexpr bool is_contiguous() const noexcept
+  {
+    return is_unique() && is_exhaustive();
+  }
+
+  template<class OtherMapping,
+           REQUIRES(detail::is_mapping<OtherMapping>::value)>
+  friend constexpr bool operator==(const mapping& lhs,
+                                   const OtherMapping& rhs) noexcept
+  {
+    if (!(lhs.extents() == rhs.extents()))
+      return false;
+    for (rank_type r = 0; r < extents_type::rank(); ++r)
+      if (lhs.stride(r) != index_type(rhs.stride(r)))
+        return false;
+    return true;
+  }
+
+  template<class OtherMapping,
+           REQUIRES(detail::is_mapping<OtherMapping>::value)>
+  friend constexpr bool operator!=(const mapping& lhs,
+                                   const OtherMapping& rhs) noexcept
+  {
+    return !(lhs == rhs);
+  }
+
+private:
+  constexpr std::array<rank_type, Extents::rank()> by_increasing_stride()
+    const noexcept
+  {
+    std::array<rank_type, Extents::rank()> order{};
+    for (rank_type r = 0; r < extents_type::rank(); ++r)
+      order[r] = r;
+    // insertion sort, constexpr and the rank is small
+    for (rank_type i = 1; i < extents_type::rank(); ++i)
+      for (rank_type j = i; j > 0 && strides_[order[j]] < strides_[order[j - 1]];
+           --j) {
+        auto tmp = order[j];
+        order[j] = order[j - 1];
+        order[j - 1] = tmp;
+      }
+    return order;
+  }
+
+  extents_type extents_;
+  strides_type strides_;
+};
+
+template<std::size_t Alignment, std::size_t AntiAliasPad>
+template<class Extents>
+class layout_right_padded<Alignment, AntiAliasPad>::mapping
+{
+  static_assert(is_extents_v<Extents>,
+                "A layout mapping needs nanda::extents as its index space");
+  static_assert(Extents::rank() > 0, "A padded layout needs rows to pad");
+
+public:
+  using extents_type = Extents;
+  using index_type = typename Extents::index_type;
+  using size_type = typename Extents::size_type;
+  using rank_type = typename Extents::rank_type;
+  using layout_type = layout_right_padded;
+  using index_array = std::array<index_type, Extents::rank()>;
+  using strides_type = std::array<index_type, Extents::rank()>;
+
+  constexpr mapping()
+    : mapping(extents_type{})
+  {}
+
+  ///@brief Debug builds throw if the padded strides of 'ext' overflow
+  /// index_type
+  constexpr mapping(const extents_type& ext)
+    : extents_{ ext }
+    , strides_{}
+  {
+    constexpr rank_type last = Extents::rank() - 1;
+    std::array<std::size_t, Extents::rank()> padded{};
+    for (rank_type r = 0; r < Extents::rank(); ++r)
+      padded[r] = std::size_t(ext.extent(r));
+    padded[last] = padded_pitch(padded[last]);
+    detail::check_index_range<index_type>(padded);
+
+    strides_[last] = 1;
+    for (rank_type r = last; r > 0; --r)
+      strides_[r - 1] = strides_[r] * index_type(padded[r]);
+    pitch_ = index_type(padded[last]);
+  }
+
+  constexpr const extents_type& extents() const noexcept { return extents_; }
+  constexpr const strides_type& strides() const noexcept { return strides_; }
+  constexpr index_type stride(rank_type r) const noexcept
+  {
+    return strides_[r];
+  }
+
+  ///@brief Elements between the starts of two consecutive rows
+  constexpr index_type pitch() const noexcept { return pitch_; }
+
+  ///@brief Every row starts at a multiple of this many elements
+  static constexpr std::size_t row_alignment() noexcept { return Alignment; }
+
+  ///@brief Whole rows, padding included, so that the last row can be
+  /// processed with full aligned vectors as well: the pitch times the number
+  /// of rows, for rank 1 too
+  constexpr index_type required_span_size() const noexcept
+  {
+    if (extents_.extent(Extents::rank() - 1) == 0)
+      return 0;
+    index_type size = pitch_;
+    for (rank_type r = 0; r + 1 < Extents::rank(); ++r)
+      size *= index_type(extents_.extent(r));
+    return size;
+  }
+
+  template<class... Idx,
+           REQUIRES(sizeof...(Idx) == Extents::rank() &&
+                    std::conjunction_v<std::is_integral<Idx>...>)>
+  constexpr index_type operator()(Idx... idx) const noexcept
+  {
+    return (*this)(index_array{ index_type(idx)... });
+  }
+
+  constexpr index_type operator()(const index_array& idx) const noexcept
+  {
+    return index_type(fast_flatten(idx, extents_, strides_));
+  }
+
+  static constexpr bool is_always_unique() noexcept { return true; }
+  static constexpr bool is_always_exhaustive() noexcept { return false; }
+  static constexpr bool is_always_strided() noexcept { return true; }
+  static constexpr bool is_always_contiguous() noexcept { return false; }
+
+  static constexpr bool is_unique() noexcept { return true; }
+  static constexpr bool is_strided() noexcept { return true; }
+
+  ///@brief The span holds no padding, the rows happen to need none
+  constexpr bool is_exhaustive() const noexcept
+  {
+    return size_type(required_span_size()) == extents_.size();
+  }
+
+  constexpr bool is_contiguous() const noexcept { return is_exhaustive(); }
+
+  friend constexpr bool operator==(const mapping& lhs,
+                                   const mapping& rhs) noexcept
+  {
+    return lhs.extents_ == rhs.extents_;
+  }
+
+  friend constexpr bool operator!=(const mapping& lhs,
+                                   const mapping& rhs) noexcept
+  {
+    return !(lhs == rhs);
+  }
+
+private:
+  static constexpr std::size_t padded_pitch(std::size_t length) noexcept
+  {
+    std::size_t pitch = (length + Alignment - 1) / Alignment * Alignment;
+    if (AntiAliasPad > 0 && pitch > 0 && (pitch & (pitch - 1)) == 0)
+      pitch += AntiAliasPad * Alignment;
+    return pitch;
+  }
+
+  extents_type extents_;
+  strides_type strides_;
+  index_type pitch_ = 0;
+};
+
+///@brief The shifts between consecutive indices in all directions of a
+/// strided mapping. Unlike get_shifts of the extents alone these include any
+/// padding, e.g. the row pitch of layout_right_padded.
+template<class Mapping, REQUIRES(detail::is_mapping<Mapping>::value)>
+constexpr auto
+get_shifts(const Mapping& map)
+{
+  std::array<std::size_t, Mapping::extents_type::rank()> shifts{};
+  for (std::size_t r = 0; r < shifts.size(); ++r)
+    shifts[r] = std::size_t(map.stride(r));
+  return shifts;
+}
+
+///@brief Number of elements every row start of the mapping is a multiple of,
+/// 1 if the layout makes no such promise
+template<class Mapping, class = void>
+struct row_alignment : std::integral_constant<std::size_t, 1>
+{};
+
+template<class Mapping>
+struct row_alignment<Mapping,
+                     std::void_t<decltype(Mapping::row_alignment())>>
+  : std::integral_constant<std::size_t, Mapping::row_alignment()>
+{};
+
+template<class Mapping>
+inline constexpr std::size_t row_alignment_v = row_alignment<Mapping>::value;
+
+} // namespace nanda
+
+#endif // NANDA_LAYOUTS_HEADER
@@ -0,0 +1,419 @@
+#ifndef NANDA_MAPPED_ARRAY_HEADER
+#define NANDA_MAPPED_ARRAY_HEADER
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "extents.hh"
+#include "layouts.hh"
+#include "ndspan.hh"
+#include "span.hh"
+#include "utility.hh"
+
+namespace nanda {
+
+///@brief How the pages of a file are mapped
+enum class map_mode
+{
+  ///@brief Writes are not allowed
+  read_only,
+  ///@brief Writes go to private copies of the pages, never to the file
+  copy_on_write
+};
+
+///@brief Access pattern hints of madvise
+enum class access_advice
+{
+  normal,
+  ///@brief Aggressive read-ahead, pages behind may be dropped early
+  sequential,
+  ///@brief No read-ahead
+  random,
+  ///@brief Start reading the pages in now
+  will_need,
+  ///@brief The pages will not be needed soon
+  dont_need
+};
+
+namespace detail {
+
+[[noreturn]] inline void
+throw_errno(const char* what)
+{
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+inline std::size_t
+page_size() noexcept
+{
+  static const auto size = std::size_t(::sysconf(_SC_PAGESIZE));
+  return size;
+}
+
+inline int
+madvise_flag(access_advice advice) noexcept
+{
+  switch (advice) {
+    case access_advice::sequential:
+      return MADV_SEQUENTIAL;
+    case access_advice::random:
+      return MADV_RANDOM;
+    case access_advice::will_need:
+      return MADV_WILLNEED;
+    case access_advice::dont_need:
+      return MADV_DONTNEED;
+    default:
+      return MADV_NORMAL;
+  }
+}
+
+} // namespace detail
+
+///@brief The bytes [offset, offset + length) of a file mapped into memory.
+/// Opening costs the same for any length: no page is read until it is first
+/// touched (or prefetched), the file descriptor is closed once mapped.
+///
+/// Failing system calls throw std::system_error.
+class mapped_file
+{
+public:
+  mapped_file() noexcept = default;
+
+  ///@param offset first byte of the file mapped, any value
+  ///@param length number of bytes mapped, the rest of the file for npos
+  ///@param huge_pages asks for transparent huge pages (madvise
+  /// MADV_HUGEPAGE), honoured where the kernel supports them for the file
+  /// system of the file and ignored elsewhere
+  mapped_file(const std::string& path,
+              map_mode mode,
+              std::size_t offset = 0,
+              std::size_t length = npos,
+              bool huge_pages = false)
+    : mode_{ mode }
+  {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      detail::throw_errno("open");
+    struct ::stat info;
+    if (::fstat(fd, &info) != 0) {
+      const int error = errno;
+      ::close(fd);
+      errno = error;
+      detail::throw_errno("fstat");
+    }
+
+    const auto file_size = std::size_t(info.st_size);
+    if (offset > file_size ||
+        (length != npos && length > file_size - offset)) {
+      ::close(fd);
+      throw std::out_of_range("Mapped range past the end of " + path);
+    }
+    size_ = length == npos ? file_size - offset : length;
+
+    // mmap maps whole pages from a page aligned offset
+    const std::size_t lead = offset % detail::page_size();
+    mapped_ = size_ + lead;
+    if (size_ > 0) {
+      const int prot =
+        mode == map_mode::read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+      base_ = ::mmap(
+        nullptr, mapped_, prot, MAP_PRIVATE, fd, ::off_t(offset - lead));
+      if (base_ == MAP_FAILED) {
+        const int error = errno;
+        base_ = nullptr;
+        ::close(fd);
+        errno = error;
+        detail::throw_errno("mmap");
+      }
+      data_ = static_cast<std::byte*>(base_) + lead;
+    }
+    ::close(fd);
+
+#ifdef MADV_HUGEPAGE
+    if (huge_pages && base_)
+      ::madvise(base_, mapped_, MADV_HUGEPAGE);
+#else
+    (void)huge_pages;
+#endif
+  }
+
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+
+  mapped_file(mapped_file&& other) noexcept
+    : base_{ std::exchange(other.base_, nullptr) }
+    , mapped_{ std::exchange(other.mapped_, 0) }
+    , data_{ std::exchange(other.data_, nullptr) }
+    , size_{ std::exchange(other.size_, 0) }
+    , mode_{ other.mode_ }
+  {}
+
+  mapped_file& operator=(mapped_file&& other) noexcept
+  {
+    mapped_file tmp{ std::move(other) };
+    swap(tmp);
+    return *this;
+  }
+
+  ~mapped_file()
+  {
+    if (base_)
+      ::munmap(base_, mapped_);
+  }
+
+  void swap(mapped_file& other) noexcept
+  {
+    std::swap(base_, other.base_);
+    std::swap(mapped_, other.mapped_);
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    std::swap(mode_, other.mode_);
+  }
+
+  std::byte* data() const noexcept { return data_; }
+  std::size_t size() const noexcept { return size_; }
+  map_mode mode() const noexcept { return mode_; }
+
+  ///@brief Hints the access pattern of the bytes [offset, offset + length),
+  /// widened to whole pages. dont_need drops the private copies of the pages
+  /// of a copy_on_write mapping, they read the file again.
+  void advise(access_advice advice,
+              std::size_t offset = 0,
+              std::size_t length = npos) const
+  {
+    if (offset >= size_)
+      return;
+    length = std::min(length, size_ - offset);
+    if (length == 0)
+      return;
+    const auto first = reinterpret_cast<std::uintptr_t>(data_ + offset);
+    const auto start = first - first % detail::page_size();
+    if (::madvise(reinterpret_cast<void*>(start),
+                  first + length - start,
+                  detail::madvise_flag(advice)) != 0)
+      detail::throw_errno("madvise");
+  }
+
+  ///@brief Starts reading the bytes [offset, offset + length) in, without
+  /// waiting for them
+  void prefetch(std::size_t offset = 0, std::size_t length = npos) const
+  {
+    advise(access_advice::will_need, offset, length);
+  }
+
+  static constexpr std::size_t npos = std::size_t(-1);
+
+private:
+  void* base_ = nullptr;
+  std::size_t mapped_ = 0;
+  std::byte* data_ = nullptr;
+  std::size_t size_ = 0;
+  map_mode mode_ = map_mode::read_only;
+};
+
+///@brief A multidimensional array whose elements are the bytes of a file,
+/// mapped instead of read. Opening is constant time whatever the size of the
+/// file; pages are read on first access, or ahead of it with advise() and
+/// prefetch().
+///
+/// The element type picks the mode: a mapped_ndarray of const T is mapped
+/// read only, one of T copy on write (writes stay in memory, the file never
+/// changes). The elements are the raw bytes in the order of Layout, with no
+/// conversion.
+///
+///@tparam T a trivially copyable element type, const for read only
+///@tparam Extents a nanda::extents describing the dimensions
+///@tparam Layout a unique layout policy
+template<class T, class Extents, class Layout = layout_right>
+class mapped_ndarray
+{
+public:
+  using element_type = T;
+  using value_type = std::remove_cv_t<T>;
+  using extents_type = Extents;
+  using layout_type = Layout;
+  using mapping_type = typename Layout::template mapping<Extents>;
+  using index_type = typename Extents::index_type;
+  using rank_type = typename Extents::rank_type;
+  using index_array = std::array<index_type, Extents::rank()>;
+  using view_type = ndspan<T, Extents, Layout>;
+  using const_view_type = ndspan<const T, Extents, Layout>;
+  using pointer = T*;
+  using reference = T&;
+  using iterator = T*;
+
+  static_assert(std::is_trivially_copyable_v<value_type>,
+                "Mapped elements are raw bytes of the file");
+  static_assert(mapping_type::is_always_unique(),
+                "A mapped array has exactly one element per index");
+
+  static constexpr map_mode mode =
+    std::is_const_v<T> ? map_mode::read_only : map_mode::copy_on_write;
+
+  static constexpr rank_type rank() noexcept { return Extents::rank(); }
+
+  mapped_ndarray() = default;
+
+  ///@brief Maps the elements of extents 'ext' starting at byte 'offset' of
+  /// the file at 'path', e.g. after a header. Throws std::out_of_range when
+  /// the file is too short and std::system_error when mapping fails.
+  ///
+  ///@param offset a multiple of alignof(T)
+  ///@param huge_pages see mapped_file
+  mapped_ndarray(const std::string& path,
+                 const extents_type& ext,
+                 std::size_t offset = 0,
+                 bool huge_pages = false)
+    : map_{ ext }
+    , file_{ path,
+             mode,
+             offset,
+             std::size_t(map_.required_span_size()) * sizeof(T),
+             huge_pages }
+  {
+    if (offset % alignof(T) != 0)
+      throw std::invalid_argument("Misaligned offset of mapped elements");
+  }
+
+  // element access
+
+  template<class... Idx,
+           REQUIRES(sizeof...(Idx) == rank() &&
+                    std::conjunction_v<std::is_integral<Idx>...>)>
+  reference operator()(Idx... idx) const noexcept
+  {
+    return view()(idx...);
+  }
+
+  reference operator()(const index_array& idx) const noexcept
+  {
+    return view()(idx);
+  }
+
+  reference operator[](index_type idx) const noexcept
+  {
+    EXPECTS(size_type(idx) < storage_size());
+    return data()[idx];
+  }
+
+  // observers
+
+  pointer data() const noexcept { return reinterpret_cast<T*>(file_.data()); }
+
+  ///@brief Number of indices of the index space
+  size_type size() const noexcept { return map_.extents().size(); }
+  [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+  ///@brief Number of mapped elements, size() plus the padding of
+  /// non-exhaustive layouts
+  size_type storage_size() const noexcept
+  {
+    return size_type(map_.required_span_size());
+  }
+
+  const mapping_type& mapping() const noexcept { return map_; }
+  const extents_type& extents() const noexcept { return map_.extents(); }
+  const mapped_file& file() const noexcept { return file_; }
+
+  index_type extent(rank_type r) const noexcept
+  {
+    EXPECTS(r < rank());
+    return map_.extents().extent(r);
+  }
+
+  index_type stride(rank_type r) const noexcept
+  {
+    EXPECTS(r < rank());
+    return map_.stride(r);
+  }
+
+  view_type view() const noexcept { return { data(), map_ }; }
+  span<T> as_span() const noexcept { return { data(), storage_size() }; }
+
+  iterator begin() const noexcept { return data(); }
+  iterator end() const noexcept { return data() + storage_size(); }
+
+  // paging
+
+  ///@brief Hints how all of the elements will be accessed
+  void advise(access_advice advice) const { file_.advise(advice); }
+
+  ///@brief Starts reading every element in
+  void prefetch() const { file_.prefetch(); }
+
+  ///@brief Starts reading in the pages of the elements of 'box', a view into
+  /// this array such as a subndspan of view(), before it is traversed. Runs
+  /// of elements along the axis of stride 1 are merged into page ranges, one
+  /// madvise per range of consecutive pages.
+  template<class U, class E, class L>
+  void prefetch(const ndspan<U, E, L>& box) const
+  {
+    static_assert(ndspan<U, E, L>::mapping_type::is_always_strided(),
+                  "Only boxes of a strided layout are prefetched");
+    if (box.empty())
+      return;
+
+    using I = std::ptrdiff_t;
+    const I base = I(box.data() - data());
+    EXPECTS(base >= 0 && std::size_t(base) < storage_size());
+    const I page = I(detail::page_size() / sizeof(T));
+
+    // rows along the axis of stride 1 (the last one if there is none)
+    std::size_t inner = E::rank() == 0 ? 0 : E::rank() - 1;
+    for (std::size_t r = 0; r < E::rank(); ++r)
+      if (box.stride(r) == 1 && box.extent(r) > 1)
+        inner = r;
+    const I run = E::rank() == 0 || box.stride(inner) != 1
+                    ? 1
+                    : I(box.extent(inner));
+
+    // pending range [first, last) of elements, merged while the pages of
+    // the next run touch it
+    I first = -1, last = -1;
+    const auto flush = [&] {
+      if (first >= 0)
+        file_.prefetch(std::size_t(first) * sizeof(T),
+                       std::size_t(last - first) * sizeof(T));
+    };
+    using box_index = typename E::index_type;
+    std::array<box_index, E::rank()> dims{};
+    for (std::size_t r = 0; r < E::rank(); ++r)
+      dims[r] = r == inner && run > 1 ? 1 : box.extent(r);
+    detail::for_each_index(dextents<box_index, E::rank()>(dims),
+                           [&](const auto& idx) {
+      I offset = base;
+      for (std::size_t r = 0; r < E::rank(); ++r)
+        offset += I(idx[r]) * I(box.stride(r));
+      if (first >= 0 && offset >= first - page && offset <= last + page) {
+        first = std::min(first, offset);
+        last = std::max(last, offset + run);
+        return;
+      }
+      flush();
+      first = offset;
+      last = offset + run;
+    });
+    flush();
+  }
+
+private:
+  mapping_type map_;
+  mapped_file file_;
+};
+
+} // namespace nanda
+
+#endif // NANDA_MAPPED_ARRAY_HEADER
@@ -0,0 +1,258 @@
+#ifndef NANDA_MEMORY_HEADER
+#define NANDA_MEMORY_HEADER
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "index_types.hh"
+#include "utility.hh"
+
+namespace nanda {
+
+/// @brief Default alignment of owned buffers, one cache line which is also
+/// the width of an AVX-512 register
+inline constexpr std::size_t default_alignment = 64;
+
+///@brief Tag of the constructors which default initialize their elements,
+/// leaving elements of trivial types to be written first by the caller
+struct default_init_t
+{
+  explicit default_init_t() = default;
+};
+
+inline constexpr default_init_t default_init{};
+
+///@brief Checks if the pointer is aligned to 'alignment' bytes
+template<class T>
+constexpr bool
+is_aligned(const T* ptr, std::size_t alignment = default_alignment) noexcept
+{
+  return reinterpret_cast<std::uintptr_t>(ptr) % alignment == 0;
+}
+
+///@brief Allocator of over-aligned memory from the global operator new, the
+/// default of the nanda containers
+///
+///@tparam T the element type
+///@tparam Alignment the alignment of the memory in bytes
+template<class T, std::size_t Alignment = default_alignment>
+struct aligned_allocator
+{
+  static_assert((Alignment & (Alignment - 1)) == 0,
+                "Alignment must be a power of two");
+
+  using value_type = T;
+  using is_always_equal = std::true_type;
+
+  template<class U>
+  struct rebind
+  {
+    using other = aligned_allocator<U, Alignment>;
+  };
+
+  aligned_allocator() noexcept = default;
+
+  template<class U>
+  aligned_allocator(const aligned_allocator<U, Alignment>&) noexcept
+  {}
+
+  T* allocate(std::size_t n)
+  {
+    return static_cast<T*>(::operator new(
+      n * sizeof(T), std::align_val_t{ std::max(Alignment, alignof(T)) }));
+  }
+
+  void deallocate(T* p, std::size_t) noexcept
+  {
+    ::operator delete(p, std::align_val_t{ std::max(Alignment, alignof(T)) });
+  }
+
+  template<class U>
+  friend constexpr bool operator==(
+    const aligned_allocator&,
+    const aligned_allocator<U, Alignment>&) noexcept
+  {
+    return true;
+  }
+
+  template<class U>
+  friend constexpr bool operator!=(
+    const aligned_allocator&,
+    const aligned_allocator<U, Alignment>&) noexcept
+  {
+    return false;
+  }
+};
+
+///@brief Owning, contiguous and over-aligned storage for 'size' elements of T.
+/// The memory is requested once on construction and the elements are value
+/// initialized (or copied from 'value').
+///
+/// The memory comes from 'Allocator', which must return blocks aligned to
+/// 'Alignment' (checked in debug builds). The allocator moves and swaps with
+/// the memory it allocated, so it must be always equal or propagate on move
+/// assignment and swap; copies take the allocator of
+/// select_on_container_copy_construction, copy assignments the one of the
+/// copied buffer if it propagates on copy assignment.
+///
+///@tparam T the element type
+///@tparam Alignment the alignment of the first element in bytes
+///@tparam Allocator an allocator of T
+template<class T,
+         std::size_t Alignment = default_alignment,
+         class Allocator = aligned_allocator<T, Alignment>>
+class aligned_buffer
+{
+  static_assert((Alignment & (Alignment - 1)) == 0,
+                "Alignment must be a power of two");
+  static_assert(Alignment >= alignof(T),
+                "Alignment must not be weaker than the one of T");
+  static_assert(std::is_same_v<typename Allocator::value_type, T>,
+                "The allocator must allocate elements of T");
+
+  using traits = std::allocator_traits<Allocator>;
+  static_assert(
+    traits::is_always_equal::value ||
+      (traits::propagate_on_container_move_assignment::value &&
+       traits::propagate_on_container_swap::value),
+    "The allocator must move with its memory");
+
+public:
+  using value_type = T;
+  using allocator_type = Allocator;
+  using pointer = T*;
+  using const_pointer = const T*;
+
+  static constexpr std::size_t alignment = Alignment;
+
+  aligned_buffer() = default;
+
+  explicit aligned_buffer(const Allocator& alloc) noexcept
+    : impl_{ alloc }
+  {}
+
+  explicit aligned_buffer(size_type size, const Allocator& alloc = Allocator())
+    : impl_{ alloc, size }
+  {
+    std::uninitialized_value_construct_n(impl_.data, size);
+  }
+
+  ///@brief Default initialized elements, no write to the memory of trivial
+  /// types
+  aligned_buffer(size_type size,
+                 default_init_t,
+                 const Allocator& alloc = Allocator())
+    : impl_{ alloc, size }
+  {
+    std::uninitialized_default_construct_n(impl_.data, size);
+  }
+
+  aligned_buffer(size_type size,
+                 const T& value,
+                 const Allocator& alloc = Allocator())
+    : impl_{ alloc, size }
+  {
+    std::uninitialized_fill_n(impl_.data, size, value);
+  }
+
+  aligned_buffer(const aligned_buffer& other)
+    : aligned_buffer(other,
+                     traits::select_on_container_copy_construction(other.impl_))
+  {}
+
+  aligned_buffer(const aligned_buffer& other, const Allocator& alloc)
+    : impl_{ alloc, other.size() }
+  {
+    std::uninitialized_copy_n(other.data(), size(), impl_.data);
+  }
+
+  aligned_buffer(aligned_buffer&& other) noexcept
+    : impl_{ std::move(other.impl_) }
+  {}
+
+  aligned_buffer& operator=(const aligned_buffer& other)
+  {
+    if (this != &other) {
+      aligned_buffer tmp{
+        other,
+        traits::propagate_on_container_copy_assignment::value
+          ? other.get_allocator()
+          : get_allocator()
+      };
+      swap(tmp);
+    }
+    return *this;
+  }
+
+  aligned_buffer& operator=(aligned_buffer&& other) noexcept
+  {
+    aligned_buffer tmp{ std::move(other) };
+    swap(tmp);
+    return *this;
+  }
+
+  ~aligned_buffer() { std::destroy_n(impl_.data, impl_.size); }
+
+  void swap(aligned_buffer& other) noexcept { impl_.swap(other.impl_); }
+
+  pointer data() noexcept { return impl_.data; }
+  const_pointer data() const noexcept { return impl_.data; }
+  size_type size() const noexcept { return impl_.size; }
+
+  allocator_type get_allocator() const noexcept { return impl_; }
+
+private:
+  ///@brief The allocator as a base, which takes no storage when it is empty.
+  /// Owns the memory but not the elements, so a block whose elements fail to
+  /// construct is still freed.
+  struct impl : Allocator
+  {
+    impl() = default;
+
+    explicit impl(const Allocator& alloc) noexcept
+      : Allocator(alloc)
+    {}
+
+    impl(const Allocator& alloc, size_type n)
+      : Allocator(alloc)
+      , data{ n == 0 ? nullptr : traits::allocate(*this, n) }
+      , size{ n }
+    {
+      EXPECTS(data == nullptr || is_aligned(data, Alignment));
+    }
+
+    impl(impl&& other) noexcept
+      : Allocator(std::move(static_cast<Allocator&>(other)))
+      , data{ std::exchange(other.data, nullptr) }
+      , size{ std::exchange(other.size, 0) }
+    {}
+
+    ~impl()
+    {
+      if (data != nullptr)
+        traits::deallocate(*this, data, size);
+    }
+
+    void swap(impl& other) noexcept
+    {
+      using std::swap;
+      swap(static_cast<Allocator&>(*this), static_cast<Allocator&>(other));
+      swap(data, other.data);
+      swap(size, other.size);
+    }
+
+    pointer data = nullptr;
+    size_type size = 0;
+  };
+
+  impl impl_;
+};
+
+} // namespace nanda
+
+#endif // NANDA_MEMORY_HEADER
@@ -0,0 +1,148 @@
+#ifndef NANDA_MULTI_INDEX_HEADER
+#define NANDA_MULTI_INDEX_HEADER
+
+#include <array>
+#include <cstddef>
+#include <iterator>
+
+#include "index_algos.hh"
+#include "rank.hh"
+
+namespace nanda {
+
+///@brief A multidimensional index together with its flat index
+template<std::size_t N, class IndexType = index_type>
+struct md_index
+{
+  std::array<IndexType, N> index;
+  IndexType offset;
+};
+
+///@brief Iterator over all multidimensional indices of 'dims' in storage
+/// order. Advancing increments the fastest running index and carries into the
+/// slower ones like an odometer, no division is ever performed.
+/// Dereferencing returns the md_index by value, so equal iterators yield
+/// equal values and no reference outlives its iterator. Copies may be
+/// advanced independently, but since reference is not value_type& it is
+/// tagged as an input iterator.
+///
+///@tparam storage storage order, the last (RowMajor) or first (ColMajor)
+/// index runs fastest
+///@tparam N rank of the index space
+///@tparam IndexType type of the indices and the flat offset
+template<StorageOrder storage, std::size_t N, class IndexType = index_type>
+class multi_index_iterator
+{
+public:
+  using index_type = IndexType;
+  using iterator_category = std::input_iterator_tag;
+  using value_type = md_index<N, IndexType>;
+  using difference_type = std::ptrdiff_t;
+  using pointer = void;
+  using reference = value_type;
+
+  constexpr multi_index_iterator() noexcept = default;
+
+  constexpr multi_index_iterator(const std::array<index_type, N>& dims,
+                                 index_type offset) noexcept
+    : dims_{ dims }
+    , current_{ {}, offset }
+  {}
+
+  constexpr reference operator*() const noexcept { return current_; }
+
+  constexpr multi_index_iterator& operator++() noexcept
+  {
+    ++current_.offset;
+    if constexpr (storage == StorageOrder::RowMajor) {
+      for (std::size_t i = N; i-- > 0;) {
+        if (++current_.index[i] < dims_[i])
+          return *this;
+        current_.index[i] = 0;
+      }
+    } else {
+      for (std::size_t i = 0; i < N; ++i) {
+        if (++current_.index[i] < dims_[i])
+          return *this;
+        current_.index[i] = 0;
+      }
+    }
+    return *this;
+  }
+
+  constexpr multi_index_iterator operator++(int) noexcept
+  {
+    auto tmp = *this;
+    ++*this;
+    return tmp;
+  }
+
+  friend constexpr bool operator==(const multi_index_iterator& lhs,
+                                   const multi_index_iterator& rhs) noexcept
+  {
+    return lhs.current_.offset == rhs.current_.offset;
+  }
+
+  friend constexpr bool operator!=(const multi_index_iterator& lhs,
+                                   const multi_index_iterator& rhs) noexcept
+  {
+    return !(lhs == rhs);
+  }
+
+private:
+  std::array<index_type, N> dims_{};
+  value_type current_{};
+};
+
+///@brief Range of all multidimensional indices of 'dims' in storage order,
+/// see multi_index_iterator
+template<StorageOrder storage, std::size_t N, class IndexType = index_type>
+class multi_index_range
+{
+public:
+  using index_type = IndexType;
+  using iterator = multi_index_iterator<storage, N, IndexType>;
+
+  constexpr explicit multi_index_range(
+    const std::array<index_type, N>& dims) noexcept
+    : dims_{ dims }
+  {}
+
+  constexpr iterator begin() const noexcept { return { dims_, 0 }; }
+  constexpr iterator end() const noexcept { return { dims_, size() }; }
+
+  constexpr index_type size() const noexcept
+  {
+    index_type size = 1;
+    for (auto dim : dims_)
+      size *= dim;
+    return size;
+  }
+
+  [[nodiscard]] constexpr bool empty() const noexcept { return size() == 0; }
+
+private:
+  std::array<index_type, N> dims_;
+};
+
+///@brief All multidimensional indices of 'dims' (an array of dimensions or a
+/// nanda::extents) in storage order, together with their flat index. The
+/// indices are of the index_type of the extents, nanda::index_type for plain
+/// arrays of dimensions.
+///
+///@tparam storage storage order
+///@param dims the maximum extent of the multidimensional array
+///@return multi_index_range usable in range-for and std algorithms
+template<StorageOrder storage, class Dims>
+constexpr auto
+multi_indices(const Dims& dims)
+{
+  constexpr std::size_t N = Rank<Dims>::value;
+  using index_t = detail::dims_index_t<Dims>;
+  return multi_index_range<storage, N, index_t>{ detail::dims_array<index_t>(
+    dims) };
+}
+
+} // namespace nanda
+
+#endif // NANDA_MULTI_INDEX_HEADER
@@ -3,10 +3,259 @@
 
 #include <algorithm>
 #include <array>
+#include <numeric>
 #include <tuple>
+#include <utility>
 
+#include "expression.hh"
+#include "extents.hh"
+#include "layouts.hh"
+#include "memory.hh"
+#include "ndspan.hh"
 #include "span.hh"
+#include "tiled_layout.hh"
 
-namespace nanda {}
+namespace nanda {
 
-#endif // NANDA_NDARRAY_HEADER
\ No newline at end of file
+///@brief Owning multidimensional array. The elements live in one contiguous
+/// buffer aligned to 'default_alignment' which is allocated once on
+/// construction; the layout mapping computes the strides once as well so
+/// element access is a single inner product of the indices and the strides.
+///
+/// Non-exhaustive layouts (layout_tiled with a partial last tile, the row
+/// padding of layout_right_padded) own required_span_size() elements, the
+/// iterators and as_span() run over all of them in memory order while size()
+/// counts the indices only.
+///
+/// The buffer comes from 'Allocator' (aligned operator new by default), which
+/// must return memory aligned to 'default_alignment'; a resource_allocator
+/// (arena.hh) carves arrays out of an arena or a pool.
+///
+///@tparam T the element type
+///@tparam Extents a nanda::extents describing the dimensions, static extents
+/// take no storage
+///@tparam Layout a unique layout policy (layout_right, layout_left,
+/// layout_right_padded, layout_tiled)
+///@tparam Allocator an allocator of T
+template<class T,
+         class Extents,
+         class Layout = layout_right,
+         class Allocator = aligned_allocator<T>>
+class ndarray
+{
+public:
+  using value_type = T;
+  using allocator_type = Allocator;
+  using extents_type = Extents;
+  using layout_type = Layout;
+  using mapping_type = typename Layout::template mapping<Extents>;
+  using index_type = typename Extents::index_type;
+  using rank_type = typename Extents::rank_type;
+  using index_array = std::array<index_type, Extents::rank()>;
+  using view_type = ndspan<T, Extents, Layout>;
+  using const_view_type = ndspan<const T, Extents, Layout>;
+  using pointer = T*;
+  using const_pointer = const T*;
+  using reference = T&;
+  using const_reference = const T&;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  static_assert(mapping_type::is_always_unique(),
+                "ndarray owns exactly one element per index");
+
+  static constexpr rank_type rank() noexcept { return Extents::rank(); }
+
+  ndarray()
+    : ndarray(extents_type{})
+  {}
+
+  explicit ndarray(const extents_type& ext,
+                   const Allocator& alloc = Allocator())
+    : map_{ ext }
+    , buffer_{ size_type(map_.required_span_size()), alloc }
+  {}
+
+  ///@brief Default initialized elements: trivial ones are left for the
+  /// caller to write, and the pages to be touched first by the threads which
+  /// will use them (see make_first_touch())
+  ndarray(const extents_type& ext,
+          default_init_t,
+          const Allocator& alloc = Allocator())
+    : map_{ ext }
+    , buffer_{ size_type(map_.required_span_size()), default_init, alloc }
+  {}
+
+  ndarray(const extents_type& ext,
+          const T& value,
+          const Allocator& alloc = Allocator())
+    : map_{ ext }
+    , buffer_{ size_type(map_.required_span_size()), value, alloc }
+  {}
+
+  ndarray(const ndarray&) = default;
+  ndarray& operator=(const ndarray&) = default;
+
+  ///@brief Takes the buffer of 'other', which is left without storage and
+  /// with extents_type{}: empty when an extent is dynamic, otherwise of the
+  /// static extents with storage_size() 0, to be assigned or destroyed only
+  ndarray(ndarray&& other) noexcept
+    : map_{ std::exchange(other.map_, mapping_type(extents_type{})) }
+    , buffer_{ std::move(other.buffer_) }
+  {}
+
+  ndarray& operator=(ndarray&& other) noexcept
+  {
+    if (this != &other) {
+      buffer_ = std::move(other.buffer_);
+      map_ = std::exchange(other.map_, mapping_type(extents_type{}));
+    }
+    return *this;
+  }
+
+  ///@brief Evaluates 'expr' into a new array of its extents, in one pass
+  template<class Expr>
+  ndarray(const expression<Expr>& expr, const Allocator& alloc = Allocator())
+    : ndarray(extents_type(expr.derived().extents()), alloc)
+  {
+    assign(view(), expr);
+  }
+
+  ///@brief Evaluates 'expr' in place, the extents must match
+  template<class Expr>
+  ndarray& operator=(const expression<Expr>& expr)
+  {
+    assign(view(), expr);
+    return *this;
+  }
+
+  // element access
+
+  template<class... Idx,
+           REQUIRES(sizeof...(Idx) == rank() &&
+                    std::conjunction_v<std::is_integral<Idx>...>)>
+  reference operator()(Idx... idx) noexcept
+  {
+    return data()[offset(index_array{ index_type(idx)... })];
+  }
+
+  template<class... Idx,
+           REQUIRES(sizeof...(Idx) == rank() &&
+                    std::conjunction_v<std::is_integral<Idx>...>)>
+  const_reference operator()(Idx... idx) const noexcept
+  {
+    return data()[offset(index_array{ index_type(idx)... })];
+  }
+
+  reference operator()(const index_array& idx) noexcept
+  {
+    return data()[offset(idx)];
+  }
+
+  const_reference operator()(const index_array& idx) const noexcept
+  {
+    return data()[offset(idx)];
+  }
+
+  reference operator[](index_type idx) noexcept
+  {
+    EXPECTS(size_type(idx) < storage_size());
+    return data()[idx];
+  }
+
+  const_reference operator[](index_type idx) const noexcept
+  {
+    EXPECTS(size_type(idx) < storage_size());
+    return data()[idx];
+  }
+
+  // observers
+
+  pointer data() noexcept { return buffer_.data(); }
+  const_pointer data() const noexcept { return buffer_.data(); }
+
+  ///@brief Number of indices of the index space
+  size_type size() const noexcept { return map_.extents().size(); }
+  [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+  ///@brief Number of owned elements, size() plus the padding of
+  /// non-exhaustive layouts
+  size_type storage_size() const noexcept { return buffer_.size(); }
+
+  const mapping_type& mapping() const noexcept { return map_; }
+  const extents_type& extents() const noexcept { return map_.extents(); }
+  const auto& strides() const noexcept { return map_.strides(); }
+
+  allocator_type get_allocator() const noexcept
+  {
+    return buffer_.get_allocator();
+  }
+
+  index_type extent(rank_type r) const noexcept
+  {
+    EXPECTS(r < rank());
+    return map_.extents().extent(r);
+  }
+
+  index_type stride(rank_type r) const noexcept
+  {
+    EXPECTS(r < rank());
+    return map_.stride(r);
+  }
+
+  view_type view() noexcept { return { data(), map_ }; }
+  const_view_type view() const noexcept { return { data(), map_ }; }
+
+  span<T> as_span() noexcept { return { data(), storage_size() }; }
+  span<const T> as_span() const noexcept
+  {
+    return { data(), storage_size() };
+  }
+
+  // iterator support
+
+  iterator begin() noexcept { return data(); }
+  iterator end() noexcept { return data() + storage_size(); }
+  const_iterator begin() const noexcept { return data(); }
+  const_iterator end() const noexcept { return data() + storage_size(); }
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator cend() const noexcept { return end(); }
+
+  void fill(const T& value) { std::fill(begin(), end(), value); }
+
+  void swap(ndarray& other) noexcept
+  {
+    std::swap(map_, other.map_);
+    buffer_.swap(other.buffer_);
+  }
+
+private:
+  index_type offset(const index_array& idx) const noexcept
+  {
+    EXPECTS(in_bounds(idx));
+    return map_(idx);
+  }
+
+  bool in_bounds(const index_array& idx) const noexcept
+  {
+    for (rank_type r = 0; r < rank(); ++r)
+      if (idx[r] < 0 || idx[r] >= map_.extents().extent(r))
+        return false;
+    return true;
+  }
+
+  mapping_type map_;
+  aligned_buffer<T, default_alignment, Allocator> buffer_;
+};
+
+template<class T, class Extents, class Layout, class Allocator>
+void
+swap(ndarray<T, Extents, Layout, Allocator>& lhs,
+     ndarray<T, Extents, Layout, Allocator>& rhs) noexcept
+{
+  lhs.swap(rhs);
+}
+
+} // namespace nanda
+
+#endif // NANDA_NDARRAY_HEADER
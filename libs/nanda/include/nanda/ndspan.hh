@@ -0,0 +1,282 @@
+#ifndef NANDA_NDSPAN_HEADER
+#define NANDA_NDSPAN_HEADER
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#include "extents.hh"
+#include "layouts.hh"
+#include "memory.hh"
+#include "span.hh"
+#include "strided_copy.hh"
+
+namespace nanda {
+
+///@brief Non-owning multidimensional view of elements of type T. The layout
+/// mapping turns a multidimensional index into an offset from data().
+///
+///@tparam T the element type
+///@tparam Extents a nanda::extents describing the index space
+///@tparam Layout layout policy (layout_right, layout_left or layout_stride)
+template<class T, class Extents, class Layout = layout_right>
+class ndspan
+{
+public:
+  using element_type = T;
+  using value_type = std::remove_cv_t<T>;
+  using extents_type = Extents;
+  using layout_type = Layout;
+  using mapping_type = typename Layout::template mapping<Extents>;
+  using index_type = typename Extents::index_type;
+  using size_type = typename Extents::size_type;
+  using rank_type = typename Extents::rank_type;
+  using index_array = std::array<index_type, Extents::rank()>;
+  using pointer = T*;
+  using reference = T&;
+
+  static constexpr rank_type rank() noexcept { return Extents::rank(); }
+  static constexpr rank_type rank_dynamic() noexcept
+  {
+    return Extents::rank_dynamic();
+  }
+
+  constexpr ndspan() = default;
+
+  constexpr ndspan(pointer ptr, const mapping_type& map) noexcept
+    : data_{ ptr }
+    , map_{ map }
+  {}
+
+  template<class E = extents_type,
+           REQUIRES(std::is_constructible_v<mapping_type, const E&>)>
+  constexpr ndspan(pointer ptr, const extents_type& ext)
+    : ndspan{ ptr, mapping_type(ext) }
+  {}
+
+  ///@brief Converts views with a compatible element type and layout (a
+  /// layout_right view to a layout_stride one for example)
+  template<class U,
+           class OtherExtents,
+           class OtherLayout,
+           REQUIRES(std::is_convertible_v<U (*)[], T (*)[]> &&
+                    std::is_constructible_v<
+                      mapping_type,
+                      const typename ndspan<U, OtherExtents, OtherLayout>::
+                        mapping_type&>)>
+  constexpr ndspan(const ndspan<U, OtherExtents, OtherLayout>& other) noexcept
+    : ndspan{ other.data(), mapping_type(other.mapping()) }
+  {}
+
+  // element access
+
+  template<class... Idx,
+           REQUIRES(sizeof...(Idx) == rank() &&
+                    std::conjunction_v<std::is_integral<Idx>...>)>
+  constexpr reference operator()(Idx... idx) const noexcept
+  {
+    return (*this)(index_array{ index_type(idx)... });
+  }
+
+  constexpr reference operator()(const index_array& idx) const noexcept
+  {
+    EXPECTS(in_bounds(idx));
+    return data_[map_(idx)];
+  }
+
+  // observers
+
+  constexpr pointer data() const noexcept { return data_; }
+  constexpr const mapping_type& mapping() const noexcept { return map_; }
+  constexpr const extents_type& extents() const noexcept
+  {
+    return map_.extents();
+  }
+  constexpr index_type extent(rank_type r) const noexcept
+  {
+    return map_.extents().extent(r);
+  }
+  constexpr index_type stride(rank_type r) const noexcept
+  {
+    return map_.stride(r);
+  }
+  constexpr size_type size() const noexcept
+  {
+    return map_.extents().size();
+  }
+  [[nodiscard]] constexpr bool empty() const noexcept { return size() == 0; }
+
+  static constexpr bool is_always_unique() noexcept
+  {
+    return mapping_type::is_always_unique();
+  }
+  static constexpr bool is_always_exhaustive() noexcept
+  {
+    return mapping_type::is_always_exhaustive();
+  }
+  static constexpr bool is_always_contiguous() noexcept
+  {
+    return mapping_type::is_always_contiguous();
+  }
+  constexpr bool is_unique() const noexcept { return map_.is_unique(); }
+  constexpr bool is_exhaustive() const noexcept
+  {
+    return map_.is_exhaustive();
+  }
+  constexpr bool is_contiguous() const noexcept
+  {
+    return map_.is_contiguous();
+  }
+
+  ///@brief The elements as a flat span, only valid for contiguous views
+  constexpr span<T> as_span() const noexcept
+  {
+    EXPECTS(is_contiguous());
+    return { data_, size_type(map_.required_span_size()) };
+  }
+
+private:
+  constexpr bool in_bounds(const index_array& idx) const noexcept
+  {
+    for (rank_type r = 0; r < rank(); ++r)
+      if (idx[r] < 0 || idx[r] >= extent(r))
+        return false;
+    return true;
+  }
+
+  pointer data_ = nullptr;
+  mapping_type map_;
+};
+
+namespace detail {
+
+template<std::size_t R, class Extents, class F>
+constexpr void
+for_each_index_impl(const Extents& ext,
+                    std::array<typename Extents::index_type, Extents::rank()>& idx,
+                    F& f)
+{
+  if constexpr (R == Extents::rank()) {
+    f(std::as_const(idx));
+  } else {
+    for (idx[R] = 0; idx[R] < ext.extent(R); ++idx[R])
+      for_each_index_impl<R + 1>(ext, idx, f);
+  }
+}
+
+///@brief Calls f(idx) for every multidimensional index of 'ext' in row-major
+/// order
+template<class Extents, class F>
+constexpr void
+for_each_index(const Extents& ext, F&& f)
+{
+  std::array<typename Extents::index_type, Extents::rank()> idx{};
+  for_each_index_impl<0>(ext, idx, f);
+}
+
+template<class T, class E, class L, class U, class F, class M>
+constexpr bool
+same_contiguous_layout(const ndspan<T, E, L>& src,
+                       const ndspan<U, F, M>& dst) noexcept
+{
+  using src_mapping = typename ndspan<T, E, L>::mapping_type;
+  using dst_mapping = typename ndspan<U, F, M>::mapping_type;
+
+  if constexpr (src_mapping::is_always_contiguous() &&
+                dst_mapping::is_always_contiguous()) {
+    return std::is_same_v<L, M>;
+  } else if constexpr (!src_mapping::is_always_strided() ||
+                       !dst_mapping::is_always_strided()) {
+    // no strides to compare, the element order is only known to match for
+    // equal mappings
+    if constexpr (std::is_same_v<src_mapping, dst_mapping>)
+      return src.is_contiguous() && src.mapping() == dst.mapping();
+    else
+      return false;
+  } else {
+    if (!src.is_contiguous() || !dst.is_contiguous())
+      return false;
+    for (std::size_t r = 0; r < E::rank(); ++r)
+      if (src.extent(r) > 1 && src.stride(r) != dst.stride(r))
+        return false;
+    return true;
+  }
+}
+
+} // namespace detail
+
+///@brief Copies the elements of 'src' into 'dst', which must not overlap.
+/// When both views are contiguous with the same element order the copy is a
+/// single flat loop (memcpy for trivially copyable elements). Other strided
+/// views are copied in runs along their common fastest axis, or transposed in
+/// cache-sized blocks when their fastest axes differ (a row-major to
+/// column-major conversion for example). Layouts without strides are copied
+/// index by index through the mappings.
+template<class T, class E, class L, class U, class F, class M>
+void
+copy(const ndspan<T, E, L>& src, const ndspan<U, F, M>& dst)
+{
+  static_assert(E::rank() == F::rank(), "Views must have the same rank");
+  EXPECTS(src.extents() == dst.extents());
+  using src_mapping = typename ndspan<T, E, L>::mapping_type;
+  using dst_mapping = typename ndspan<U, F, M>::mapping_type;
+
+  if (detail::same_contiguous_layout(src, dst)) {
+    if constexpr (std::is_same_v<std::remove_cv_t<T>, U> &&
+                  std::is_trivially_copyable_v<U>) {
+      if (!src.empty())
+        std::memcpy(dst.data(), src.data(), src.size() * sizeof(U));
+    } else {
+      std::copy_n(src.data(), src.size(), dst.data());
+    }
+    return;
+  }
+
+  if constexpr (E::rank() > 0 && src_mapping::is_always_strided() &&
+                dst_mapping::is_always_strided()) {
+    std::array<std::ptrdiff_t, E::rank()> src_strides, dst_strides, dims;
+    for (std::size_t r = 0; r < E::rank(); ++r) {
+      src_strides[r] = std::ptrdiff_t(src.stride(r));
+      dst_strides[r] = std::ptrdiff_t(dst.stride(r));
+      dims[r] = std::ptrdiff_t(src.extent(r));
+    }
+    detail::strided_copy(
+      src.data(), src_strides, dst.data(), dst_strides, dims);
+  } else {
+    detail::for_each_index(src.extents(), [&](const auto& idx) {
+      dst(idx) = src(idx);
+    });
+  }
+}
+
+///@brief Whether every row (run of the last index) of 'view' starts on a
+/// 'bytes' boundary, so that a kernel may use aligned vector loads on it.
+/// Views of layout_aligned_rows<T, bytes> over an owned ndarray always are.
+template<class T, class E, class L>
+bool
+rows_aligned(const ndspan<T, E, L>& view,
+             std::size_t bytes = default_alignment) noexcept
+{
+  using mapping_type = typename ndspan<T, E, L>::mapping_type;
+
+  if (!is_aligned(view.data(), bytes))
+    return false;
+  if constexpr (E::rank() == 0 || !mapping_type::is_always_strided()) {
+    return E::rank() == 0;
+  } else {
+    if (view.extent(E::rank() - 1) > 1 && view.stride(E::rank() - 1) != 1)
+      return false;
+    for (std::size_t r = 0; r + 1 < E::rank(); ++r) {
+      const std::size_t pitch = std::size_t(view.stride(r)) * sizeof(T);
+      if (view.extent(r) > 1 && pitch % bytes != 0)
+        return false;
+    }
+    return true;
+  }
+}
+
+} // namespace nanda
+
+#endif // NANDA_NDSPAN_HEADER
@@ -0,0 +1,461 @@
+#ifndef NANDA_NPY_HEADER
+#define NANDA_NPY_HEADER
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "binary_io.hh"
+#include "thread_pool.hh"
+
+namespace nanda {
+
+///@brief The header of an NPY file
+struct npy_header
+{
+  ///@brief The dtype, as "<f4"
+  std::string descr;
+  bool fortran_order = false;
+  std::vector<std::size_t> shape;
+  ///@brief Byte offset of the first element
+  std::size_t data_offset = 0;
+
+  StorageOrder storage_order() const noexcept
+  {
+    return fortran_order ? StorageOrder::ColMajor : StorageOrder::RowMajor;
+  }
+
+  std::size_t size() const noexcept
+  {
+    std::size_t n = 1;
+    for (auto extent : shape)
+      n *= extent;
+    return n;
+  }
+};
+
+namespace detail {
+
+inline constexpr char npy_magic[] = "\x93NUMPY";
+
+inline constexpr char native_byte_order =
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  '>';
+#else
+  '<';
+#endif
+
+template<class T>
+constexpr char
+npy_kind() noexcept
+{
+  if constexpr (std::is_same_v<T, bool>)
+    return 'b';
+  else if constexpr (std::is_floating_point_v<T>)
+    return 'f';
+  else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+    return 'i';
+  else if constexpr (std::is_integral_v<T>)
+    return 'u';
+  else
+    static_assert(sizeof(T) == 0, "No NPY dtype for this element type");
+}
+
+[[noreturn]] inline void
+throw_npy_error(const std::string& what)
+{
+  throw std::runtime_error("Invalid NPY file: " + what);
+}
+
+///@brief The value of 'key' in the Python dict literal of an NPY header, up
+/// to the next ',' or '}' out of parentheses and quotes
+inline std::string
+npy_dict_value(const std::string& dict, const std::string& key)
+{
+  auto pos = dict.find("'" + key + "'");
+  if (pos == std::string::npos)
+    throw_npy_error("no '" + key + "' in the header");
+  pos = dict.find(':', pos);
+  if (pos == std::string::npos)
+    throw_npy_error("no value for '" + key + "'");
+  std::size_t end = ++pos;
+  int depth = 0;
+  bool quoted = false;
+  for (; end < dict.size(); ++end) {
+    const char c = dict[end];
+    if (c == '\'')
+      quoted = !quoted;
+    else if (quoted)
+      continue;
+    else if (c == '(')
+      ++depth;
+    else if (c == ')')
+      --depth;
+    else if (depth == 0 && (c == ',' || c == '}'))
+      break;
+  }
+  const auto first = dict.find_first_not_of(" ", pos);
+  const auto last = dict.find_last_not_of(" ", end - 1);
+  if (first == std::string::npos || first > last)
+    throw_npy_error("empty value for '" + key + "'");
+  return dict.substr(first, last - first + 1);
+}
+
+inline npy_header
+parse_npy_header(const std::string& dict, std::size_t data_offset)
+{
+  npy_header header;
+  header.data_offset = data_offset;
+
+  const auto descr = npy_dict_value(dict, "descr");
+  if (descr.size() < 3 || descr.front() != '\'' || descr.back() != '\'')
+    throw_npy_error("unsupported descr " + descr);
+  header.descr = descr.substr(1, descr.size() - 2);
+
+  const auto fortran = npy_dict_value(dict, "fortran_order");
+  if (fortran != "True" && fortran != "False")
+    throw_npy_error("fortran_order " + fortran);
+  header.fortran_order = fortran == "True";
+
+  const auto shape = npy_dict_value(dict, "shape");
+  if (shape.front() != '(' || shape.back() != ')')
+    throw_npy_error("shape " + shape);
+  for (std::size_t pos = 1; pos + 1 < shape.size();) {
+    pos = shape.find_first_not_of(" ,", pos);
+    if (pos == std::string::npos || pos + 1 >= shape.size())
+      break;
+    std::size_t end = pos;
+    std::size_t extent = 0;
+    for (; end < shape.size() && shape[end] >= '0' && shape[end] <= '9'; ++end)
+      extent = extent * 10 + std::size_t(shape[end] - '0');
+    // the 'L' suffix of files written by Python 2
+    if (end < shape.size() && shape[end] == 'L')
+      ++end;
+    if (end == pos)
+      throw_npy_error("shape " + shape);
+    header.shape.push_back(extent);
+    pos = end;
+  }
+  return header;
+}
+
+inline npy_header
+read_npy_header(const binary_file& file)
+{
+  char prefix[10];
+  file.read_at(prefix, sizeof(prefix), 0);
+  if (std::string(prefix, 6) != npy_magic)
+    throw_npy_error("bad magic string");
+  const auto major = static_cast<unsigned char>(prefix[6]);
+  std::size_t length = 0, offset = 0;
+  if (major == 1) {
+    length = std::size_t(static_cast<unsigned char>(prefix[8])) |
+             std::size_t(static_cast<unsigned char>(prefix[9])) << 8;
+    offset = 10;
+  } else if (major == 2 || major == 3) {
+    char more[2];
+    file.read_at(more, sizeof(more), 10);
+    length = std::size_t(static_cast<unsigned char>(prefix[8])) |
+             std::size_t(static_cast<unsigned char>(prefix[9])) << 8 |
+             std::size_t(static_cast<unsigned char>(more[0])) << 16 |
+             std::size_t(static_cast<unsigned char>(more[1])) << 24;
+    offset = 12;
+  } else {
+    throw_npy_error("version " + std::to_string(major));
+  }
+  std::string dict(length, '\0');
+  file.read_at(dict.data(), length, offset);
+  return parse_npy_header(dict, offset + length);
+}
+
+///@brief The header bytes of an NPY file of 'descr' elements, padded so the
+/// elements start 64 byte aligned
+inline std::string
+format_npy_header(const std::string& descr,
+                  bool fortran_order,
+                  const std::vector<std::size_t>& shape)
+{
+  std::string dict = "{'descr': '" + descr + "', 'fortran_order': " +
+                     (fortran_order ? "True" : "False") + ", 'shape': (";
+  for (std::size_t r = 0; r < shape.size(); ++r)
+    dict += std::to_string(shape[r]) + (shape.size() == 1 ? ",)" : "") +
+            (r + 1 < shape.size() ? ", " : "");
+  if (shape.size() != 1)
+    dict += ")";
+  dict += ", }";
+
+  const bool large = 10 + dict.size() + 1 > 0xffff;
+  const std::size_t prefix = large ? 12 : 10;
+  const std::size_t total = (prefix + dict.size() + 1 + 63) / 64 * 64;
+  dict.append(total - prefix - dict.size() - 1, ' ');
+  dict += '\n';
+
+  std::string header(npy_magic, 6);
+  header += char(large ? 2 : 1);
+  header += char(0);
+  for (std::size_t k = 0; k < prefix - 8; ++k)
+    header += char((dict.size() >> (8 * k)) & 0xff);
+  return header + dict;
+}
+
+///@brief Checks the header against elements of type T and rank N, returns
+/// whether the bytes of the elements are swapped
+template<class T, std::size_t N>
+bool
+check_npy_header(const npy_header& header)
+{
+  const auto& descr = header.descr;
+  const std::string expected = npy_kind<T>() + std::to_string(sizeof(T));
+  if (descr.size() != expected.size() + 1 || descr.substr(1) != expected)
+    throw std::runtime_error("NPY dtype " + descr + " is not " + expected);
+  if (header.shape.size() != N)
+    throw std::runtime_error("NPY rank " + std::to_string(header.shape.size()) +
+                             " is not " + std::to_string(N));
+  const char order = descr.front() == '=' ? native_byte_order : descr.front();
+  if (order != '<' && order != '>' && order != '|')
+    throw std::runtime_error("NPY byte order " + descr);
+  return sizeof(T) > 1 && order != '|' && order != native_byte_order;
+}
+
+template<std::size_t N>
+std::array<std::size_t, N>
+npy_dims(const npy_header& header)
+{
+  std::array<std::size_t, N> dims{};
+  for (std::size_t r = 0; r < N; ++r)
+    dims[r] = header.shape[r];
+  return dims;
+}
+
+} // namespace detail
+
+///@brief The NPY dtype of T in native byte order, as "<f8"
+template<class T>
+std::string
+npy_descr()
+{
+  using value_type = std::remove_cv_t<T>;
+  const char order = sizeof(value_type) == 1 ? '|' : detail::native_byte_order;
+  return order + (detail::npy_kind<value_type>() +
+                  std::to_string(sizeof(value_type)));
+}
+
+///@brief Reads the header of the NPY file at 'path'
+inline npy_header
+read_npy_header(const std::string& path)
+{
+  const detail::binary_file file(path, O_RDONLY);
+  return detail::read_npy_header(file);
+}
+
+///@brief Reads the box of an NPY file starting at index 'first' with the
+/// extents of 'dst', in bounded reads straight into 'dst' where the box is
+/// contiguous in both. The dtype and rank of the file must match 'dst', its
+/// order is any.
+template<class Dst, REQUIRES(detail::is_io_array_v<Dst>)>
+void
+read_npy(const std::string& path,
+         const std::array<std::size_t, remove_cvref_t<Dst>::rank()>& first,
+         Dst&& dst,
+         std::size_t chunk = default_io_chunk)
+{
+  const auto view = detail::io_view(dst);
+  using view_type = decltype(view);
+  constexpr auto N = view_type::rank();
+  const detail::binary_file file(path, O_RDONLY);
+  const auto header = detail::read_npy_header(file);
+  const bool swap_bytes =
+    detail::check_npy_header<typename view_type::value_type, N>(header);
+  detail::read_box(file,
+                   header.data_offset,
+                   detail::npy_dims<N>(header),
+                   header.storage_order(),
+                   first,
+                   view,
+                   swap_bytes,
+                   chunk);
+}
+
+///@brief Reads an NPY file of the extents of 'dst' into 'dst'
+template<class Dst, REQUIRES(detail::is_io_array_v<Dst>)>
+void
+read_npy(const std::string& path,
+         Dst&& dst,
+         std::size_t chunk = default_io_chunk)
+{
+  const auto view = detail::io_view(dst);
+  const detail::binary_file file(path, O_RDONLY);
+  const auto header = detail::read_npy_header(file);
+  constexpr auto N = decltype(view)::rank();
+  const auto dims = detail::npy_dims<N>(header);
+  if (dims != detail::extents_array(view.extents()))
+    throw std::runtime_error("NPY shape does not match the extents");
+  const bool swap_bytes =
+    detail::check_npy_header<typename decltype(view)::value_type, N>(header);
+  detail::read_box(file,
+                   header.data_offset,
+                   dims,
+                   header.storage_order(),
+                   {},
+                   view,
+                   swap_bytes,
+                   chunk);
+}
+
+///@brief Reads the NPY file at 'path' into a new ndarray of its shape. A
+/// file in the storage order of Layout is read without a staging buffer.
+template<class T, std::size_t N, class Layout = layout_right>
+ndarray<T, dims<N>, Layout>
+read_npy(const std::string& path, std::size_t chunk = default_io_chunk)
+{
+  const detail::binary_file file(path, O_RDONLY);
+  const auto header = detail::read_npy_header(file);
+  const bool swap_bytes = detail::check_npy_header<T, N>(header);
+  std::array<index_type, N> shape{};
+  for (std::size_t r = 0; r < N; ++r)
+    shape[r] = index_type(header.shape[r]);
+  ndarray<T, dims<N>, Layout> arr{ dims<N>(shape) };
+  detail::read_box(file,
+                   header.data_offset,
+                   detail::npy_dims<N>(header),
+                   header.storage_order(),
+                   {},
+                   arr.view(),
+                   swap_bytes,
+                   chunk);
+  return arr;
+}
+
+///@brief Writes 'src' to a new NPY file (truncating an existing one). A
+/// layout_left view is written in Fortran order, any other one in C order;
+/// packed views go to the file straight from their memory.
+template<class Src, REQUIRES(detail::is_io_array_v<Src>)>
+void
+write_npy(const std::string& path,
+          const Src& src,
+          std::size_t chunk = default_io_chunk)
+{
+  const auto view = detail::io_view(src);
+  using view_type = decltype(view);
+  constexpr bool fortran_order =
+    std::is_same_v<typename view_type::layout_type, layout_left>;
+  const auto header =
+    detail::format_npy_header(npy_descr<typename view_type::value_type>(),
+                              fortran_order,
+                              [&] {
+                                const auto dims =
+                                  detail::extents_array(view.extents());
+                                return std::vector<std::size_t>(dims.begin(),
+                                                                dims.end());
+                              }());
+  const detail::binary_file file(path, O_WRONLY | O_CREAT | O_TRUNC);
+  file.write_at(header.data(), header.size(), 0);
+  detail::write_packed(file,
+                       header.size(),
+                       fortran_order ? StorageOrder::ColMajor
+                                     : StorageOrder::RowMajor,
+                       view,
+                       chunk);
+}
+
+///@brief Streams an NPY file in slabs of 'slab' indices along the slowest
+/// axis of Layout (the first for layout_right, the last for layout_left),
+/// calling f(first, view) for each in order with the index of the slab
+/// along that axis and a view of its elements.
+///
+/// Two slab buffers alternate: the next slab is read by a job submitted to
+/// 'pool' while f processes the current one on the calling thread, so
+/// reading overlaps with the processing. The views are valid until f
+/// returns. An exception of the reads or of f ends the stream and is
+/// rethrown.
+template<class T, std::size_t N, class Layout = layout_right, class F>
+void
+for_each_npy_slab(thread_pool& pool,
+                  const std::string& path,
+                  std::size_t slab,
+                  F&& f,
+                  std::size_t chunk = default_io_chunk)
+{
+  static_assert(N > 0, "Only arrays of rank 1 or more are streamed");
+  static_assert(std::is_same_v<Layout, layout_right> ||
+                  std::is_same_v<Layout, layout_left>,
+                "Slabs are packed in layout_right or layout_left");
+  using E = dims<N>;
+  using view_type = ndspan<T, E, Layout>;
+  constexpr std::size_t axis = std::is_same_v<Layout, layout_right> ? 0 : N - 1;
+
+  const detail::binary_file file(path, O_RDONLY);
+  const auto header = detail::read_npy_header(file);
+  const bool swap_bytes = detail::check_npy_header<T, N>(header);
+  const auto dims = detail::npy_dims<N>(header);
+  const std::size_t total = dims[axis];
+  if (total == 0)
+    return;
+  slab = std::max<std::size_t>(std::min(slab, total), 1);
+
+  std::array<index_type, N> shape{};
+  for (std::size_t r = 0; r < N; ++r)
+    shape[r] = index_type(dims[r]);
+  shape[axis] = index_type(slab);
+  // a prefix along the slowest axis of a packed buffer is packed too
+  ndarray<T, E, Layout> buffers[2] = { ndarray<T, E, Layout>{ E(shape) },
+                                       ndarray<T, E, Layout>{ E(shape) } };
+
+  const auto slab_view = [&](int b, std::size_t first) {
+    auto ext = shape;
+    ext[axis] = index_type(std::min(slab, total - first));
+    return view_type(buffers[b].data(), E(ext));
+  };
+  const auto read = [&](int b, std::size_t first) {
+    std::array<std::size_t, N> corner{};
+    corner[axis] = first;
+    detail::read_box(file,
+                     header.data_offset,
+                     dims,
+                     header.storage_order(),
+                     corner,
+                     slab_view(b, first),
+                     swap_bytes,
+                     chunk);
+  };
+
+  read(0, 0);
+  int current = 0;
+  for (std::size_t first = 0; first < total; first += slab) {
+    const std::size_t next = first + slab;
+    std::future<void> reader;
+    if (next < total)
+      reader = pool.submit([&, next, b = 1 - current] { read(b, next); });
+    try {
+      f(index_type(first), slab_view(current, first));
+    } catch (...) {
+      if (reader.valid())
+        reader.wait();
+      throw;
+    }
+    if (reader.valid())
+      reader.get();
+    current = 1 - current;
+  }
+}
+
+///@brief for_each_npy_slab reading ahead on the default_thread_pool()
+template<class T, std::size_t N, class Layout = layout_right, class F>
+void
+for_each_npy_slab(const std::string& path,
+                  std::size_t slab,
+                  F&& f,
+                  std::size_t chunk = default_io_chunk)
+{
+  for_each_npy_slab<T, N, Layout>(
+    default_thread_pool(), path, slab, std::forward<F>(f), chunk);
+}
+
+} // namespace nanda
+
+#endif // NANDA_NPY_HEADER
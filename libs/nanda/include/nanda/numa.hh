@@ -0,0 +1,334 @@
+#ifndef NANDA_NUMA_HEADER
+#define NANDA_NUMA_HEADER
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "arena.hh"
+#include "layouts.hh"
+#include "mapped_array.hh"
+#include "memory.hh"
+#include "ndarray.hh"
+#include "parallel_for.hh"
+#include "thread_pool.hh"
+#include "utility.hh"
+
+namespace nanda {
+
+///@brief Pages backing the large blocks of a page_resource
+enum class huge_pages
+{
+  ///@brief Base pages only, transparent huge pages disabled for the block
+  none,
+  ///@brief Transparent huge pages (madvise MADV_HUGEPAGE) on a block aligned
+  /// to the huge page size, base pages where the kernel has none to give
+  transparent,
+  ///@brief Explicit huge pages (MAP_HUGETLB) from the pool reserved in
+  /// /proc/sys/vm/nr_hugepages, std::bad_alloc when it runs out
+  reserved
+};
+
+namespace detail {
+
+///@brief The default huge page size of the kernel, 2 MiB if unknown
+inline std::size_t
+huge_page_size()
+{
+  static const std::size_t size = [] {
+    std::ifstream meminfo("/proc/meminfo");
+    std::string line;
+    while (std::getline(meminfo, line)) {
+      unsigned long kib = 0;
+      if (std::sscanf(line.c_str(), "Hugepagesize: %lu kB", &kib) == 1)
+        return std::size_t(kib) * 1024;
+    }
+    return std::size_t(1) << 21;
+  }();
+  return size;
+}
+
+constexpr std::size_t
+round_up(std::size_t bytes, std::size_t multiple) noexcept
+{
+  return (bytes + multiple - 1) / multiple * multiple;
+}
+
+} // namespace detail
+
+///@brief A memory resource mapping its large blocks straight from the
+/// kernel, on the pages of 'mode'. The pages are zero and not touched: each
+/// one is placed on a NUMA node when it is first written, by the node of the
+/// writing thread under the default policy, so a buffer written first in
+/// parallel (make_first_touch()) is spread over the nodes of the threads
+/// working on it.
+///
+/// Blocks smaller than 'min_bytes' come from 'upstream'. Mappings count as
+/// upstream allocations in stats().
+class page_resource : public counting_resource
+{
+public:
+  explicit page_resource(huge_pages mode = huge_pages::transparent,
+                         std::size_t min_bytes = std::size_t(1) << 20,
+                         std::pmr::memory_resource* upstream =
+                           std::pmr::new_delete_resource()) noexcept
+    : counting_resource{ upstream }
+    , mode_{ mode }
+    , min_bytes_{ min_bytes }
+  {}
+
+  page_resource(const page_resource&) = delete;
+  page_resource& operator=(const page_resource&) = delete;
+
+  huge_pages mode() const noexcept { return mode_; }
+  std::size_t min_bytes() const noexcept { return min_bytes_; }
+
+  ///@brief Size of the pages the large blocks are aligned and rounded to
+  std::size_t page_bytes() const
+  {
+    return mode_ == huge_pages::none ? detail::page_size()
+                                     : detail::huge_page_size();
+  }
+
+protected:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override
+  {
+    if (bytes < min_bytes_)
+      return counting_resource::do_allocate(bytes, alignment);
+
+    const std::size_t page = page_bytes();
+    EXPECTS(alignment <= page);
+    const std::size_t length = detail::round_up(bytes, page);
+    void* p = mode_ == huge_pages::transparent ? map_aligned(length, page)
+                                               : map(length);
+    count_upstream(length);
+    count_allocate(bytes);
+    return p;
+  }
+
+  void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+  {
+    if (bytes < min_bytes_) {
+      counting_resource::do_deallocate(p, bytes, alignment);
+      return;
+    }
+    count_deallocate(bytes);
+    ::munmap(p, detail::round_up(bytes, page_bytes()));
+  }
+
+private:
+  void* map(std::size_t length) const
+  {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_HUGETLB
+    if (mode_ == huge_pages::reserved)
+      flags |= MAP_HUGETLB;
+#endif
+    void* p = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (p == MAP_FAILED)
+      throw std::bad_alloc();
+#ifdef MADV_NOHUGEPAGE
+    if (mode_ == huge_pages::none)
+      ::madvise(p, length, MADV_NOHUGEPAGE);
+#endif
+    return p;
+  }
+
+  ///@brief A mapping of 'length' bytes aligned to 'page', cut out of a
+  /// larger one, so the kernel can back all of it with huge pages
+  void* map_aligned(std::size_t length, std::size_t page) const
+  {
+    void* base = ::mmap(nullptr,
+                        length + page,
+                        PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS,
+                        -1,
+                        0);
+    if (base == MAP_FAILED)
+      throw std::bad_alloc();
+    const auto address = reinterpret_cast<std::uintptr_t>(base);
+    const std::size_t lead = detail::round_up(address, page) - address;
+    auto* p = static_cast<std::byte*>(base) + lead;
+    if (lead > 0)
+      ::munmap(base, lead);
+    if (page > lead)
+      ::munmap(p + length, page - lead);
+#ifdef MADV_HUGEPAGE
+    ::madvise(p, length, MADV_HUGEPAGE);
+#endif
+    return p;
+  }
+
+  huge_pages mode_;
+  std::size_t min_bytes_;
+};
+
+///@brief An array of 'ext' filled with 'value' on the threads of 'pool'.
+/// Each element is written first by the thread a parallel_for over 'ext'
+/// with the same pool and grain hands its index to, in the storage order of
+/// the layout, so the pages of a fresh buffer (a page_resource, or a large
+/// operator new) sit on the NUMA nodes of the threads that will work on
+/// them. Non-exhaustive layouts are filled in equal shares of their storage
+/// instead, as their padding has no index.
+///
+/// Elements of non-trivial types are default constructed first, on the
+/// calling thread.
+template<class Layout = layout_right,
+         class T,
+         class Extents,
+         class Allocator = aligned_allocator<T>>
+ndarray<T, Extents, Layout, Allocator>
+make_first_touch(thread_pool& pool,
+                 const Extents& ext,
+                 const T& value,
+                 const Allocator& alloc = Allocator(),
+                 std::size_t grain = default_parallel_grain)
+{
+  ndarray<T, Extents, Layout, Allocator> arr(ext, default_init, alloc);
+  T* data = arr.data();
+  const auto& map = arr.mapping();
+  if (map.is_exhaustive()) {
+    constexpr auto order = std::is_same_v<Layout, layout_left>
+                             ? StorageOrder::ColMajor
+                             : StorageOrder::RowMajor;
+    parallel_for<order>(
+      pool, ext, [&](const auto& idx) { data[map(idx)] = value; }, grain);
+  } else {
+    const std::array<index_type, 1> storage{ index_type(arr.storage_size()) };
+    parallel_for(
+      pool, storage, [&](const auto& idx) { data[idx[0]] = value; }, grain);
+  }
+  return arr;
+}
+
+///@brief Where the pages of a range of memory are
+struct page_report
+{
+  ///@brief Resident base pages per NUMA node, indexed by node
+  std::vector<std::size_t> pages_per_node;
+  ///@brief Base pages never touched (or swapped out)
+  std::size_t not_present = 0;
+  ///@brief Bytes on huge pages, transparent or explicit, of the mappings
+  /// overlapping the range
+  std::size_t huge_bytes = 0;
+  ///@brief Size of the base pages counted
+  std::size_t page_bytes = 0;
+
+  std::size_t resident() const noexcept
+  {
+    std::size_t pages = 0;
+    for (auto n : pages_per_node)
+      pages += n;
+    return pages;
+  }
+
+  ///@brief One line, "node 0: 512 pages, node 1: 512 pages, 0 not present,
+  /// 4 MiB on huge pages"
+  std::string to_string() const
+  {
+    std::string text;
+    for (std::size_t node = 0; node < pages_per_node.size(); ++node)
+      text += "node " + std::to_string(node) + ": " +
+              std::to_string(pages_per_node[node]) + " pages, ";
+    return text + std::to_string(not_present) + " not present, " +
+           std::to_string(huge_bytes >> 20) + " MiB on huge pages";
+  }
+};
+
+namespace detail {
+
+///@brief Bytes on huge pages of the mappings of this process overlapping
+/// [first, last), from /proc/self/smaps
+inline std::size_t
+huge_page_bytes(std::uintptr_t first, std::uintptr_t last)
+{
+  std::ifstream smaps("/proc/self/smaps");
+  std::string line;
+  bool overlaps = false;
+  std::size_t bytes = 0;
+  while (std::getline(smaps, line)) {
+    unsigned long begin = 0, end = 0, kib = 0;
+    if (std::sscanf(line.c_str(), "%lx-%lx ", &begin, &end) == 2)
+      overlaps = begin < last && end > first;
+    else if (overlaps &&
+             (std::sscanf(line.c_str(), "AnonHugePages: %lu kB", &kib) == 1 ||
+              std::sscanf(line.c_str(), "Private_Hugetlb: %lu kB", &kib) ==
+                1 ||
+              std::sscanf(line.c_str(), "Shared_Hugetlb: %lu kB", &kib) == 1))
+      bytes += std::size_t(kib) * 1024;
+  }
+  return bytes;
+}
+
+} // namespace detail
+
+///@brief The NUMA nodes of the pages of [p, p + bytes), asked to the kernel
+/// with move_pages(2) without moving any. Throws std::system_error where the
+/// kernel has no NUMA support.
+inline page_report
+page_placement(const void* p, std::size_t bytes)
+{
+  page_report report;
+  report.page_bytes = detail::page_size();
+  if (bytes == 0)
+    return report;
+
+  const auto page = report.page_bytes;
+  const auto address = reinterpret_cast<std::uintptr_t>(p);
+  const std::uintptr_t first = address / page * page;
+  const std::uintptr_t last = detail::round_up(address + bytes, page);
+
+  constexpr std::size_t batch = 1024;
+  std::array<void*, batch> pages;
+  std::array<int, batch> status;
+  for (std::uintptr_t at = first; at < last;) {
+    const auto count = std::min<std::size_t>(batch, (last - at) / page);
+    for (std::size_t k = 0; k < count; ++k, at += page)
+      pages[k] = reinterpret_cast<void*>(at);
+    if (::syscall(SYS_move_pages,
+                  0,
+                  (unsigned long)count,
+                  pages.data(),
+                  nullptr,
+                  status.data(),
+                  0) != 0)
+      detail::throw_errno("move_pages");
+    for (std::size_t k = 0; k < count; ++k) {
+      if (status[k] < 0) {
+        ++report.not_present;
+        continue;
+      }
+      const auto node = std::size_t(status[k]);
+      if (node >= report.pages_per_node.size())
+        report.pages_per_node.resize(node + 1);
+      ++report.pages_per_node[node];
+    }
+  }
+  report.huge_bytes = detail::huge_page_bytes(first, last);
+  return report;
+}
+
+///@brief The NUMA nodes of the pages of the buffer of 'arr'
+template<class T, class E, class L, class A>
+page_report
+page_placement(const ndarray<T, E, L, A>& arr)
+{
+  return page_placement(arr.data(), arr.storage_size() * sizeof(T));
+}
+
+} // namespace nanda
+
+#endif // NANDA_NUMA_HEADER
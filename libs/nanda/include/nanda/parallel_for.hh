@@ -0,0 +1,175 @@
+#ifndef NANDA_PARALLEL_FOR_HEADER
+#define NANDA_PARALLEL_FOR_HEADER
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "index_algos.hh"
+#include "rank.hh"
+#include "thread_pool.hh"
+
+namespace nanda {
+
+///@brief Elements a parallel_for block covers at least when no grain is
+/// given, enough to hide the cost of handing a block out
+inline constexpr std::size_t default_parallel_grain = 4096;
+
+namespace detail {
+
+///@brief The index of the first element of row 'first' (a run of the fastest
+/// index) of 'dims'
+template<StorageOrder storage, class IndexType, std::size_t N>
+std::array<IndexType, N>
+row_index(const std::array<IndexType, N>& dims, IndexType first)
+{
+  std::array<IndexType, N> idx{};
+  IndexType row = first;
+  if constexpr (storage == StorageOrder::RowMajor) {
+    for (std::size_t i = N - 1; i-- > 0;) {
+      idx[i] = row % dims[i];
+      row /= dims[i];
+    }
+  } else {
+    for (std::size_t i = 1; i < N; ++i) {
+      idx[i] = row % dims[i];
+      row /= dims[i];
+    }
+  }
+  return idx;
+}
+
+///@brief Runs f over 'rows' consecutive rows (runs of the fastest index) of
+/// 'dims', starting at row 'first'. The index of the first row is computed
+/// once, the others follow by incrementing like an odometer.
+template<StorageOrder storage, class IndexType, std::size_t N, class F>
+void
+for_each_row(const std::array<IndexType, N>& dims,
+             IndexType first,
+             IndexType rows,
+             F& f)
+{
+  constexpr std::size_t fast = storage == StorageOrder::RowMajor ? N - 1 : 0;
+  const IndexType length = dims[fast];
+
+  auto idx = row_index<storage>(dims, first);
+  IndexType offset = first * length;
+  for (IndexType r = 0; r < rows; ++r) {
+    for (IndexType j = 0; j < length; ++j) {
+      idx[fast] = j;
+      if constexpr (std::is_invocable_v<F&,
+                                        const std::array<IndexType, N>&,
+                                        IndexType>)
+        f(static_cast<const std::array<IndexType, N>&>(idx), offset + j);
+      else
+        f(static_cast<const std::array<IndexType, N>&>(idx));
+    }
+    offset += length;
+
+    if constexpr (storage == StorageOrder::RowMajor) {
+      for (std::size_t i = N - 1; i-- > 0;) {
+        if (++idx[i] < dims[i])
+          break;
+        idx[i] = 0;
+      }
+    } else {
+      for (std::size_t i = 1; i < N; ++i) {
+        if (++idx[i] < dims[i])
+          break;
+        idx[i] = 0;
+      }
+    }
+  }
+}
+
+} // namespace detail
+
+///@brief Calls f(idx), or f(idx, offset) if f takes the flat index as well,
+/// for every multidimensional index of 'dims' on the threads of 'pool'. If f
+/// takes f(first_idx, first_offset, rows) instead it is called once per
+/// block, with the index and flat offset of its first element and its number
+/// of rows, and walks the block itself with strides it computes once.
+///
+/// The index space is cut into blocks of whole rows along the outer
+/// dimensions, each block covering at least 'grain' elements, so a thread
+/// walks contiguous memory of the arrays it indexes with 'dims'. Within a
+/// block the indices advance like an odometer, the only division is the one
+/// locating the first row. The order of the calls across blocks is
+/// unspecified, f must be safe to call concurrently for distinct indices.
+///
+///@tparam storage storage order, the fastest running index is never split
+///@param dims an array of dimensions or a nanda::extents
+///@param f the function to call
+///@param grain minimum number of elements per block
+template<StorageOrder storage = StorageOrder::RowMajor, class Dims, class F>
+void
+parallel_for(thread_pool& pool,
+             const Dims& dims,
+             F&& f,
+             std::size_t grain = default_parallel_grain)
+{
+  constexpr std::size_t N = Rank<Dims>::value;
+  using index_t = detail::dims_index_t<Dims>;
+  const auto dim = detail::dims_array<index_t>(dims);
+
+  if constexpr (N == 0) {
+    f(dim);
+  } else {
+    // a rank 1 space is cut into rows of single elements
+    constexpr std::size_t fast =
+      storage == StorageOrder::RowMajor ? N - 1 : 0;
+    const index_t length = N == 1 ? 1 : dim[fast];
+    index_t size = 1;
+    for (auto d : dim)
+      size *= d;
+    if (size == 0)
+      return;
+
+    const index_t rows = size / length;
+    const auto row_length = std::size_t(length);
+    const auto per_block =
+      index_t(std::max<std::size_t>(1, (grain + row_length - 1) / row_length));
+    const auto blocks = std::size_t((rows + per_block - 1) / per_block);
+
+    pool.run(blocks, [&](std::size_t block) {
+      const index_t first = index_t(block) * per_block;
+      const index_t count = std::min(per_block, rows - first);
+      using index_array = std::array<index_t, N>;
+      if constexpr (std::is_invocable_v<F&,
+                                        const index_array&,
+                                        index_t,
+                                        index_t>) {
+        index_array idx{ first };
+        if constexpr (N > 1)
+          idx = detail::row_index<storage>(dim, first);
+        f(static_cast<const index_array&>(idx), first * length, count);
+      } else if constexpr (N == 1) {
+        for (index_t i = first; i < first + count; ++i) {
+          const std::array<index_t, 1> idx{ i };
+          if constexpr (std::is_invocable_v<F&, decltype(idx), index_t>)
+            f(idx, i);
+          else
+            f(idx);
+        }
+      } else {
+        detail::for_each_row<storage>(dim, first, count, f);
+      }
+    });
+  }
+}
+
+///@brief parallel_for on the default_thread_pool()
+template<StorageOrder storage = StorageOrder::RowMajor, class Dims, class F>
+void
+parallel_for(const Dims& dims,
+             F&& f,
+             std::size_t grain = default_parallel_grain)
+{
+  parallel_for<storage>(default_thread_pool(), dims, std::forward<F>(f), grain);
+}
+
+} // namespace nanda
+
+#endif // NANDA_PARALLEL_FOR_HEADER
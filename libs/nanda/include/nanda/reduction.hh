@@ -0,0 +1,1134 @@
+#ifndef NANDA_REDUCTION_HEADER
+#define NANDA_REDUCTION_HEADER
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "concepts.hh"
+#include "expression.hh"
+#include "ndarray.hh"
+#include "thread_pool.hh"
+
+namespace nanda {
+
+///@brief How floating point sums are accumulated. Integer sums are exact and
+/// always use the naive loop.
+enum class summation
+{
+  ///@brief One running sum per vector lane, the fastest
+  naive,
+  ///@brief Recursive halving, the error grows with log(n) instead of n
+  pairwise,
+  ///@brief Compensated (Kahan) summation, the error does not grow with n.
+  /// Relies on strict floating point semantics, -ffast-math defeats it.
+  kahan
+};
+
+///@brief Axes to reduce given at compile time, sum(a, axes<0, 2>). Runtime
+/// axes are a single integer or a std::array of them.
+template<std::size_t... Axes>
+struct axis_list
+{};
+
+template<std::size_t... Axes>
+inline constexpr axis_list<Axes...> axes{};
+
+///@brief Elements a reduction task covers at least, reductions over fewer
+/// elements than this run on the calling thread
+inline constexpr std::size_t default_reduce_grain = std::size_t(1) << 15;
+
+///@brief The type sums of T accumulate in: T itself for floating point
+/// types, 64 bit integers otherwise
+template<class T>
+using sum_type_t =
+  std::conditional_t<std::is_floating_point_v<T>,
+                     T,
+                     std::conditional_t<std::is_signed_v<T>,
+                                        std::int64_t,
+                                        std::uint64_t>>;
+
+///@brief The type of the mean of T elements: T for floating point types,
+/// double otherwise
+template<class T>
+using mean_type_t =
+  std::conditional_t<std::is_floating_point_v<T>, T, double>;
+
+namespace detail {
+
+///@brief Independent accumulators per contiguous run, enough for the widest
+/// vector of 32 bit elements and to hide the latency of the adds
+inline constexpr std::size_t reduce_lanes = 16;
+
+///@brief Elements the pairwise sum adds up naively
+inline constexpr std::size_t pairwise_block = 256;
+
+///@brief Rows the column-wise pairwise sum adds up naively
+inline constexpr std::size_t pairwise_rows = 16;
+
+///@brief Outputs a column-wise task accumulates at once, their partial
+/// results stay in the L1 cache
+inline constexpr std::size_t reduce_column_block = 512;
+
+///@brief Folds n elements 'stride' apart into 'reduce_lanes' accumulators,
+/// add(acc, x) adds an element and merge(acc, acc) combines two of them
+template<class State, class T, class I, class Add, class Merge>
+State
+lane_fold(const State& init,
+          const T* p,
+          I n,
+          I stride,
+          const Add& add,
+          const Merge& merge)
+{
+  constexpr I lanes = I(reduce_lanes);
+  State lane[reduce_lanes];
+  std::fill_n(lane, reduce_lanes, init);
+
+  I i = 0;
+  if (stride == 1) {
+    for (; i + lanes <= n; i += lanes)
+      for (I l = 0; l < lanes; ++l)
+        add(lane[l], p[i + l]);
+  } else {
+    for (; i + lanes <= n; i += lanes)
+      for (I l = 0; l < lanes; ++l)
+        add(lane[l], p[(i + l) * stride]);
+  }
+  for (; i < n; ++i)
+    add(lane[0], p[i * stride]);
+
+  for (std::size_t width = reduce_lanes / 2; width > 0; width /= 2)
+    for (std::size_t l = 0; l < width; ++l)
+      merge(lane[l], lane[l + width]);
+  return lane[0];
+}
+
+///@brief Running sum and the error of the additions so far, the exact sum
+/// is sum - error
+template<class Acc>
+struct compensated
+{
+  Acc sum{};
+  Acc error{};
+};
+
+template<class Acc>
+inline void
+kahan_add(compensated<Acc>& s, Acc x) noexcept
+{
+  const Acc y = x - s.error;
+  const Acc t = s.sum + y;
+  s.error = (t - s.sum) - y;
+  s.sum = t;
+}
+
+template<class Acc>
+inline void
+kahan_merge(compensated<Acc>& s, const compensated<Acc>& other) noexcept
+{
+  // two-sum of the running sums, the rounding error joins the others
+  const Acc t = s.sum + other.sum;
+  const Acc big = std::abs(s.sum) >= std::abs(other.sum) ? s.sum : other.sum;
+  const Acc small = std::abs(s.sum) >= std::abs(other.sum) ? other.sum : s.sum;
+  s.error = s.error + other.error - ((big - t) + small);
+  s.sum = t;
+}
+
+template<class Acc, class T, class I>
+Acc
+naive_sum(const T* p, I n, I stride)
+{
+  return lane_fold(
+    Acc{},
+    p,
+    n,
+    stride,
+    [](Acc& s, const auto& x) { s += Acc(x); },
+    [](Acc& s, const Acc& other) { s += other; });
+}
+
+template<class Acc, class T, class I>
+Acc
+pairwise_sum(const T* p, I n, I stride)
+{
+  if (std::size_t(n) <= pairwise_block)
+    return naive_sum<Acc>(p, n, stride);
+  // split on a lane boundary, the halves keep the vectorized loop
+  const I half = n / 2 / I(reduce_lanes) * I(reduce_lanes);
+  return pairwise_sum<Acc>(p, half, stride) +
+         pairwise_sum<Acc>(p + half * stride, n - half, stride);
+}
+
+template<class Acc, class T, class I>
+compensated<Acc>
+kahan_sum(const T* p, I n, I stride)
+{
+  // sums and errors in separate lanes, the loop vectorizes like the naive one
+  constexpr I lanes = I(reduce_lanes);
+  Acc sum[reduce_lanes] = {};
+  Acc error[reduce_lanes] = {};
+  const auto add = [&](I l, Acc x) {
+    const Acc y = x - error[l];
+    const Acc t = sum[l] + y;
+    error[l] = (t - sum[l]) - y;
+    sum[l] = t;
+  };
+
+  I i = 0;
+  if (stride == 1) {
+    for (; i + lanes <= n; i += lanes)
+      for (I l = 0; l < lanes; ++l)
+        add(l, Acc(p[i + l]));
+  } else {
+    for (; i + lanes <= n; i += lanes)
+      for (I l = 0; l < lanes; ++l)
+        add(l, Acc(p[(i + l) * stride]));
+  }
+  for (; i < n; ++i)
+    add(0, Acc(p[i * stride]));
+
+  compensated<Acc> total{ sum[0], error[0] };
+  for (std::size_t l = 1; l < reduce_lanes; ++l)
+    kahan_merge(total, compensated<Acc>{ sum[l], error[l] });
+  return total;
+}
+
+template<class T>
+constexpr T
+lowest_value() noexcept
+{
+  if constexpr (std::numeric_limits<T>::has_infinity)
+    return -std::numeric_limits<T>::infinity();
+  else
+    return std::numeric_limits<T>::lowest();
+}
+
+template<class T>
+constexpr T
+highest_value() noexcept
+{
+  if constexpr (std::numeric_limits<T>::has_infinity)
+    return std::numeric_limits<T>::infinity();
+  else
+    return std::numeric_limits<T>::max();
+}
+
+} // namespace detail
+
+// Reducers
+//
+// A reducer folds the elements of one output into a state_type:
+//   state_type init() const;
+//   void accumulate(state_type&, const T& x, I pos) const;
+//   void merge(state_type&, const state_type& later) const;
+//   result_type finish(const state_type&, size_type count) const;
+// 'pos' is the row-major flat index of the element within the reduced axes,
+// merge() combines the state of elements at larger positions. Optionally
+//   void run(state_type&, const T* p, I n, I stride, I pos, I pos_step) const;
+// folds n elements 'stride' apart at once (the contiguous, vectorized case)
+// and 'static constexpr bool is_pairwise = true' asks the column-wise loop
+// to combine the rows pairwise.
+
+///@brief Sum in Acc
+template<class Acc, summation Mode = summation::naive>
+struct sum_reducer
+{
+  static constexpr summation mode =
+    std::is_floating_point_v<Acc> ? Mode : summation::naive;
+  static constexpr bool is_pairwise = mode == summation::pairwise;
+
+  using state_type = std::conditional_t<mode == summation::kahan,
+                                        detail::compensated<Acc>,
+                                        Acc>;
+  using result_type = Acc;
+
+  state_type init() const noexcept { return {}; }
+
+  template<class T, class I>
+  void accumulate(state_type& s, const T& x, I) const noexcept
+  {
+    if constexpr (mode == summation::kahan)
+      detail::kahan_add(s, Acc(x));
+    else
+      s += Acc(x);
+  }
+
+  template<class T, class I>
+  void run(state_type& s, const T* p, I n, I stride, I, I) const noexcept
+  {
+    if constexpr (mode == summation::kahan)
+      detail::kahan_merge(s, detail::kahan_sum<Acc>(p, n, stride));
+    else if constexpr (mode == summation::pairwise)
+      s += detail::pairwise_sum<Acc>(p, n, stride);
+    else
+      s += detail::naive_sum<Acc>(p, n, stride);
+  }
+
+  void merge(state_type& s, const state_type& other) const noexcept
+  {
+    if constexpr (mode == summation::kahan)
+      detail::kahan_merge(s, other);
+    else
+      s += other;
+  }
+
+  result_type finish(const state_type& s, size_type) const noexcept
+  {
+    if constexpr (mode == summation::kahan)
+      return s.sum - s.error;
+    else
+      return s;
+  }
+};
+
+///@brief Arithmetic mean in Acc, NaN for an empty reduction of floating point
+/// elements
+template<class Acc, summation Mode = summation::naive>
+struct mean_reducer : sum_reducer<Acc, Mode>
+{
+  using typename sum_reducer<Acc, Mode>::state_type;
+  using result_type = Acc;
+
+  result_type finish(const state_type& s, size_type count) const noexcept
+  {
+    return sum_reducer<Acc, Mode>::finish(s, count) / Acc(count);
+  }
+};
+
+///@brief Smallest element, NaNs are skipped. An empty reduction gives
+/// +infinity (the largest value for integers).
+template<class T>
+struct min_reducer
+{
+  using state_type = T;
+  using result_type = T;
+
+  state_type init() const noexcept { return detail::highest_value<T>(); }
+
+  template<class I>
+  void accumulate(state_type& s, const T& x, I) const noexcept
+  {
+    s = x < s ? x : s;
+  }
+
+  template<class I>
+  void run(state_type& s, const T* p, I n, I stride, I, I) const noexcept
+  {
+    const auto keep = [](T& m, const T& x) { m = x < m ? x : m; };
+    keep(s, detail::lane_fold(init(), p, n, stride, keep, keep));
+  }
+
+  void merge(state_type& s, const state_type& other) const noexcept
+  {
+    s = other < s ? other : s;
+  }
+
+  result_type finish(const state_type& s, size_type) const noexcept
+  {
+    return s;
+  }
+};
+
+///@brief Largest element, NaNs are skipped. An empty reduction gives
+/// -infinity (the lowest value for integers).
+template<class T>
+struct max_reducer
+{
+  using state_type = T;
+  using result_type = T;
+
+  state_type init() const noexcept { return detail::lowest_value<T>(); }
+
+  template<class I>
+  void accumulate(state_type& s, const T& x, I) const noexcept
+  {
+    s = x > s ? x : s;
+  }
+
+  template<class I>
+  void run(state_type& s, const T* p, I n, I stride, I, I) const noexcept
+  {
+    const auto keep = [](T& m, const T& x) { m = x > m ? x : m; };
+    keep(s, detail::lane_fold(init(), p, n, stride, keep, keep));
+  }
+
+  void merge(state_type& s, const state_type& other) const noexcept
+  {
+    s = other > s ? other : s;
+  }
+
+  result_type finish(const state_type& s, size_type) const noexcept
+  {
+    return s;
+  }
+};
+
+///@brief Position of the first smallest (Less = std::less) or largest
+/// (Less = std::greater) element within the reduced axes. NaNs are skipped,
+/// an empty or all NaN reduction gives -1.
+template<class T, class I, class Less>
+struct arg_reducer
+{
+  struct state_type
+  {
+    T value;
+    I pos;
+  };
+  using result_type = I;
+
+  state_type init() const noexcept
+  {
+    return { std::is_same_v<Less, std::less<>> ? detail::highest_value<T>()
+                                               : detail::lowest_value<T>(),
+             I(-1) };
+  }
+
+  void accumulate(state_type& s, const T& x, I pos) const noexcept
+  {
+    if (Less{}(x, s.value) ||
+        (x == s.value && (s.pos < 0 || pos < s.pos)))
+      s = { x, pos };
+  }
+
+  void merge(state_type& s, const state_type& other) const noexcept
+  {
+    if (other.pos >= 0)
+      accumulate(s, other.value, other.pos);
+  }
+
+  result_type finish(const state_type& s, size_type) const noexcept
+  {
+    return s.pos;
+  }
+};
+
+template<class T, class I>
+using argmin_reducer = arg_reducer<T, I, std::less<>>;
+
+template<class T, class I>
+using argmax_reducer = arg_reducer<T, I, std::greater<>>;
+
+namespace detail {
+
+template<class R, class T, class I>
+using reducer_run_t = decltype(std::declval<const R&>().run(
+  std::declval<typename R::state_type&>(),
+  std::declval<const T*>(),
+  I{},
+  I{},
+  I{},
+  I{}));
+
+template<class R>
+using reducer_pairwise_t = decltype(R::is_pairwise);
+
+template<class R>
+constexpr bool
+reducer_is_pairwise() noexcept
+{
+  if constexpr (concepts::expr::is_detected_v<reducer_pairwise_t, R>)
+    return R::is_pairwise;
+  else
+    return false;
+}
+
+///@brief Folds n elements 'stride' apart, through the reducer's run() when
+/// it has one
+template<class R, class T, class I>
+void
+reduce_run(const R& r,
+           typename R::state_type& s,
+           const T* p,
+           I n,
+           I stride,
+           I pos,
+           I pos_step)
+{
+  if constexpr (concepts::expr::is_detected_v<reducer_run_t, R, T, I>) {
+    r.run(s, p, n, stride, pos, pos_step);
+  } else {
+    for (I i = 0; i < n; ++i)
+      r.accumulate(s, p[i * stride], pos + i * pos_step);
+  }
+}
+
+///@brief Merges the states of consecutive runs pairwise for a pairwise
+/// reducer, sequentially for any other. Like a binary counter a state is
+/// merged into the one before it once both cover as many runs.
+template<class R>
+class run_merger
+{
+public:
+  using state_type = typename R::state_type;
+
+  explicit run_merger(const R& r)
+    : r_{ r }
+  {}
+
+  void push(state_type s)
+  {
+    if constexpr (!reducer_is_pairwise<R>()) {
+      if (depth_ == 0)
+        stack_[depth_++] = s;
+      else
+        r_.merge(stack_[0], s);
+    } else {
+      std::size_t runs = 1;
+      while (depth_ > 0 && runs_[depth_ - 1] == runs) {
+        --depth_;
+        r_.merge(stack_[depth_], s);
+        s = stack_[depth_];
+        runs *= 2;
+      }
+      runs_[depth_] = runs;
+      stack_[depth_++] = s;
+    }
+  }
+
+  ///@brief The merged state, init() when no run was pushed
+  state_type result() const
+  {
+    if (depth_ == 0)
+      return r_.init();
+    state_type s = stack_[depth_ - 1];
+    for (std::size_t d = depth_ - 1; d-- > 0;) {
+      state_type earlier = stack_[d];
+      r_.merge(earlier, s);
+      s = earlier;
+    }
+    return s;
+  }
+
+private:
+  const R& r_;
+  std::array<state_type, 64> stack_{};
+  std::array<std::size_t, 64> runs_{};
+  std::size_t depth_ = 0;
+};
+
+///@brief The axes of a reduction as an array
+template<std::size_t... Axes>
+constexpr std::array<std::size_t, sizeof...(Axes)>
+axes_array(axis_list<Axes...>) noexcept
+{
+  return { Axes... };
+}
+
+template<class Int, REQUIRES(std::is_integral_v<Int>)>
+constexpr std::array<std::size_t, 1>
+axes_array(Int axis) noexcept
+{
+  return { std::size_t(axis) };
+}
+
+template<class Int, std::size_t K, REQUIRES(std::is_integral_v<Int>)>
+constexpr std::array<std::size_t, K>
+axes_array(const std::array<Int, K>& axes) noexcept
+{
+  std::array<std::size_t, K> result{};
+  for (std::size_t k = 0; k < K; ++k)
+    result[k] = std::size_t(axes[k]);
+  return result;
+}
+
+template<class Axes>
+inline constexpr std::size_t axes_count_v =
+  std::tuple_size_v<decltype(axes_array(std::declval<const Axes&>()))>;
+
+///@brief Every axis is below 'rank' and appears once
+template<std::size_t K>
+constexpr bool
+valid_axes(const std::array<std::size_t, K>& axes, std::size_t rank) noexcept
+{
+  for (std::size_t k = 0; k < K; ++k) {
+    if (axes[k] >= rank)
+      return false;
+    for (std::size_t l = 0; l < k; ++l)
+      if (axes[l] == axes[k])
+        return false;
+  }
+  return true;
+}
+
+template<class Axes, std::size_t N>
+constexpr bool
+static_axes_valid() noexcept
+{
+  if constexpr (std::is_empty_v<Axes>)
+    return valid_axes(axes_array(Axes{}), N);
+  else
+    return true;
+}
+
+///@brief Walks the indices of a subset of the axes of an array in row-major
+/// order, keeping the offset into the array and the position within the
+/// subset up to date
+template<class I, std::size_t N>
+struct axes_odometer
+{
+  std::size_t rank = 0;
+  std::array<std::size_t, N> axis{};
+  std::array<I, N> extent{};
+  std::array<I, N> stride{};
+  std::array<I, N> pos_stride{};
+  std::array<I, N> idx{};
+  I offset = 0;
+  I pos = 0;
+
+  void seek(I flat) noexcept
+  {
+    offset = 0;
+    pos = 0;
+    for (std::size_t i = rank; i-- > 0;) {
+      idx[i] = flat % extent[i];
+      flat /= extent[i];
+      offset += idx[i] * stride[i];
+      pos += idx[i] * pos_stride[i];
+    }
+  }
+
+  void next() noexcept
+  {
+    for (std::size_t i = rank; i-- > 0;) {
+      ++idx[i];
+      offset += stride[i];
+      pos += pos_stride[i];
+      if (idx[i] < extent[i])
+        return;
+      offset -= idx[i] * stride[i];
+      pos -= idx[i] * pos_stride[i];
+      idx[i] = 0;
+    }
+  }
+};
+
+template<class R, class T, class E, class L, class U, class F, class M>
+void
+reduce_indexwise(const ndspan<T, E, L>& src,
+                 const std::array<bool, E::rank()>& reduced,
+                 const ndspan<U, F, M>& dst,
+                 const R& r,
+                 size_type count)
+{
+  using I = typename E::index_type;
+  constexpr std::size_t N = E::rank();
+
+  // row-major positions of the outputs and within the reduced axes
+  std::array<I, N> out_stride{}, pos_stride{};
+  I out_size = 1, pos_size = 1;
+  for (std::size_t a = N; a-- > 0;) {
+    if (reduced[a]) {
+      pos_stride[a] = pos_size;
+      pos_size *= src.extent(a);
+    } else {
+      out_stride[a] = out_size;
+      out_size *= src.extent(a);
+    }
+  }
+
+  std::vector<typename R::state_type> states(std::size_t(out_size), r.init());
+  for_each_index(src.extents(), [&](const auto& idx) {
+    I out = 0, pos = 0;
+    for (std::size_t a = 0; a < N; ++a) {
+      out += idx[a] * out_stride[a];
+      pos += idx[a] * pos_stride[a];
+    }
+    r.accumulate(states[std::size_t(out)], src(idx), pos);
+  });
+
+  std::size_t out = 0;
+  for_each_index(dst.extents(), [&](const auto& idx) {
+    dst(idx) = r.finish(states[out++], count);
+  });
+}
+
+template<class R, class T, class E, class L, class U, class F, class M>
+void
+reduce_strided(const ndspan<T, E, L>& src,
+               const std::array<bool, E::rank()>& reduced,
+               const ndspan<U, F, M>& dst,
+               const R& r,
+               size_type count,
+               thread_pool& pool,
+               std::size_t grain)
+{
+  using I = typename E::index_type;
+  using state_type = typename R::state_type;
+  using dst_index = typename ndspan<U, F, M>::index_array;
+  constexpr std::size_t N = E::rank();
+  constexpr std::size_t out_rank = F::rank();
+
+  // the axis with the smallest stride, the one the loop runs along
+  std::size_t unit = N;
+  for (std::size_t a = 0; a < N; ++a)
+    if (src.extent(a) > 1 &&
+        (unit == N || std::abs(src.stride(a)) <= std::abs(src.stride(unit))))
+      unit = a;
+  if (unit == N) // a single element
+    unit = N - 1;
+
+  // kept axes in output order, reduced axes with their positions
+  axes_odometer<I, N> kept, rows;
+  std::array<I, N> pos_stride{};
+  std::array<std::size_t, N> out_axis{};
+  I pos_size = 1;
+  for (std::size_t a = N; a-- > 0;) {
+    if (reduced[a]) {
+      pos_stride[a] = pos_size;
+      pos_size *= src.extent(a);
+    }
+  }
+  // reduced axes continuing the run along a reduced unit axis join it, so
+  // that a contiguous block is folded as one run
+  I length = src.extent(unit);
+  std::array<bool, N> joined{};
+  for (bool merged = reduced[unit]; merged;) {
+    merged = false;
+    for (std::size_t a = 0; a < N; ++a) {
+      if (a == unit || !reduced[a] || joined[a] || src.extent(a) == 1 ||
+          src.stride(a) != src.stride(unit) * length ||
+          pos_stride[a] != pos_stride[unit] * length)
+        continue;
+      length *= src.extent(a);
+      joined[a] = true;
+      merged = true;
+    }
+  }
+  for (std::size_t a = 0, out = 0; a < N; ++a) {
+    auto& odo = reduced[a] ? rows : kept;
+    if (!reduced[a])
+      out_axis[a] = out++;
+    if (a == unit || joined[a])
+      continue;
+    odo.axis[odo.rank] = a;
+    odo.extent[odo.rank] = src.extent(a);
+    odo.stride[odo.rank] = src.stride(a);
+    odo.pos_stride[odo.rank] = pos_stride[a];
+    ++odo.rank;
+  }
+
+  const I unit_stride = src.stride(unit);
+  I outer = 1;
+  for (std::size_t k = 0; k < kept.rank; ++k)
+    outer *= kept.extent[k];
+
+  const auto write = [&](const axes_odometer<I, N>& at, I j, state_type& s) {
+    dst_index idx{};
+    for (std::size_t k = 0; k < at.rank; ++k)
+      idx[out_axis[at.axis[k]]] = at.idx[k];
+    if constexpr (out_rank > 0)
+      if (!reduced[unit])
+        idx[out_axis[unit]] = j;
+    dst(idx) = r.finish(s, count);
+  };
+
+  if (reduced[unit]) {
+    // every output folds runs along the unit axis, a long reduction is
+    // split in chunks whose partial states are merged in order afterwards
+    const I size = I(count);
+    const I chunks = std::max<I>(1, size / I(grain));
+    const I chunk = (size + chunks - 1) / chunks;
+    const I per_task =
+      chunks > 1 ? 1 : std::max<I>(1, I(grain) / std::max<I>(1, size));
+    const auto tasks =
+      std::size_t(chunks > 1 ? outer * chunks : (outer + per_task - 1) / per_task);
+    std::vector<state_type> partial(chunks > 1 ? std::size_t(outer * chunks) : 0);
+
+    pool.run(tasks, [&](std::size_t task) {
+      auto out = kept;
+      auto runs = rows;
+      const I first = chunks > 1 ? I(task) / chunks : I(task) * per_task;
+      const I last = chunks > 1 ? first + 1 : std::min(first + per_task, outer);
+      const I begin = chunks > 1 ? I(task) % chunks * chunk : 0;
+      const I end = chunks > 1 ? std::min(begin + chunk, size) : size;
+
+      out.seek(first);
+      for (I o = first; o < last; ++o, out.next()) {
+        run_merger<R> merger(r);
+        I at = begin;
+        I j = at % length;
+        runs.seek(at / length);
+        while (at < end) {
+          const I n = std::min(length - j, end - at);
+          state_type run = r.init();
+          reduce_run(r,
+                     run,
+                     src.data() + out.offset + runs.offset + j * unit_stride,
+                     n,
+                     unit_stride,
+                     runs.pos + j * pos_stride[unit],
+                     pos_stride[unit]);
+          merger.push(run);
+          at += n;
+          j = 0;
+          runs.next();
+        }
+        state_type s = merger.result();
+        if (chunks > 1)
+          partial[std::size_t(task)] = s;
+        else
+          write(out, 0, s);
+      }
+    });
+
+    if (chunks > 1) {
+      auto out = kept;
+      out.seek(0);
+      for (I o = 0; o < outer; ++o, out.next()) {
+        run_merger<R> merger(r);
+        for (I c = 0; c < chunks; ++c)
+          merger.push(partial[std::size_t(o * chunks + c)]);
+        state_type s = merger.result();
+        write(out, 0, s);
+      }
+    }
+    return;
+  }
+
+  // the unit axis is kept: every reduced row is added to a block of
+  // consecutive outputs, reading the input along the unit axis
+  const I width = std::min<I>(length, I(reduce_column_block));
+  const I blocks = (length + width - 1) / width;
+  const I size = I(count);
+  const I per_task = std::max<I>(1, I(grain) / std::max<I>(1, size * width));
+  const I pairs = outer * blocks;
+  const auto tasks = std::size_t((pairs + per_task - 1) / per_task);
+
+  pool.run(tasks, [&](std::size_t task) {
+    auto out = kept;
+    auto at = rows;
+    std::vector<state_type> states(static_cast<std::size_t>(width));
+    std::vector<std::vector<state_type>> levels;
+
+    // adds rows [first, first + n) to s[0, w)
+    const auto add_rows = [&](auto& self,
+                              state_type* s,
+                              const T* base,
+                              I w,
+                              I first,
+                              I n,
+                              std::size_t depth) -> void {
+      if constexpr (reducer_is_pairwise<R>()) {
+        if (std::size_t(n) > pairwise_rows) {
+          const I half = n / 2;
+          self(self, s, base, w, first, half, depth + 1);
+          if (levels.size() <= depth)
+            levels.resize(depth + 1);
+          levels[depth].resize(std::size_t(width));
+          state_type* t = levels[depth].data();
+          std::fill_n(t, w, r.init());
+          self(self, t, base, w, first + half, n - half, depth + 1);
+          for (I j = 0; j < w; ++j)
+            r.merge(s[j], t[j]);
+          return;
+        }
+      }
+      at.seek(first);
+      for (I row = 0; row < n; ++row, at.next()) {
+        const T* p = base + at.offset;
+        if (unit_stride == 1) {
+          for (I j = 0; j < w; ++j)
+            r.accumulate(s[j], p[j], at.pos);
+        } else {
+          for (I j = 0; j < w; ++j)
+            r.accumulate(s[j], p[j * unit_stride], at.pos);
+        }
+      }
+    };
+
+    const I first = I(task) * per_task;
+    const I last = std::min(first + per_task, pairs);
+    for (I pair = first; pair < last; ++pair) {
+      out.seek(pair / blocks);
+      const I j0 = pair % blocks * width;
+      const I w = std::min(width, length - j0);
+      std::fill_n(states.data(), w, r.init());
+      add_rows(add_rows,
+               states.data(),
+               src.data() + out.offset + j0 * unit_stride,
+               w,
+               I(0),
+               size,
+               0);
+      for (I j = 0; j < w; ++j)
+        write(out, j0 + j, states[std::size_t(j)]);
+    }
+  });
+}
+
+template<class T, class E, class L, class A>
+ndspan<const T, E, L>
+reduce_source(const ndarray<T, E, L, A>& src) noexcept
+{
+  return src.view();
+}
+
+template<class T, class E, class L>
+const ndspan<T, E, L>&
+reduce_source(const ndspan<T, E, L>& src) noexcept
+{
+  return src;
+}
+
+template<class Src>
+inline constexpr bool is_reduce_source_v =
+  is_ndarray<Src>::value || is_ndspan<Src>::value;
+
+template<class Src>
+using reduce_source_t = remove_cvref_t<decltype(reduce_source(
+  std::declval<const Src&>()))>;
+
+template<class Src, class Axes>
+using reduced_extents_t =
+  dextents<typename reduce_source_t<Src>::index_type,
+           reduce_source_t<Src>::rank() - axes_count_v<Axes>>;
+
+///@brief The extents of 'ext' without the axes of 'axes'
+template<class Extents, std::size_t K>
+dextents<typename Extents::index_type, Extents::rank() - K>
+reduced_extents(const Extents& ext, const std::array<std::size_t, K>& axes)
+{
+  std::array<typename Extents::index_type, Extents::rank() - K> dims{};
+  for (std::size_t a = 0, out = 0; a < Extents::rank(); ++a)
+    if (std::find(axes.begin(), axes.end(), a) == axes.end())
+      dims[out++] = ext.extent(a);
+  return dextents<typename Extents::index_type, Extents::rank() - K>(dims);
+}
+
+} // namespace detail
+
+///@brief Reduces 'src' (an ndarray or ndspan) along 'axes' into 'dst', whose
+/// extents are those of 'src' without the reduced axes in their order.
+///
+/// The loop follows the layout of 'src'. When the axis with the smallest
+/// stride is reduced, every output folds contiguous runs along it (a
+/// vectorized loop for the built-in reducers), reduced axes that continue
+/// those runs in memory joining them, and a pairwise reducer combines the
+/// runs pairwise too; when it is kept, the reduced rows are accumulated
+/// column-wise into a block of consecutive outputs.
+/// Layouts without strides (tiled, space-filling curves) are reduced index by
+/// index on the calling thread.
+///
+/// The outputs, and long reductions in chunks of 'grain' elements, are shared
+/// among the threads of 'pool'. The chunks depend on the sizes only, so the
+/// result does not depend on the number of threads.
+///
+///@param axes axis_list, a single axis or a std::array of distinct axes
+///@param reducer see sum_reducer for the interface
+template<class Src,
+         class Axes,
+         class U,
+         class F,
+         class M,
+         class Reducer,
+         REQUIRES(detail::is_reduce_source_v<Src>)>
+void
+reduce(const Src& source,
+       const Axes& axes,
+       const ndspan<U, F, M>& dst,
+       const Reducer& reducer,
+       thread_pool& pool = default_thread_pool(),
+       std::size_t grain = default_reduce_grain)
+{
+  const auto& src = detail::reduce_source(source);
+  using source_type = detail::reduce_source_t<Src>;
+  using mapping_type = typename source_type::mapping_type;
+  constexpr std::size_t N = source_type::rank();
+  constexpr std::size_t K = detail::axes_count_v<Axes>;
+  static_assert(K <= N, "Cannot reduce more axes than the rank");
+  static_assert(F::rank() == N - K,
+                "The destination has the rank of the source without the "
+                "reduced axes");
+  static_assert(detail::static_axes_valid<Axes, N>(),
+                "The axes must be distinct and below the rank");
+
+  const auto list = detail::axes_array(axes);
+  EXPECTS(detail::valid_axes(list, N));
+  EXPECTS(dst.extents() == detail::reduced_extents(src.extents(), list));
+
+  std::array<bool, N> reduced{};
+  size_type count = 1;
+  for (auto a : list) {
+    reduced[a] = true;
+    count *= size_type(src.extent(a));
+  }
+
+  if (dst.empty())
+    return;
+  if (count == 0) {
+    detail::for_each_index(dst.extents(), [&](const auto& idx) {
+      dst(idx) = reducer.finish(reducer.init(), 0);
+    });
+    return;
+  }
+
+  if constexpr (N > 0 && mapping_type::is_always_strided())
+    detail::reduce_strided(src, reduced, dst, reducer, count, pool, grain);
+  else
+    detail::reduce_indexwise(src, reduced, dst, reducer, count);
+}
+
+///@brief Reduces 'src' along 'axes' into a new array of the reduced rank
+/// (layout_right, dynamic extents)
+template<class Result,
+         class Src,
+         class Axes,
+         class Reducer,
+         REQUIRES(detail::is_reduce_source_v<Src>)>
+ndarray<Result, detail::reduced_extents_t<Src, Axes>>
+reduce(const Src& source,
+       const Axes& axes,
+       const Reducer& reducer,
+       thread_pool& pool = default_thread_pool())
+{
+  const auto& src = detail::reduce_source(source);
+  ndarray<Result, detail::reduced_extents_t<Src, Axes>> result(
+    detail::reduced_extents(src.extents(), detail::axes_array(axes)));
+  reduce(src, axes, result.view(), reducer, pool);
+  return result;
+}
+
+namespace detail {
+
+template<class Reducer, class Src, class Axes>
+auto
+reduce_to_array(const Src& src,
+                const Axes& axes,
+                const Reducer& reducer,
+                thread_pool& pool)
+{
+  return reduce<typename Reducer::result_type>(src, axes, reducer, pool);
+}
+
+template<template<class, summation> class Reducer,
+         class Acc,
+         class Src,
+         class Axes>
+auto
+reduce_summation(const Src& src,
+                 const Axes& axes,
+                 summation mode,
+                 thread_pool& pool)
+{
+  switch (mode) {
+    case summation::pairwise:
+      return reduce_to_array(
+        src, axes, Reducer<Acc, summation::pairwise>{}, pool);
+    case summation::kahan:
+      return reduce_to_array(src, axes, Reducer<Acc, summation::kahan>{}, pool);
+    default:
+      return reduce_to_array(src, axes, Reducer<Acc, summation::naive>{}, pool);
+  }
+}
+
+template<class Acc, class Default>
+using accumulator_t =
+  std::conditional_t<std::is_void_v<Acc>, Default, Acc>;
+
+template<class Src>
+using reduce_value_t = typename reduce_source_t<Src>::value_type;
+
+template<class Src>
+using reduce_index_t = typename reduce_source_t<Src>::index_type;
+
+} // namespace detail
+
+///@brief Sum along 'axes', in sum_type_t of the elements unless Acc is given
+template<class Acc = void,
+         class Src,
+         class Axes,
+         REQUIRES(detail::is_reduce_source_v<Src>)>
+auto
+sum(const Src& src,
+    const Axes& axes,
+    summation mode = summation::naive,
+    thread_pool& pool = default_thread_pool())
+{
+  using acc_type =
+    detail::accumulator_t<Acc, sum_type_t<detail::reduce_value_t<Src>>>;
+  return detail::reduce_summation<sum_reducer, acc_type>(src, axes, mode, pool);
+}
+
+///@brief Mean along 'axes', in mean_type_t of the elements unless Acc is
+/// given
+template<class Acc = void,
+         class Src,
+         class Axes,
+         REQUIRES(detail::is_reduce_source_v<Src>)>
+auto
+mean(const Src& src,
+     const Axes& axes,
+     summation mode = summation::naive,
+     thread_pool& pool = default_thread_pool())
+{
+  using acc_type =
+    detail::accumulator_t<Acc, mean_type_t<detail::reduce_value_t<Src>>>;
+  return detail::reduce_summation<mean_reducer, acc_type>(
+    src, axes, mode, pool);
+}
+
+///@brief Smallest element along 'axes'
+template<class Src, class Axes, REQUIRES(detail::is_reduce_source_v<Src>)>
+auto
+amin(const Src& src,
+     const Axes& axes,
+     thread_pool& pool = default_thread_pool())
+{
+  return detail::reduce_to_array(
+    src, axes, min_reducer<detail::reduce_value_t<Src>>{}, pool);
+}
+
+///@brief Largest element along 'axes'
+template<class Src, class Axes, REQUIRES(detail::is_reduce_source_v<Src>)>
+auto
+amax(const Src& src,
+     const Axes& axes,
+     thread_pool& pool = default_thread_pool())
+{
+  return detail::reduce_to_array(
+    src, axes, max_reducer<detail::reduce_value_t<Src>>{}, pool);
+}
+
+///@brief Position of the first smallest element along 'axes', a row-major
+/// flat index within the reduced axes (the index along the axis for a single
+/// one)
+template<class Src, class Axes, REQUIRES(detail::is_reduce_source_v<Src>)>
+auto
+argmin(const Src& src,
+       const Axes& axes,
+       thread_pool& pool = default_thread_pool())
+{
+  return detail::reduce_to_array(
+    src,
+    axes,
+    argmin_reducer<detail::reduce_value_t<Src>, detail::reduce_index_t<Src>>{},
+    pool);
+}
+
+///@brief Position of the first largest element along 'axes', see argmin()
+template<class Src, class Axes, REQUIRES(detail::is_reduce_source_v<Src>)>
+auto
+argmax(const Src& src,
+       const Axes& axes,
+       thread_pool& pool = default_thread_pool())
+{
+  return detail::reduce_to_array(
+    src,
+    axes,
+    argmax_reducer<detail::reduce_value_t<Src>, detail::reduce_index_t<Src>>{},
+    pool);
+}
+
+} // namespace nanda
+
+#endif // NANDA_REDUCTION_HEADER
@@ -0,0 +1,1915 @@
+#ifndef NANDA_SIMD_HEADER
+#define NANDA_SIMD_HEADER
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "concepts.hh"
+#include "extents.hh"
+#include "memory.hh"
+#include "span.hh"
+#include "utility.hh"
+
+#if (defined(__x86_64__) || defined(__i386__)) &&                             \
+  (defined(__GNUC__) || defined(__clang__))
+#define NANDA_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define NANDA_SIMD_INLINE __attribute__((always_inline)) inline
+#else
+#define NANDA_SIMD_INLINE inline
+#endif
+
+#ifdef NANDA_SIMD_X86
+#define NANDA_TARGET_SSE2 __attribute__((target("sse2")))
+#define NANDA_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define NANDA_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#endif
+
+// the generic loops pass vectors between functions of different targets, they
+// are always inlined into a function of the right target. GCC also flags the
+// deliberately undefined registers of its own AVX-512 intrinsics.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+namespace nanda {
+
+///@brief Instruction sets of the SIMD kernels, by increasing vector width
+enum class simd_isa
+{
+  scalar,
+  sse2,
+  avx2,
+  avx512
+};
+
+///@brief Comparisons of simd::select
+enum class simd_cmp
+{
+  lt,
+  le,
+  gt,
+  ge,
+  eq,
+  ne
+};
+
+constexpr const char*
+simd_isa_name(simd_isa isa) noexcept
+{
+  switch (isa) {
+    case simd_isa::sse2:
+      return "sse2";
+    case simd_isa::avx2:
+      return "avx2";
+    case simd_isa::avx512:
+      return "avx512";
+    default:
+      return "scalar";
+  }
+}
+
+///@brief Whether the CPU (and the OS) support the kernels of 'isa'. AVX2
+/// kernels use FMA as well, the AVX-512 ones only need AVX-512F.
+inline bool
+simd_isa_supported(simd_isa isa) noexcept
+{
+#ifdef NANDA_SIMD_X86
+  switch (isa) {
+    case simd_isa::sse2:
+      return __builtin_cpu_supports("sse2");
+    case simd_isa::avx2:
+      return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case simd_isa::avx512:
+      return __builtin_cpu_supports("avx512f") &&
+             simd_isa_supported(simd_isa::avx2);
+    default:
+      return true;
+  }
+#else
+  return isa == simd_isa::scalar;
+#endif
+}
+
+///@brief The widest supported instruction set, from CPUID
+inline simd_isa
+detect_simd_isa() noexcept
+{
+  for (auto isa : { simd_isa::avx512, simd_isa::avx2, simd_isa::sse2 })
+    if (simd_isa_supported(isa))
+      return isa;
+  return simd_isa::scalar;
+}
+
+namespace detail {
+
+inline std::atomic<simd_isa>&
+simd_isa_state() noexcept
+{
+  static std::atomic<simd_isa> isa{ detect_simd_isa() };
+  return isa;
+}
+
+} // namespace detail
+
+///@brief The instruction set the kernels dispatch to by default, detected
+/// once on first use
+inline simd_isa
+active_simd_isa() noexcept
+{
+  return detail::simd_isa_state().load(std::memory_order_relaxed);
+}
+
+///@brief Makes the kernels dispatch to 'isa', or to the widest supported one
+/// below it (tests, benchmarks). Returns the instruction set now active.
+inline simd_isa
+set_simd_isa(simd_isa isa) noexcept
+{
+  while (!simd_isa_supported(isa))
+    isa = simd_isa(int(isa) - 1);
+  detail::simd_isa_state().store(isa, std::memory_order_relaxed);
+  return isa;
+}
+
+namespace detail {
+
+enum class simd_op
+{
+  add,
+  sub,
+  mul,
+  min,
+  max
+};
+
+// the scalar reference of every kernel, also used for the heads and tails of
+// the vector loops. Integers wrap like the vector instructions, min and max
+// return the second operand on unordered comparisons like minps and maxps.
+
+template<simd_op Op, class T>
+constexpr T
+scalar_binary(T a, T b) noexcept
+{
+  if constexpr (Op == simd_op::min) {
+    return a < b ? a : b;
+  } else if constexpr (Op == simd_op::max) {
+    return a > b ? a : b;
+  } else if constexpr (std::is_integral_v<T>) {
+    using U = std::make_unsigned_t<T>;
+    if constexpr (Op == simd_op::add)
+      return T(U(a) + U(b));
+    else if constexpr (Op == simd_op::sub)
+      return T(U(a) - U(b));
+    else
+      return T(U(a) * U(b));
+  } else {
+    if constexpr (Op == simd_op::add)
+      return a + b;
+    else if constexpr (Op == simd_op::sub)
+      return a - b;
+    else
+      return a * b;
+  }
+}
+
+template<class T>
+T
+scalar_abs(T a) noexcept
+{
+  if constexpr (std::is_integral_v<T>)
+    return a < 0 ? T(std::make_unsigned_t<T>(0) - std::make_unsigned_t<T>(a))
+                 : a;
+  else
+    return std::fabs(a);
+}
+
+template<simd_cmp C, class T>
+constexpr bool
+scalar_compare(T a, T b) noexcept
+{
+  if constexpr (C == simd_cmp::lt)
+    return a < b;
+  else if constexpr (C == simd_cmp::le)
+    return a <= b;
+  else if constexpr (C == simd_cmp::gt)
+    return a > b;
+  else if constexpr (C == simd_cmp::ge)
+    return a >= b;
+  else if constexpr (C == simd_cmp::eq)
+    return a == b;
+  else
+    return a != b;
+}
+
+///@brief Vector type and operations of T for an instruction set. The primary
+/// template is one lane wide, it serves the scalar kernels and the element
+/// types an instruction set has no specialization for.
+template<simd_isa Isa, class T>
+struct simd_vec
+{
+  using type = T;
+  using mask = bool;
+  static constexpr std::size_t width = 1;
+
+  static type load(const T* p) noexcept { return *p; }
+  static type broadcast(T x) noexcept { return x; }
+  static void store(T* p, type v) noexcept { *p = v; }
+  template<simd_op Op>
+  static type binary(type a, type b) noexcept
+  {
+    return scalar_binary<Op>(a, b);
+  }
+  static type abs(type a) noexcept { return scalar_abs(a); }
+  static type fma(type a, type b, type c) noexcept { return a * b + c; }
+  template<simd_cmp C>
+  static mask compare(type a, type b) noexcept
+  {
+    return scalar_compare<C>(a, b);
+  }
+  static type blend(mask m, type x, type y) noexcept { return m ? x : y; }
+
+  // integer lanes only: unaligned store, store of the low byte of every lane,
+  // high half of the unsigned product and logical right shift
+  static void storeu(T* p, type v) noexcept { *p = v; }
+  static void store_bytes(std::uint8_t* p, type v) noexcept
+  {
+    *p = std::uint8_t(v);
+  }
+  static type mulhi_u32(type a, type b) noexcept
+  {
+    return type((std::uint64_t(std::uint32_t(a)) * std::uint32_t(b)) >> 32);
+  }
+  static type shift_right(type a, int s) noexcept
+  {
+    return type(std::make_unsigned_t<T>(a) >> s);
+  }
+};
+
+///@brief Converts 'width' elements From -> To for an instruction set, the
+/// primary template one at a time
+template<simd_isa Isa, class From, class To>
+struct simd_convert
+{
+  static constexpr std::size_t width = 1;
+
+  static void apply(const From* in, To* out) noexcept { *out = To(*in); }
+};
+
+#ifdef NANDA_SIMD_X86
+
+// SSE2, part of every x86-64 CPU
+
+template<>
+struct simd_vec<simd_isa::sse2, float>
+{
+  using type = __m128;
+  using mask = __m128;
+  static constexpr std::size_t width = 4;
+
+  NANDA_TARGET_SSE2 static type load(const float* p) noexcept
+  {
+    return _mm_loadu_ps(p);
+  }
+  NANDA_TARGET_SSE2 static type broadcast(float x) noexcept
+  {
+    return _mm_set1_ps(x);
+  }
+  NANDA_TARGET_SSE2 static void store(float* p, type v) noexcept
+  {
+    _mm_store_ps(p, v);
+  }
+  template<simd_op Op>
+  NANDA_TARGET_SSE2 static type binary(type a, type b) noexcept
+  {
+    if constexpr (Op == simd_op::add)
+      return _mm_add_ps(a, b);
+    else if constexpr (Op == simd_op::sub)
+      return _mm_sub_ps(a, b);
+    else if constexpr (Op == simd_op::mul)
+      return _mm_mul_ps(a, b);
+    else if constexpr (Op == simd_op::min)
+      return _mm_min_ps(a, b);
+    else
+      return _mm_max_ps(a, b);
+  }
+  NANDA_TARGET_SSE2 static type abs(type a) noexcept
+  {
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+  }
+  // no fused multiply-add before AVX2
+  NANDA_TARGET_SSE2 static type fma(type a, type b, type c) noexcept
+  {
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+  }
+  template<simd_cmp C>
+  NANDA_TARGET_SSE2 static mask compare(type a, type b) noexcept
+  {
+    if constexpr (C == simd_cmp::lt)
+      return _mm_cmplt_ps(a, b);
+    else if constexpr (C == simd_cmp::le)
+      return _mm_cmple_ps(a, b);
+    else if constexpr (C == simd_cmp::gt)
+      return _mm_cmpgt_ps(a, b);
+    else if constexpr (C == simd_cmp::ge)
+      return _mm_cmpge_ps(a, b);
+    else if constexpr (C == simd_cmp::eq)
+      return _mm_cmpeq_ps(a, b);
+    else
+      return _mm_cmpneq_ps(a, b);
+  }
+  NANDA_TARGET_SSE2 static type blend(mask m, type x, type y) noexcept
+  {
+    return _mm_or_ps(_mm_and_ps(m, x), _mm_andnot_ps(m, y));
+  }
+};
+
+template<>
+struct simd_vec<simd_isa::sse2, double>
+{
+  using type = __m128d;
+  using mask = __m128d;
+  static constexpr std::size_t width = 2;
+
+  NANDA_TARGET_SSE2 static type load(const double* p) noexcept
+  {
+    return _mm_loadu_pd(p);
+  }
+  NANDA_TARGET_SSE2 static type broadcast(double x) noexcept
+  {
+    return _mm_set1_pd(x);
+  }
+  NANDA_TARGET_SSE2 static void store(double* p, type v) noexcept
+  {
+    _mm_store_pd(p, v);
+  }
+  template<simd_op Op>
+  NANDA_TARGET_SSE2 static type binary(type a, type b) noexcept
+  {
+    if constexpr (Op == simd_op::add)
+      return _mm_add_pd(a, b);
+    else if constexpr (Op == simd_op::sub)
+      return _mm_sub_pd(a, b);
+    else if constexpr (Op == simd_op::mul)
+      return _mm_mul_pd(a, b);
+    else if constexpr (Op == simd_op::min)
+      return _mm_min_pd(a, b);
+    else
+      return _mm_max_pd(a, b);
+  }
+  NANDA_TARGET_SSE2 static type abs(type a) noexcept
+  {
+    return _mm_andnot_pd(_mm_set1_pd(-0.0), a);
+  }
+  NANDA_TARGET_SSE2 static type fma(type a, type b, type c) noexcept
+  {
+    return _mm_add_pd(_mm_mul_pd(a, b), c);
+  }
+  template<simd_cmp C>
+  NANDA_TARGET_SSE2 static mask compare(type a, type b) noexcept
+  {
+    if constexpr (C == simd_cmp::lt)
+      return _mm_cmplt_pd(a, b);
+    else if constexpr (C == simd_cmp::le)
+      return _mm_cmple_pd(a, b);
+    else if constexpr (C == simd_cmp::gt)
+      return _mm_cmpgt_pd(a, b);
+    else if constexpr (C == simd_cmp::ge)
+      return _mm_cmpge_pd(a, b);
+    else if constexpr (C == simd_cmp::eq)
+      return _mm_cmpeq_pd(a, b);
+    else
+      return _mm_cmpneq_pd(a, b);
+  }
+  NANDA_TARGET_SSE2 static type blend(mask m, type x, type y) noexcept
+  {
+    return _mm_or_pd(_mm_and_pd(m, x), _mm_andnot_pd(m, y));
+  }
+};
+
+template<>
+struct simd_vec<simd_isa::sse2, std::int32_t>
+{
+  using type = __m128i;
+  using mask = __m128i;
+  static constexpr std::size_t width = 4;
+
+  NANDA_TARGET_SSE2 static type load(const std::int32_t* p) noexcept
+  {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  }
+  NANDA_TARGET_SSE2 static type broadcast(std::int32_t x) noexcept
+  {
+    return _mm_set1_epi32(x);
+  }
+  NANDA_TARGET_SSE2 static void store(std::int32_t* p, type v) noexcept
+  {
+    _mm_store_si128(reinterpret_cast<__m128i*>(p), v);
+  }
+  template<simd_op Op>
+  NANDA_TARGET_SSE2 static type binary(type a, type b) noexcept
+  {
+    if constexpr (Op == simd_op::add) {
+      return _mm_add_epi32(a, b);
+    } else if constexpr (Op == simd_op::sub) {
+      return _mm_sub_epi32(a, b);
+    } else if constexpr (Op == simd_op::mul) {
+      // pmulld is SSE4.1, multiply the even and the odd lanes separately
+      const __m128i even = _mm_mul_epu32(a, b);
+      const __m128i odd =
+        _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+      return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    } else if constexpr (Op == simd_op::min) {
+      return blend(_mm_cmplt_epi32(a, b), a, b);
+    } else {
+      return blend(_mm_cmpgt_epi32(a, b), a, b);
+    }
+  }
+  NANDA_TARGET_SSE2 static type abs(type a) noexcept
+  {
+    const __m128i sign = _mm_srai_epi32(a, 31);
+    return _mm_sub_epi32(_mm_xor_si128(a, sign), sign);
+  }
+  template<simd_cmp C>
+  NANDA_TARGET_SSE2 static mask compare(type a, type b) noexcept
+  {
+    const __m128i ones = _mm_set1_epi32(-1);
+    if constexpr (C == simd_cmp::lt)
+      return _mm_cmplt_epi32(a, b);
+    else if constexpr (C == simd_cmp::le)
+      return _mm_xor_si128(_mm_cmpgt_epi32(a, b), ones);
+    else if constexpr (C == simd_cmp::gt)
+      return _mm_cmpgt_epi32(a, b);
+    else if constexpr (C == simd_cmp::ge)
+      return _mm_xor_si128(_mm_cmplt_epi32(a, b), ones);
+    else if constexpr (C == simd_cmp::eq)
+      return _mm_cmpeq_epi32(a, b);
+    else
+      return _mm_xor_si128(_mm_cmpeq_epi32(a, b), ones);
+  }
+  NANDA_TARGET_SSE2 static type blend(mask m, type x, type y) noexcept
+  {
+    return _mm_or_si128(_mm_and_si128(m, x), _mm_andnot_si128(m, y));
+  }
+  NANDA_TARGET_SSE2 static void storeu(std::int32_t* p, type v) noexcept
+  {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+  }
+  NANDA_TARGET_SSE2 static void store_bytes(std::uint8_t* p, type v) noexcept
+  {
+    const __m128i words = _mm_packs_epi32(v, v);
+    const std::int32_t bytes =
+      _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+    std::memcpy(p, &bytes, 4);
+  }
+  NANDA_TARGET_SSE2 static type mulhi_u32(type a, type b) noexcept
+  {
+    // the high halves of the even products, then of the odd ones in place
+    const __m128i even = _mm_srli_epi64(_mm_mul_epu32(a, b), 32);
+    const __m128i odd =
+      _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_or_si128(even,
+                        _mm_and_si128(odd, _mm_set_epi32(-1, 0, -1, 0)));
+  }
+  NANDA_TARGET_SSE2 static type shift_right(type a, int s) noexcept
+  {
+    return _mm_srl_epi32(a, _mm_cvtsi32_si128(s));
+  }
+};
+
+template<>
+struct simd_convert<simd_isa::sse2, float, std::int32_t>
+{
+  static constexpr std::size_t width = 4;
+
+  NANDA_TARGET_SSE2 static void apply(const float* in,
+                                      std::int32_t* out) noexcept
+  {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                     _mm_cvttps_epi32(_mm_loadu_ps(in)));
+  }
+};
+
+template<>
+struct simd_convert<simd_isa::sse2, std::int32_t, float>
+{
+  static constexpr std::size_t width = 4;
+
+  NANDA_TARGET_SSE2 static void apply(const std::int32_t* in,
+                                      float* out) noexcept
+  {
+    _mm_storeu_ps(out,
+                  _mm_cvtepi32_ps(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(in))));
+  }
+};
+
+template<>
+struct simd_convert<simd_isa::sse2, float, double>
+{
+  static constexpr std::size_t width = 2;
+
+  NANDA_TARGET_SSE2 static void apply(const float* in, double* out) noexcept
+  {
+    const __m128i two = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in));
+    _mm_storeu_pd(out, _mm_cvtps_pd(_mm_castsi128_ps(two)));
+  }
+};
+
+template<>
+struct simd_convert<simd_isa::sse2, double, float>
+{
+  static constexpr std::size_t width = 2;
+
+  NANDA_TARGET_SSE2 static void apply(const double* in, float* out) noexcept
+  {
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out),
+                     _mm_castps_si128(_mm_cvtpd_ps(_mm_loadu_pd(in))));
+  }
+};
+
+// AVX2 with FMA
+
+template<>
+struct simd_vec<simd_isa::avx2, float>
+{
+  using type = __m256;
+  using mask = __m256;
+  static constexpr std::size_t width = 8;
+
+  NANDA_TARGET_AVX2 static type load(const float* p) noexcept
+  {
+    return _mm256_loadu_ps(p);
+  }
+  NANDA_TARGET_AVX2 static type broadcast(float x) noexcept
+  {
+    return _mm256_set1_ps(x);
+  }
+  NANDA_TARGET_AVX2 static void store(float* p, type v) noexcept
+  {
+    _mm256_store_ps(p, v);
+  }
+  template<simd_op Op>
+  NANDA_TARGET_AVX2 static type binary(type a, type b) noexcept
+  {
+    if constexpr (Op == simd_op::add)
+      return _mm256_add_ps(a, b);
+    else if constexpr (Op == simd_op::sub)
+      return _mm256_sub_ps(a, b);
+    else if constexpr (Op == simd_op::mul)
+      return _mm256_mul_ps(a, b);
+    else if constexpr (Op == simd_op::min)
+      return _mm256_min_ps(a, b);
+    else
+      return _mm256_max_ps(a, b);
+  }
+  NANDA_TARGET_AVX2 static type abs(type a) noexcept
+  {
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a);
+  }
+  NANDA_TARGET_AVX2 static type fma(type a, type b, type c) noexcept
+  {
+    return _mm256_fmadd_ps(a, b, c);
+  }
+  template<simd_cmp C>
+  NANDA_TARGET_AVX2 static mask compare(type a, type b) noexcept
+  {
+    if constexpr (C == simd_cmp::lt)
+      return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+    else if constexpr (C == simd_cmp::le)
+      return _mm256_cmp_ps(a, b, _CMP_LE_OQ);
+    else if constexpr (C == simd_cmp::gt)
+      return _mm256_cmp_ps(a, b, _CMP_GT_OQ);
+    else if constexpr (C == simd_cmp::ge)
+      return _mm256_cmp_ps(a, b, _CMP_GE_OQ);
+    else if constexpr (C == simd_cmp::eq)
+      return _mm256_cmp_ps(a, b, _CMP_EQ_OQ);
+    else
+      return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ);
+  }
+  NANDA_TARGET_AVX2 static type blend(mask m, type x, type y) noexcept
+  {
+    return _mm256_blendv_ps(y, x, m);
+  }
+};
+
+template<>
+struct simd_vec<simd_isa::avx2, double>
+{
+  using type = __m256d;
+  using mask = __m256d;
+  static constexpr std::size_t width = 4;
+
+  NANDA_TARGET_AVX2 static type load(const double* p) noexcept
+  {
+    return _mm256_loadu_pd(p);
+  }
+  NANDA_TARGET_AVX2 static type broadcast(double x) noexcept
+  {
+    return _mm256_set1_pd(x);
+  }
+  NANDA_TARGET_AVX2 static void store(double* p, type v) noexcept
+  {
+    _mm256_store_pd(p, v);
+  }
+  template<simd_op Op>
+  NANDA_TARGET_AVX2 static type binary(type a, type b) noexcept
+  {
+    if constexpr (Op == simd_op::add)
+      return _mm256_add_pd(a, b);
+    else if constexpr (Op == simd_op::sub)
+      return _mm256_sub_pd(a, b);
+    else if constexpr (Op == simd_op::mul)
+      return _mm256_mul_pd(a, b);
+    else if constexpr (Op == simd_op::min)
+      return _mm256_min_pd(a, b);
+    else
+      return _mm256_max_pd(a, b);
+  }
+  NANDA_TARGET_AVX2 static type abs(type a) noexcept
+  {
+    return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a);
+  }
+  NANDA_TARGET_AVX2 static type fma(type a, type b, type c) noexcept
+  {
+    return _mm256_fmadd_pd(a, b, c);
+  }
+  template<simd_cmp C>
+  NANDA_TARGET_AVX2 static mask compare(type a, type b) noexcept
+  {
+    if constexpr (C == simd_cmp::lt)
+      return _mm256_cmp_pd(a, b, _CMP_LT_OQ);
+    else if constexpr (C == simd_cmp::le)
+      return _mm256_cmp_pd(a, b, _CMP_LE_OQ);
+    else if constexpr (C == simd_cmp::gt)
+      return _mm256_cmp_pd(a, b, _CMP_GT_OQ);
+    else if constexpr (C == simd_cmp::ge)
+      return _mm256_cmp_pd(a, b, _CMP_GE_OQ);
+    else if constexpr (C == simd_cmp::eq)
+      return _mm256_cmp_pd(a, b, _CMP_EQ_OQ);
+    else
+      return _mm256_cmp_pd(a, b, _CMP_NEQ_UQ);
+  }
+  NANDA_TARGET_AVX2 static type blend(mask m, type x, type y) noexcept
+  {
+    return _mm256_blendv_pd(y, x, m);
+  }
+};
+
+template<>
+struct simd_vec<simd_isa::avx2, std::int32_t>
+{
+  using type = __m256i;
+  using mask = __m256i;
+  static constexpr std::size_t width = 8;
+
+  NANDA_TARGET_AVX2 static type load(const std::int32_t* p) noexcept
+  {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+  }
+  NANDA_TARGET_AVX2 static type broadcast(std::int32_t x) noexcept
+  {
+    return _mm256_set1_epi32(x);
+  }
+  NANDA_TARGET_AVX2 static void store(std::int32_t* p, type v) noexcept
+  {
+    _mm256_store_si256(reinterpret_cast<__m256i*>(p), v);
+  }
+  template<simd_op Op>
+  NANDA_TARGET_AVX2 static type binary(type a, type b) noexcept
+  {
+    if constexpr (Op == simd_op::add)
+      return _mm256_add_epi32(a, b);
+    else if constexpr (Op == simd_op::sub)
+      return _mm256_sub_epi32(a, b);
+    else if constexpr (Op == simd_op::mul)
+      return _mm256_mullo_epi32(a, b);
+    else if constexpr (Op == simd_op::min)
+      return _mm256_min_epi32(a, b);
+    else
+      return _mm256_max_epi32(a, b);
+  }
+  NANDA_TARGET_AVX2 static type abs(type a) noexcept
+  {
+    return _mm256_abs_epi32(a);
+  }
+  template<simd_cmp C>
+  NANDA_TARGET_AVX2 static mask compare(type a, type b) noexcept
+  {
+    const __m256i ones = _mm256_set1_epi32(-1);
+    if constexpr (C == simd_cmp::lt)
+      return _mm256_cmpgt_epi32(b, a);
+    else if constexpr (C == simd_cmp::le)
+      return _mm256_xor_si256(_mm256_cmpgt_epi32(a, b), ones);
+    else if constexpr (C == simd_cmp::gt)
+      return _mm256_cmpgt_epi32(a, b);
+    else if constexpr (C == simd_cmp::ge)
+      return _mm256_xor_si256(_mm256_cmpgt_epi32(b, a), ones);
+    else if constexpr (C == simd_cmp::eq)
+      return _mm256_cmpeq_epi32(a, b);
+    else
+      return _mm256_xor_si256(_mm256_cmpeq_epi32(a, b), ones);
+  }
+  NANDA_TARGET_AVX2 static type blend(mask m, type x, type y) noexcept
+  {
+    return _mm256_blendv_epi8(y, x, m);
+  }
+  NANDA_TARGET_AVX2 static void storeu(std::int32_t* p, type v) noexcept
+  {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+  }
+  NANDA_TARGET_AVX2 static void store_bytes(std::uint8_t* p, type v) noexcept
+  {
+    // the packs work within the 128 bit halves, 4 bytes in each
+    const __m256i words = _mm256_packs_epi32(v, v);
+    const __m256i bytes = _mm256_packus_epi16(words, words);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(p),
+                     _mm_unpacklo_epi32(_mm256_castsi256_si128(bytes),
+                                        _mm256_extracti128_si256(bytes, 1)));
+  }
+  NANDA_TARGET_AVX2 static type mulhi_u32(type a, type b) noexcept
+  {
+    const __m256i even = _mm256_srli_epi64(_mm256_mul_epu32(a, b), 32);
+    const __m256i odd =
+      _mm256_mul_epu32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+    return _mm256_blend_epi32(even, odd, 0xaa);
+  }
+  NANDA_TARGET_AVX2 static type shift_right(type a, int s) noexcept
+  {
+    return _mm256_srl_epi32(a, _mm_cvtsi32_si128(s));
+  }
+};
+
+template<>
+struct simd_convert<simd_isa::avx2, float, std::int32_t>
+{
+  static constexpr std::size_t width = 8;
+
+  NANDA_TARGET_AVX2 static void apply(const float* in,
+                                      std::int32_t* out) noexcept
+  {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out),
+                        _mm256_cvttps_epi32(_mm256_loadu_ps(in)));
+  }
+};
+
+template<>
+struct simd_convert<simd_isa::avx2, std::int32_t, float>
+{
+  static constexpr std::size_t width = 8;
+
+  NANDA_TARGET_AVX2 static void apply(const std::int32_t* in,
+                                      float* out) noexcept
+  {
+    _mm256_storeu_ps(out,
+                     _mm256_cvtepi32_ps(_mm256_loadu_si256(
+                       reinterpret_cast<const __m256i*>(in))));
+  }
+};
+
+template<>
+struct simd_convert<simd_isa::avx2, float, double>
+{
+  static constexpr std::size_t width = 4;
+
+  NANDA_TARGET_AVX2 static void apply(const float* in, double* out) noexcept
+  {
+    _mm256_storeu_pd(out, _mm256_cvtps_pd(_mm_loadu_ps(in)));
+  }
+};
+
+template<>
+struct simd_convert<simd_isa::avx2, double, float>
+{
+  static constexpr std::size_t width = 4;
+
+  NANDA_TARGET_AVX2 static void apply(const double* in, float* out) noexcept
+  {
+    _mm_storeu_ps(out, _mm256_cvtpd_ps(_mm256_loadu_pd(in)));
+  }
+};
+
+// AVX-512F, comparisons produce mask registers
+
+template<>
+struct simd_vec<simd_isa::avx512, float>
+{
+  using type = __m512;
+  using mask = __mmask16;
+  static constexpr std::size_t width = 16;
+
+  NANDA_TARGET_AVX512 static type load(const float* p) noexcept
+  {
+    return _mm512_loadu_ps(p);
+  }
+  NANDA_TARGET_AVX512 static type broadcast(float x) noexcept
+  {
+    return _mm512_set1_ps(x);
+  }
+  NANDA_TARGET_AVX512 static void store(float* p, type v) noexcept
+  {
+    _mm512_store_ps(p, v);
+  }
+  template<simd_op Op>
+  NANDA_TARGET_AVX512 static type binary(type a, type b) noexcept
+  {
+    if constexpr (Op == simd_op::add)
+      return _mm512_add_ps(a, b);
+    else if constexpr (Op == simd_op::sub)
+      return _mm512_sub_ps(a, b);
+    else if constexpr (Op == simd_op::mul)
+      return _mm512_mul_ps(a, b);
+    else if constexpr (Op == simd_op::min)
+      return _mm512_min_ps(a, b);
+    else
+      return _mm512_max_ps(a, b);
+  }
+  NANDA_TARGET_AVX512 static type abs(type a) noexcept
+  {
+    return _mm512_abs_ps(a);
+  }
+  NANDA_TARGET_AVX512 static type fma(type a, type b, type c) noexcept
+  {
+    return _mm512_fmadd_ps(a, b, c);
+  }
+  template<simd_cmp C>
+  NANDA_TARGET_AVX512 static mask compare(type a, type b) noexcept
+  {
+    if constexpr (C == simd_cmp::lt)
+      return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ);
+    else if constexpr (C == simd_cmp::le)
+      return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ);
+    else if constexpr (C == simd_cmp::gt)
+      return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ);
+    else if constexpr (C == simd_cmp::ge)
+      return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ);
+    else if constexpr (C == simd_cmp::eq)
+      return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ);
+    else
+      return _mm512_cmp_ps_mask(a, b, _CMP_NEQ_UQ);
+  }
+  NANDA_TARGET_AVX512 static type blend(mask m, type x, type y) noexcept
+  {
+    return _mm512_mask_blend_ps(m, y, x);
+  }
+};
+
+template<>
+struct simd_vec<simd_isa::avx512, double>
+{
+  using type = __m512d;
+  using mask = __mmask8;
+  static constexpr std::size_t width = 8;
+
+  NANDA_TARGET_AVX512 static type load(const double* p) noexcept
+  {
+    return _mm512_loadu_pd(p);
+  }
+  NANDA_TARGET_AVX512 static type broadcast(double x) noexcept
+  {
+    return _mm512_set1_pd(x);
+  }
+  NANDA_TARGET_AVX512 static void store(double* p, type v) noexcept
+  {
+    _mm512_store_pd(p, v);
+  }
+  template<simd_op Op>
+  NANDA_TARGET_AVX512 static type binary(type a, type b) noexcept
+  {
+    if constexpr (Op == simd_op::add)
+      return _mm512_add_pd(a, b);
+    else if constexpr (Op == simd_op::sub)
+      return _mm512_sub_pd(a, b);
+    else if constexpr (Op == simd_op::mul)
+      return _mm512_mul_pd(a, b);
+    else if constexpr (Op == simd_op::min)
+      return _mm512_min_pd(a, b);
+    else
+      return _mm512_max_pd(a, b);
+  }
+  NANDA_TARGET_AVX512 static type abs(type a) noexcept
+  {
+    return _mm512_abs_pd(a);
+  }
+  NANDA_TARGET_AVX512 static type fma(type a, type b, type c) noexcept
+  {
+    return _mm512_fmadd_pd(a, b, c);
+  }
+  template<simd_cmp C>
+  NANDA_TARGET_AVX512 static mask compare(type a, type b) noexcept
+  {
+    if constexpr (C == simd_cmp::lt)
+      return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ);
+    else if constexpr (C == simd_cmp::le)
+      return _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ);
+    else if constexpr (C == simd_cmp::gt)
+      return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ);
+    else if constexpr (C == simd_cmp::ge)
+      return _mm512_cmp_pd_mask(a, b, _CMP_GE_OQ);
+    else if constexpr (C == simd_cmp::eq)
+      return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ);
+    else
+      return _mm512_cmp_pd_mask(a, b, _CMP_NEQ_UQ);
+  }
+  NANDA_TARGET_AVX512 static type blend(mask m, type x, type y) noexcept
+  {
+    return _mm512_mask_blend_pd(m, y, x);
+  }
+};
+
+template<>
+struct simd_vec<simd_isa::avx512, std::int32_t>
+{
+  using type = __m512i;
+  using mask = __mmask16;
+  static constexpr std::size_t width = 16;
+
+  NANDA_TARGET_AVX512 static type load(const std::int32_t* p) noexcept
+  {
+    return _mm512_loadu_si512(p);
+  }
+  NANDA_TARGET_AVX512 static type broadcast(std::int32_t x) noexcept
+  {
+    return _mm512_set1_epi32(x);
+  }
+  NANDA_TARGET_AVX512 static void store(std::int32_t* p, type v) noexcept
+  {
+    _mm512_store_si512(p, v);
+  }
+  template<simd_op Op>
+  NANDA_TARGET_AVX512 static type binary(type a, type b) noexcept
+  {
+    if constexpr (Op == simd_op::add)
+      return _mm512_add_epi32(a, b);
+    else if constexpr (Op == simd_op::sub)
+      return _mm512_sub_epi32(a, b);
+    else if constexpr (Op == simd_op::mul)
+      return _mm512_mullo_epi32(a, b);
+    else if constexpr (Op == simd_op::min)
+      return _mm512_min_epi32(a, b);
+    else
+      return _mm512_max_epi32(a, b);
+  }
+  NANDA_TARGET_AVX512 static type abs(type a) noexcept
+  {
+    return _mm512_abs_epi32(a);
+  }
+  template<simd_cmp C>
+  NANDA_TARGET_AVX512 static mask compare(type a, type b) noexcept
+  {
+    if constexpr (C == simd_cmp::lt)
+      return _mm512_cmp_epi32_mask(a, b, _MM_CMPINT_LT);
+    else if constexpr (C == simd_cmp::le)
+      return _mm512_cmp_epi32_mask(a, b, _MM_CMPINT_LE);
+    else if constexpr (C == simd_cmp::gt)
+      return _mm512_cmp_epi32_mask(a, b, _MM_CMPINT_NLE);
+    else if constexpr (C == simd_cmp::ge)
+      return _mm512_cmp_epi32_mask(a, b, _MM_CMPINT_NLT);
+    else if constexpr (C == simd_cmp::eq)
+      return _mm512_cmp_epi32_mask(a, b, _MM_CMPINT_EQ);
+    else
+      return _mm512_cmp_epi32_mask(a, b, _MM_CMPINT_NE);
+  }
+  NANDA_TARGET_AVX512 static type blend(mask m, type x, type y) noexcept
+  {
+    return _mm512_mask_blend_epi32(m, y, x);
+  }
+  NANDA_TARGET_AVX512 static void storeu(std::int32_t* p, type v) noexcept
+  {
+    _mm512_storeu_si512(p, v);
+  }
+  NANDA_TARGET_AVX512 static void store_bytes(std::uint8_t* p, type v) noexcept
+  {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm512_cvtepi32_epi8(v));
+  }
+  NANDA_TARGET_AVX512 static type mulhi_u32(type a, type b) noexcept
+  {
+    const __m512i even = _mm512_srli_epi64(_mm512_mul_epu32(a, b), 32);
+    const __m512i odd =
+      _mm512_mul_epu32(_mm512_srli_epi64(a, 32), _mm512_srli_epi64(b, 32));
+    return _mm512_mask_blend_epi32(0xaaaa, even, odd);
+  }
+  NANDA_TARGET_AVX512 static type shift_right(type a, int s) noexcept
+  {
+    return _mm512_srl_epi32(a, _mm_cvtsi32_si128(s));
+  }
+};
+
+template<>
+struct simd_convert<simd_isa::avx512, float, std::int32_t>
+{
+  static constexpr std::size_t width = 16;
+
+  NANDA_TARGET_AVX512 static void apply(const float* in,
+                                        std::int32_t* out) noexcept
+  {
+    _mm512_storeu_si512(out, _mm512_cvttps_epi32(_mm512_loadu_ps(in)));
+  }
+};
+
+template<>
+struct simd_convert<simd_isa::avx512, std::int32_t, float>
+{
+  static constexpr std::size_t width = 16;
+
+  NANDA_TARGET_AVX512 static void apply(const std::int32_t* in,
+                                        float* out) noexcept
+  {
+    _mm512_storeu_ps(out, _mm512_cvtepi32_ps(_mm512_loadu_si512(in)));
+  }
+};
+
+template<>
+struct simd_convert<simd_isa::avx512, float, double>
+{
+  static constexpr std::size_t width = 8;
+
+  NANDA_TARGET_AVX512 static void apply(const float* in, double* out) noexcept
+  {
+    _mm512_storeu_pd(out, _mm512_cvtps_pd(_mm256_loadu_ps(in)));
+  }
+};
+
+template<>
+struct simd_convert<simd_isa::avx512, double, float>
+{
+  static constexpr std::size_t width = 8;
+
+  NANDA_TARGET_AVX512 static void apply(const double* in, float* out) noexcept
+  {
+    _mm256_storeu_ps(out, _mm512_cvtpd_ps(_mm512_loadu_pd(in)));
+  }
+};
+
+#endif // NANDA_SIMD_X86
+
+// the loops, written once and inlined into the entry points of every
+// instruction set. The scalar head runs until the stores are aligned to the
+// vector width, the loads are unaligned since the operands may be offset
+// differently; the scalar tail takes what is left.
+
+template<class V, class T>
+NANDA_SIMD_INLINE std::size_t
+simd_head(const T* out, std::size_t n) noexcept
+{
+  constexpr std::size_t bytes = V::width * sizeof(T);
+  const auto misalign = reinterpret_cast<std::uintptr_t>(out) % bytes;
+  const std::size_t head =
+    misalign == 0 ? 0 : (bytes - misalign) / sizeof(T);
+  return head < n ? head : n;
+}
+
+// a splat operand is a single element read for every output (a stride 0
+// axis), its vector is built once outside the loop
+template<class V, simd_op Op, bool SplatA = false, bool SplatB = false, class T>
+NANDA_SIMD_INLINE void
+simd_binary_loop(const T* a, const T* b, T* out, std::size_t n) noexcept
+{
+  constexpr std::size_t sa = SplatA ? 0 : 1, sb = SplatB ? 0 : 1;
+  std::size_t k = 0;
+  for (const auto head = simd_head<V>(out, n); k < head; ++k)
+    out[k] = scalar_binary<Op>(a[k * sa], b[k * sb]);
+  if (k + V::width <= n) {
+    const auto va = SplatA ? V::broadcast(*a) : typename V::type{};
+    const auto vb = SplatB ? V::broadcast(*b) : typename V::type{};
+    for (; k + V::width <= n; k += V::width) {
+      auto x = va, y = vb;
+      if constexpr (!SplatA)
+        x = V::load(a + k);
+      if constexpr (!SplatB)
+        y = V::load(b + k);
+      V::store(out + k, V::template binary<Op>(x, y));
+    }
+  }
+  for (; k < n; ++k)
+    out[k] = scalar_binary<Op>(a[k * sa], b[k * sb]);
+}
+
+template<class V, class T>
+NANDA_SIMD_INLINE void
+simd_abs_loop(const T* a, T* out, std::size_t n) noexcept
+{
+  std::size_t k = 0;
+  for (const auto head = simd_head<V>(out, n); k < head; ++k)
+    out[k] = scalar_abs(a[k]);
+  for (; k + V::width <= n; k += V::width)
+    V::store(out + k, V::abs(V::load(a + k)));
+  for (; k < n; ++k)
+    out[k] = scalar_abs(a[k]);
+}
+
+///@brief Whether V::fma rounds once, which the scalar head and tail of
+/// simd_fma_loop then match so no element depends on the alignment of 'out'
+template<class V>
+inline constexpr bool simd_fused_fma_v = false;
+
+template<simd_isa Isa, class T>
+inline constexpr bool simd_fused_fma_v<simd_vec<Isa, T>> =
+  (Isa == simd_isa::avx2 || Isa == simd_isa::avx512) &&
+  std::is_floating_point_v<T>;
+
+template<class V, class T>
+NANDA_SIMD_INLINE T
+scalar_fma(T a, T b, T c) noexcept
+{
+  if constexpr (simd_fused_fma_v<V>)
+    return std::fma(a, b, c);
+  else
+    return a * b + c;
+}
+
+template<class V, class T>
+NANDA_SIMD_INLINE void
+simd_fma_loop(const T* a, const T* b, const T* c, T* out, std::size_t n) noexcept
+{
+  std::size_t k = 0;
+  for (const auto head = simd_head<V>(out, n); k < head; ++k)
+    out[k] = scalar_fma<V>(a[k], b[k], c[k]);
+  for (; k + V::width <= n; k += V::width)
+    V::store(out + k, V::fma(V::load(a + k), V::load(b + k), V::load(c + k)));
+  for (; k < n; ++k)
+    out[k] = scalar_fma<V>(a[k], b[k], c[k]);
+}
+
+template<class V, simd_cmp C, class T>
+NANDA_SIMD_INLINE void
+simd_select_loop(const T* a,
+                 const T* b,
+                 const T* x,
+                 const T* y,
+                 T* out,
+                 std::size_t n) noexcept
+{
+  std::size_t k = 0;
+  for (const auto head = simd_head<V>(out, n); k < head; ++k)
+    out[k] = scalar_compare<C>(a[k], b[k]) ? x[k] : y[k];
+  for (; k + V::width <= n; k += V::width) {
+    const auto m = V::template compare<C>(V::load(a + k), V::load(b + k));
+    V::store(out + k, V::blend(m, V::load(x + k), V::load(y + k)));
+  }
+  for (; k < n; ++k)
+    out[k] = scalar_compare<C>(a[k], b[k]) ? x[k] : y[k];
+}
+
+template<class C, class From, class To>
+NANDA_SIMD_INLINE void
+simd_cast_loop(const From* in, To* out, std::size_t n) noexcept
+{
+  std::size_t k = 0;
+  for (; k + C::width <= n; k += C::width)
+    C::apply(in + k, out + k);
+  for (; k < n; ++k)
+    out[k] = To(in[k]);
+}
+
+///@brief Entry points of the kernels for one instruction set, the primary
+/// template is the scalar fallback
+template<simd_isa Isa>
+struct simd_kernels
+{
+  template<simd_op Op, bool SplatA = false, bool SplatB = false, class T>
+  static void binary(const T* a, const T* b, T* out, std::size_t n) noexcept
+  {
+    simd_binary_loop<simd_vec<Isa, T>, Op, SplatA, SplatB>(a, b, out, n);
+  }
+
+  template<class T>
+  static void abs(const T* a, T* out, std::size_t n) noexcept
+  {
+    simd_abs_loop<simd_vec<Isa, T>>(a, out, n);
+  }
+
+  template<class T>
+  static void fma(const T* a,
+                  const T* b,
+                  const T* c,
+                  T* out,
+                  std::size_t n) noexcept
+  {
+    simd_fma_loop<simd_vec<Isa, T>>(a, b, c, out, n);
+  }
+
+  template<simd_cmp C, class T>
+  static void select(const T* a,
+                     const T* b,
+                     const T* x,
+                     const T* y,
+                     T* out,
+                     std::size_t n) noexcept
+  {
+    simd_select_loop<simd_vec<Isa, T>, C>(a, b, x, y, out, n);
+  }
+
+  template<class From, class To>
+  static void cast(const From* in, To* out, std::size_t n) noexcept
+  {
+    simd_cast_loop<simd_convert<Isa, From, To>>(in, out, n);
+  }
+};
+
+#ifdef NANDA_SIMD_X86
+
+// the same entry points compiled for each instruction set
+#define NANDA_SIMD_KERNELS(isa, target)                                        \
+  template<>                                                                   \
+  struct simd_kernels<simd_isa::isa>                                           \
+  {                                                                            \
+    template<simd_op Op, bool SplatA = false, bool SplatB = false, class T>   \
+    target static void binary(const T* a,                                      \
+                              const T* b,                                      \
+                              T* out,                                          \
+                              std::size_t n) noexcept                          \
+    {                                                                          \
+      simd_binary_loop<simd_vec<simd_isa::isa, T>, Op, SplatA, SplatB>(        \
+        a, b, out, n);                                                         \
+    }                                                                          \
+                                                                               \
+    template<class T>                                                          \
+    target static void abs(const T* a, T* out, std::size_t n) noexcept        \
+    {                                                                          \
+      simd_abs_loop<simd_vec<simd_isa::isa, T>>(a, out, n);                    \
+    }                                                                          \
+                                                                               \
+    template<class T>                                                          \
+    target static void fma(const T* a,                                         \
+                           const T* b,                                         \
+                           const T* c,                                         \
+                           T* out,                                             \
+                           std::size_t n) noexcept                             \
+    {                                                                          \
+      simd_fma_loop<simd_vec<simd_isa::isa, T>>(a, b, c, out, n);              \
+    }                                                                          \
+                                                                               \
+    template<simd_cmp C, class T>                                              \
+    target static void select(const T* a,                                      \
+                              const T* b,                                      \
+                              const T* x,                                      \
+                              const T* y,                                      \
+                              T* out,                                          \
+                              std::size_t n) noexcept                          \
+    {                                                                          \
+      simd_select_loop<simd_vec<simd_isa::isa, T>, C>(a, b, x, y, out, n);     \
+    }                                                                          \
+                                                                               \
+    template<class From, class To>                                             \
+    target static void cast(const From* in, To* out, std::size_t n) noexcept  \
+    {                                                                          \
+      simd_cast_loop<simd_convert<simd_isa::isa, From, To>>(in, out, n);       \
+    }                                                                          \
+  };
+
+NANDA_SIMD_KERNELS(sse2, NANDA_TARGET_SSE2)
+NANDA_SIMD_KERNELS(avx2, NANDA_TARGET_AVX2)
+NANDA_SIMD_KERNELS(avx512, NANDA_TARGET_AVX512)
+
+#undef NANDA_SIMD_KERNELS
+
+#endif // NANDA_SIMD_X86
+
+///@brief Calls f(simd_kernels<isa>{})
+template<class F>
+void
+simd_dispatch(simd_isa isa, F&& f)
+{
+  switch (isa) {
+#ifdef NANDA_SIMD_X86
+    case simd_isa::avx512:
+      return f(simd_kernels<simd_isa::avx512>{});
+    case simd_isa::avx2:
+      return f(simd_kernels<simd_isa::avx2>{});
+    case simd_isa::sse2:
+      return f(simd_kernels<simd_isa::sse2>{});
+#endif
+    default:
+      return f(simd_kernels<simd_isa::scalar>{});
+  }
+}
+
+template<class R>
+using as_span_t = decltype(std::declval<R&>().as_span());
+
+///@brief The elements of a span, of an ndarray or a contiguous ndspan (all
+/// of its storage) or of any range with data() and size()
+template<class R>
+auto
+simd_elements(R&& range)
+{
+  if constexpr (concepts::expr::is_detected_v<as_span_t, R>) {
+    return range.as_span();
+  } else {
+    using element = std::remove_pointer_t<decltype(std::data(range))>;
+    return span<element>(std::data(range), std::size(range));
+  }
+}
+
+template<class R>
+using simd_element_t = std::remove_cv_t<
+  std::remove_pointer_t<decltype(simd_elements(std::declval<R>()).data())>>;
+
+///@brief ndarrays and ndspans of a strided layout, the operands that have a
+/// shape and may broadcast
+template<class R, class = void>
+struct is_simd_shaped : std::false_type
+{};
+
+template<class R>
+struct is_simd_shaped<R, std::void_t<typename R::mapping_type>>
+  : std::bool_constant<R::mapping_type::is_always_strided()>
+{};
+
+template<class R>
+inline constexpr bool is_simd_shaped_v =
+  is_simd_shaped<remove_cvref_t<R>>::value;
+
+///@brief ndarrays and ndspans of any layout, strided or not
+template<class R, class = void>
+struct is_simd_mapped : std::false_type
+{};
+
+template<class R>
+struct is_simd_mapped<R, std::void_t<typename R::mapping_type>>
+  : std::true_type
+{};
+
+///@brief ndarrays and ndspans of a layout without strides (tiled,
+/// space-filling curves), whose element order is only known to match that of
+/// an array of the same mapping
+template<class R>
+inline constexpr bool is_simd_unstrided_v =
+  is_simd_mapped<remove_cvref_t<R>>::value && !is_simd_shaped_v<R>;
+
+///@brief The element type of an operand, void for a scalar
+template<class A, bool = std::is_arithmetic_v<A>>
+struct simd_operand_element
+{
+  using type = simd_element_t<const A&>;
+};
+
+template<class A>
+struct simd_operand_element<A, true>
+{
+  using type = void;
+};
+
+template<class A, class T>
+inline constexpr bool is_simd_operand_of_v =
+  std::is_arithmetic_v<A> ||
+  std::is_same_v<typename simd_operand_element<A>::type, T>;
+
+///@brief Whether an operand is a scalar or shaped (ndarray, ndspan), the
+/// operands that broadcast. Plain ranges are always read flat.
+template<class A>
+inline constexpr bool is_simd_broadcastable_v =
+  std::is_arithmetic_v<A> || is_simd_shaped_v<A>;
+
+///@brief Whether the scalar or shaped 'a' can be read as the flat range of
+/// 'out', its elements in the order of those of 'out'
+template<class A, class Out>
+bool
+simd_flat_operand(const A& a, const Out& out)
+{
+  if constexpr (std::is_arithmetic_v<A>) {
+    return true;
+  } else {
+    if (!a.mapping().is_contiguous() || !(a.extents() == out.extents()))
+      return false;
+    for (std::size_t r = 0; r < out.extents().rank(); ++r)
+      if (out.extent(r) > 1 &&
+          std::size_t(a.stride(r)) != std::size_t(out.stride(r)))
+        return false;
+    return true;
+  }
+}
+
+///@brief out = op(a, b) over an index space of strides 'as', 'bs' and 'os'.
+/// Rows along the axis of smallest output stride go to the kernels, an
+/// operand of stride 0 along it is splat once per row instead of loaded per
+/// element, and axes that continue the rows of every operand are merged into
+/// them first.
+template<simd_op Op, class T, std::size_t N>
+void
+simd_binary_strided(const T* a,
+                    std::array<std::ptrdiff_t, N> as,
+                    const T* b,
+                    std::array<std::ptrdiff_t, N> bs,
+                    T* out,
+                    std::array<std::ptrdiff_t, N> os,
+                    std::array<std::ptrdiff_t, N> dims,
+                    simd_isa isa)
+{
+  std::size_t rows = 1;
+  for (auto d : dims) {
+    if (d == 0)
+      return;
+    rows *= std::size_t(d);
+  }
+  if constexpr (N == 0) {
+    *out = scalar_binary<Op>(*a, *b);
+  } else {
+    std::size_t inner = N - 1;
+    for (std::size_t r = 0; r < N; ++r)
+      if (dims[r] > 1 && (dims[inner] == 1 ||
+                          std::abs(os[r]) < std::abs(os[inner])))
+        inner = r;
+    for (bool merged = true; merged;) {
+      merged = false;
+      for (std::size_t r = 0; r < N; ++r) {
+        const auto d = dims[inner];
+        if (r == inner || dims[r] == 1 || os[r] != os[inner] * d ||
+            as[r] != as[inner] * d || bs[r] != bs[inner] * d)
+          continue;
+        dims[inner] *= dims[r];
+        dims[r] = 1;
+        merged = true;
+      }
+    }
+    const auto n = std::size_t(dims[inner]);
+    const std::ptrdiff_t sa = as[inner], sb = bs[inner], so = os[inner];
+    rows /= n;
+
+    simd_dispatch(isa, [&](auto kernels) {
+      std::array<std::ptrdiff_t, N> idx{};
+      for (std::size_t row = 0; row < rows; ++row) {
+        if (so == 1 && (sa == 0 || sa == 1) && (sb == 0 || sb == 1)) {
+          if (sa == 1 && sb == 1)
+            kernels.template binary<Op>(a, b, out, n);
+          else if (sa == 1)
+            kernels.template binary<Op, false, true>(a, b, out, n);
+          else if (sb == 1)
+            kernels.template binary<Op, true, false>(a, b, out, n);
+          else
+            kernels.template binary<Op, true, true>(a, b, out, n);
+        } else {
+          for (std::size_t k = 0; k < n; ++k) {
+            const auto i = std::ptrdiff_t(k);
+            out[i * so] = scalar_binary<Op>(a[i * sa], b[i * sb]);
+          }
+        }
+        // the next row, the last axes first
+        for (std::size_t r = N; r-- > 0;) {
+          if (r == inner)
+            continue;
+          if (++idx[r] < dims[r]) {
+            a += as[r];
+            b += bs[r];
+            out += os[r];
+            break;
+          }
+          a -= as[r] * (dims[r] - 1);
+          b -= bs[r] * (dims[r] - 1);
+          out -= os[r] * (dims[r] - 1);
+          idx[r] = 0;
+        }
+      }
+    });
+  }
+}
+
+///@brief The data and strides of an operand broadcast to 'ext'
+template<class T, class A, class E>
+std::pair<const T*, std::array<std::ptrdiff_t, E::rank()>>
+simd_broadcast_operand(const A& a, const T& scalar, const E& ext)
+{
+  if constexpr (std::is_arithmetic_v<A>) {
+    return { &scalar, {} };
+  } else {
+    using F = remove_cvref_t<decltype(a.extents())>;
+    std::array<std::ptrdiff_t, F::rank()> strides{};
+    for (std::size_t r = 0; r < F::rank(); ++r)
+      strides[r] = std::ptrdiff_t(a.stride(r));
+    return { a.data(), broadcast_strides(a.extents(), strides, ext) };
+  }
+}
+
+///@brief Whether 'a' has its elements in the storage order of 'out': a
+/// scalar or a plain range (read flat) always, an ndarray or ndspan only when
+/// it has the mapping of 'out'
+template<class A, class Out>
+bool
+simd_same_mapping(const A& a, const Out& out)
+{
+  if constexpr (!is_simd_mapped<remove_cvref_t<A>>::value) {
+    return true;
+  } else if constexpr (std::is_same_v<
+                         typename remove_cvref_t<A>::mapping_type,
+                         typename remove_cvref_t<Out>::mapping_type>) {
+    return a.mapping() == out.mapping();
+  } else {
+    return false;
+  }
+}
+
+///@brief The offset of index 'idx' in a mapping of any index type
+template<class M, std::size_t N>
+auto
+simd_mapped_offset(const M& map, const std::array<std::ptrdiff_t, N>& idx)
+{
+  typename M::index_array own{};
+  for (std::size_t r = 0; r < N; ++r)
+    own[r] = typename M::index_type(idx[r]);
+  return std::ptrdiff_t(map(own));
+}
+
+///@brief Reads operand 'x' at the index 'idx' of 'out' when called with the
+/// offset of that index in 'out'. A scalar is returned as is, strided
+/// operands broadcast to 'ext', unstrided ones must have the extents 'ext'
+/// and plain ranges are read in the storage order of 'out'.
+template<class X, class T, class E, std::size_t N>
+auto
+simd_indexed_reader(const X& x,
+                    const T& scalar,
+                    const E& ext,
+                    const std::array<std::ptrdiff_t, N>& idx)
+{
+  if constexpr (std::is_arithmetic_v<X>) {
+    return [&scalar](std::ptrdiff_t) { return scalar; };
+  } else if constexpr (is_simd_shaped_v<X>) {
+    const auto [p, s] = simd_broadcast_operand(x, scalar, ext);
+    return [&idx, p = p, s = s](std::ptrdiff_t) {
+      std::ptrdiff_t offset = 0;
+      for (std::size_t r = 0; r < N; ++r)
+        offset += idx[r] * s[r];
+      return p[offset];
+    };
+  } else if constexpr (is_simd_unstrided_v<X>) {
+    EXPECTS(x.extents() == ext);
+    return [&idx, &x](std::ptrdiff_t) {
+      return x.data()[simd_mapped_offset(x.mapping(), idx)];
+    };
+  } else {
+    const auto sx = simd_elements(x);
+    return [p = sx.data()](std::ptrdiff_t offset) { return p[offset]; };
+  }
+}
+
+///@brief Calls f(offset) with the offset in 'out' of every index of 'out',
+/// which 'idx' holds during the call, last index fastest
+template<class Out, std::size_t N, class F>
+void
+simd_for_each_offset(const Out& out, std::array<std::ptrdiff_t, N>& idx, F&& f)
+{
+  const auto& ext = out.extents();
+  for (std::size_t r = 0; r < N; ++r)
+    if (ext.extent(r) == 0)
+      return;
+  idx = {};
+  for (;;) {
+    f(simd_mapped_offset(out.mapping(), idx));
+    std::size_t r = N;
+    while (r > 0 && ++idx[r - 1] == std::ptrdiff_t(ext.extent(r - 1)))
+      idx[--r] = 0;
+    if (r == 0)
+      return;
+  }
+}
+
+///@brief out = op(a, b) index by index, for operands of a layout without
+/// strides and a different mapping than 'out', see simd_indexed_reader()
+template<simd_op Op, class T, class A, class B, class Out>
+void
+simd_binary_indexed(const A& a,
+                    const T& scalar_a,
+                    const B& b,
+                    const T& scalar_b,
+                    Out& out)
+{
+  const auto& ext = out.extents();
+  std::array<std::ptrdiff_t, remove_cvref_t<decltype(ext)>::rank()> idx{};
+  const auto ea = simd_indexed_reader(a, scalar_a, ext, idx);
+  const auto eb = simd_indexed_reader(b, scalar_b, ext, idx);
+  T* po = out.data();
+  simd_for_each_offset(out, idx, [&](std::ptrdiff_t o) {
+    po[o] = scalar_binary<Op>(T(ea(o)), T(eb(o)));
+  });
+}
+
+///@brief Whether the array operand 'a' can be read flat along 'out': a plain
+/// range always, a strided one with the extents and strides of 'out', an
+/// unstrided one with its mapping
+template<class A, class Out>
+bool
+simd_flat_array_operand(const A& a, const Out& out)
+{
+  if constexpr (is_simd_shaped_v<A> && is_simd_shaped_v<Out>)
+    return simd_flat_operand(a, out);
+  else
+    return simd_same_mapping(a, out);
+}
+
+///@brief Whether the kernels may run over the flat elements of 'out' and of
+/// the array operands 'a', in storage order: 'out' is a plain range, or it is
+/// contiguous and every operand is read flat along it
+template<class Out, class... A>
+bool
+simd_flat_arrays(const Out& out, const A&... a)
+{
+  if constexpr (!is_simd_mapped<remove_cvref_t<Out>>::value)
+    return true;
+  else
+    return out.mapping().is_contiguous() &&
+           (simd_flat_array_operand(a, out) && ...);
+}
+
+///@brief Unless the kernels may run flat (see simd_flat_arrays()), runs
+/// f(o, x...) index by index with a reference to the element of 'out' and the
+/// values of the array operands 'a' at every index of 'out' and returns true,
+/// see simd_indexed_reader()
+template<class Out, class F, class... A>
+bool
+simd_indexed(Out& out, F&& f, const A&... a)
+{
+  if constexpr (!is_simd_mapped<remove_cvref_t<Out>>::value) {
+    return false;
+  } else {
+    if (simd_flat_arrays(out, a...))
+      return false;
+    const auto& ext = out.extents();
+    std::array<std::ptrdiff_t, remove_cvref_t<decltype(ext)>::rank()> idx{};
+    // array operands only, the scalar of a reader is never read
+    const auto readers = std::make_tuple(
+      simd_indexed_reader(a, simd_element_t<const A&>{}, ext, idx)...);
+    auto* po = out.data();
+    simd_for_each_offset(out, idx, [&](std::ptrdiff_t o) {
+      std::apply([&](const auto&... read) { f(po[o], read(o)...); }, readers);
+    });
+    return true;
+  }
+}
+
+///@brief out = op(a, b) for every element. A scalar operand is splat. When
+/// 'out' and every other operand are shaped (ndarray, ndspan), one of other
+/// extents than 'out' or not contiguous in its order is broadcast to it and
+/// read through its strides; plain ranges are read flat and must have the
+/// size of 'out'. Arrays of a layout without strides are read flat only when
+/// they share the mapping of 'out', index by index otherwise.
+template<simd_op Op, class A, class B, class Out>
+void
+simd_binary(const A& a, const B& b, Out&& out, simd_isa isa)
+{
+  using T = simd_element_t<Out>;
+  static_assert(is_simd_operand_of_v<A, T> && is_simd_operand_of_v<B, T>,
+                "The operands must have the element type of the output");
+  const T scalar_a = [&] {
+    if constexpr (std::is_arithmetic_v<A>)
+      return T(a);
+    else
+      return T{};
+  }();
+  const T scalar_b = [&] {
+    if constexpr (std::is_arithmetic_v<B>)
+      return T(b);
+    else
+      return T{};
+  }();
+
+  if constexpr (is_simd_unstrided_v<Out> || is_simd_unstrided_v<A> ||
+                is_simd_unstrided_v<B>) {
+    static_assert(is_simd_mapped<remove_cvref_t<Out>>::value,
+                  "An operand of a layout without strides needs an ndarray "
+                  "or ndspan output");
+    if (!out.mapping().is_contiguous() || !simd_same_mapping(a, out) ||
+        !simd_same_mapping(b, out)) {
+      simd_binary_indexed<Op>(a, scalar_a, b, scalar_b, out);
+      return;
+    }
+  } else if constexpr (is_simd_shaped_v<Out> && is_simd_broadcastable_v<A> &&
+                       is_simd_broadcastable_v<B>) {
+    if (!out.mapping().is_contiguous() || !simd_flat_operand(a, out) ||
+        !simd_flat_operand(b, out)) {
+      const auto& ext = out.extents();
+      using E = remove_cvref_t<decltype(ext)>;
+      std::array<std::ptrdiff_t, E::rank()> os{}, dims{};
+      for (std::size_t r = 0; r < E::rank(); ++r) {
+        os[r] = std::ptrdiff_t(out.stride(r));
+        dims[r] = std::ptrdiff_t(ext.extent(r));
+      }
+      const auto [pa, as] = simd_broadcast_operand(a, scalar_a, ext);
+      const auto [pb, bs] = simd_broadcast_operand(b, scalar_b, ext);
+      simd_binary_strided<Op>(pa, as, pb, bs, out.data(), os, dims, isa);
+      return;
+    }
+  }
+
+  const auto so = simd_elements(out);
+  const auto elements = [&](const auto& x, const T& scalar) {
+    using X = remove_cvref_t<decltype(x)>;
+    if constexpr (std::is_arithmetic_v<X>) {
+      return span<const T>(&scalar, 1);
+    } else {
+      const auto sx = simd_elements(x);
+      EXPECTS(sx.size() == so.size());
+      return span<const T>(sx.data(), sx.size());
+    }
+  };
+  const auto sa = elements(a, scalar_a);
+  const auto sb = elements(b, scalar_b);
+  constexpr bool splat_a = std::is_arithmetic_v<A>;
+  constexpr bool splat_b = std::is_arithmetic_v<B>;
+
+  simd_dispatch(isa, [&](auto kernels) {
+    kernels.template binary<Op, splat_a, splat_b>(
+      sa.data(), sb.data(), so.data(), so.size());
+  });
+}
+
+} // namespace detail
+
+///@brief Elementwise kernels over contiguous ranges, explicitly vectorized
+/// for SSE2, AVX2 and AVX-512 and picked at run time (see active_simd_isa()).
+/// Arguments are spans, ndarrays, ndspans or any range with data() and
+/// size(), all of the same size; 'out' may be one of the inputs. When 'out'
+/// is an ndarray or ndspan, operands of another element order than 'out' and
+/// an 'out' that is not contiguous are paired index by index instead of by
+/// storage position.
+///
+/// The binary kernels (add, sub, mul, min, max) broadcast as well: an operand
+/// may be a scalar, and when 'out' is an ndarray or ndspan the operands may be
+/// ndarrays or strided ndspans of any extents that broadcast to those of
+/// 'out' (see broadcast_extents(), broadcast_to()). Stride 0 axes are not
+/// expanded: a broadcast row is reused as it is and a broadcast element is
+/// splat into a register once per row of 'out'. float,
+/// double and std::int32_t are vectorized, other element types run the scalar
+/// loop. Results are the same on every instruction set except for fma, which
+/// is only fused on AVX2 and AVX-512.
+namespace simd {
+
+template<class A, class B, class Out>
+void
+add(const A& a, const B& b, Out&& out, simd_isa isa = active_simd_isa())
+{
+  detail::simd_binary<detail::simd_op::add>(a, b, out, isa);
+}
+
+template<class A, class B, class Out>
+void
+sub(const A& a, const B& b, Out&& out, simd_isa isa = active_simd_isa())
+{
+  detail::simd_binary<detail::simd_op::sub>(a, b, out, isa);
+}
+
+template<class A, class B, class Out>
+void
+mul(const A& a, const B& b, Out&& out, simd_isa isa = active_simd_isa())
+{
+  detail::simd_binary<detail::simd_op::mul>(a, b, out, isa);
+}
+
+///@brief out = a < b ? a : b, the second operand if one of them is NaN
+template<class A, class B, class Out>
+void
+min(const A& a, const B& b, Out&& out, simd_isa isa = active_simd_isa())
+{
+  detail::simd_binary<detail::simd_op::min>(a, b, out, isa);
+}
+
+///@brief out = a > b ? a : b, the second operand if one of them is NaN
+template<class A, class B, class Out>
+void
+max(const A& a, const B& b, Out&& out, simd_isa isa = active_simd_isa())
+{
+  detail::simd_binary<detail::simd_op::max>(a, b, out, isa);
+}
+
+///@brief out = |a|, the lowest integer stays itself
+template<class A, class Out>
+void
+abs(const A& a, Out&& out, simd_isa isa = active_simd_isa())
+{
+  using T = detail::simd_element_t<Out>;
+  static_assert(std::is_same_v<detail::simd_element_t<const A&>, T>,
+                "The operand must have the element type of the output");
+  if (detail::simd_indexed(
+        out, [](T& o, T x) { o = detail::scalar_abs(x); }, a))
+    return;
+  const auto sa = detail::simd_elements(a);
+  const auto so = detail::simd_elements(out);
+  EXPECTS(sa.size() == so.size());
+
+  detail::simd_dispatch(isa, [&](auto kernels) {
+    kernels.abs(sa.data(), so.data(), so.size());
+  });
+}
+
+///@brief out = a * b + c, with a single rounding where the instruction set
+/// has fused multiply-add
+template<class A, class B, class C, class Out>
+void
+fma(const A& a,
+    const B& b,
+    const C& c,
+    Out&& out,
+    simd_isa isa = active_simd_isa())
+{
+  using T = detail::simd_element_t<Out>;
+  static_assert(std::is_floating_point_v<T>, "fma needs floating point");
+  static_assert(std::is_same_v<detail::simd_element_t<const A&>, T> &&
+                  std::is_same_v<detail::simd_element_t<const B&>, T> &&
+                  std::is_same_v<detail::simd_element_t<const C&>, T>,
+                "The operands must have the element type of the output");
+  // index by index the elements go through the kernels, fused where they are
+  bool indexed = false;
+  detail::simd_dispatch(isa, [&](auto kernels) {
+    indexed = detail::simd_indexed(
+      out,
+      [&](T& o, T x, T y, T z) { kernels.fma(&x, &y, &z, &o, 1); },
+      a,
+      b,
+      c);
+  });
+  if (indexed)
+    return;
+  const auto sa = detail::simd_elements(a);
+  const auto sb = detail::simd_elements(b);
+  const auto sc = detail::simd_elements(c);
+  const auto so = detail::simd_elements(out);
+  EXPECTS(sa.size() == so.size() && sb.size() == so.size() &&
+          sc.size() == so.size());
+
+  detail::simd_dispatch(isa, [&](auto kernels) {
+    kernels.fma(sa.data(), sb.data(), sc.data(), so.data(), so.size());
+  });
+}
+
+///@brief out = cmp(a, b) ? x : y for every element
+template<simd_cmp Cmp, class A, class B, class X, class Y, class Out>
+void
+select(const A& a,
+       const B& b,
+       const X& x,
+       const Y& y,
+       Out&& out,
+       simd_isa isa = active_simd_isa())
+{
+  using T = detail::simd_element_t<Out>;
+  static_assert(std::is_same_v<detail::simd_element_t<const A&>, T> &&
+                  std::is_same_v<detail::simd_element_t<const B&>, T> &&
+                  std::is_same_v<detail::simd_element_t<const X&>, T> &&
+                  std::is_same_v<detail::simd_element_t<const Y&>, T>,
+                "The operands must have the element type of the output");
+  if (detail::simd_indexed(
+        out,
+        [](T& o, T ea, T eb, T ex, T ey) {
+          o = detail::scalar_compare<Cmp>(ea, eb) ? ex : ey;
+        },
+        a,
+        b,
+        x,
+        y))
+    return;
+  const auto sa = detail::simd_elements(a);
+  const auto sb = detail::simd_elements(b);
+  const auto sx = detail::simd_elements(x);
+  const auto sy = detail::simd_elements(y);
+  const auto so = detail::simd_elements(out);
+  EXPECTS(sa.size() == so.size() && sb.size() == so.size() &&
+          sx.size() == so.size() && sy.size() == so.size());
+
+  detail::simd_dispatch(isa, [&](auto kernels) {
+    kernels.template select<Cmp>(
+      sa.data(), sb.data(), sx.data(), sy.data(), so.data(), so.size());
+  });
+}
+
+///@brief out = To(in), float <-> std::int32_t and float <-> double are
+/// vectorized. Floating point values converted to integers are truncated and
+/// must be representable.
+template<class In, class Out>
+void
+cast(const In& in, Out&& out, simd_isa isa = active_simd_isa())
+{
+  using From = detail::simd_element_t<const In&>;
+  using To = detail::simd_element_t<Out>;
+  if (detail::simd_indexed(out, [](To& o, From x) { o = To(x); }, in))
+    return;
+  const auto si = detail::simd_elements(in);
+  const auto so = detail::simd_elements(out);
+  EXPECTS(si.size() == so.size());
+
+  detail::simd_dispatch(isa, [&](auto kernels) {
+    kernels.template cast<From, To>(si.data(), so.data(), so.size());
+  });
+}
+
+} // namespace simd
+
+} // namespace nanda
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // NANDA_SIMD_HEADER
@@ -0,0 +1,611 @@
+#ifndef NANDA_SPACE_FILLING_HEADER
+#define NANDA_SPACE_FILLING_HEADER
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+#include "extents.hh"
+#include "index_algos.hh"
+#include "utility.hh"
+
+namespace nanda {
+
+namespace detail {
+
+///@brief Scatters the low bits of 'x' to the set bits of 'mask', the
+/// semantics of the BMI2 pdep instruction
+constexpr std::uint64_t
+pdep_portable(std::uint64_t x, std::uint64_t mask) noexcept
+{
+  std::uint64_t out = 0;
+  for (std::uint64_t bit = 1; mask != 0; bit += bit) {
+    if (x & bit)
+      out |= mask & (~mask + 1);
+    mask &= mask - 1;
+  }
+  return out;
+}
+
+///@brief Gathers the bits of 'x' selected by 'mask' into the low bits, the
+/// semantics of the BMI2 pext instruction
+constexpr std::uint64_t
+pext_portable(std::uint64_t x, std::uint64_t mask) noexcept
+{
+  std::uint64_t out = 0;
+  for (std::uint64_t bit = 1; mask != 0; bit += bit) {
+    if (x & mask & (~mask + 1))
+      out |= bit;
+    mask &= mask - 1;
+  }
+  return out;
+}
+
+///@brief pdep, a single instruction when compiling for BMI2 (-mbmi2,
+/// -march=haswell and later). Note that AMD CPUs before Zen 3 implement it in
+/// microcode and are faster with the portable fallback.
+constexpr std::uint64_t
+pdep(std::uint64_t x, std::uint64_t mask) noexcept
+{
+#if defined(__BMI2__)
+  if (!__builtin_is_constant_evaluated())
+    return _pdep_u64(x, mask);
+#endif
+  return pdep_portable(x, mask);
+}
+
+///@brief pext, see pdep
+constexpr std::uint64_t
+pext(std::uint64_t x, std::uint64_t mask) noexcept
+{
+#if defined(__BMI2__)
+  if (!__builtin_is_constant_evaluated())
+    return _pext_u64(x, mask);
+#endif
+  return pext_portable(x, mask);
+}
+
+///@brief Inserts N - 1 zero bits after each of the low 64 / N bits of 'x' with
+/// the usual magic number sequences, a few shifts and masks
+template<std::size_t N>
+constexpr std::uint64_t
+spread_bits(std::uint64_t x) noexcept
+{
+  static_assert(N == 2 || N == 3, "Magic numbers for ranks 2 and 3 only");
+  if constexpr (N == 2) {
+    x &= 0x00000000ffffffff;
+    x = (x | (x << 16)) & 0x0000ffff0000ffff;
+    x = (x | (x << 8)) & 0x00ff00ff00ff00ff;
+    x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0f;
+    x = (x | (x << 2)) & 0x3333333333333333;
+    x = (x | (x << 1)) & 0x5555555555555555;
+  } else {
+    x &= 0x00000000001fffff;
+    x = (x | (x << 32)) & 0x001f00000000ffff;
+    x = (x | (x << 16)) & 0x001f0000ff0000ff;
+    x = (x | (x << 8)) & 0x100f00f00f00f00f;
+    x = (x | (x << 4)) & 0x10c30c30c30c30c3;
+    x = (x | (x << 2)) & 0x1249249249249249;
+  }
+  return x;
+}
+
+///@brief Inverse of spread_bits
+template<std::size_t N>
+constexpr std::uint64_t
+compact_bits(std::uint64_t x) noexcept
+{
+  static_assert(N == 2 || N == 3, "Magic numbers for ranks 2 and 3 only");
+  if constexpr (N == 2) {
+    x &= 0x5555555555555555;
+    x = (x | (x >> 1)) & 0x3333333333333333;
+    x = (x | (x >> 2)) & 0x0f0f0f0f0f0f0f0f;
+    x = (x | (x >> 4)) & 0x00ff00ff00ff00ff;
+    x = (x | (x >> 8)) & 0x0000ffff0000ffff;
+    x = (x | (x >> 16)) & 0x00000000ffffffff;
+  } else {
+    x &= 0x1249249249249249;
+    x = (x | (x >> 2)) & 0x10c30c30c30c30c3;
+    x = (x | (x >> 4)) & 0x100f00f00f00f00f;
+    x = (x | (x >> 8)) & 0x001f0000ff0000ff;
+    x = (x | (x >> 16)) & 0x001f00000000ffff;
+    x = (x | (x >> 32)) & 0x00000000001fffff;
+  }
+  return x;
+}
+
+///@brief Bits of direction r in an N dimensional Morton code with equal bits
+/// per direction, the last direction owns the lowest bit
+template<std::size_t N>
+constexpr std::uint64_t
+morton_mask(std::size_t r) noexcept
+{
+  std::uint64_t mask = 0;
+  for (std::size_t pos = N - 1 - r; pos < 64 / N * N; pos += N)
+    mask |= std::uint64_t(1) << pos;
+  return mask;
+}
+
+///@brief Number of bits needed for the indices [0, n)
+constexpr int
+ceil_log2(std::uint64_t n) noexcept
+{
+  int log = 0;
+  while ((std::uint64_t(1) << log) < n)
+    ++log;
+  return log;
+}
+
+} // namespace detail
+
+///@brief Morton (Z-order) code of the index 'idx': the bits of the indices are
+/// interleaved, the last index taking the lowest bit. Each index may use up to
+/// 64 / N bits.
+template<std::size_t N, class T>
+constexpr std::uint64_t
+morton_encode(const std::array<T, N>& idx) noexcept
+{
+  std::uint64_t code = 0;
+  for (std::size_t r = 0; r < N; ++r) {
+    if constexpr (N == 2 || N == 3)
+      code |= detail::spread_bits<N>(std::uint64_t(idx[r])) << (N - 1 - r);
+    else
+      code |= detail::pdep(std::uint64_t(idx[r]), detail::morton_mask<N>(r));
+  }
+  return code;
+}
+
+///@brief The index of the Morton code 'code', inverse of morton_encode
+template<std::size_t N, class IndexType = index_type>
+constexpr std::array<IndexType, N>
+morton_decode(std::uint64_t code) noexcept
+{
+  std::array<IndexType, N> idx{};
+  for (std::size_t r = 0; r < N; ++r) {
+    if constexpr (N == 2 || N == 3)
+      idx[r] = IndexType(detail::compact_bits<N>(code >> (N - 1 - r)));
+    else
+      idx[r] = IndexType(detail::pext(code, detail::morton_mask<N>(r)));
+  }
+  return idx;
+}
+
+///@brief Position of the index 'idx' along the N dimensional Hilbert curve
+/// through the cube [0, 2^bits)^N. Consecutive positions are always direct
+/// neighbours, unlike for the Morton order. Uses the transform of J. Skilling,
+/// "Programming the Hilbert curve" (2004).
+template<std::size_t N, class T>
+constexpr std::uint64_t
+hilbert_encode(const std::array<T, N>& idx, int bits) noexcept
+{
+  EXPECTS(bits >= 0 && std::size_t(bits) * N <= 64);
+
+  std::array<std::uint64_t, N> x{};
+  for (std::size_t r = 0; r < N; ++r)
+    x[r] = std::uint64_t(idx[r]);
+  if (bits == 0)
+    return 0;
+
+  // inverse undo
+  const std::uint64_t m = std::uint64_t(1) << (bits - 1);
+  for (std::uint64_t q = m; q > 1; q >>= 1) {
+    const std::uint64_t p = q - 1;
+    for (std::size_t r = 0; r < N; ++r) {
+      if (x[r] & q) {
+        x[0] ^= p;
+      } else {
+        const std::uint64_t t = (x[0] ^ x[r]) & p;
+        x[0] ^= t;
+        x[r] ^= t;
+      }
+    }
+  }
+
+  // Gray encode
+  for (std::size_t r = 1; r < N; ++r)
+    x[r] ^= x[r - 1];
+  std::uint64_t t = 0;
+  for (std::uint64_t q = m; q > 1; q >>= 1)
+    if (x[N - 1] & q)
+      t ^= q - 1;
+  for (std::size_t r = 0; r < N; ++r)
+    x[r] ^= t;
+
+  // the transposed form interleaves to the position, the first direction
+  // taking the highest bit of each level like in morton_encode
+  std::uint64_t code = 0;
+  for (int b = bits; b-- > 0;)
+    for (std::size_t r = 0; r < N; ++r)
+      code = (code << 1) | ((x[r] >> b) & 1);
+  return code;
+}
+
+///@brief The index at position 'code' of the Hilbert curve through the cube
+/// [0, 2^bits)^N, inverse of hilbert_encode
+template<std::size_t N, class IndexType = index_type>
+constexpr std::array<IndexType, N>
+hilbert_decode(std::uint64_t code, int bits) noexcept
+{
+  EXPECTS(bits >= 0 && std::size_t(bits) * N <= 64);
+
+  std::array<std::uint64_t, N> x{};
+  for (int b = bits; b-- > 0;)
+    for (std::size_t r = 0; r < N; ++r)
+      x[r] |= ((code >> (std::size_t(b) * N + (N - 1 - r))) & 1) << b;
+
+  std::array<IndexType, N> idx{};
+  if (bits == 0)
+    return idx;
+
+  // Gray decode
+  const std::uint64_t t = x[N - 1] >> 1;
+  for (std::size_t r = N - 1; r > 0; --r)
+    x[r] ^= x[r - 1];
+  x[0] ^= t;
+
+  // undo excess work
+  const std::uint64_t end = std::uint64_t(2) << (bits - 1);
+  for (std::uint64_t q = 2; q != end; q <<= 1) {
+    const std::uint64_t p = q - 1;
+    for (std::size_t r = N; r-- > 0;) {
+      if (x[r] & q) {
+        x[0] ^= p;
+      } else {
+        const std::uint64_t s = (x[0] ^ x[r]) & p;
+        x[0] ^= s;
+        x[r] ^= s;
+      }
+    }
+  }
+
+  for (std::size_t r = 0; r < N; ++r)
+    idx[r] = IndexType(x[r]);
+  return idx;
+}
+
+///@brief Morton (Z-order) layout: the offset of an index is its Morton code,
+/// so neighbours in every direction are close in memory at every scale.
+///
+/// Every extent is padded to the next power of two. Directions with fewer bits
+/// drop out of the interleaving once their bits are used up (e.g. a 4x16 box
+/// interleaves two levels and keeps two plain levels of the last direction),
+/// so the padding never exceeds a factor of two per direction.
+struct layout_morton
+{
+  template<class Extents>
+  class mapping;
+};
+
+///@brief Hilbert layout: the offset of an index is its position along the
+/// Hilbert curve, consecutive offsets are always direct neighbours. The index
+/// space is padded to a cube whose extent is the next power of two of the
+/// largest extent.
+struct layout_hilbert
+{
+  template<class Extents>
+  class mapping;
+};
+
+namespace detail {
+
+///@brief Common part of the space-filling curve mappings, which are unique
+/// but neither strided nor, for non power of two extents, exhaustive
+template<class Layout, class Extents>
+class curve_mapping_base
+{
+  static_assert(is_extents_v<Extents>,
+                "A layout mapping needs nanda::extents as its index space");
+
+public:
+  using extents_type = Extents;
+  using index_type = typename Extents::index_type;
+  using size_type = typename Extents::size_type;
+  using rank_type = typename Extents::rank_type;
+  using layout_type = Layout;
+  using index_array = std::array<index_type, Extents::rank()>;
+
+  static constexpr rank_type rank() noexcept { return Extents::rank(); }
+
+  constexpr const extents_type& extents() const noexcept { return extents_; }
+
+  static constexpr bool is_always_unique() noexcept { return true; }
+  static constexpr bool is_always_exhaustive() noexcept { return false; }
+  static constexpr bool is_always_strided() noexcept { return false; }
+  static constexpr bool is_always_contiguous() noexcept { return false; }
+
+  static constexpr bool is_unique() noexcept { return true; }
+  static constexpr bool is_strided() noexcept { return false; }
+
+  friend constexpr bool operator==(const curve_mapping_base& lhs,
+                                   const curve_mapping_base& rhs) noexcept
+  {
+    return lhs.extents_ == rhs.extents_;
+  }
+
+  friend constexpr bool operator!=(const curve_mapping_base& lhs,
+                                   const curve_mapping_base& rhs) noexcept
+  {
+    return !(lhs == rhs);
+  }
+
+protected:
+  constexpr curve_mapping_base(const extents_type& ext) noexcept
+    : extents_{ ext }
+  {}
+
+  ///@brief Debug builds throw if the padded extents overflow index_type or
+  /// the 64 bit curve position
+  static constexpr void check_padded_bits(const index_array& bits)
+  {
+    std::array<std::uint64_t, rank()> padded{};
+    int total = 0;
+    for (rank_type r = 0; r < rank(); ++r) {
+      runtime_assert(bits[r] < 64, "Extent too large for a 64 bit curve");
+      padded[r] = std::uint64_t(1) << bits[r];
+      total += bits[r];
+    }
+    runtime_assert(total < 64, "Extents too large for a 64 bit curve");
+    check_index_range<index_type>(padded);
+  }
+
+  extents_type extents_;
+};
+
+} // namespace detail
+
+template<class Extents>
+class layout_morton::mapping
+  : public detail::curve_mapping_base<layout_morton, Extents>
+{
+  using base_type = detail::curve_mapping_base<layout_morton, Extents>;
+  static constexpr std::size_t N = Extents::rank();
+
+public:
+  using typename base_type::extents_type;
+  using typename base_type::index_array;
+  using typename base_type::index_type;
+  using typename base_type::rank_type;
+
+  constexpr mapping()
+    : mapping(extents_type{})
+  {}
+
+  ///@brief Debug builds throw if the padded extents overflow index_type
+  constexpr mapping(const extents_type& ext)
+    : base_type{ ext }
+  {
+    int max_bits = 0;
+    for (rank_type r = 0; r < N; ++r) {
+      bits_[r] = detail::ceil_log2(std::uint64_t(ext.extent(r)));
+      max_bits = std::max(max_bits, int(bits_[r]));
+    }
+    base_type::check_padded_bits(bits_);
+
+    // level by level from the lowest bit, the last direction first, skipping
+    // directions whose bits are used up
+    int pos = 0;
+    for (int level = 0; level < max_bits; ++level)
+      for (rank_type r = N; r-- > 0;)
+        if (level < bits_[r])
+          masks_[r] |= std::uint64_t(1) << pos++;
+
+    regular_ = true;
+    for (rank_type r = 0; r < N; ++r)
+      regular_ = regular_ && bits_[r] == max_bits;
+  }
+
+  ///@brief Bits of the Morton code owned by direction r
+  constexpr std::uint64_t mask(rank_type r) const noexcept
+  {
+    return masks_[r];
+  }
+
+  ///@brief Number of elements including the padding to powers of two
+  constexpr index_type required_span_size() const noexcept
+  {
+    int total = 0;
+    for (rank_type r = 0; r < N; ++r)
+      total += bits_[r];
+    return index_type(1) << total;
+  }
+
+  constexpr bool is_exhaustive() const noexcept
+  {
+    return required_span_size() == index_type(this->extents_.size());
+  }
+  constexpr bool is_contiguous() const noexcept { return is_exhaustive(); }
+
+  template<class... Idx,
+           REQUIRES(sizeof...(Idx) == N &&
+                    std::conjunction_v<std::is_integral<Idx>...>)>
+  constexpr index_type operator()(Idx... idx) const noexcept
+  {
+    return (*this)(index_array{ index_type(idx)... });
+  }
+
+  ///@brief The offset of 'idx', the Morton counterpart of flatten
+  constexpr index_type operator()(const index_array& idx) const noexcept
+  {
+    std::uint64_t code = 0;
+    for (rank_type r = 0; r < N; ++r)
+      code |= deposit(std::uint64_t(idx[r]), r);
+    return index_type(code);
+  }
+
+  ///@brief The index stored at 'offset', the Morton counterpart of unflatten.
+  /// Offsets into the padding map onto indices beyond the extents.
+  constexpr index_array unflatten(index_type offset) const noexcept
+  {
+    index_array idx{};
+    for (rank_type r = 0; r < N; ++r)
+      idx[r] = index_type(extract(std::uint64_t(offset), r));
+    return idx;
+  }
+
+  ///@brief The offset of the index 'delta' steps away from the one at
+  /// 'offset' in direction r, computed on the code directly by a carry through
+  /// the bits of direction r. The neighbour must lie within the padded extent.
+  constexpr index_type step(index_type offset,
+                            rank_type r,
+                            index_type delta) const noexcept
+  {
+    const std::uint64_t mask = masks_[r];
+    const auto code = std::uint64_t(offset);
+
+    // moving up the bits of the other directions are set so the carry runs
+    // through them, moving down they are cleared so the borrow does. The sign
+    // is turned into masks arithmetically, the compiler otherwise branches on
+    // it and the direction of random steps is unpredictable.
+    const auto down = std::uint64_t(std::int64_t(delta) >> 63);
+    const std::uint64_t magnitude = (std::uint64_t(delta) ^ down) - down;
+    const std::uint64_t dilated =
+      magnitude == 1 ? mask & (~mask + 1) : deposit(magnitude, r);
+    const std::uint64_t signed_dilated = (dilated ^ down) - down;
+
+    const std::uint64_t moved =
+      (((code & mask) | (~mask & ~down)) + signed_dilated) & mask;
+    return index_type(moved | (code & ~mask));
+  }
+
+  ///@brief step(offset, r, 1)
+  constexpr index_type next(index_type offset, rank_type r) const noexcept
+  {
+    return step(offset, r, 1);
+  }
+
+  ///@brief step(offset, r, -1)
+  constexpr index_type prev(index_type offset, rank_type r) const noexcept
+  {
+    return step(offset, r, -1);
+  }
+
+private:
+  constexpr std::uint64_t deposit(std::uint64_t x, rank_type r) const noexcept
+  {
+#if !defined(__BMI2__)
+    if constexpr (N == 2 || N == 3)
+      if (regular_)
+        return detail::spread_bits<N>(x) << (N - 1 - r);
+#endif
+    return detail::pdep(x, masks_[r]);
+  }
+
+  constexpr std::uint64_t extract(std::uint64_t code,
+                                  rank_type r) const noexcept
+  {
+#if !defined(__BMI2__)
+    if constexpr (N == 2 || N == 3)
+      if (regular_)
+        return detail::compact_bits<N>(code >> (N - 1 - r));
+#endif
+    return detail::pext(code, masks_[r]);
+  }
+
+  index_array bits_{};
+  std::array<std::uint64_t, N> masks_{};
+  bool regular_ = true;
+};
+
+template<class Extents>
+class layout_hilbert::mapping
+  : public detail::curve_mapping_base<layout_hilbert, Extents>
+{
+  using base_type = detail::curve_mapping_base<layout_hilbert, Extents>;
+  static constexpr std::size_t N = Extents::rank();
+
+public:
+  using typename base_type::extents_type;
+  using typename base_type::index_array;
+  using typename base_type::index_type;
+  using typename base_type::rank_type;
+
+  constexpr mapping()
+    : mapping(extents_type{})
+  {}
+
+  ///@brief Debug builds throw if the padded cube overflows index_type
+  constexpr mapping(const extents_type& ext)
+    : base_type{ ext }
+  {
+    for (rank_type r = 0; r < N; ++r)
+      bits_ = std::max(bits_, detail::ceil_log2(std::uint64_t(ext.extent(r))));
+    index_array bits{};
+    for (rank_type r = 0; r < N; ++r)
+      bits[r] = index_type(bits_);
+    base_type::check_padded_bits(bits);
+  }
+
+  ///@brief The cube has an extent of 2^bits() in every direction
+  constexpr int bits() const noexcept { return bits_; }
+
+  ///@brief Number of elements of the padded cube
+  constexpr index_type required_span_size() const noexcept
+  {
+    return index_type(1) << (std::size_t(bits_) * N);
+  }
+
+  constexpr bool is_exhaustive() const noexcept
+  {
+    return required_span_size() == index_type(this->extents_.size());
+  }
+  constexpr bool is_contiguous() const noexcept { return is_exhaustive(); }
+
+  template<class... Idx,
+           REQUIRES(sizeof...(Idx) == N &&
+                    std::conjunction_v<std::is_integral<Idx>...>)>
+  constexpr index_type operator()(Idx... idx) const noexcept
+  {
+    return (*this)(index_array{ index_type(idx)... });
+  }
+
+  ///@brief The offset of 'idx', the Hilbert counterpart of flatten
+  constexpr index_type operator()(const index_array& idx) const noexcept
+  {
+    return index_type(hilbert_encode(idx, bits_));
+  }
+
+  ///@brief The index stored at 'offset', the Hilbert counterpart of
+  /// unflatten. Offsets into the padding map onto indices beyond the extents.
+  constexpr index_array unflatten(index_type offset) const noexcept
+  {
+    return hilbert_decode<N, index_type>(std::uint64_t(offset), bits_);
+  }
+
+  ///@brief The offset of the index 'delta' steps away from the one at
+  /// 'offset' in direction r. The curve has no carry rule like the Morton
+  /// order, the index is decoded, moved and encoded again. The neighbour must
+  /// lie within the padded cube.
+  constexpr index_type step(index_type offset,
+                            rank_type r,
+                            index_type delta) const noexcept
+  {
+    auto idx = unflatten(offset);
+    idx[r] += delta;
+    return (*this)(idx);
+  }
+
+  ///@brief step(offset, r, 1)
+  constexpr index_type next(index_type offset, rank_type r) const noexcept
+  {
+    return step(offset, r, 1);
+  }
+
+  ///@brief step(offset, r, -1)
+  constexpr index_type prev(index_type offset, rank_type r) const noexcept
+  {
+    return step(offset, r, -1);
+  }
+
+private:
+  int bits_ = 0;
+};
+
+} // namespace nanda
+
+#endif // NANDA_SPACE_FILLING_HEADER
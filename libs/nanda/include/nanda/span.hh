@@ -1,6 +1,7 @@
 #ifndef NANDA_SPAN2_HEADER
 #define NANDA_SPAN2_HEADER
 
+#include <algorithm>   // for std::equal, etc.
 #include <array>       // for std::array, etc.
 #include <cassert>     // for assert
 #include <cstddef>     // for std::size_t, etc.
@@ -16,12 +17,7 @@ namespace nanda {
 // constants
 
 namespace detail {
-using span_index_t = std::ptrdiff_t;
-}
-
-constexpr detail::span_index_t dynamic_extent = -1;
-
-namespace detail {
+using span_index_t = std::size_t;
 template<class To,
          class From,
          REQUIRES(std::is_integral_v<To>&& std::is_integral_v<From>)>
@@ -44,11 +40,14 @@ byte_size(span_index_t n) noexcept
 template<span_index_t N>
 struct span_extent
 {
-  constexpr span_extent(span_index_t size) noexcept
+  constexpr span_extent() noexcept = default;
+  constexpr span_extent([[maybe_unused]] span_index_t size) noexcept
     // this constructor does nothing, the delegation exists only
     // to provide a place for the contract check expression.
     : span_extent{}
-  {}
+  {
+    EXPECTS(size == N);
+  }
 
   constexpr span_index_t size() const noexcept { return N; }
 };
@@ -78,7 +77,7 @@ subspan_extent(span_index_t Extent,
 
 // class template span
 
-template<class T, std::size_t N = detail::dynamic_extent>
+template<class T, std::size_t N = dynamic_extent>
 class span;
 
 // namespace detail {
@@ -156,14 +155,7 @@ class span;
 //                        is_compatible_element<C, E>::value>
 // {};
 
-} // namespace nanda
-
-namespace concepts {} // namespace concepts
-
-#define span_REQUIRES_0(VA)                                                    \
-  template<bool B = (VA), typename std::enable_if<B, int>::type = 0>
-
-template<class T, detail::span_index_t N>
+template<class T, std::size_t N>
 class span : detail::span_extent<N>
 {
 public:
@@ -171,12 +163,17 @@ public:
   using element_type = T;
   using value_type = std::remove_cv_t<T>;
   using index_type = detail::span_index_t;
-  using difference_type = index_type;
+  using size_type = index_type;
+  using difference_type = std::ptrdiff_t;
   using pointer = T*;
+  using const_pointer = const T*;
   using reference = T&;
+  using const_reference = const T&;
   using iterator = T*;
+  using const_iterator = const T*;
   using reverse_iterator =
     std::reverse_iterator<iterator>; // ranges::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
   static constexpr index_type extent = N;
 
@@ -191,7 +188,16 @@ public:
   template<class = void> // Artificially templatize so that the other
                          // constructor is preferred for {ptr, 0}
   constexpr span(pointer first, pointer last) noexcept
-    : span{ first, last - first }
+    : span{ first, detail::narrow_cast<index_type>(last - first) }
+  {}
+
+  template<class It,
+           REQUIRES(!std::is_convertible_v<It, pointer>),
+           REQUIRES(std::is_convertible_v<decltype(nanda::to_address(
+                                            std::declval<const It&>())),
+                                          pointer>)>
+  constexpr span(It first, index_type cnt) noexcept
+    : span{ nanda::to_address(first), cnt }
   {}
 
   template<class Rng,
@@ -210,24 +216,26 @@ public:
     : span{ std::data(rng), N }
   {}
 
-  template<index_t Cnt>
+  template<index_type Cnt>
   constexpr span<T, Cnt> first() const noexcept
   {
+    static_assert(
+      N == dynamic_extent || Cnt <= N,
+      "Count of elements to extract must be less than the static span extent.");
     EXPECTS(Cnt <= size());
     return { data_, Cnt };
   }
 
-  constexpr span<T, Cnt> first(index_type cnt) const noexcept
+  constexpr span<T> first(index_type cnt) const noexcept
   {
-    EXPECTS(cnt >= 0 && cnt <= size());
+    EXPECTS(cnt <= size());
     EXPECTS(cnt == 0 || data_ != nullptr);
     return span<T>{ data_, cnt };
   }
 
-  template<index_t Cnt>
+  template<index_type Cnt>
   constexpr span<T, Cnt> last() const noexcept
   {
-    static_assert(Cnt >= 0, "Count of elements to extract cannot be negative.");
     static_assert(
       N == dynamic_extent || Cnt <= N,
       "Count of elements to extract must be less than the static span extent.");
@@ -238,7 +246,7 @@ public:
   }
   constexpr span<T> last(index_type cnt) const noexcept
   {
-    return EXPECTS(cnt >= 0 && cnt <= size()),
+    return EXPECTS(cnt <= size()),
            EXPECTS((cnt == 0 && size() == 0) || data_ != nullptr),
            span<T>{ data_ + size() - cnt, cnt };
   }
@@ -247,10 +255,6 @@ public:
   constexpr span<T, detail::subspan_extent(N, Offset, Count)> subspan()
     const noexcept
   {
-    static_assert(Offset >= 0,
-                  "Offset of first element to extract cannot be negative.");
-    static_assert(Count >= dynamic_extent,
-                  "Count of elements to extract cannot be negative.");
     static_assert(
       N == dynamic_extent ||
         N >= Offset + (Count == dynamic_extent ? 0 : Count),
@@ -262,38 +266,33 @@ public:
            };
   }
   template<index_type Offset>
-  constexpr span<T, (N >= Offset ? N - Offset : dynamic_extent)> subspan()
-    const noexcept
+  constexpr auto subspan() const noexcept
   {
-    static_assert(Offset >= 0,
-                  "Offset of first element to extract cannot be negative.");
     static_assert(
       N == dynamic_extent || N >= Offset,
       "Offset of first element to extract must be within the static "
       "span extent.");
+    using result_t =
+      span<T, (N == dynamic_extent ? dynamic_extent : N - Offset)>;
     return EXPECTS(size() >= Offset),
-           EXPECTS((Offset == 0 && size() == 0) || data_ != nullptr), span < T,
-           N >= Offset ? N - Offset
-                       : dynamic_extent > { data_ + Offset, size() - Offset };
+           EXPECTS((Offset == 0 && size() == 0) || data_ != nullptr),
+           result_t{ data_ + Offset, size() - Offset };
   }
   constexpr span<T, dynamic_extent> subspan(index_type offset) const noexcept
   {
-    return EXPECTS(offset >= 0), EXPECTS(size() >= offset),
+    return EXPECTS(size() >= offset),
            EXPECTS((offset == 0 && size() == 0) || data_ != nullptr),
            span<T, dynamic_extent>{ data_ + offset, size() - offset };
   }
   constexpr span<T, dynamic_extent> subspan(index_type offset,
                                             index_type cnt) const noexcept
   {
-    return EXPECTS(offset >= 0), EXPECTS(cnt >= 0),
-           EXPECTS(size() >= offset + cnt),
+    return EXPECTS(size() >= offset + cnt),
            EXPECTS((offset == 0 && cnt == 0) || data_ != nullptr),
            span<T, dynamic_extent>{ data_ + offset, cnt };
   }
 
   // observers
-  constexpr pointer data() const noexcept { return data_; }
-
   using detail::span_extent<N>::size;
   constexpr index_type size_bytes() const noexcept
   {
@@ -346,49 +345,62 @@ public:
 
   constexpr const_reverse_iterator crbegin() const noexcept
   {
-    return reverse_iterator{ cend() };
+    return const_reverse_iterator{ cend() };
   }
 
   constexpr const_reverse_iterator crend() const noexcept
   {
-    return reverse_iterator{ cbegin() };
+    return const_reverse_iterator{ cbegin() };
   }
 
   friend constexpr iterator begin(span s) noexcept { return s.begin(); }
 
   friend constexpr iterator end(span s) noexcept { return s.end(); }
 
-  template<class U, index_type M, REQUIRES(equality_comparable_with<T, U>)>
+  template<class U,
+           std::size_t M,
+           REQUIRES(CONCEPT(concepts::equality_comparable_with<T, U>))>
   bool operator==(span<U, M> const& that) const
   {
-    RANGES_EXPECT(!size() || data());
-    RANGES_EXPECT(!that.size() || that.data());
-    return ranges::equal(*this, that);
+    EXPECTS(!size() || data());
+    EXPECTS(!that.size() || that.data());
+    return std::equal(begin(), end(), that.begin(), that.end());
   }
-  template<class U, index_type M, REQUIRES(equality_comparable_with<T, U>)>
+  template<class U,
+           std::size_t M,
+           REQUIRES(CONCEPT(concepts::equality_comparable_with<T, U>))>
   bool operator!=(span<U, M> const& that) const
   {
     return !(*this == that);
   }
 
-  template<class U, index_type M, REQUIRES(totally_ordered_with<T, U>)>
+  template<class U,
+           std::size_t M,
+           REQUIRES(CONCEPT(concepts::totally_ordered_with<T, U>))>
   bool operator<(span<U, M> const& that) const
   {
-    RANGES_EXPECT(!size() || data());
-    RANGES_EXPECT(!that.size() || that.data());
-    return ranges::lexicographical_compare(*this, that);
+    EXPECTS(!size() || data());
+    EXPECTS(!that.size() || that.data());
+    return std::lexicographical_compare(
+      begin(), end(), that.begin(), that.end());
   }
-  template<class U, index_type M, REQUIRES(totally_ordered_with<T, U>)>
+  template<class U,
+           std::size_t M,
+           REQUIRES(CONCEPT(concepts::totally_ordered_with<T, U>))>
   bool operator>(span<U, M> const& that) const
   {
     return that < *this;
   }
-  template<class U, index_type M, REQUIRES(totally_ordered_with<T, U>)>
+  template<class U,
+           std::size_t M,
+           REQUIRES(CONCEPT(concepts::totally_ordered_with<T, U>))>
   bool operator<=(span<U, M> const& that) const
   {
     return !(that < *this);
   }
-  template<class U, index_type M, REQUIRES(totally_ordered_with<T, U>)>
+  template<class U,
+           std::size_t M,
+           REQUIRES(CONCEPT(concepts::totally_ordered_with<T, U>))>
   bool operator>=(span<U, M> const& that) const
   {
     return !(*this < that);
@@ -398,20 +410,30 @@ private:
   T* data_ = nullptr;
 };
 
-} // namespace nanda
+template<class T, std::size_t N>
+constexpr typename span<T, N>::index_type span<T, N>::extent;
+
+template<class T, std::size_t N>
+span(T (&)[N]) -> span<T, N>;
+
+template<class T, std::size_t N>
+span(std::array<T, N>&) -> span<T, N>;
+
+template<class T, std::size_t N>
+span(const std::array<T, N>&) -> span<const T, N>;
 
-template<class T, detail::span_index_t N>
-RANGES_INLINE_VAR constexpr bool enable_borrowed_range<span<T, N>> = true;
+template<class Rng,
+         REQUIRES(CONCEPT(concepts::has_size_and_data<Rng>) &&
+                  !std::is_array_v<std::remove_reference_t<Rng>>)>
+span(Rng&& rng) -> span<concepts::detail::element_t<Rng>>;
 
-template<class T, detail::span_index_t N>
-constexpr detail::span_index_t span<T, N>::extent;
+namespace concepts {
+template<class T, std::size_t N>
+struct static_extent_of<span<T, N>> : std::integral_constant<std::size_t, N>
+{};
+} // namespace concepts
 
-template<class Rng, REQUIRES(CONCEPT(concepts::contiguous_range<Rng>))>
-span(Rng&& rng) -> span<
-  detail::element_t<Rng>,
-  (range_cardinality<Rng>::value < cardinality()
-     ? dynamic_extent
-     : static_cast<detail::span_index_t>(range_cardinality<Rng>::value))>;
+} // namespace nanda
 
 namespace std {
 
@@ -443,4 +465,4 @@ get(nanda::span<T, N> s) noexcept
 
 } // namespace std
 
-#endif
\ No newline at end of file
+#endif
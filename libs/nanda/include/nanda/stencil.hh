@@ -0,0 +1,625 @@
+#ifndef NANDA_STENCIL_HEADER
+#define NANDA_STENCIL_HEADER
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "extents.hh"
+#include "index_types.hh"
+#include "layouts.hh"
+#include "ndarray.hh"
+#include "ndspan.hh"
+#include "thread_pool.hh"
+#include "utility.hh"
+
+namespace nanda {
+
+///@brief One point of a neighbourhood, its offset from the centre along
+/// every axis
+template<int... Offsets>
+struct offset
+{
+  static constexpr std::array<int, sizeof...(Offsets)> value{ Offsets... };
+};
+
+namespace detail {
+
+template<std::size_t N, std::size_t K>
+constexpr int
+shape_radius(const std::array<std::array<int, N>, K>& offsets) noexcept
+{
+  int radius = 0;
+  for (const auto& point : offsets)
+    for (auto d : point)
+      radius = std::max(radius, d < 0 ? -d : d);
+  return radius;
+}
+
+///@brief The centre, then the points at -r and +r along each axis in turn
+template<std::size_t N, int R>
+constexpr auto
+star_offsets() noexcept
+{
+  std::array<std::array<int, N>, 2 * N * R + 1> offsets{};
+  std::size_t k = 1;
+  for (std::size_t d = 0; d < N; ++d)
+    for (int r = 1; r <= R; ++r) {
+      offsets[k++][d] = -r;
+      offsets[k++][d] = r;
+    }
+  return offsets;
+}
+
+constexpr std::size_t
+power(std::size_t base, std::size_t exponent) noexcept
+{
+  std::size_t p = 1;
+  while (exponent-- > 0)
+    p *= base;
+  return p;
+}
+
+///@brief Every point of [-R, R]^N in row-major order
+template<std::size_t N, int R>
+constexpr auto
+box_offsets() noexcept
+{
+  std::array<std::array<int, N>, power(2 * R + 1, N)> offsets{};
+  for (std::size_t k = 0; k < offsets.size(); ++k) {
+    std::size_t rest = k;
+    for (std::size_t d = N; d-- > 0;) {
+      offsets[k][d] = int(rest % (2 * R + 1)) - R;
+      rest /= 2 * R + 1;
+    }
+  }
+  return offsets;
+}
+
+} // namespace detail
+
+///@brief A neighbourhood listed point by point, as nanda::offset types. Like
+/// star_stencil and box_stencil, it describes the points a stencil reads
+/// with its rank, its number of points, their offsets and the radius, the
+/// largest offset along any axis, which is the width of the halo.
+template<class First, class... Rest>
+struct stencil_shape
+{
+  static constexpr std::size_t rank = First::value.size();
+  static constexpr std::size_t size = 1 + sizeof...(Rest);
+  static constexpr std::array<std::array<int, rank>, size> offsets{
+    First::value,
+    Rest::value...
+  };
+  static constexpr int radius = detail::shape_radius(offsets);
+
+  static_assert(((Rest::value.size() == rank) && ...),
+                "The points of a neighbourhood have the same rank");
+};
+
+///@brief The centre and the points up to R away along each axis, 2 N R + 1
+/// points: the 5-point (N = 2) and 7-point (N = 3) stencils for R = 1
+template<std::size_t N, int R = 1>
+struct star_stencil
+{
+  static_assert(N > 0 && R >= 0, "A star stencil needs axes");
+
+  static constexpr std::size_t rank = N;
+  static constexpr std::size_t size = 2 * N * R + 1;
+  static constexpr auto offsets = detail::star_offsets<N, R>();
+  static constexpr int radius = R;
+};
+
+///@brief Every point up to R away along all axes, (2 R + 1)^N points: the
+/// 9-point (N = 2) and 27-point (N = 3) stencils for R = 1
+template<std::size_t N, int R = 1>
+struct box_stencil
+{
+  static_assert(N > 0 && R >= 0, "A box stencil needs axes");
+
+  static constexpr std::size_t rank = N;
+  static constexpr std::size_t size = detail::power(2 * R + 1, N);
+  static constexpr auto offsets = detail::box_offsets<N, R>();
+  static constexpr int radius = R;
+};
+
+///@brief What lies outside the grid
+enum class boundary
+{
+  ///@brief The grid wraps around along every axis
+  periodic,
+  ///@brief The value of the nearest point of the grid
+  clamp,
+  ///@brief A fixed value
+  constant
+};
+
+///@brief The neighbourhood of one grid point, handed to the pointwise
+/// function of a stencil
+template<class T, class Shape>
+class stencil_point
+{
+public:
+  using value_type = T;
+  using index_array = std::array<index_type, Shape::rank>;
+
+  static constexpr std::size_t rank = Shape::rank;
+
+  stencil_point(const T* centre,
+                const index_type* offsets,
+                const index_type* strides,
+                const index_array& index) noexcept
+    : p_{ centre }
+    , offsets_{ offsets }
+    , strides_{ strides }
+    , index_{ index }
+  {}
+
+  const T& center() const noexcept { return *p_; }
+
+  ///@brief The value at the K-th point of the shape
+  template<std::size_t K>
+  const T& get() const noexcept
+  {
+    static_assert(K < Shape::size, "The shape has no such point");
+    return p_[offsets_[K]];
+  }
+
+  ///@brief The value at the given offsets from the centre, within the radius
+  /// of the shape
+  template<class... D,
+           REQUIRES(sizeof...(D) == rank &&
+                    std::conjunction_v<std::is_integral<D>...>)>
+  const T& operator()(D... d) const noexcept
+  {
+    EXPECTS(((d >= -Shape::radius && d <= Shape::radius) && ...));
+    index_type offset = 0;
+    std::size_t k = 0;
+    ((offset += index_type(d) * strides_[k++]), ...);
+    return p_[offset];
+  }
+
+  ///@brief Index of the point in the grid, wrapped for the halo points a
+  /// periodic grid computes within a time block
+  const index_array& index() const noexcept { return index_; }
+
+private:
+  const T* p_;
+  const index_type* offsets_;
+  const index_type* strides_;
+  const index_array& index_;
+};
+
+///@brief Blocking of stencil_grid::run()
+struct stencil_options
+{
+  ///@brief Edge of the blocks the grid is cut into and the threads share,
+  /// along all axes but the last, 0 for 16
+  index_type block = 0;
+  ///@brief Time steps a block advances in one go. Above 1 each block is
+  /// copied with a halo of radius * time_block points into a buffer of its
+  /// thread and advanced there, the halo shrinking by the radius at every
+  /// step, so the grid is read and written once per time_block steps at the
+  /// cost of computing the halo redundantly. This pays off when the sweeps
+  /// are bound by memory bandwidth, and the blocks fit in cache.
+  index_type time_block = 1;
+  ///@brief Length of the blocks along the last axis, 0 for 4096 points, or
+  /// 256 with time blocking. Long rows keep the vectorized inner loop busy.
+  index_type row_block = 0;
+};
+
+namespace detail {
+
+template<std::size_t N>
+using grid_index = std::array<index_type, N>;
+
+template<std::size_t N>
+index_type
+dot(const grid_index<N>& idx, const grid_index<N>& strides) noexcept
+{
+  index_type offset = 0;
+  for (std::size_t d = 0; d < N; ++d)
+    offset += idx[d] * strides[d];
+  return offset;
+}
+
+///@brief Calls g(first, length) for the rows of the box [lo, hi), which run
+/// along the last axis
+template<std::size_t N, class G>
+void
+for_each_box_row(const grid_index<N>& lo, const grid_index<N>& hi, G&& g)
+{
+  for (std::size_t d = 0; d < N; ++d)
+    if (hi[d] <= lo[d])
+      return;
+  auto idx = lo;
+  const index_type length = hi[N - 1] - lo[N - 1];
+  for (;;) {
+    g(static_cast<const grid_index<N>&>(idx), length);
+    std::size_t d = N - 1;
+    for (;;) {
+      if (d == 0)
+        return;
+      --d;
+      if (++idx[d] < hi[d])
+        break;
+      idx[d] = lo[d];
+    }
+  }
+}
+
+///@brief A row-major buffer covering the grid points from 'origin' on
+template<class T, std::size_t N>
+struct grid_plane
+{
+  T* data;
+  grid_index<N> origin;
+  grid_index<N> strides;
+
+  T* at(const grid_index<N>& idx) const noexcept
+  {
+    index_type offset = 0;
+    for (std::size_t d = 0; d < N; ++d)
+      offset += (idx[d] - origin[d]) * strides[d];
+    return data + offset;
+  }
+};
+
+template<std::size_t N>
+grid_index<N>
+row_major_strides(const grid_index<N>& dims) noexcept
+{
+  grid_index<N> strides{};
+  index_type stride = 1;
+  for (std::size_t d = N; d-- > 0;) {
+    strides[d] = stride;
+    stride *= dims[d];
+  }
+  return strides;
+}
+
+///@brief Sets the points of the box [lo, hi) outside the grid [0, dims)
+/// from the points inside, along one axis after the other so the corners
+/// take the values of their nearest (or wrapped) grid point. The sources
+/// must lie in the box.
+template<class T, std::size_t N>
+void
+fill_boundary(const grid_plane<T, N>& plane,
+              const grid_index<N>& lo,
+              const grid_index<N>& hi,
+              const grid_index<N>& dims,
+              boundary kind,
+              const T& value)
+{
+  if (kind == boundary::constant) {
+    for_each_box_row(lo, hi, [&](const grid_index<N>& first, index_type n) {
+      bool inside = true;
+      for (std::size_t d = 0; d + 1 < N; ++d)
+        inside = inside && first[d] >= 0 && first[d] < dims[d];
+      T* row = plane.at(first);
+      for (index_type j = 0; j < n; ++j) {
+        const index_type x = first[N - 1] + j;
+        if (!inside || x < 0 || x >= dims[N - 1])
+          row[j] = value;
+      }
+    });
+    return;
+  }
+
+  const auto source = [&](index_type x, index_type n) {
+    if (kind == boundary::clamp)
+      return std::clamp(x, index_type(0), n - 1);
+    return (x % n + n) % n;
+  };
+  for (std::size_t d = 0; d < N; ++d) {
+    // the slabs before and after the grid along d
+    auto below = hi;
+    below[d] = std::min(hi[d], index_type(0));
+    auto above = lo;
+    above[d] = std::max(lo[d], dims[d]);
+    const auto fill = [&](const grid_index<N>& first, index_type n) {
+      T* row = plane.at(first);
+      auto src = first;
+      if (d + 1 == N) {
+        for (index_type j = 0; j < n; ++j) {
+          src[d] = source(first[d] + j, dims[d]);
+          row[j] = *plane.at(src);
+        }
+      } else {
+        src[d] = source(first[d], dims[d]);
+        std::copy_n(plane.at(src), n, row);
+      }
+    };
+    for_each_box_row(lo, below, fill);
+    for_each_box_row(above, hi, fill);
+  }
+}
+
+///@brief dst = f(neighbourhood in src) over the box [lo, hi), src and dst
+/// having the geometry of 'plane'. The points of the box outside the grid
+/// [0, dims) are wrapped ones, their index() is the wrapped index.
+template<class Shape, class T, class F>
+void
+sweep(const T* src,
+      const grid_plane<T, Shape::rank>& plane,
+      const grid_index<Shape::rank>& lo,
+      const grid_index<Shape::rank>& hi,
+      const grid_index<Shape::rank>& dims,
+      F& f)
+{
+  constexpr std::size_t N = Shape::rank;
+  std::array<index_type, Shape::size> offsets{};
+  for (std::size_t k = 0; k < Shape::size; ++k)
+    for (std::size_t d = 0; d < N; ++d)
+      offsets[k] += Shape::offsets[k][d] * plane.strides[d];
+
+  const index_type n = dims[N - 1];
+  for_each_box_row(lo, hi, [&](const grid_index<N>& first, index_type length) {
+    const index_type start = plane.at(first) - plane.data;
+    const T* in = src + start;
+    T* out = plane.data + start;
+    auto idx = first;
+    for (std::size_t d = 0; d + 1 < N; ++d)
+      idx[d] = (idx[d] % dims[d] + dims[d]) % dims[d];
+    // the row before, within and after the grid, along which x + shift is
+    // the wrapped index
+    const index_type x0 = first[N - 1];
+    const index_type x1 = x0 + length;
+    const std::array<std::array<index_type, 3>, 3> segments{ {
+      { x0, std::min(x1, index_type(0)), n },
+      { std::max(x0, index_type(0)), std::min(x1, n), 0 },
+      { std::max(x0, n), x1, -n },
+    } };
+    for (const auto& [begin, end, shift] : segments)
+      for (index_type x = begin; x < end; ++x) {
+        idx[N - 1] = x + shift;
+        out[x - x0] = f(stencil_point<T, Shape>(
+          in + (x - x0), offsets.data(), plane.strides.data(), idx));
+      }
+  });
+}
+
+///@brief Copies the box [lo, hi) of the grid between two buffers
+template<class T, std::size_t N>
+void
+copy_box(const grid_plane<T, N>& from,
+         const grid_plane<T, N>& to,
+         const grid_index<N>& lo,
+         const grid_index<N>& hi)
+{
+  for_each_box_row(lo, hi, [&](const grid_index<N>& first, index_type n) {
+    std::copy_n(from.at(first), n, to.at(first));
+  });
+}
+
+} // namespace detail
+
+///@brief A grid advanced in time by a stencil: a pointwise function of the
+/// neighbourhood 'Shape' of every point. The grid owns two buffers with a
+/// halo of ghost points around the interior, filled before every step (or
+/// every time block) according to the boundary condition. The grid is cut
+/// into blocks that stay in cache, which the threads share.
+///
+/// The update function takes a stencil_point<T, Shape> and returns the new
+/// value of its centre, it must not depend on the order of the calls.
+///
+/// Invalid extents or options throw std::invalid_argument.
+///
+///@tparam T the element type
+///@tparam Shape star_stencil, box_stencil or stencil_shape
+template<class T, class Shape>
+class stencil_grid
+{
+public:
+  static constexpr std::size_t rank = Shape::rank;
+
+  using value_type = T;
+  using shape_type = Shape;
+  using extents_type = dims<rank>;
+  using index_array = std::array<index_type, rank>;
+  using view_type = ndspan<T, extents_type, layout_stride>;
+  using const_view_type = ndspan<const T, extents_type, layout_stride>;
+
+  explicit stencil_grid(const extents_type& ext,
+                        boundary kind = boundary::periodic,
+                        const T& value = T(),
+                        const stencil_options& options = {})
+    : ext_{ ext }
+    , kind_{ kind }
+    , value_{ value }
+    , options_{ options }
+    , halo_{ Shape::radius * options.time_block }
+  {
+    if (options.time_block < 1 || options.block < 0 || options.row_block < 0)
+      throw std::invalid_argument("Invalid stencil blocking");
+    for (std::size_t d = 0; d < rank; ++d) {
+      dims_[d] = ext.extent(d);
+      if (dims_[d] < 1)
+        throw std::invalid_argument("A stencil grid needs points");
+      if (kind == boundary::periodic && halo_ > dims_[d])
+        throw std::invalid_argument(
+          "A periodic grid must be at least as wide as its halo");
+    }
+    if (options_.block == 0)
+      options_.block = 16;
+    if (options_.row_block == 0)
+      options_.row_block = options_.time_block > 1 ? 256 : 4096;
+
+    index_array padded;
+    for (std::size_t d = 0; d < rank; ++d)
+      padded[d] = dims_[d] + 2 * halo_;
+    for (auto& buffer : buffers_)
+      buffer = ndarray<T, extents_type>(extents_type(padded), value);
+  }
+
+  const extents_type& extents() const noexcept { return ext_; }
+  boundary boundary_kind() const noexcept { return kind_; }
+  const stencil_options& options() const noexcept { return options_; }
+  ///@brief Width of the ghost layer around the interior
+  index_type halo() const noexcept { return halo_; }
+
+  ///@brief The current values of the grid points
+  view_type field() noexcept
+  {
+    return { buffers_[current_].data() + interior_offset(), interior() };
+  }
+
+  const_view_type field() const noexcept
+  {
+    return { buffers_[current_].data() + interior_offset(), interior() };
+  }
+
+  ///@brief Advances the grid by 'steps' time steps of f on the threads of
+  /// 'pool'
+  template<class F>
+  void run(index_type steps, F&& f, thread_pool& pool = default_thread_pool())
+  {
+    const auto tiles = tile_grid();
+    index_type count = 1;
+    for (auto t : tiles)
+      count *= t;
+
+    while (steps > 0) {
+      const index_type depth = std::min(steps, options_.time_block);
+      const auto cur = plane(current_);
+      const auto next = plane(1 - current_);
+      index_array lo, hi;
+      for (std::size_t d = 0; d < rank; ++d) {
+        lo[d] = -Shape::radius * depth;
+        hi[d] = dims_[d] + Shape::radius * depth;
+      }
+      detail::fill_boundary(cur, lo, hi, dims_, kind_, value_);
+
+      pool.run(std::size_t(count), [&](std::size_t task) {
+        index_array first, last;
+        tile(tiles, index_type(task), first, last);
+        if (depth == 1)
+          detail::sweep<Shape>(cur.data, next, first, last, dims_, f);
+        else
+          advance_tile(cur, next, first, last, depth, f);
+      });
+      current_ = 1 - current_;
+      steps -= depth;
+    }
+  }
+
+private:
+  using plane_type = detail::grid_plane<T, rank>;
+
+  // both buffers have the same strides
+  index_array strides() const noexcept
+  {
+    index_array strides;
+    for (std::size_t d = 0; d < rank; ++d)
+      strides[d] = index_type(buffers_[0].strides()[d]);
+    return strides;
+  }
+
+  index_type interior_offset() const noexcept
+  {
+    index_array corner;
+    corner.fill(halo_);
+    return detail::dot(corner, strides());
+  }
+
+  layout_stride::mapping<extents_type> interior() const noexcept
+  {
+    return { ext_, strides() };
+  }
+
+  plane_type plane(int which) noexcept
+  {
+    index_array origin;
+    origin.fill(-halo_);
+    return { buffers_[which].data(), origin, strides() };
+  }
+
+  index_type edge(std::size_t d) const noexcept
+  {
+    return d + 1 < rank ? options_.block : options_.row_block;
+  }
+
+  index_array tile_grid() const noexcept
+  {
+    index_array tiles;
+    for (std::size_t d = 0; d < rank; ++d)
+      tiles[d] = (dims_[d] + edge(d) - 1) / edge(d);
+    return tiles;
+  }
+
+  void tile(const index_array& tiles,
+            index_type id,
+            index_array& first,
+            index_array& last) const noexcept
+  {
+    for (std::size_t d = rank; d-- > 0;) {
+      first[d] = id % tiles[d] * edge(d);
+      last[d] = std::min(first[d] + edge(d), dims_[d]);
+      id /= tiles[d];
+    }
+  }
+
+  ///@brief 'depth' steps of the tile [first, last) in a buffer of the thread,
+  /// from 'cur' into 'next'
+  template<class F>
+  void advance_tile(const plane_type& cur,
+                    const plane_type& next,
+                    const index_array& first,
+                    const index_array& last,
+                    index_type depth,
+                    F& f) const
+  {
+    const index_type reach = Shape::radius * depth;
+    index_array lo, hi, dims;
+    std::size_t volume = 1;
+    for (std::size_t d = 0; d < rank; ++d) {
+      lo[d] = first[d] - reach;
+      hi[d] = last[d] + reach;
+      dims[d] = hi[d] - lo[d];
+      volume *= std::size_t(dims[d]);
+    }
+    thread_local std::vector<T> scratch;
+    if (scratch.size() < 2 * volume)
+      scratch.resize(2 * volume);
+    plane_type a{ scratch.data(), lo, detail::row_major_strides(dims) };
+    plane_type b{ scratch.data() + volume, lo, a.strides };
+    detail::copy_box(cur, a, lo, hi);
+
+    for (index_type t = 1; t <= depth; ++t) {
+      // the points still valid after step t
+      index_array valid_lo, valid_hi, sweep_lo, sweep_hi;
+      // wrapped points are computed like the points they copy, the others
+      // outside the grid follow the boundary condition
+      const bool wraps = kind_ == boundary::periodic;
+      for (std::size_t d = 0; d < rank; ++d) {
+        valid_lo[d] = first[d] - Shape::radius * (depth - t);
+        valid_hi[d] = last[d] + Shape::radius * (depth - t);
+        sweep_lo[d] =
+          wraps ? valid_lo[d] : std::max(valid_lo[d], index_type(0));
+        sweep_hi[d] = wraps ? valid_hi[d] : std::min(valid_hi[d], dims_[d]);
+      }
+      detail::sweep<Shape>(a.data, b, sweep_lo, sweep_hi, dims_, f);
+      if (kind_ != boundary::periodic)
+        detail::fill_boundary(b, valid_lo, valid_hi, dims_, kind_, value_);
+      std::swap(a.data, b.data);
+    }
+    detail::copy_box(a, next, first, last);
+  }
+
+  extents_type ext_;
+  index_array dims_{};
+  boundary kind_;
+  T value_;
+  stencil_options options_;
+  index_type halo_;
+  std::array<ndarray<T, extents_type>, 2> buffers_;
+  int current_ = 0;
+};
+
+} // namespace nanda
+
+#endif // NANDA_STENCIL_HEADER
@@ -0,0 +1,371 @@
+#ifndef NANDA_STRIDED_COPY_HEADER
+#define NANDA_STRIDED_COPY_HEADER
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <type_traits>
+
+#include "simd.hh"
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+namespace nanda {
+namespace detail {
+
+///@brief Side of the square tiles the SIMD kernels transpose in registers
+inline constexpr std::size_t transpose_tile = 8;
+
+///@brief Side below which the recursive transpose stops splitting, the source
+/// and destination blocks of 4 byte elements take 4KB each and stay in L1
+inline constexpr std::size_t transpose_block = 32;
+
+///@brief Copies an 8x8 tile of trivially copyable elements, the transpose of
+/// the rows of 'src' ('ss' elements apart) to the rows of 'dst'
+template<class T, class I>
+NANDA_SIMD_INLINE void
+transpose_tile_scalar(const T* src, I ss, T* dst, I ds) noexcept
+{
+  constexpr I n = I(transpose_tile);
+  for (I i = 0; i < n; ++i)
+    for (I j = 0; j < n; ++j)
+      dst[j * ds + i] = src[i * ss + j];
+}
+
+#ifdef NANDA_SIMD_X86
+
+///@brief 8x8 transpose of 4 byte elements in eight AVX registers: pairs of
+/// rows are interleaved, then pairs of pairs, then the 128 bit halves swapped
+template<class I>
+NANDA_TARGET_AVX2 inline void
+transpose_tile_avx2(const float* src, I ss, float* dst, I ds) noexcept
+{
+  const __m256 r0 = _mm256_loadu_ps(src + 0 * ss);
+  const __m256 r1 = _mm256_loadu_ps(src + 1 * ss);
+  const __m256 r2 = _mm256_loadu_ps(src + 2 * ss);
+  const __m256 r3 = _mm256_loadu_ps(src + 3 * ss);
+  const __m256 r4 = _mm256_loadu_ps(src + 4 * ss);
+  const __m256 r5 = _mm256_loadu_ps(src + 5 * ss);
+  const __m256 r6 = _mm256_loadu_ps(src + 6 * ss);
+  const __m256 r7 = _mm256_loadu_ps(src + 7 * ss);
+
+  const __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+  const __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+  const __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+  const __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+  const __m256 t4 = _mm256_unpacklo_ps(r4, r5);
+  const __m256 t5 = _mm256_unpackhi_ps(r4, r5);
+  const __m256 t6 = _mm256_unpacklo_ps(r6, r7);
+  const __m256 t7 = _mm256_unpackhi_ps(r6, r7);
+
+  const __m256 u0 = _mm256_shuffle_ps(t0, t2, 0x44);
+  const __m256 u1 = _mm256_shuffle_ps(t0, t2, 0xee);
+  const __m256 u2 = _mm256_shuffle_ps(t1, t3, 0x44);
+  const __m256 u3 = _mm256_shuffle_ps(t1, t3, 0xee);
+  const __m256 u4 = _mm256_shuffle_ps(t4, t6, 0x44);
+  const __m256 u5 = _mm256_shuffle_ps(t4, t6, 0xee);
+  const __m256 u6 = _mm256_shuffle_ps(t5, t7, 0x44);
+  const __m256 u7 = _mm256_shuffle_ps(t5, t7, 0xee);
+
+  _mm256_storeu_ps(dst + 0 * ds, _mm256_permute2f128_ps(u0, u4, 0x20));
+  _mm256_storeu_ps(dst + 1 * ds, _mm256_permute2f128_ps(u1, u5, 0x20));
+  _mm256_storeu_ps(dst + 2 * ds, _mm256_permute2f128_ps(u2, u6, 0x20));
+  _mm256_storeu_ps(dst + 3 * ds, _mm256_permute2f128_ps(u3, u7, 0x20));
+  _mm256_storeu_ps(dst + 4 * ds, _mm256_permute2f128_ps(u0, u4, 0x31));
+  _mm256_storeu_ps(dst + 5 * ds, _mm256_permute2f128_ps(u1, u5, 0x31));
+  _mm256_storeu_ps(dst + 6 * ds, _mm256_permute2f128_ps(u2, u6, 0x31));
+  _mm256_storeu_ps(dst + 7 * ds, _mm256_permute2f128_ps(u3, u7, 0x31));
+}
+
+///@brief 4x4 transpose of 8 byte elements in four AVX registers
+template<class I>
+NANDA_TARGET_AVX2 NANDA_SIMD_INLINE void
+transpose_quad_avx2(const double* src, I ss, double* dst, I ds) noexcept
+{
+  const __m256d r0 = _mm256_loadu_pd(src + 0 * ss);
+  const __m256d r1 = _mm256_loadu_pd(src + 1 * ss);
+  const __m256d r2 = _mm256_loadu_pd(src + 2 * ss);
+  const __m256d r3 = _mm256_loadu_pd(src + 3 * ss);
+
+  const __m256d t0 = _mm256_unpacklo_pd(r0, r1);
+  const __m256d t1 = _mm256_unpackhi_pd(r0, r1);
+  const __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+  const __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+
+  _mm256_storeu_pd(dst + 0 * ds, _mm256_permute2f128_pd(t0, t2, 0x20));
+  _mm256_storeu_pd(dst + 1 * ds, _mm256_permute2f128_pd(t1, t3, 0x20));
+  _mm256_storeu_pd(dst + 2 * ds, _mm256_permute2f128_pd(t0, t2, 0x31));
+  _mm256_storeu_pd(dst + 3 * ds, _mm256_permute2f128_pd(t1, t3, 0x31));
+}
+
+///@brief 8x8 transpose of 8 byte elements as four 4x4 quadrants
+template<class I>
+NANDA_TARGET_AVX2 inline void
+transpose_tile_avx2(const double* src, I ss, double* dst, I ds) noexcept
+{
+  transpose_quad_avx2(src, ss, dst, ds);
+  transpose_quad_avx2(src + 4, ss, dst + 4 * ds, ds);
+  transpose_quad_avx2(src + 4 * ss, ss, dst + 4, ds);
+  transpose_quad_avx2(src + 4 * ss + 4, ss, dst + 4 * ds + 4, ds);
+}
+
+///@brief 4x4 transpose of 4 byte elements in four SSE registers
+template<class I>
+NANDA_TARGET_SSE2 NANDA_SIMD_INLINE void
+transpose_quad_sse2(const float* src, I ss, float* dst, I ds) noexcept
+{
+  __m128 r0 = _mm_loadu_ps(src + 0 * ss);
+  __m128 r1 = _mm_loadu_ps(src + 1 * ss);
+  __m128 r2 = _mm_loadu_ps(src + 2 * ss);
+  __m128 r3 = _mm_loadu_ps(src + 3 * ss);
+  _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+  _mm_storeu_ps(dst + 0 * ds, r0);
+  _mm_storeu_ps(dst + 1 * ds, r1);
+  _mm_storeu_ps(dst + 2 * ds, r2);
+  _mm_storeu_ps(dst + 3 * ds, r3);
+}
+
+template<class I>
+NANDA_TARGET_SSE2 inline void
+transpose_tile_sse2(const float* src, I ss, float* dst, I ds) noexcept
+{
+  transpose_quad_sse2(src, ss, dst, ds);
+  transpose_quad_sse2(src + 4, ss, dst + 4 * ds, ds);
+  transpose_quad_sse2(src + 4 * ss, ss, dst + 4, ds);
+  transpose_quad_sse2(src + 4 * ss + 4, ss, dst + 4 * ds + 4, ds);
+}
+
+#endif // NANDA_SIMD_X86
+
+template<class T, class I>
+using transpose_tile_fn = void (*)(const T*, I, T*, I) noexcept;
+
+///@brief The tile kernel for elements of type T: in-register transposes for
+/// trivially copyable 4 and 8 byte elements when the CPU has them, a scalar
+/// loop otherwise
+template<class T, class I>
+transpose_tile_fn<T, I>
+select_transpose_tile(simd_isa isa = active_simd_isa()) noexcept
+{
+#ifdef NANDA_SIMD_X86
+  // the elements are moved as raw 4 or 8 byte words
+  if constexpr (std::is_trivially_copyable_v<T> && sizeof(T) == 4) {
+    if (isa >= simd_isa::avx2)
+      return [](const T* src, I ss, T* dst, I ds) noexcept {
+        transpose_tile_avx2(reinterpret_cast<const float*>(src),
+                            ss,
+                            reinterpret_cast<float*>(dst),
+                            ds);
+      };
+    if (isa >= simd_isa::sse2)
+      return [](const T* src, I ss, T* dst, I ds) noexcept {
+        transpose_tile_sse2(reinterpret_cast<const float*>(src),
+                            ss,
+                            reinterpret_cast<float*>(dst),
+                            ds);
+      };
+  } else if constexpr (std::is_trivially_copyable_v<T> && sizeof(T) == 8) {
+    if (isa >= simd_isa::avx2)
+      return [](const T* src, I ss, T* dst, I ds) noexcept {
+        transpose_tile_avx2(reinterpret_cast<const double*>(src),
+                            ss,
+                            reinterpret_cast<double*>(dst),
+                            ds);
+      };
+  }
+#endif
+  (void)isa;
+  return [](const T* src, I ss, T* dst, I ds) noexcept {
+    transpose_tile_scalar(src, ss, dst, ds);
+  };
+}
+
+///@brief Copies the plane dst[i * di + j * dj] = src[i * si + j * sj] for
+/// i < rows and j < cols. The plane is halved along its longer side until a
+/// block fits the cache (cache-oblivious), a block is copied in tiles.
+///
+/// 'tile' is used for full tiles when the source is contiguous along j and
+/// the destination along i, the transposing case.
+template<class T, class U, class I>
+void
+copy_plane(const T* src,
+           I si,
+           I sj,
+           U* dst,
+           I di,
+           I dj,
+           I rows,
+           I cols,
+           transpose_tile_fn<std::remove_cv_t<T>, I> tile)
+{
+  constexpr I block = I(transpose_block);
+  constexpr I side = I(transpose_tile);
+
+  if (rows > block || cols > block) {
+    // split on a tile boundary so the halves keep full tiles
+    if (rows >= cols) {
+      const I half = std::max(rows / 2 / side * side, I(1));
+      copy_plane(src, si, sj, dst, di, dj, half, cols, tile);
+      copy_plane(src + half * si,
+                 si,
+                 sj,
+                 dst + half * di,
+                 di,
+                 dj,
+                 rows - half,
+                 cols,
+                 tile);
+    } else {
+      const I half = std::max(cols / 2 / side * side, I(1));
+      copy_plane(src, si, sj, dst, di, dj, rows, half, tile);
+      copy_plane(src + half * sj,
+                 si,
+                 sj,
+                 dst + half * dj,
+                 di,
+                 dj,
+                 rows,
+                 cols - half,
+                 tile);
+    }
+    return;
+  }
+
+  I i = 0;
+  if constexpr (std::is_same_v<std::remove_cv_t<T>, U>) {
+    if (tile && sj == 1 && di == 1) {
+      const I full_rows = rows / side * side;
+      I j = 0;
+      for (; j + side <= cols; j += side)
+        for (i = 0; i < full_rows; i += side)
+          tile(src + i * si + j, si, dst + j * dj + i, dj);
+      for (; j < cols; ++j)
+        for (I k = 0; k < full_rows; ++k)
+          dst[k + j * dj] = src[k * si + j];
+      i = full_rows;
+    }
+  }
+  for (; i < rows; ++i)
+    for (I j = 0; j < cols; ++j)
+      dst[i * di + j * dj] = src[i * si + j * sj];
+}
+
+///@brief The axis with the smallest stride among those of extent above one,
+/// N if there is none
+template<class I, std::size_t N>
+std::size_t
+fastest_axis(const std::array<I, N>& strides,
+             const std::array<I, N>& extents) noexcept
+{
+  std::size_t fast = N;
+  for (std::size_t a = 0; a < N; ++a)
+    if (extents[a] > 1 &&
+        (fast == N || std::abs(strides[a]) <= std::abs(strides[fast])))
+      fast = a;
+  return fast;
+}
+
+///@brief Copies the elements of one strided index space to another,
+/// dst[idx . dst_strides] = src[idx . src_strides] for every index of
+/// 'extents'. The regions must not overlap.
+///
+/// When the fastest axes of the source and the destination differ the copy
+/// is a transpose of the plane they span, done by copy_plane() for every
+/// index of the other axes. Otherwise it copies runs along the shared fastest
+/// axis. The other axes are walked by decreasing destination stride.
+template<class T, class U, class I, std::size_t N>
+void
+strided_copy(const T* src,
+             const std::array<I, N>& src_strides,
+             U* dst,
+             const std::array<I, N>& dst_strides,
+             const std::array<I, N>& extents)
+{
+  for (auto e : extents)
+    if (e == 0)
+      return;
+
+  const std::size_t a = fastest_axis(src_strides, extents);
+  const std::size_t b = fastest_axis(dst_strides, extents);
+  if (a == N) { // a single element
+    *dst = *src;
+    return;
+  }
+  const bool plane = b != N && b != a;
+
+  // the remaining axes, outermost (largest destination stride) first
+  std::array<std::size_t, N> outer{};
+  std::size_t rank = 0;
+  for (std::size_t r = 0; r < N; ++r)
+    if (r != a && !(plane && r == b) && extents[r] > 1)
+      outer[rank++] = r;
+  // insertion sort, there are at most N - 1 of them
+  for (std::size_t i = 1; i < rank; ++i) {
+    const std::size_t r = outer[i];
+    std::size_t j = i;
+    for (; j > 0 &&
+           std::abs(dst_strides[outer[j - 1]]) < std::abs(dst_strides[r]);
+         --j)
+      outer[j] = outer[j - 1];
+    outer[j] = r;
+  }
+
+  transpose_tile_fn<std::remove_cv_t<T>, I> tile = nullptr;
+  if constexpr (std::is_same_v<std::remove_cv_t<T>, U>)
+    tile = select_transpose_tile<U, I>();
+
+  std::array<I, N> idx{};
+  I src_offset = 0, dst_offset = 0;
+  for (;;) {
+    if (plane) {
+      copy_plane(src + src_offset,
+                 src_strides[b],
+                 src_strides[a],
+                 dst + dst_offset,
+                 dst_strides[b],
+                 dst_strides[a],
+                 extents[b],
+                 extents[a],
+                 tile);
+    } else {
+      const T* s = src + src_offset;
+      U* d = dst + dst_offset;
+      const I n = extents[a], ss = src_strides[a], ds = dst_strides[a];
+      if (ss == 1 && ds == 1) {
+        std::copy_n(s, n, d);
+      } else {
+        for (I k = 0; k < n; ++k)
+          d[k * ds] = s[k * ss];
+      }
+    }
+
+    // odometer over the remaining axes, the last one the fastest
+    std::size_t r = rank;
+    for (; r-- > 0;) {
+      const std::size_t axis = outer[r];
+      src_offset += src_strides[axis];
+      dst_offset += dst_strides[axis];
+      if (++idx[axis] < extents[axis])
+        break;
+      src_offset -= idx[axis] * src_strides[axis];
+      dst_offset -= idx[axis] * dst_strides[axis];
+      idx[axis] = 0;
+    }
+    if (r == std::size_t(-1))
+      return;
+  }
+}
+
+} // namespace detail
+} // namespace nanda
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // NANDA_STRIDED_COPY_HEADER
@@ -0,0 +1,284 @@
+#ifndef NANDA_SUBNDSPAN_HEADER
+#define NANDA_SUBNDSPAN_HEADER
+
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "extents.hh"
+#include "layouts.hh"
+#include "ndarray.hh"
+#include "ndspan.hh"
+#include "utility.hh"
+
+namespace nanda {
+
+///@brief Slice taking every index of an axis
+struct full_extent_t
+{
+  explicit full_extent_t() = default;
+};
+
+inline constexpr full_extent_t full_extent{};
+
+///@brief Slice taking the indices offset, offset + stride, ... below
+/// offset + extent; 'extent' is the length of the range, not the number of
+/// indices taken
+template<class OffsetType, class ExtentType, class StrideType>
+struct strided_slice
+{
+  using offset_type = OffsetType;
+  using extent_type = ExtentType;
+  using stride_type = StrideType;
+
+  OffsetType offset{};
+  ExtentType extent{};
+  StrideType stride{};
+};
+
+template<class OffsetType, class ExtentType, class StrideType>
+strided_slice(OffsetType, ExtentType, StrideType)
+  -> strided_slice<OffsetType, ExtentType, StrideType>;
+
+namespace detail {
+
+template<class S>
+inline constexpr bool is_index_slice_v =
+  std::is_integral_v<remove_cvref_t<S>>;
+
+template<class T, T V>
+inline constexpr bool is_index_slice_v<std::integral_constant<T, V>> = true;
+
+template<class S>
+inline constexpr bool is_full_slice_v =
+  std::is_same_v<remove_cvref_t<S>, full_extent_t>;
+
+template<class S>
+struct is_strided_slice : std::false_type
+{};
+
+template<class O, class E, class S>
+struct is_strided_slice<strided_slice<O, E, S>> : std::true_type
+{};
+
+///@brief A [first, last) pair: std::pair, a two element std::tuple or
+/// std::array
+template<class S>
+struct is_range_slice : std::false_type
+{};
+
+template<class A, class B>
+struct is_range_slice<std::pair<A, B>>
+  : std::bool_constant<std::is_integral_v<A> && std::is_integral_v<B>>
+{};
+
+template<class A, class B>
+struct is_range_slice<std::tuple<A, B>>
+  : std::bool_constant<std::is_integral_v<A> && std::is_integral_v<B>>
+{};
+
+template<class A>
+struct is_range_slice<std::array<A, 2>> : std::is_integral<A>
+{};
+
+template<class S>
+inline constexpr bool is_slice_v =
+  is_index_slice_v<S> || is_full_slice_v<S> ||
+  is_strided_slice<remove_cvref_t<S>>::value ||
+  is_range_slice<remove_cvref_t<S>>::value;
+
+///@brief Kind of every slice: 0 an index, 1 every index, 2 a contiguous
+/// range, 3 a strided range
+template<class S>
+constexpr int
+slice_kind() noexcept
+{
+  if constexpr (is_index_slice_v<S>)
+    return 0;
+  else if constexpr (is_full_slice_v<S>)
+    return 1;
+  else if constexpr (is_range_slice<remove_cvref_t<S>>::value)
+    return 2;
+  else
+    return 3;
+}
+
+///@brief The extents and layout of a slice of an Extents / Layout view
+template<class Extents, class Layout, class... Slices>
+struct sub_view
+{
+  static constexpr std::size_t rank = Extents::rank();
+  static constexpr std::array<int, sizeof...(Slices)> kinds{
+    slice_kind<Slices>()...
+  };
+  static constexpr std::size_t sub_rank =
+    (std::size_t(0) + ... + std::size_t(!is_index_slice_v<Slices>));
+
+  ///@brief Static extents survive full_extent slices only
+  static constexpr std::array<std::size_t, sub_rank> static_extents() noexcept
+  {
+    std::array<std::size_t, sub_rank> result{};
+    std::size_t out = 0;
+    for (std::size_t k = 0; k < rank; ++k) {
+      if (kinds[k] == 0)
+        continue;
+      result[out++] = kinds[k] == 1 ? Extents::static_extent(k) : dynamic_extent;
+    }
+    return result;
+  }
+
+  template<std::size_t... Is>
+  static auto make_extents(std::index_sequence<Is...>)
+    -> extents<typename Extents::index_type, static_extents()[Is]...>;
+
+  using extents_type =
+    decltype(make_extents(std::make_index_sequence<sub_rank>{}));
+
+  ///@brief A layout_right slice stays layout_right when it takes indices
+  /// along the leading axes, a range along the next one and every index
+  /// along the others: the elements are still one contiguous block. The same
+  /// mirrored for layout_left.
+  static constexpr bool keeps_packed(bool right) noexcept
+  {
+    if (sub_rank == 0)
+      return true;
+    for (std::size_t n = 0; n < rank; ++n) {
+      const std::size_t k = right ? n : rank - 1 - n;
+      const std::size_t leading = rank - sub_rank;
+      if (n < leading && kinds[k] != 0)
+        return false;
+      if (n == leading && kinds[k] != 1 && kinds[k] != 2)
+        return false;
+      if (n > leading && kinds[k] != 1)
+        return false;
+    }
+    return true;
+  }
+
+  using layout_type = std::conditional_t<
+    std::is_same_v<Layout, layout_right> && keeps_packed(true),
+    layout_right,
+    std::conditional_t<std::is_same_v<Layout, layout_left> &&
+                         keeps_packed(false),
+                       layout_left,
+                       layout_stride>>;
+};
+
+///@brief First index, number of indices and step of a slice of an axis of
+/// length 'extent'
+template<class I>
+struct slice_range
+{
+  I first;
+  I count;
+  I step;
+};
+
+template<class I, class S>
+constexpr slice_range<I>
+make_slice_range(const S& slice, I extent) noexcept
+{
+  using slice_type = remove_cvref_t<S>;
+  if constexpr (is_index_slice_v<S>) {
+    EXPECTS(I(slice) >= 0 && I(slice) < extent);
+    return { I(slice), 1, 1 };
+  } else if constexpr (is_full_slice_v<S>) {
+    return { 0, extent, 1 };
+  } else if constexpr (is_range_slice<slice_type>::value) {
+    const I first = I(std::get<0>(slice));
+    const I last = I(std::get<1>(slice));
+    EXPECTS(0 <= first && first <= last && last <= extent);
+    return { first, last - first, 1 };
+  } else {
+    const I first = I(slice.offset);
+    const I length = I(slice.extent);
+    const I step = I(slice.stride);
+    EXPECTS(0 <= first && 0 <= length && first + length <= extent);
+    EXPECTS(length == 0 || step > 0);
+    return { first, length == 0 ? 0 : 1 + (length - 1) / step, step };
+  }
+}
+
+} // namespace detail
+
+///@brief The part of 'view' selected by one slice per axis, without copying.
+/// This is submdspan of the C++26 mdspan (P2630) for ndspan. A slice is
+///   - an index, the axis is dropped from the result (the rank drops at
+///     compile time),
+///   - full_extent, every index,
+///   - a [first, last) pair (std::pair, std::tuple or std::array),
+///   - a strided_slice{ offset, extent, stride }.
+///
+/// A layout_right view sliced with indices along its leading axes, a range
+/// along the next one and full_extent along the rest stays layout_right and
+/// contiguous (layout_left mirrored), so kernels keep their fast paths. Any
+/// other slice of a strided view is a layout_stride view. Full_extent keeps a
+/// static extent static.
+template<class T, class E, class L, class... Slices>
+auto
+subndspan(const ndspan<T, E, L>& view, const Slices&... slices)
+{
+  static_assert(sizeof...(Slices) == E::rank(),
+                "One slice per axis is needed");
+  static_assert((detail::is_slice_v<Slices> && ...),
+                "A slice is an index, full_extent, a [first, last) pair or a "
+                "strided_slice");
+  static_assert(ndspan<T, E, L>::mapping_type::is_always_strided(),
+                "Only views of a strided layout can be sliced");
+
+  using index_type = typename E::index_type;
+  using sub = detail::sub_view<E, L, Slices...>;
+  using sub_extents = typename sub::extents_type;
+  using sub_layout = typename sub::layout_type;
+  using sub_mapping = typename sub_layout::template mapping<sub_extents>;
+
+  std::size_t axis = 0;
+  const std::array<detail::slice_range<index_type>, E::rank()> ranges{
+    detail::make_slice_range(slices, view.extent(axis++))...
+  };
+
+  index_type offset = 0;
+  std::array<index_type, sub::sub_rank> dims{}, strides{};
+  for (std::size_t k = 0, out = 0; k < E::rank(); ++k) {
+    offset += ranges[k].first * index_type(view.stride(k));
+    if (sub::kinds[k] == 0)
+      continue;
+    dims[out] = ranges[k].count;
+    strides[out] = ranges[k].step * index_type(view.stride(k));
+    ++out;
+  }
+
+  // an empty slice may start one past the end, never dereferenced
+  T* data = view.data() + offset;
+  if constexpr (std::is_same_v<sub_layout, layout_stride>)
+    return ndspan<T, sub_extents, sub_layout>(
+      data, sub_mapping(sub_extents(dims), strides));
+  else
+    return ndspan<T, sub_extents, sub_layout>(data,
+                                              sub_mapping(sub_extents(dims)));
+}
+
+template<class T, class E, class L, class A, class... Slices>
+auto
+subndspan(ndarray<T, E, L, A>& arr, const Slices&... slices)
+{
+  return subndspan(arr.view(), slices...);
+}
+
+template<class T, class E, class L, class A, class... Slices>
+auto
+subndspan(const ndarray<T, E, L, A>& arr, const Slices&... slices)
+{
+  return subndspan(arr.view(), slices...);
+}
+
+///@brief The view would outlive the array
+template<class T, class E, class L, class A, class... Slices>
+void
+subndspan(ndarray<T, E, L, A>&& arr, const Slices&... slices) = delete;
+
+} // namespace nanda
+
+#endif // NANDA_SUBNDSPAN_HEADER
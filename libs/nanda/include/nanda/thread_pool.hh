@@ -0,0 +1,262 @@
+#ifndef NANDA_THREAD_POOL_HEADER
+#define NANDA_THREAD_POOL_HEADER
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace nanda {
+
+///@brief Fixed set of threads running data-parallel loops of independent
+/// tasks. The tasks of a loop are dealt out as one contiguous range per
+/// thread (the workers and the calling thread). A thread takes tasks from
+/// the front of its own range and, once it is empty, steals the back half of
+/// another thread's range, so uneven tasks balance without a central queue.
+///
+/// The workers sleep between loops and the pool serves any number of them.
+/// Loops submitted from several threads run one after the other, a loop
+/// started from inside a task runs serially on the calling thread. Single
+/// jobs run asynchronously on an idle worker, see submit().
+class thread_pool
+{
+public:
+  ///@param threads total number of threads working on a loop, the caller
+  /// included
+  explicit thread_pool(
+    std::size_t threads = std::max(1u, std::thread::hardware_concurrency()))
+    : slots_(new slot[std::max<std::size_t>(threads, 1)])
+    , size_{ std::max<std::size_t>(threads, 1) }
+  {
+    workers_.reserve(size_ - 1);
+    for (std::size_t id = 1; id < size_; ++id)
+      workers_.emplace_back([this, id] { worker(id); });
+  }
+
+  thread_pool(const thread_pool&) = delete;
+  thread_pool& operator=(const thread_pool&) = delete;
+
+  ~thread_pool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_)
+      worker.join();
+  }
+
+  ///@brief Number of threads working on a loop, the caller included
+  std::size_t size() const noexcept { return size_; }
+
+  ///@brief Calls f(task) for every task in [0, tasks) and returns once all of
+  /// them are done. The first exception thrown by a task is rethrown here,
+  /// the tasks not started by then are skipped.
+  template<class F>
+  void run(std::size_t tasks, F&& f)
+  {
+    if (tasks == 0)
+      return;
+    if (in_task() || size_ == 1 || tasks == 1) {
+      for (std::size_t task = 0; task < tasks; ++task)
+        f(task);
+      return;
+    }
+
+    std::lock_guard<std::mutex> serial(run_mutex_);
+    using callable = std::remove_reference_t<F>;
+    call_ = [](void* ctx, std::size_t task) {
+      (*static_cast<callable*>(ctx))(task);
+    };
+    context_ = static_cast<void*>(std::addressof(f));
+    error_ = nullptr;
+    failed_.store(false, std::memory_order_relaxed);
+
+    // one contiguous share per thread, the first ones one task larger
+    const std::size_t share = tasks / size_;
+    const std::size_t extra = tasks % size_;
+    std::size_t begin = 0;
+    for (std::size_t id = 0; id < size_; ++id) {
+      const std::size_t end = begin + share + (id < extra ? 1 : 0);
+      std::lock_guard<std::mutex> lock(slots_[id].mutex);
+      slots_[id].begin = begin;
+      slots_[id].end = end;
+      begin = end;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++generation_;
+      busy_ = size_ - 1;
+    }
+    wake_.notify_all();
+
+    work(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return busy_ == 0; });
+    if (error_)
+      std::rethrow_exception(error_);
+  }
+
+  ///@brief Runs f() on the next idle worker and returns at once. The future
+  /// is ready once f returned and rethrows its exception. The loops of run()
+  /// go first, and a pool without workers or a call from inside a task runs
+  /// f right away on the calling thread. Jobs not started when the pool is
+  /// destroyed are dropped, their futures report a broken promise.
+  template<class F>
+  std::future<void> submit(F&& f)
+  {
+    std::packaged_task<void()> job(std::forward<F>(f));
+    auto done = job.get_future();
+    if (in_task() || size_ == 1) {
+      job();
+      return done;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      jobs_.push_back(std::move(job));
+    }
+    wake_.notify_one();
+    return done;
+  }
+
+private:
+  struct alignas(64) slot
+  {
+    std::mutex mutex;
+    std::size_t begin = 0;
+    std::size_t end = 0;
+  };
+
+  static bool& in_task() noexcept
+  {
+    static thread_local bool flag = false;
+    return flag;
+  }
+
+  void worker(std::size_t id)
+  {
+    std::size_t seen = 0;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [&] {
+          return stop_ || generation_ != seen || !jobs_.empty();
+        });
+        if (stop_)
+          return;
+        if (generation_ == seen) {
+          auto job = std::move(jobs_.front());
+          jobs_.pop_front();
+          lock.unlock();
+          in_task() = true;
+          job();
+          in_task() = false;
+          continue;
+        }
+        seen = generation_;
+      }
+      work(id);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--busy_ == 0)
+          done_.notify_one();
+      }
+    }
+  }
+
+  void work(std::size_t id)
+  {
+    in_task() = true;
+    std::size_t task;
+    while (take(id, task) || (steal(id) && take(id, task))) {
+      if (failed_.load(std::memory_order_relaxed))
+        continue;
+      try {
+        call_(context_, task);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_)
+          error_ = std::current_exception();
+        failed_.store(true, std::memory_order_relaxed);
+      }
+    }
+    in_task() = false;
+  }
+
+  bool take(std::size_t id, std::size_t& task)
+  {
+    slot& own = slots_[id];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (own.begin == own.end)
+      return false;
+    task = own.begin++;
+    return true;
+  }
+
+  ///@brief Moves the back half of the first non-empty range after 'id' into
+  /// the range of 'id'
+  bool steal(std::size_t id)
+  {
+    for (std::size_t k = 1; k < size_; ++k) {
+      slot& victim = slots_[(id + k) % size_];
+      std::size_t begin, end;
+      {
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        const std::size_t left = victim.end - victim.begin;
+        if (left == 0)
+          continue;
+        end = victim.end;
+        begin = end - (left + 1) / 2;
+        victim.end = begin;
+      }
+      std::lock_guard<std::mutex> lock(slots_[id].mutex);
+      slots_[id].begin = begin;
+      slots_[id].end = end;
+      return true;
+    }
+    return false;
+  }
+
+  std::unique_ptr<slot[]> slots_;
+  std::size_t size_;
+  std::vector<std::thread> workers_;
+
+  std::mutex run_mutex_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  std::size_t generation_ = 0;
+  std::size_t busy_ = 0;
+  bool stop_ = false;
+  std::deque<std::packaged_task<void()>> jobs_;
+
+  void (*call_)(void*, std::size_t) = nullptr;
+  void* context_ = nullptr;
+  std::exception_ptr error_;
+  std::atomic<bool> failed_{ false };
+};
+
+///@brief The pool shared by the parallel algorithms when none is given, one
+/// thread per hardware thread, created on first use
+inline thread_pool&
+default_thread_pool()
+{
+  static thread_pool pool;
+  return pool;
+}
+
+} // namespace nanda
+
+#endif // NANDA_THREAD_POOL_HEADER
@@ -0,0 +1,468 @@
+#ifndef NANDA_TILED_LAYOUT_HEADER
+#define NANDA_TILED_LAYOUT_HEADER
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+#include "extents.hh"
+#include "index_algos.hh"
+#include "layouts.hh"
+#include "multi_index.hh"
+#include "ndspan.hh"
+
+namespace nanda {
+
+namespace detail {
+
+///@brief Row-major strides of the static extents 'Extents'
+template<std::size_t... Extents>
+constexpr std::array<std::size_t, sizeof...(Extents)>
+static_row_major_strides()
+{
+  std::array<std::size_t, sizeof...(Extents)> extents{ Extents... };
+  std::array<std::size_t, sizeof...(Extents)> strides{};
+  std::size_t stride = 1;
+  for (std::size_t r = sizeof...(Extents); r-- > 0;) {
+    strides[r] = stride;
+    stride *= extents[r];
+  }
+  return strides;
+}
+
+} // namespace detail
+
+///@brief Blocked layout: the index space is cut into tiles of the compile time
+/// extents Tile..., the elements of a tile are stored contiguously in
+/// row-major order and the tiles themselves follow each other in row-major
+/// order. Neighbours in every direction thus stay within a few cache lines
+/// and pages, which linear layouts only offer for the contiguous direction.
+///
+/// Extents that are not a multiple of the tile extents are padded up to whole
+/// tiles, the mapping is then not exhaustive.
+///
+///@tparam Tile extent of a tile in every direction, one per rank
+template<std::size_t... Tile>
+struct layout_tiled
+{
+  static_assert(sizeof...(Tile) > 0, "A tile needs at least one direction");
+  static_assert(((Tile > 0) && ...), "Tile extents must be positive");
+
+  static constexpr std::size_t tile_rank = sizeof...(Tile);
+  static constexpr std::size_t tile_size = (Tile * ...);
+  static constexpr std::array<std::size_t, tile_rank> tile_extents{ Tile... };
+  ///@brief Row-major strides of the elements inside a tile
+  static constexpr std::array<std::size_t, tile_rank> inner_strides =
+    detail::static_row_major_strides<Tile...>();
+
+  template<class Extents>
+  class mapping;
+};
+
+template<std::size_t... Tile>
+template<class Extents>
+class layout_tiled<Tile...>::mapping
+{
+  static_assert(is_extents_v<Extents>,
+                "A layout mapping needs nanda::extents as its index space");
+  static_assert(Extents::rank() == sizeof...(Tile),
+                "One tile extent per direction is required");
+
+  using unsigned_index = std::make_unsigned_t<typename Extents::index_type>;
+
+public:
+  using extents_type = Extents;
+  using index_type = typename Extents::index_type;
+  using size_type = typename Extents::size_type;
+  using rank_type = typename Extents::rank_type;
+  using layout_type = layout_tiled;
+  using index_array = std::array<index_type, Extents::rank()>;
+
+  static constexpr rank_type rank() noexcept { return Extents::rank(); }
+
+  ///@brief Extent of a tile in direction r
+  static constexpr index_type tile_extent(rank_type r) noexcept
+  {
+    return index_type(tile_extents[r]);
+  }
+
+  ///@brief Distance between consecutive indices in direction r inside a tile
+  static constexpr index_type inner_stride(rank_type r) noexcept
+  {
+    return index_type(inner_strides[r]);
+  }
+
+  constexpr mapping()
+    : mapping(extents_type{})
+  {}
+
+  ///@brief Debug builds throw if the padded size overflows index_type
+  constexpr mapping(const extents_type& ext)
+    : extents_{ ext }
+  {
+    std::array<index_type, rank()> padded{};
+    for (rank_type r = 0; r < rank(); ++r) {
+      tiles_[r] = (ext.extent(r) + tile_extent(r) - 1) / tile_extent(r);
+      padded[r] = tiles_[r] * tile_extent(r);
+    }
+    detail::check_index_range<index_type>(padded);
+
+    index_type stride = index_type(tile_size);
+    for (rank_type r = rank(); r-- > 0;) {
+      tile_strides_[r] = stride;
+      stride *= tiles_[r];
+    }
+  }
+
+  constexpr const extents_type& extents() const noexcept { return extents_; }
+
+  ///@brief Number of tiles in every direction, partial tiles included
+  constexpr const index_array& tiles() const noexcept { return tiles_; }
+
+  ///@brief Distance between the first elements of consecutive tiles in
+  /// direction r
+  constexpr index_type tile_stride(rank_type r) const noexcept
+  {
+    return tile_strides_[r];
+  }
+
+  ///@brief Number of elements including the padding of partial tiles
+  constexpr index_type required_span_size() const noexcept
+  {
+    index_type size = index_type(tile_size);
+    for (rank_type r = 0; r < rank(); ++r)
+      size *= tiles_[r];
+    return size;
+  }
+
+  template<class... Idx,
+           REQUIRES(sizeof...(Idx) == rank() &&
+                    std::conjunction_v<std::is_integral<Idx>...>)>
+  constexpr index_type operator()(Idx... idx) const noexcept
+  {
+    return (*this)(index_array{ index_type(idx)... });
+  }
+
+  ///@brief The offset of 'idx', the tiled counterpart of flatten. The tile
+  /// extents are constants so the divisions reduce to shifts and masks for
+  /// powers of two.
+  constexpr index_type operator()(const index_array& idx) const noexcept
+  {
+    index_type offset = 0;
+    for (rank_type r = 0; r < rank(); ++r) {
+      const auto i = unsigned_index(idx[r]);
+      const auto t = unsigned_index(tile_extents[r]);
+      offset += index_type(i / t) * tile_strides_[r] +
+                index_type(i % t) * inner_stride(r);
+    }
+    return offset;
+  }
+
+  ///@brief The index stored at 'offset', the tiled counterpart of
+  /// unflatten. Offsets into the padding of a partial tile map onto indices
+  /// beyond the extents.
+  constexpr index_array unflatten(index_type offset) const noexcept
+  {
+    const auto tile = unsigned_index(offset) / unsigned_index(tile_size);
+    auto inner = unsigned_index(offset) % unsigned_index(tile_size);
+    auto tile_offset = index_type(tile) * index_type(tile_size);
+
+    index_array idx{};
+    for (rank_type r = 0; r < rank(); ++r) {
+      const index_type t = tile_offset / tile_strides_[r];
+      tile_offset -= t * tile_strides_[r];
+      const auto i = inner / unsigned_index(inner_strides[r]);
+      inner -= i * unsigned_index(inner_strides[r]);
+      idx[r] = t * tile_extent(r) + index_type(i);
+    }
+    return idx;
+  }
+
+  static constexpr bool is_always_unique() noexcept { return true; }
+  static constexpr bool is_always_exhaustive() noexcept
+  {
+    if constexpr (Extents::is_static()) {
+      for (rank_type r = 0; r < rank(); ++r)
+        if (Extents::static_extent(r) % tile_extents[r] != 0)
+          return false;
+      return true;
+    } else {
+      return false;
+    }
+  }
+  static constexpr bool is_always_strided() noexcept { return false; }
+  static constexpr bool is_always_contiguous() noexcept
+  {
+    return is_always_exhaustive();
+  }
+
+  static constexpr bool is_unique() noexcept { return true; }
+  constexpr bool is_exhaustive() const noexcept
+  {
+    for (rank_type r = 0; r < rank(); ++r)
+      if (extents_.extent(r) % tile_extent(r) != 0)
+        return false;
+    return true;
+  }
+  ///@brief Conservatively false, tiles only collapse to strides for a single
+  /// tile per direction
+  static constexpr bool is_strided() noexcept { return false; }
+  constexpr bool is_contiguous() const noexcept { return is_exhaustive(); }
+
+  friend constexpr bool operator==(const mapping& lhs,
+                                   const mapping& rhs) noexcept
+  {
+    return lhs.extents_ == rhs.extents_;
+  }
+
+  friend constexpr bool operator!=(const mapping& lhs,
+                                   const mapping& rhs) noexcept
+  {
+    return !(lhs == rhs);
+  }
+
+private:
+  extents_type extents_;
+  index_array tiles_{};
+  index_array tile_strides_{};
+};
+
+///@brief Given an array of multidimensional indices computes the offset in
+/// the tiled layout layout_tiled<Tile...> of the dimensions 'dims'
+template<std::size_t... Tile, class Idx, class Dims>
+constexpr auto
+tiled_flatten(const Idx& idx, const Dims& dims)
+{
+  using index_t = detail::dims_index_t<Dims>;
+  using extents_t = dextents<index_t, sizeof...(Tile)>;
+  typename layout_tiled<Tile...>::template mapping<extents_t> map(
+    extents_t(detail::dims_array<index_t>(dims)));
+
+  std::array<index_t, sizeof...(Tile)> md_idx{};
+  for (std::size_t r = 0; r < sizeof...(Tile); ++r)
+    md_idx[r] = index_t(idx[r]);
+  return map(md_idx);
+}
+
+///@brief Given an offset into the tiled layout layout_tiled<Tile...> of the
+/// dimensions 'dims' computes the multidimensional index
+template<std::size_t... Tile, class IndexType, class Dims>
+constexpr auto
+tiled_unflatten(IndexType offset, const Dims& dims)
+{
+  using extents_t = dextents<IndexType, sizeof...(Tile)>;
+  typename layout_tiled<Tile...>::template mapping<extents_t> map(
+    extents_t(detail::dims_array<IndexType>(dims)));
+  return map.unflatten(offset);
+}
+
+///@brief Iterator over the indices of a tiled mapping in memory order: every
+/// index of a tile is visited before the next tile, the padding of partial
+/// tiles is skipped. Like multi_index_iterator no division is performed while
+/// advancing, and the md_index is returned by value, so it is tagged as an
+/// input iterator.
+///
+///@tparam Mapping a layout_tiled mapping
+template<class Mapping>
+class tiled_index_iterator
+{
+  static constexpr std::size_t N = Mapping::rank();
+
+public:
+  using index_type = typename Mapping::index_type;
+  using iterator_category = std::input_iterator_tag;
+  using value_type = md_index<N, index_type>;
+  using difference_type = std::ptrdiff_t;
+  using pointer = void;
+  using reference = value_type;
+
+  constexpr tiled_index_iterator() noexcept = default;
+
+  constexpr tiled_index_iterator(const Mapping& map, index_type count) noexcept
+    : map_{ &map }
+    , count_{ count }
+  {
+    clip_tile();
+  }
+
+  constexpr reference operator*() const noexcept { return current_; }
+
+  ///@brief Index of the current tile in the grid of tiles
+  constexpr const std::array<index_type, N>& tile() const noexcept
+  {
+    return tile_;
+  }
+
+  constexpr tiled_index_iterator& operator++() noexcept
+  {
+    ++count_;
+    // odometer inside the tile, clipped to the extents
+    for (std::size_t r = N; r-- > 0;) {
+      if (inner_[r] + 1 < clip_[r]) {
+        ++inner_[r];
+        ++current_.index[r];
+        current_.offset += Mapping::inner_stride(r);
+        return *this;
+      }
+      current_.index[r] -= inner_[r];
+      current_.offset -= inner_[r] * Mapping::inner_stride(r);
+      inner_[r] = 0;
+    }
+
+    // odometer over the tiles
+    for (std::size_t r = N; r-- > 0;) {
+      if (tile_[r] + 1 < map_->tiles()[r]) {
+        ++tile_[r];
+        current_.index[r] += Mapping::tile_extent(r);
+        current_.offset += map_->tile_stride(r);
+        break;
+      }
+      current_.offset -= tile_[r] * map_->tile_stride(r);
+      current_.index[r] = 0;
+      tile_[r] = 0;
+    }
+    clip_tile();
+    return *this;
+  }
+
+  constexpr tiled_index_iterator operator++(int) noexcept
+  {
+    auto tmp = *this;
+    ++*this;
+    return tmp;
+  }
+
+  friend constexpr bool operator==(const tiled_index_iterator& lhs,
+                                   const tiled_index_iterator& rhs) noexcept
+  {
+    return lhs.count_ == rhs.count_;
+  }
+
+  friend constexpr bool operator!=(const tiled_index_iterator& lhs,
+                                   const tiled_index_iterator& rhs) noexcept
+  {
+    return !(lhs == rhs);
+  }
+
+private:
+  constexpr void clip_tile() noexcept
+  {
+    for (std::size_t r = 0; r < N; ++r)
+      clip_[r] = std::min(Mapping::tile_extent(r),
+                          map_->extents().extent(r) - current_.index[r]);
+  }
+
+  const Mapping* map_ = nullptr;
+  index_type count_ = 0;
+  std::array<index_type, N> tile_{};
+  std::array<index_type, N> inner_{};
+  std::array<index_type, N> clip_{};
+  value_type current_{};
+};
+
+///@brief Range of all indices of a tiled mapping in memory order, see
+/// tiled_index_iterator. The mapping must outlive the range.
+template<class Mapping>
+class tiled_index_range
+{
+public:
+  using index_type = typename Mapping::index_type;
+  using iterator = tiled_index_iterator<Mapping>;
+
+  constexpr explicit tiled_index_range(const Mapping& map) noexcept
+    : map_{ &map }
+  {}
+
+  constexpr iterator begin() const noexcept { return { *map_, 0 }; }
+  constexpr iterator end() const noexcept { return { *map_, size() }; }
+
+  constexpr index_type size() const noexcept
+  {
+    return index_type(map_->extents().size());
+  }
+
+  [[nodiscard]] constexpr bool empty() const noexcept { return size() == 0; }
+
+private:
+  const Mapping* map_;
+};
+
+///@brief All indices of the layout_tiled mapping 'map' in memory order,
+/// together with their offsets
+template<class Mapping>
+constexpr auto
+tiled_indices(const Mapping& map) noexcept
+{
+  return tiled_index_range<Mapping>{ map };
+}
+
+namespace detail {
+
+///@brief Calls f(first, length) for every row of every tile of 'map', a row
+/// being the up to Tile[rank - 1] indices along the last direction starting
+/// at the index 'first'. Such a row is contiguous in the tiled layout and in
+/// any row-major layout.
+template<class Mapping, class F>
+constexpr void
+for_each_tile_row(const Mapping& map, F&& f)
+{
+  using index_type = typename Mapping::index_type;
+  constexpr std::size_t N = Mapping::rank();
+  using grid_type = dextents<index_type, N>;
+
+  for_each_index(grid_type(map.tiles()), [&](const auto& tile) {
+    std::array<index_type, N> origin{};
+    std::array<index_type, N> clip{};
+    for (std::size_t r = 0; r < N; ++r) {
+      origin[r] = tile[r] * Mapping::tile_extent(r);
+      clip[r] = std::min(Mapping::tile_extent(r),
+                         map.extents().extent(r) - origin[r]);
+    }
+    const index_type length = clip[N - 1];
+    clip[N - 1] = 1;
+
+    for_each_index(grid_type(clip), [&](const auto& inner) {
+      std::array<index_type, N> first{};
+      for (std::size_t r = 0; r < N; ++r)
+        first[r] = origin[r] + inner[r];
+      f(first, length);
+    });
+  });
+}
+
+} // namespace detail
+
+///@brief Converts a row-major view into a tiled one, copying whole tile rows
+template<class T, class E, class U, class F, std::size_t... Tile>
+void
+copy(const ndspan<T, E, layout_right>& src,
+     const ndspan<U, F, layout_tiled<Tile...>>& dst)
+{
+  static_assert(E::rank() == F::rank(), "Views must have the same rank");
+  EXPECTS(src.extents() == dst.extents());
+
+  detail::for_each_tile_row(dst.mapping(), [&](const auto& first, auto length) {
+    std::copy_n(&src(first), length, &dst(first));
+  });
+}
+
+///@brief Converts a tiled view back into a row-major one, copying whole tile
+/// rows
+template<class T, class E, class U, class F, std::size_t... Tile>
+void
+copy(const ndspan<T, E, layout_tiled<Tile...>>& src,
+     const ndspan<U, F, layout_right>& dst)
+{
+  static_assert(E::rank() == F::rank(), "Views must have the same rank");
+  EXPECTS(src.extents() == dst.extents());
+
+  detail::for_each_tile_row(src.mapping(), [&](const auto& first, auto length) {
+    std::copy_n(&src(first), length, &dst(first));
+  });
+}
+
+} // namespace nanda
+
+#endif // NANDA_TILED_LAYOUT_HEADER
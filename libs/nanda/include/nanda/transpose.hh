@@ -0,0 +1,278 @@
+#ifndef NANDA_TRANSPOSE_HEADER
+#define NANDA_TRANSPOSE_HEADER
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "extents.hh"
+#include "layouts.hh"
+#include "ndarray.hh"
+#include "ndspan.hh"
+#include "strided_copy.hh"
+
+namespace nanda {
+
+namespace detail {
+
+template<class Extents, class Seq = std::make_index_sequence<Extents::rank()>>
+struct reversed_extents;
+
+template<class Extents, std::size_t... Is>
+struct reversed_extents<Extents, std::index_sequence<Is...>>
+{
+  using type =
+    extents<typename Extents::index_type,
+            Extents::static_extent(Extents::rank() - 1 - Is)...>;
+
+  static constexpr type make(const Extents& ext) noexcept
+  {
+    return type(std::array<typename Extents::index_type, Extents::rank()>{
+      ext.extent(Extents::rank() - 1 - Is)... });
+  }
+};
+
+///@brief The layout of the transpose of a view of layout L: reversing the
+/// axes of a packed layout gives the packed layout of the other order
+template<class L>
+struct transposed_layout
+{
+  using type = layout_stride;
+};
+
+template<>
+struct transposed_layout<layout_right>
+{
+  using type = layout_left;
+};
+
+template<>
+struct transposed_layout<layout_left>
+{
+  using type = layout_right;
+};
+
+///@brief Whether 'perm' holds every axis below N once
+template<std::size_t N>
+constexpr bool
+is_permutation(const std::array<std::size_t, N>& perm) noexcept
+{
+  std::array<bool, N> seen{};
+  for (auto a : perm) {
+    if (a >= N || seen[a])
+      return false;
+    seen[a] = true;
+  }
+  return true;
+}
+
+} // namespace detail
+
+///@brief A view of the same elements with the axes reordered, axis k of the
+/// result is axis perm[k] of 'view'. No element is copied, the result has
+/// the extents and strides of 'view' permuted.
+///
+///@param perm a permutation of the axes of 'view'
+template<class T, class E, class L>
+ndspan<T, dextents<typename E::index_type, E::rank()>, layout_stride>
+permute_axes(const ndspan<T, E, L>& view,
+             const std::array<std::size_t, E::rank()>& perm)
+{
+  static_assert(ndspan<T, E, L>::mapping_type::is_always_strided(),
+                "Permuting the axes needs a strided layout, copy the view "
+                "to one first");
+  EXPECTS(detail::is_permutation(perm));
+
+  using index_type = typename E::index_type;
+  using result_extents = dextents<index_type, E::rank()>;
+  std::array<index_type, E::rank()> dims{}, strides{};
+  for (std::size_t k = 0; k < E::rank(); ++k) {
+    dims[k] = view.extent(perm[k]);
+    strides[k] = index_type(view.stride(perm[k]));
+  }
+  return { view.data(),
+           layout_stride::mapping<result_extents>(result_extents(dims),
+                                                  strides) };
+}
+
+///@brief The view with its axes reversed, the matrix transpose for rank 2.
+/// No element is copied: a layout_right view becomes a layout_left one and
+/// the other way around, other strided layouts give a layout_stride view.
+template<class T, class E, class L>
+auto
+transpose(const ndspan<T, E, L>& view)
+{
+  using reversed = detail::reversed_extents<E>;
+  using layout = typename detail::transposed_layout<L>::type;
+
+  if constexpr (std::is_same_v<layout, layout_stride>) {
+    std::array<std::size_t, E::rank()> perm{};
+    for (std::size_t k = 0; k < E::rank(); ++k)
+      perm[k] = E::rank() - 1 - k;
+    const auto permuted = permute_axes(view, perm);
+    using extents_type = typename reversed::type;
+    return ndspan<T, extents_type, layout_stride>(
+      view.data(),
+      layout_stride::mapping<extents_type>(
+        reversed::make(view.extents()), permuted.mapping().strides()));
+  } else {
+    return ndspan<T, typename reversed::type, layout>(
+      view.data(), reversed::make(view.extents()));
+  }
+}
+
+template<class T, class E, class L, class A>
+auto
+transpose(ndarray<T, E, L, A>& arr)
+{
+  return transpose(arr.view());
+}
+
+template<class T, class E, class L, class A>
+auto
+transpose(const ndarray<T, E, L, A>& arr)
+{
+  return transpose(arr.view());
+}
+
+///@brief The view would outlive the array
+template<class T, class E, class L, class A>
+void
+transpose(ndarray<T, E, L, A>&& arr) = delete;
+
+template<class T, class E, class L, class A>
+auto
+permute_axes(ndarray<T, E, L, A>& arr,
+             const std::array<std::size_t, E::rank()>& perm)
+{
+  return permute_axes(arr.view(), perm);
+}
+
+template<class T, class E, class L, class A>
+auto
+permute_axes(const ndarray<T, E, L, A>& arr,
+             const std::array<std::size_t, E::rank()>& perm)
+{
+  return permute_axes(arr.view(), perm);
+}
+
+template<class T, class E, class L, class A>
+void
+permute_axes(ndarray<T, E, L, A>&& arr,
+             const std::array<std::size_t, E::rank()>& perm) = delete;
+
+///@brief A new layout_right array holding the elements of 'view' in its
+/// order, the materialized form of a transposed or permuted view. The copy
+/// is blocked, see copy().
+template<class T, class E, class L>
+ndarray<std::remove_cv_t<T>, E>
+materialize(const ndspan<T, E, L>& view)
+{
+  ndarray<std::remove_cv_t<T>, E> result(view.extents());
+  copy(view, result.view());
+  return result;
+}
+
+///@brief The transpose of 'src' as a new layout_right array
+template<class Src>
+auto
+transpose_copy(const Src& src)
+{
+  return materialize(transpose(src));
+}
+
+///@brief The axes of 'src' permuted as by permute_axes(), as a new
+/// layout_right array
+template<class Src>
+auto
+permute_axes_copy(const Src& src,
+                  const std::array<std::size_t, Src::rank()>& perm)
+{
+  return materialize(permute_axes(src, perm));
+}
+
+///@brief Transposes the square matrix 'view' in place. Pairs of tiles
+/// mirrored across the diagonal are transposed into each other through a
+/// small buffer, with the in-register kernels of copy() for tiles of
+/// contiguous rows.
+template<class T, class E, class L>
+void
+transpose_in_place(const ndspan<T, E, L>& view)
+{
+  static_assert(E::rank() == 2, "Only matrices are transposed in place");
+  static_assert(!std::is_const_v<T>, "The view must be writable");
+  static_assert(ndspan<T, E, L>::mapping_type::is_always_strided(),
+                "Transposing in place needs a strided layout");
+  EXPECTS(view.extent(0) == view.extent(1));
+
+  using I = std::ptrdiff_t;
+  constexpr I side = I(detail::transpose_tile);
+  constexpr I block = I(detail::transpose_block);
+  const I n = I(view.extent(0));
+  const I s0 = I(view.stride(0)), s1 = I(view.stride(1));
+  T* data = view.data();
+
+  // rows along the axis of stride 1, tiles then load contiguous runs
+  const bool rows_contiguous = s1 == 1 || s0 != 1;
+  const I row = rows_contiguous ? s0 : s1;
+  const I col = rows_contiguous ? s1 : s0;
+
+  detail::transpose_tile_fn<T, I> tile = nullptr;
+  if (col == 1)
+    tile = detail::select_transpose_tile<T, I>();
+
+  T a[detail::transpose_tile * detail::transpose_tile];
+  T b[detail::transpose_tile * detail::transpose_tile];
+
+  // element (i, j) of the tile at (ti, tj) into buf[j * side + i]
+  const auto load = [&](I ti, I tj, I rows, I cols, T* buf) {
+    const T* p = data + ti * row + tj * col;
+    if (tile && rows == side && cols == side) {
+      tile(p, row, buf, side);
+    } else {
+      for (I i = 0; i < rows; ++i)
+        for (I j = 0; j < cols; ++j)
+          buf[j * side + i] = p[i * row + j * col];
+    }
+  };
+  const auto store = [&](I ti, I tj, I rows, I cols, const T* buf) {
+    T* p = data + ti * row + tj * col;
+    for (I i = 0; i < rows; ++i)
+      for (I j = 0; j < cols; ++j)
+        p[i * row + j * col] = buf[i * side + j];
+  };
+
+  // blocks of tiles keep both mirrored regions in cache
+  for (I bi = 0; bi < n; bi += block) {
+    for (I bj = bi; bj < n; bj += block) {
+      const I ei = std::min(bi + block, n), ej = std::min(bj + block, n);
+      for (I ti = bi; ti < ei; ti += side) {
+        const I rows = std::min(side, n - ti);
+        for (I tj = bi == bj ? ti : bj; tj < ej; tj += side) {
+          const I cols = std::min(side, n - tj);
+          load(ti, tj, rows, cols, a);
+          if (ti == tj) {
+            store(ti, tj, cols, rows, a);
+          } else {
+            load(tj, ti, cols, rows, b);
+            store(tj, ti, cols, rows, a);
+            store(ti, tj, rows, cols, b);
+          }
+        }
+      }
+    }
+  }
+}
+
+template<class T, class E, class L, class A>
+void
+transpose_in_place(ndarray<T, E, L, A>& arr)
+{
+  transpose_in_place(arr.view());
+}
+
+} // namespace nanda
+
+#endif // NANDA_TRANSPOSE_HEADER
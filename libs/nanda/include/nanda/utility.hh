@@ -1,7 +1,11 @@
 #ifndef NANDA_UTILITY_HEADER
 #define NANDA_UTILITY_HEADER
 
+#include <array>
+#include <cassert>
 #include <cstddef>
+#include <memory>
+#include <stdexcept>
 #include <tuple>
 #include <type_traits>
 
@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory_resource>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "nanda/arena.hh"
+#include "nanda/ndarray.hh"
+#include "nanda/reduction.hh"
+#include "nanda/transpose.hh"
+
+using namespace nanda;
+
+namespace {
+
+using matrix = dextents<index_type, 2>;
+
+template<class T>
+using arena_matrix =
+  ndarray<T, matrix, layout_right, resource_allocator<T>>;
+
+///@brief Throws from its copy constructor once 'budget' copies were made
+struct throwing_copy
+{
+  static inline int budget = 0;
+
+  throwing_copy() = default;
+  throwing_copy(const throwing_copy&)
+  {
+    if (budget-- == 0)
+      throw std::runtime_error("copy failed");
+  }
+};
+
+} // namespace
+
+TEST(ArenaTest, DefaultAllocatorTakesNoStorage)
+{
+  static_assert(std::is_same_v<ndarray<float, matrix>::allocator_type,
+                               aligned_allocator<float>>);
+  static_assert(sizeof(ndarray<float, matrix>) ==
+                sizeof(arena_matrix<float>) - sizeof(void*));
+  ndarray<double, matrix> arr(matrix{ 3, 5 });
+  EXPECT_TRUE(is_aligned(arr.data()));
+  EXPECT_EQ(arr.get_allocator(), aligned_allocator<double>{});
+}
+
+TEST(ArenaTest, ArenaCarvesAndRewinds)
+{
+  arena_resource arena(1024);
+  void* a = arena.allocate(100, 8);
+  void* b = arena.allocate(10, 64);
+  EXPECT_EQ(static_cast<char*>(b) - static_cast<char*>(a), 128);
+  EXPECT_TRUE(is_aligned(static_cast<char*>(b), 64));
+  arena.deallocate(a, 100, 8);
+  EXPECT_EQ(arena.stats().allocations, 2u);
+  EXPECT_EQ(arena.stats().deallocations, 1u);
+  EXPECT_EQ(arena.stats().bytes_in_use, 10u);
+  EXPECT_EQ(arena.stats().upstream_allocations, 1u);
+
+  // larger than the buffer, a new buffer twice as large at least
+  void* c = arena.allocate(5000, 64);
+  EXPECT_NE(c, nullptr);
+  EXPECT_EQ(arena.stats().upstream_allocations, 2u);
+  EXPECT_GE(arena.stats().upstream_bytes, 1024u + 5000);
+
+  // the last buffer stays, the next rounds take nothing upstream
+  for (int round = 0; round < 3; ++round) {
+    arena.rewind();
+    EXPECT_EQ(arena.stats().bytes_in_use, 0u);
+    EXPECT_NE(arena.allocate(3000, 64), nullptr);
+    EXPECT_NE(arena.allocate(1000, 64), nullptr);
+  }
+  EXPECT_EQ(arena.stats().upstream_allocations, 2u);
+  arena.release();
+  EXPECT_EQ(arena.available(), 0u);
+}
+
+TEST(ArenaTest, PoolReusesSizeClasses)
+{
+  pool_resource pool(1 << 12, 1 << 14);
+  std::vector<void*> blocks;
+  for (int k = 0; k < 10; ++k)
+    blocks.push_back(pool.allocate(100, 16));
+  for (auto* p : blocks)
+    EXPECT_TRUE(is_aligned(static_cast<char*>(p), 128));
+  EXPECT_EQ(pool.stats().upstream_allocations, 1u);
+
+  // given back blocks serve the next requests of the class
+  pool.deallocate(blocks[3], 100, 16);
+  EXPECT_EQ(pool.allocate(128, 64), blocks[3]);
+  EXPECT_EQ(pool.stats().upstream_allocations, 1u);
+
+  // other classes and large blocks
+  void* page = pool.allocate(4096, 4096);
+  EXPECT_TRUE(is_aligned(static_cast<char*>(page), 4096));
+  void* large = pool.allocate(1 << 13, 64);
+  EXPECT_EQ(pool.stats().upstream_allocations, 3u);
+  pool.deallocate(large, 1 << 13, 64);
+  pool.deallocate(page, 4096, 4096);
+  EXPECT_EQ(pool.stats().allocations, 13u);
+  EXPECT_EQ(pool.stats().deallocations, 3u);
+  EXPECT_EQ(pool.stats().peak_bytes, 10 * 100u + 28 + 4096 + (1 << 13));
+}
+
+TEST(ArenaTest, ScratchArraysFromTheCurrentResource)
+{
+  arena_resource arena;
+  EXPECT_EQ(current_resource(), std::pmr::new_delete_resource());
+  {
+    scoped_resource scope(arena);
+    EXPECT_EQ(current_resource(), &arena);
+
+    scratch_ndarray<float, matrix> a(matrix{ 16, 16 }, 1.0f);
+    scratch_ndarray<float, matrix> b(a * 2.0f + a);
+    EXPECT_EQ(b(15, 15), 3.0f);
+    EXPECT_TRUE(is_aligned(b.data()));
+    EXPECT_EQ(a.get_allocator().resource(), &arena);
+    EXPECT_EQ(arena.stats().allocations, 2u);
+
+    // the algorithms take scratch arrays as any other
+    EXPECT_EQ(sum(b, 0)(7), 3.0f * 16);
+    EXPECT_EQ(transpose(b)(3, 4), 3.0f);
+
+    // nested scopes, restored on the way out
+    pool_resource pool;
+    {
+      scoped_resource inner(pool);
+      scratch_ndarray<int, matrix> c(matrix{ 4, 4 });
+      EXPECT_EQ(c.get_allocator().resource(), &pool);
+    }
+    EXPECT_EQ(current_resource(), &arena);
+    EXPECT_EQ(pool.stats().bytes_in_use, 0u);
+  }
+  EXPECT_EQ(current_resource(), std::pmr::new_delete_resource());
+  EXPECT_EQ(arena.stats().deallocations, 2u);
+}
+
+TEST(ArenaTest, AllocatorPropagation)
+{
+  counting_resource first, second;
+  arena_matrix<int> a(matrix{ 4, 4 }, 1, &first);
+  arena_matrix<int> b(matrix{ 2, 2 }, 2, &second);
+  EXPECT_EQ(first.stats().allocations, 1u);
+
+  // moves and swaps keep the memory with its resource
+  arena_matrix<int> moved = std::move(a);
+  EXPECT_EQ(moved.get_allocator().resource(), &first);
+  swap(moved, b);
+  EXPECT_EQ(moved.get_allocator().resource(), &second);
+  EXPECT_EQ(b.get_allocator().resource(), &first);
+  EXPECT_EQ(b(3, 3), 1);
+
+  // copies draw from the current resource
+  const arena_matrix<int> copy = b;
+  EXPECT_EQ(copy.get_allocator().resource(), std::pmr::new_delete_resource());
+  EXPECT_EQ(copy(3, 3), 1);
+
+  b = moved;
+  EXPECT_EQ(b.get_allocator().resource(), &second);
+  EXPECT_EQ(first.stats().deallocations, 1u);
+  EXPECT_EQ(first.stats().bytes_in_use, 0u);
+}
+
+TEST(ArenaTest, FailedConstructionFreesMemory)
+{
+  counting_resource counter;
+  using buffer = aligned_buffer<throwing_copy,
+                                default_alignment,
+                                resource_allocator<throwing_copy>>;
+  throwing_copy::budget = 3;
+  EXPECT_THROW(buffer(8, throwing_copy{}, &counter), std::runtime_error);
+  EXPECT_EQ(counter.stats().allocations, 1u);
+  EXPECT_EQ(counter.stats().deallocations, 1u);
+  EXPECT_EQ(counter.stats().bytes_in_use, 0u);
+}
@@ -0,0 +1,215 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "nanda/batched_index.hh"
+
+#include "test_utils.hh"
+
+using namespace nanda;
+using namespace nanda::test;
+
+namespace {
+
+///@brief Values in [lo, hi), the same on every run
+template<class T>
+std::vector<T>
+pseudo_random(std::size_t n, T lo, T hi)
+{
+  std::vector<T> v(n);
+  std::uint64_t state = 12345;
+  for (auto& x : v) {
+    state = state * 6364136223846793005u + 1442695040888963407u;
+    x = T(lo + T((state >> 33) % std::uint64_t(hi - lo)));
+  }
+  return v;
+}
+
+template<class T, std::size_t N>
+std::array<span<const T>, N>
+const_spans(const std::array<std::vector<T>, N>& v)
+{
+  std::array<span<const T>, N> out;
+  for (std::size_t d = 0; d < N; ++d)
+    out[d] = span<const T>(v[d].data(), v[d].size());
+  return out;
+}
+
+template<class T, std::size_t N>
+std::array<span<T>, N>
+spans(std::array<std::vector<T>, N>& v)
+{
+  std::array<span<T>, N> out;
+  for (std::size_t d = 0; d < N; ++d)
+    out[d] = span<T>(v[d].data(), v[d].size());
+  return out;
+}
+
+} // namespace
+
+TEST(BatchedIndexTest, LaneDividerIsExact)
+{
+  using lane = detail::simd_vec<simd_isa::scalar, std::int32_t>;
+  std::vector<std::uint32_t> divisors;
+  for (std::uint32_t d = 1; d < 300; ++d)
+    divisors.push_back(d);
+  for (int log = 9; log < 31; ++log) {
+    divisors.push_back(1u << log);
+    divisors.push_back((1u << log) - 1);
+    divisors.push_back((1u << log) + 1);
+  }
+  divisors.push_back(std::numeric_limits<std::int32_t>::max());
+
+  const auto numerators = pseudo_random<std::int32_t>(
+    200, 0, std::numeric_limits<std::int32_t>::max());
+  for (auto d : divisors) {
+    const detail::lane_divider div(d);
+    const auto divide = [&](std::int64_t n) {
+      std::int32_t q = -1;
+      detail::lane_divide<lane>(std::int32_t(n), div, q);
+      return q;
+    };
+    const std::int64_t max = std::numeric_limits<std::int32_t>::max();
+    for (std::int64_t n : { std::int64_t(0), std::int64_t(1), d - 1l, d + 0l,
+                            d + 1l, max })
+      if (n <= max) {
+        EXPECT_EQ(divide(n), n / d) << d;
+      }
+    for (auto n : numerators)
+      EXPECT_EQ(divide(n), n / std::int32_t(d)) << d;
+  }
+}
+
+// lengths that leave a tail after the vectors, and coordinates on both sides
+// of every direction
+TEST(BatchedIndexTest, FlattenMatchesTheScalarLoop)
+{
+  const std::array<index_type, 3> dims{ 37, 5, 64 };
+  const std::size_t n = 1000 + 13;
+  std::array<std::vector<index_type>, 3> coords;
+  for (std::size_t d = 0; d < 3; ++d)
+    coords[d] = pseudo_random<index_type>(n, -2, dims[d] + 2);
+  coords[0][0] = std::numeric_limits<index_type>::min();
+  coords[2][1] = std::numeric_limits<index_type>::max();
+
+  for (auto isa : supported_isas()) {
+    SCOPED_TRACE(simd_isa_name(isa));
+    std::vector<index_type> row(n), col(n);
+    std::vector<std::uint8_t> valid(n, 7);
+    const auto count = flatten_batch<StorageOrder::RowMajor>(
+      const_spans(coords), dims, span<index_type>(row.data(), n),
+      span<std::uint8_t>(valid.data(), n), isa);
+    flatten_batch<StorageOrder::ColMajor>(
+      const_spans(coords), dims, span<index_type>(col.data(), n), {}, isa);
+
+    std::size_t expected = 0;
+    for (std::size_t k = 0; k < n; ++k) {
+      const std::array<index_type, 3> idx{ coords[0][k], coords[1][k],
+                                           coords[2][k] };
+      bool ok = true;
+      for (std::size_t d = 0; d < 3; ++d)
+        ok = ok && idx[d] >= 0 && idx[d] < dims[d];
+      expected += ok;
+      ASSERT_EQ(valid[k], ok) << k;
+      ASSERT_EQ(row[k], ok ? flatten<StorageOrder::RowMajor>(idx, dims) : -1);
+      ASSERT_EQ(col[k], ok ? flatten<StorageOrder::ColMajor>(idx, dims) : -1);
+    }
+    EXPECT_EQ(count, expected);
+    EXPECT_GT(expected, 0u);
+    EXPECT_LT(expected, n);
+  }
+}
+
+TEST(BatchedIndexTest, UnflattenMatchesTheScalarLoop)
+{
+  // extents of one make directions with a unit shift that are not the
+  // fastest running one
+  const extents<index_type, 3, dynamic_extent, 1, 100> dims(1000);
+  const auto size = index_type(dims.size());
+  const std::size_t n = 2000 + 9;
+  auto flat = pseudo_random<index_type>(n, -3, size + 3);
+  flat[0] = std::numeric_limits<index_type>::min();
+  flat[1] = std::numeric_limits<index_type>::max();
+  flat[2] = size - 1;
+
+  for (auto isa : supported_isas()) {
+    SCOPED_TRACE(simd_isa_name(isa));
+    for (auto storage : { StorageOrder::RowMajor, StorageOrder::ColMajor }) {
+      std::array<std::vector<index_type>, 4> coords;
+      for (auto& c : coords)
+        c.assign(n, 7);
+      std::vector<std::uint8_t> valid(n);
+      const span<const index_type> in(flat.data(), n);
+      const span<std::uint8_t> mask(valid.data(), n);
+      const auto count =
+        storage == StorageOrder::RowMajor
+          ? unflatten_batch<StorageOrder::RowMajor>(
+              in, dims, spans(coords), mask, isa)
+          : unflatten_batch<StorageOrder::ColMajor>(
+              in, dims, spans(coords), mask, isa);
+
+      std::size_t expected = 0;
+      for (std::size_t k = 0; k < n; ++k) {
+        const bool ok = flat[k] >= 0 && flat[k] < size;
+        expected += ok;
+        ASSERT_EQ(valid[k], ok) << k;
+        std::array<index_type, 4> idx{ -1, -1, -1, -1 };
+        if (ok && storage == StorageOrder::RowMajor)
+          idx = unflatten<StorageOrder::RowMajor>(flat[k], dims);
+        else if (ok)
+          idx = unflatten<StorageOrder::ColMajor>(flat[k], dims);
+        for (std::size_t d = 0; d < 4; ++d)
+          ASSERT_EQ(coords[d][k], idx[d]) << k;
+      }
+      EXPECT_EQ(count, expected);
+    }
+  }
+}
+
+TEST(BatchedIndexTest, WideIndicesAndSmallBatches)
+{
+  // 64 bit indices take the scalar loop, past the range of 32 bits
+  const std::array<std::int64_t, 2> dims{ 100000, 100000 };
+  std::array<std::vector<std::int64_t>, 2> coords{
+    std::vector<std::int64_t>{ 99999, 5, -1 },
+    std::vector<std::int64_t>{ 99999, 100000, 3 }
+  };
+  std::vector<std::int64_t> flat(3);
+  EXPECT_EQ(flatten_batch<StorageOrder::RowMajor>(
+              const_spans(coords), dims, span<std::int64_t>(flat.data(), 3)),
+            1u);
+  EXPECT_EQ(flat, (std::vector<std::int64_t>{ 9999999999, -1, -1 }));
+
+  flat[1] = 100000;
+  flat[2] = 10000000000;
+  std::vector<std::uint8_t> valid(3);
+  EXPECT_EQ(unflatten_batch<StorageOrder::ColMajor>(
+              span<const std::int64_t>(flat.data(), 3),
+              dims,
+              spans(coords),
+              span<std::uint8_t>(valid.data(), 3)),
+            2u);
+  EXPECT_EQ(coords[0], (std::vector<std::int64_t>{ 99999, 0, -1 }));
+  EXPECT_EQ(coords[1], (std::vector<std::int64_t>{ 99999, 1, -1 }));
+  EXPECT_EQ(valid, (std::vector<std::uint8_t>{ 1, 1, 0 }));
+
+  // fewer points than a vector, and none
+  const std::array<index_type, 1> line{ 10 };
+  std::array<std::vector<index_type>, 1> x{ std::vector<index_type>{ 3, 10 } };
+  std::vector<index_type> out(2);
+  for (auto isa : supported_isas()) {
+    EXPECT_EQ(flatten_batch<StorageOrder::RowMajor>(
+                const_spans(x), line, span<index_type>(out.data(), 2), {}, isa),
+              1u);
+    EXPECT_EQ(out, (std::vector<index_type>{ 3, -1 }));
+    EXPECT_EQ(flatten_batch<StorageOrder::RowMajor>(
+                std::array<span<const index_type>, 1>{},
+                line,
+                span<index_type>{},
+                {},
+                isa),
+              0u);
+  }
+}
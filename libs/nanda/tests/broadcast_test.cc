@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "nanda/broadcast.hh"
+#include "nanda/ndarray.hh"
+#include "nanda/simd.hh"
+#include "nanda/subndspan.hh"
+
+#include "test_utils.hh"
+
+using namespace nanda;
+using namespace nanda::test;
+
+namespace {
+
+using vector = dextents<index_type, 1>;
+using matrix = dextents<index_type, 2>;
+using cube = dextents<index_type, 3>;
+
+} // namespace
+
+TEST(BroadcastTest, Extents)
+{
+  EXPECT_TRUE(broadcastable(matrix{ 4, 3 }, matrix{ 1, 3 }));
+  EXPECT_TRUE(broadcastable(matrix{ 4, 3 }, vector{ 3 }));
+  EXPECT_TRUE(broadcastable(cube{ 2, 1, 5 }, matrix{ 7, 1 }));
+  EXPECT_TRUE(broadcastable(extents<index_type>{}, cube{ 2, 3, 4 }));
+  EXPECT_FALSE(broadcastable(matrix{ 4, 3 }, vector{ 4 }));
+  EXPECT_FALSE(broadcastable(matrix{ 4, 3 }, matrix{ 2, 3 }));
+
+  EXPECT_EQ(broadcast_extents(cube{ 2, 1, 5 }, matrix{ 7, 1 }),
+            (cube{ 2, 7, 5 }));
+  EXPECT_EQ(broadcast_extents(vector{ 1 }, matrix{ 0, 4 }), (matrix{ 0, 4 }));
+
+  // equal types are kept, static extents included
+  using fixed = extents<index_type, 2, 3>;
+  static_assert(std::is_same_v<broadcast_extents_t<fixed, fixed>, fixed>);
+  static_assert(std::is_same_v<broadcast_extents_t<fixed, vector>, matrix>);
+}
+
+TEST(BroadcastTest, StrideZeroViews)
+{
+  ndarray<int, matrix> row(matrix{ 1, 4 });
+  iota_fill(row);
+  const auto rows = broadcast_to(row, cube{ 2, 3, 4 });
+  EXPECT_EQ(rows.data(), row.data());
+  EXPECT_EQ(rows.stride(0), 0);
+  EXPECT_EQ(rows.stride(1), 0);
+  EXPECT_EQ(rows.stride(2), 1);
+  EXPECT_FALSE(rows.is_unique());
+  detail::for_each_index(rows.extents(), [&](const auto& idx) {
+    EXPECT_EQ(rows(idx), row(0, idx[2]));
+  });
+
+  // the shifts of the mapping, padding included
+  ndarray<float, matrix, layout_right_padded<8>> padded(matrix{ 3, 5 });
+  iota_fill(padded);
+  ndarray<float, vector> line(vector{ 5 });
+  iota_fill(line);
+  const auto [p, l] = broadcast_views(padded, line);
+  EXPECT_EQ(p.stride(0), 8);
+  EXPECT_EQ(p(2, 4), padded(2, 4));
+  EXPECT_EQ(l.stride(0), 0);
+  EXPECT_EQ(l(1, 2), line(2));
+}
+
+TEST(BroadcastTest, Expressions)
+{
+  ndarray<double, matrix> a(matrix{ 4, 6 });
+  iota_fill(a);
+  ndarray<double, matrix> row(matrix{ 1, 6 }), column(matrix{ 4, 1 });
+  iota_fill(row, 0, 10);
+  iota_fill(column, 0, 100);
+  ndarray<double, vector> line(vector{ 6 });
+  iota_fill(line, 0, 1000);
+
+  const ndarray<double, matrix> sum = a + row * 2.0 - column + line;
+  EXPECT_EQ(sum.extents(), a.extents());
+  for (index_type i = 0; i < 4; ++i)
+    for (index_type j = 0; j < 6; ++j)
+      EXPECT_EQ(sum(i, j), a(i, j) + row(0, j) * 2 - column(i, 0) + line(j));
+
+  // an outer product of a column and a row
+  const ndarray<double, matrix> outer = column * row;
+  EXPECT_EQ(outer.extents(), (matrix{ 4, 6 }));
+  EXPECT_EQ(outer(3, 5), column(3, 0) * row(0, 5));
+
+  // the flat path stays for operands of equal extents, assignment included
+  ndarray<double, matrix> out(a.extents());
+  out = a * 0.5 + a;
+  EXPECT_EQ(out(2, 3), a(2, 3) * 1.5);
+  out = a - row;
+  EXPECT_EQ(out(2, 3), a(2, 3) - row(0, 3));
+}
+
+template<class T, class Layout>
+void
+check_simd_broadcast()
+{
+  ndarray<T, matrix> a(matrix{ 9, 37 });
+  iota_fill(a);
+  ndarray<T, matrix> row(matrix{ 1, 37 }), column(matrix{ 9, 1 });
+  iota_fill(row, 0, 3);
+  iota_fill(column, 0, 5);
+  ndarray<T, vector> line(vector{ 37 });
+  iota_fill(line, 0, 7);
+  ndarray<T, matrix, Layout> out(a.extents());
+
+  simd::add(a, row, out);
+  for (index_type i = 0; i < 9; ++i)
+    for (index_type j = 0; j < 37; ++j)
+      ASSERT_EQ(out(i, j), T(a(i, j) + row(0, j)));
+
+  simd::sub(column, a, out);
+  for (index_type i = 0; i < 9; ++i)
+    for (index_type j = 0; j < 37; ++j)
+      ASSERT_EQ(out(i, j), T(column(i, 0) - a(i, j)));
+
+  simd::mul(column, line, out);
+  for (index_type i = 0; i < 9; ++i)
+    for (index_type j = 0; j < 37; ++j)
+      ASSERT_EQ(out(i, j), T(column(i, 0) * line(j)));
+
+  simd::max(a, T(100), out);
+  for (index_type i = 0; i < 9; ++i)
+    for (index_type j = 0; j < 37; ++j)
+      ASSERT_EQ(out(i, j), std::max(a(i, j), T(100)));
+
+  // an explicit stride 0 view and a strided output
+  ndarray<T, matrix> wide(matrix{ 9, 74 }, T(-1));
+  ndspan<T, matrix, layout_stride> odd(
+    wide.data() + 1,
+    layout_stride::mapping<matrix>(matrix{ 9, 37 }, { 74, 2 }));
+  simd::min(broadcast_to(line, a.extents()), a, odd);
+  for (index_type i = 0; i < 9; ++i)
+    for (index_type j = 0; j < 37; ++j) {
+      ASSERT_EQ(wide(i, 2 * j), T(-1));
+      ASSERT_EQ(wide(i, 2 * j + 1), std::min(line(j), a(i, j)));
+    }
+}
+
+TEST(BroadcastTest, SimdKernelsEveryIsa)
+{
+  isa_guard guard;
+  for (auto isa : { simd_isa::scalar,
+                    simd_isa::sse2,
+                    simd_isa::avx2,
+                    simd_isa::avx512 }) {
+    set_simd_isa(isa);
+    SCOPED_TRACE(simd_isa_name(active_simd_isa()));
+    check_simd_broadcast<float, layout_right>();
+    check_simd_broadcast<double, layout_left>();
+    check_simd_broadcast<std::int32_t, layout_right>();
+    check_simd_broadcast<std::int16_t, layout_right>();
+  }
+
+  // a scalar operand of flat ranges
+  std::vector<float> x(19, 2.0f), y(19);
+  simd::mul(3.0f, x, y);
+  EXPECT_EQ(y[18], 6.0f);
+}
+
+TEST(BroadcastTest, ScalarsIntoStridedOutput)
+{
+  // only the column is written, not the storage it spans
+  ndarray<float, matrix> m(matrix{ 4, 4 }, -1.0f);
+  simd::add(1.0f, 2.0f, subndspan(m, full_extent, 1));
+  detail::for_each_index(m.extents(), [&](const auto& idx) {
+    EXPECT_EQ(m(idx), idx[1] == 1 ? 3.0f : -1.0f);
+  });
+}
+
+TEST(BroadcastTest, FlatRangesWithShapedOutput)
+{
+  // plain ranges do not broadcast, they are read flat in the order of 'out'
+  std::vector<float> a(12), b(12, 0.5f);
+  for (std::size_t k = 0; k < a.size(); ++k)
+    a[k] = float(k);
+  const span<const float> sa(a.data(), a.size());
+  const span<const float> sb(b.data(), b.size());
+
+  ndarray<float, dims<1>> line(dims<1>{ 12 });
+  simd::add(sa, sb, line);
+  EXPECT_EQ(line(11), 11.5f);
+
+  ndarray<float, matrix> grid(matrix{ 3, 4 });
+  simd::mul(a, sb, grid);
+  EXPECT_EQ(grid(2, 3), 5.5f);
+  simd::sub(sa, 1.0f, grid.view());
+  EXPECT_EQ(grid(1, 0), 3.0f);
+}
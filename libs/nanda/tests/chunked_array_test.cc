@@ -0,0 +1,263 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "nanda/chunked_array.hh"
+#include "nanda/ndarray.hh"
+#include "nanda/subndspan.hh"
+
+#include "test_utils.hh"
+
+using namespace nanda;
+using namespace nanda::test;
+
+namespace {
+
+using matrix = dextents<index_type, 2>;
+using cube = dextents<index_type, 3>;
+
+///@brief Number of chunk files in the array directory 'dir'
+std::size_t
+chunk_files(const temp_path& dir)
+{
+  std::size_t n = 0;
+  for (const auto& entry : std::filesystem::directory_iterator(dir.path))
+    n += entry.path().filename().string().front() == 'c';
+  return n;
+}
+
+template<class T>
+void
+check_round_trip(const chunk_options& options)
+{
+  const temp_path dir(std::string("round_trip_") +
+                     detail::codec_name(options.codec));
+  ndarray<T, cube> arr(cube{ 13, 17, 9 });
+  iota_fill(arr, -100);
+  {
+    chunked_array<T, 3> store(
+      dir.path, arr.extents(), cube{ 4, 5, 4 }, options);
+    EXPECT_EQ(store.grid_extents(), (cube{ 4, 4, 3 }));
+    store.write({ 0, 0, 0 }, arr);
+  }
+  // every chunk written, edge chunks included
+  EXPECT_EQ(chunk_files(dir), 48u);
+
+  const chunked_array<T, 3> opened(dir.path);
+  EXPECT_EQ(opened.extents(), arr.extents());
+  EXPECT_EQ(opened.chunk_extents(), (cube{ 4, 5, 4 }));
+  EXPECT_EQ(opened.options().codec, options.codec);
+  EXPECT_EQ(opened.options().delta, options.delta);
+  EXPECT_EQ(opened.options().shuffle, options.shuffle);
+
+  chunked_array<T, 3> store(dir.path);
+  ndarray<T, cube> out(arr.extents());
+  store.read({ 0, 0, 0 }, out);
+  EXPECT_TRUE(same_elements(out, arr));
+
+  // a box across chunk borders, into a strided view
+  ndarray<T, cube> big(cube{ 8, 8, 8 });
+  const auto box = subndspan(
+    big, std::pair{ 1, 7 }, strided_slice{ 0, 8, 2 }, std::pair{ 2, 7 });
+  store.read({ 5, 3, 2 }, box);
+  const auto expected = subndspan(
+    arr, std::pair{ 5, 11 }, std::pair{ 3, 7 }, std::pair{ 2, 7 });
+  EXPECT_TRUE(same_elements(box, expected));
+}
+
+} // namespace
+
+TEST(ChunkedArrayTest, RoundTripEveryCodec)
+{
+  for (auto codec :
+       { chunk_codec::none, chunk_codec::lz4, chunk_codec::zstd }) {
+    if (!codec_available(codec))
+      continue;
+    SCOPED_TRACE(detail::codec_name(codec));
+    check_round_trip<float>({ codec, 1, false, false });
+    check_round_trip<double>({ codec, 3, false, true });
+    check_round_trip<std::int32_t>({ codec, 1, true, false });
+    check_round_trip<std::uint16_t>({ codec, 1, true, true });
+    check_round_trip<std::int8_t>({ codec, 1, true, true });
+  }
+}
+
+TEST(ChunkedArrayTest, PartialWritesTouchOverlappingChunks)
+{
+  const temp_path dir("partial");
+  chunked_array<std::int64_t, 2> store(dir.path,
+                                       matrix{ 100, 100 },
+                                       matrix{ 10, 10 },
+                                       {},
+                                       default_chunk_cache,
+                                       -1);
+
+  // never written chunks read as the fill value, without a file
+  ndarray<std::int64_t, matrix> box(matrix{ 15, 15 });
+  store.read({ 42, 42 }, box);
+  EXPECT_EQ(box(0, 0), -1);
+  EXPECT_EQ(box(14, 14), -1);
+  EXPECT_EQ(store.stats().loads, 0u);
+
+  // a box over parts of four chunks and all of none
+  ndarray<std::int64_t, matrix> patch(matrix{ 6, 6 });
+  iota_fill(patch);
+  store.write({ 7, 17 }, patch);
+  store.flush();
+  EXPECT_EQ(store.stats().stores, 4u);
+  EXPECT_EQ(chunk_files(dir), 4u);
+
+  // a whole chunk written is not read first
+  ndarray<std::int64_t, matrix> whole(matrix{ 10, 10 }, 5);
+  store.write({ 90, 90 }, whole);
+  store.flush();
+  EXPECT_EQ(chunk_files(dir), 5u);
+
+  chunked_array<std::int64_t, 2> opened(dir.path, 0);
+  EXPECT_EQ(opened.fill_value(), -1);
+  ndarray<std::int64_t, matrix> out(matrix{ 8, 8 });
+  opened.read({ 6, 16 }, out);
+  EXPECT_EQ(opened.stats().loads, 4u);
+  for (index_type i = 0; i < 8; ++i)
+    for (index_type j = 0; j < 8; ++j) {
+      const bool inside = i >= 1 && i < 7 && j >= 1 && j < 7;
+      EXPECT_EQ(out(i, j), inside ? patch(i - 1, j - 1) : -1);
+    }
+  ndarray<std::int64_t, matrix> corner(matrix{ 1, 1 });
+  opened.read({ 99, 99 }, corner);
+  EXPECT_EQ(corner(0, 0), 5);
+}
+
+TEST(ChunkedArrayTest, NonFiniteFillSurvivesReopening)
+{
+  const temp_path dir("nan_fill");
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  chunked_array<float, 2>(
+    dir.path, matrix{ 8, 8 }, matrix{ 4, 4 }, {}, default_chunk_cache, nan);
+
+  chunked_array<float, 2> opened(dir.path);
+  EXPECT_TRUE(std::isnan(opened.fill_value()));
+  ndarray<float, matrix> box(matrix{ 2, 2 }, 0.0f);
+  opened.read({ 3, 3 }, box);
+  EXPECT_TRUE(std::isnan(box(1, 1)));
+
+  const temp_path other("inf_fill");
+  const double inf = std::numeric_limits<double>::infinity();
+  chunked_array<double, 1>(
+    other.path, dims<1>{ 4 }, dims<1>{ 2 }, {}, default_chunk_cache, -inf);
+  EXPECT_EQ((chunked_array<double, 1>(other.path).fill_value()), -inf);
+
+  // a fill that does not parse is an error, not a zero
+  std::ifstream in(other.path / ".nanda_chunks");
+  std::string metadata(std::istreambuf_iterator<char>(in), {});
+  in.close();
+  metadata.replace(metadata.find("fill "), std::string::npos, "fill oops\n");
+  std::ofstream(other.path / ".nanda_chunks", std::ios::trunc) << metadata;
+  EXPECT_THROW((chunked_array<double, 1>(other.path)), std::runtime_error);
+}
+
+TEST(ChunkedArrayTest, BoundedCache)
+{
+  const temp_path dir("cache");
+  // room for two chunks of 8 x 8 floats
+  chunked_array<float, 2> store(dir.path,
+                                matrix{ 32, 32 },
+                                matrix{ 8, 8 },
+                                {},
+                                2 * 64 * sizeof(float));
+  ndarray<float, matrix> arr(matrix{ 32, 32 });
+  iota_fill(arr);
+  store.write({ 0, 0 }, arr);
+  // evicted dirty chunks are written back on the way
+  EXPECT_EQ(store.stats().stores, 14u);
+  EXPECT_LE(store.cached_bytes(), 2 * 64 * sizeof(float));
+  store.flush();
+  EXPECT_EQ(store.stats().stores, 16u);
+
+  ndarray<float, matrix> row(matrix{ 1, 32 });
+  store.read({ 3, 0 }, row);
+  store.read({ 4, 0 }, row);
+  EXPECT_EQ(store.stats().loads, 8u);
+  EXPECT_EQ(row(0, 31), arr(4, 31));
+
+  // the last two chunks of the row stay cached
+  ndarray<float, matrix> tail(matrix{ 1, 16 });
+  const auto hits = store.stats().hits;
+  store.read({ 5, 16 }, tail);
+  EXPECT_EQ(store.stats().hits, hits + 2);
+}
+
+TEST(ChunkedArrayTest, Readahead)
+{
+  const temp_path dir("readahead");
+  chunked_array<std::uint8_t, 2> store(
+    dir.path, matrix{ 8, 64 }, matrix{ 8, 8 });
+  ndarray<std::uint8_t, matrix> arr(matrix{ 8, 64 }, 7);
+  store.write({ 0, 0 }, arr);
+  store.flush();
+
+  chunked_array<std::uint8_t, 2> scan(dir.path, 0);
+  scan.set_readahead(2);
+  ndarray<std::uint8_t, matrix> column(matrix{ 8, 8 });
+  for (index_type c = 0; c < 8; ++c)
+    scan.read({ 0, 8 * c }, column);
+  // announced from the third chunk on, up to the end of the grid
+  EXPECT_EQ(scan.stats().readaheads, 2u + 2 + 2 + 2 + 1);
+  EXPECT_EQ(column(7, 7), 7);
+}
+
+TEST(ChunkedArrayTest, CorruptChunkIsNotCached)
+{
+  const temp_path dir("corrupt");
+  {
+    chunked_array<float, 2> store(dir.path, matrix{ 8, 4 }, matrix{ 4, 4 });
+    store.write({ 0, 0 }, ndarray<float, matrix>(matrix{ 8, 4 }, 5.0f));
+  }
+  std::ofstream(dir.path / "c0", std::ios::binary | std::ios::trunc) << "bad";
+
+  chunked_array<float, 2> store(dir.path);
+  ndarray<float, matrix> box(matrix{ 2, 2 });
+  EXPECT_THROW(store.read({ 0, 0 }, box), std::runtime_error);
+  EXPECT_THROW(store.read({ 0, 0 }, box), std::runtime_error);
+  // a partial write fails too instead of replacing the chunk by fill values
+  EXPECT_THROW(store.write({ 1, 1 }, box), std::runtime_error);
+  store.flush();
+  EXPECT_EQ(std::filesystem::file_size(dir.path / "c0"), 3u);
+
+  store.read({ 4, 0 }, box);
+  EXPECT_EQ(box(1, 1), 5.0f);
+}
+
+TEST(ChunkedArrayTest, Errors)
+{
+  const temp_path dir("errors");
+  chunked_array<double, 2> store(dir.path, matrix{ 10, 10 }, matrix{ 4, 4 });
+  ndarray<double, matrix> box(matrix{ 4, 4 });
+  EXPECT_THROW(store.read({ 7, 0 }, box), std::out_of_range);
+  EXPECT_THROW(store.write({ -1, 0 }, box), std::out_of_range);
+
+  EXPECT_THROW(
+    (chunked_array<double, 2>(dir.path, matrix{ 10, 10 }, matrix{ 4, 4 })),
+    std::runtime_error);
+  EXPECT_THROW((chunked_array<float, 2>(dir.path)), std::runtime_error);
+  EXPECT_THROW((chunked_array<double, 3>(dir.path)), std::runtime_error);
+  EXPECT_THROW((chunked_array<double, 2>(dir.path / "missing")),
+               std::runtime_error);
+
+  const temp_path other("errors_options");
+  EXPECT_THROW((chunked_array<double, 2>(other.path,
+                                         matrix{ 10, 10 },
+                                         matrix{ 4, 4 },
+                                         { chunk_codec::none, 1, true })),
+               std::invalid_argument);
+  EXPECT_THROW(
+    (chunked_array<double, 2>(other.path, matrix{ 10, 10 }, matrix{ 0, 4 })),
+    std::invalid_argument);
+}
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "nanda/ndarray.hh"
+
+using namespace nanda;
+
+namespace {
+
+using matrix = dextents<index_type, 2>;
+
+template<class Layout = layout_right>
+ndarray<double, matrix, Layout>
+iota_matrix(index_type rows, index_type cols, double start)
+{
+  ndarray<double, matrix, Layout> arr(matrix{ rows, cols });
+  for (index_type i = 0; i < rows; ++i)
+    for (index_type j = 0; j < cols; ++j)
+      arr(i, j) = start + double(i * cols + j);
+  return arr;
+}
+
+} // namespace
+
+TEST(ExpressionTest, ArithmeticIsFused)
+{
+  auto a = iota_matrix(3, 4, 1);
+  auto b = iota_matrix(3, 4, 2);
+  auto c = iota_matrix(3, 4, 3);
+
+  auto expr = a * b + c * 2.0 - 1.0 / a;
+  static_assert(detail::is_expression_v<decltype(expr)>);
+  ndarray<double, matrix> result = expr;
+
+  for (index_type i = 0; i < 3; ++i)
+    for (index_type j = 0; j < 4; ++j)
+      EXPECT_DOUBLE_EQ(result(i, j),
+                       a(i, j) * b(i, j) + c(i, j) * 2.0 - 1.0 / a(i, j));
+
+  // the expression is lazy, it sees the current values of its operands
+  a.fill(0.5);
+  result = expr;
+  EXPECT_DOUBLE_EQ(result(1, 1), 0.5 * b(1, 1) + c(1, 1) * 2.0 - 2.0);
+}
+
+TEST(ExpressionTest, ComparisonsAndFunctions)
+{
+  auto a = iota_matrix(2, 3, -2);
+  ndarray<bool, matrix> positive = a > 0.0;
+  ndarray<double, matrix> root = sqrt(abs(a)) + maximum(a, 0.0);
+
+  for (index_type i = 0; i < 2; ++i)
+    for (index_type j = 0; j < 3; ++j) {
+      EXPECT_EQ(positive(i, j), a(i, j) > 0.0);
+      EXPECT_DOUBLE_EQ(root(i, j),
+                       std::sqrt(std::abs(a(i, j))) + std::max(a(i, j), 0.0));
+    }
+
+  ndarray<bool, matrix> both = (a >= -1.0) && !(a == 2.0);
+  EXPECT_FALSE(both(0, 0));
+  EXPECT_TRUE(both(0, 1));
+  EXPECT_FALSE(both(1, 1));
+}
+
+TEST(ExpressionTest, MixedLayoutsUseTheIndexPath)
+{
+  auto a = iota_matrix(3, 5, 0);
+  auto b = iota_matrix<layout_left>(3, 5, 0);
+  auto padded = iota_matrix<layout_right_padded<4>>(3, 5, 0);
+
+  ndarray<double, matrix> c(matrix{ 3, 5 });
+  EXPECT_TRUE((a + a).derived().flat_compatible(c.view()));
+  EXPECT_FALSE((a + b).derived().flat_compatible(c.view()));
+
+  c = a + b - padded;
+  for (index_type i = 0; i < 3; ++i)
+    for (index_type j = 0; j < 5; ++j)
+      EXPECT_DOUBLE_EQ(c(i, j), b(i, j));
+}
+
+TEST(ExpressionTest, AssignToView)
+{
+  auto a = iota_matrix(4, 4, 0);
+  ndarray<float, matrix> out(matrix{ 4, 4 }, -1.0f);
+
+  // every other column of 'out', through a strided view
+  using strided = ndspan<float, matrix, layout_stride>;
+  strided cols(out.data(),
+               layout_stride::mapping<matrix>(matrix{ 4, 2 }, { 4, 2 }));
+  ndspan<const double, matrix, layout_stride> src(
+    a.data(), layout_stride::mapping<matrix>(matrix{ 4, 2 }, { 4, 2 }));
+  assign(cols, src * 2.0);
+
+  for (index_type i = 0; i < 4; ++i)
+    for (index_type j = 0; j < 4; ++j)
+      EXPECT_EQ(out(i, j), j % 2 == 0 ? float(2 * a(i, j)) : -1.0f);
+}
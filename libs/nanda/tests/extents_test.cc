@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+
+#include "nanda/index_algos.hh"
+#include "nanda/ndarray.hh"
+
+using namespace nanda;
+
+TEST(ExtentsTest, StaticExtentsTakeNoStorage)
+{
+  static_assert(std::is_empty_v<extents<int, 3, 3>>);
+  static_assert(std::is_empty_v<extents<int, 3, 3, 3>>);
+  static_assert(std::is_trivially_copyable_v<extents<int, 4, 4>>);
+  static_assert(sizeof(extents<int, dynamic_extent, 3>) == sizeof(int));
+  static_assert(sizeof(extents<long, 2, dynamic_extent, dynamic_extent>) ==
+                2 * sizeof(long));
+  static_assert(sizeof(dextents<int, 3>) == 3 * sizeof(int));
+}
+
+TEST(ExtentsTest, RankAndStaticExtent)
+{
+  using ext = extents<int, 2, dynamic_extent, 4, dynamic_extent>;
+  static_assert(ext::rank() == 4);
+  static_assert(ext::rank_dynamic() == 2);
+  static_assert(ext::static_extent(0) == 2);
+  static_assert(ext::static_extent(1) == dynamic_extent);
+  static_assert(extents<int, 3, 3>::rank_dynamic() == 0);
+  static_assert(dextents<int, 5>::rank_dynamic() == 5);
+  static_assert(Rank<ext>::value == 4);
+}
+
+TEST(ExtentsTest, ConstantFolding)
+{
+  constexpr extents<int, 3, 4, 5> ext;
+  static_assert(ext.extent(1) == 4);
+  static_assert(ext.fwd_prod_of_extents(0) == 1);
+  static_assert(ext.fwd_prod_of_extents(2) == 12);
+  static_assert(ext.rev_prod_of_extents(0) == 20);
+  static_assert(ext.rev_prod_of_extents(2) == 1);
+  static_assert(ext.size() == 60);
+}
+
+TEST(ExtentsTest, ConstructFromDynamicValues)
+{
+  extents<int, 2, dynamic_extent, 4, dynamic_extent> ext(3, 5);
+  EXPECT_EQ(ext.extent(0), 2);
+  EXPECT_EQ(ext.extent(1), 3);
+  EXPECT_EQ(ext.extent(2), 4);
+  EXPECT_EQ(ext.extent(3), 5);
+  EXPECT_EQ(ext.size(), 120u);
+
+  extents<int, 2, dynamic_extent, 4, dynamic_extent> all(2, 3, 4, 5);
+  EXPECT_EQ(all, ext);
+
+  std::array<int, 2> dyn{ 3, 5 };
+  extents<int, 2, dynamic_extent, 4, dynamic_extent> from_array = dyn;
+  EXPECT_EQ(from_array, ext);
+
+  span<int, 2> dyn_span(dyn);
+  extents<int, 2, dynamic_extent, 4, dynamic_extent> from_span = dyn_span;
+  EXPECT_EQ(from_span, ext);
+
+  extents deduced(2, 3, 4, 5);
+  static_assert(decltype(deduced)::rank_dynamic() == 4);
+  EXPECT_EQ(deduced, ext);
+  EXPECT_NE(deduced, (extents<int, 2, 3, 4, 6>{}));
+}
+
+TEST(ExtentsTest, Conversions)
+{
+  extents<int, 3, 4> fixed;
+  dextents<long, 2> dynamic = fixed;
+  EXPECT_EQ(dynamic.extent(0), 3);
+  EXPECT_EQ(dynamic.extent(1), 4);
+  EXPECT_EQ(dynamic, fixed);
+
+  static_assert(std::is_convertible_v<extents<int, 3, 4>, dextents<long, 2>>);
+  // dynamic to static or narrowing index types must be explicit
+  static_assert(!std::is_convertible_v<dextents<int, 2>, extents<int, 3, 4>>);
+  static_assert(std::is_constructible_v<extents<int, 3, 4>, dextents<int, 2>>);
+  static_assert(!std::is_convertible_v<dextents<long, 2>, dextents<int, 2>>);
+  static_assert(
+    !std::is_constructible_v<extents<int, 3, 4>, extents<int, 3, 5>>);
+}
+
+TEST(ExtentsTest, ShiftsMatchArrayDims)
+{
+  using dimension = std::array<size_type, 3>;
+  dimension dim{ 4, 1, 6 };
+  extents<int, 4, dynamic_extent, 6> ext(1);
+
+  EXPECT_EQ((get_shifts<StorageOrder::RowMajor>(ext)),
+            (get_shifts<StorageOrder::RowMajor>(dim)));
+  EXPECT_EQ((get_shifts<StorageOrder::ColMajor>(ext)),
+            (get_shifts<StorageOrder::ColMajor>(dim)));
+
+  std::array<index_type, 3> pos{ 1, 0, 3 };
+  EXPECT_EQ((flatten<StorageOrder::RowMajor>(pos, ext)), 9);
+  EXPECT_EQ((flatten<StorageOrder::ColMajor>(pos, ext)), 13);
+  EXPECT_EQ((unflatten<StorageOrder::RowMajor>(index_type(9), ext)), pos);
+
+  constexpr extents<int, 3, 3, 3> cube;
+  static_assert(get_shift<0, StorageOrder::RowMajor>(cube) == 9);
+  static_assert(get_shift<2, StorageOrder::ColMajor>(cube) == 9);
+}
+
+TEST(ExtentsTest, NdarrayWithExtents)
+{
+  ndarray<double, extents<int, 3, 3>> fixed;
+  EXPECT_EQ(fixed.size(), 9u);
+  fixed(2, 1) = 4.0;
+  EXPECT_EQ(fixed[7], 4.0);
+
+  ndarray<double, extents<int, dynamic_extent, 4>> dynamic(
+    extents<int, dynamic_extent, 4>(2));
+  EXPECT_EQ(dynamic.size(), 8u);
+  EXPECT_EQ(dynamic.extent(0), 2u);
+  EXPECT_EQ(dynamic.extent(1), 4u);
+}
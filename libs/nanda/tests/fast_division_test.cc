@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "nanda/fast_division.hh"
+#include "nanda/multi_index.hh"
+
+using namespace nanda;
+
+TEST(FastDivisionTest, Divider32)
+{
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<std::uint32_t> numerators;
+
+  std::vector<std::uint32_t> divisors{ 1, 2, 3, 5, 6, 7, 10, 12, 641, 4096 };
+  for (std::uint32_t d = 1; d < 300; ++d)
+    divisors.push_back(d);
+  divisors.push_back(0x7fffffff);
+  divisors.push_back(0x80000001);
+  divisors.push_back(0xffffffff);
+
+  for (auto d : divisors) {
+    divider<std::uint32_t> div(d);
+    EXPECT_EQ(div.divisor(), d);
+    for (std::uint32_t n : { 0u, 1u, d - 1, d, d + 1, 0xfffffffeu, 0xffffffffu })
+      EXPECT_EQ(n / div, n / d) << n << " / " << d;
+    for (int k = 0; k < 1000; ++k) {
+      auto n = numerators(gen);
+      EXPECT_EQ(n / div, n / d) << n << " / " << d;
+    }
+  }
+}
+
+TEST(FastDivisionTest, Divider64)
+{
+  std::mt19937_64 gen(7);
+  std::uniform_int_distribution<std::uint64_t> numerators;
+
+  for (std::uint64_t d : { std::uint64_t(1),
+                           std::uint64_t(3),
+                           std::uint64_t(7),
+                           std::uint64_t(1) << 40,
+                           (std::uint64_t(1) << 40) + 1,
+                           std::uint64_t(4096) * 4096 * 4096,
+                           std::numeric_limits<std::uint64_t>::max() }) {
+    divider<std::uint64_t> div(d);
+    for (int k = 0; k < 1000; ++k) {
+      auto n = numerators(gen);
+      EXPECT_EQ(n / div, n / d) << n << " / " << d;
+    }
+    EXPECT_EQ(std::numeric_limits<std::uint64_t>::max() / div,
+              std::numeric_limits<std::uint64_t>::max() / d);
+  }
+}
+
+TEST(FastDivisionTest, Constexpr)
+{
+  constexpr divider<std::uint32_t> div(7);
+  static_assert(700u / div == 100u);
+  static_assert(699u / div == 99u);
+}
+
+template<StorageOrder storage, class Dims>
+void
+check_all_indices(const Dims& dims)
+{
+  auto fast = make_unflattener<storage>(dims);
+  index_type size = fast.size();
+  for (index_type i = 0; i < size; ++i)
+    ASSERT_EQ(fast(i), (unflatten<storage>(i, dims))) << i;
+}
+
+TEST(FastDivisionTest, UnflattenerMatchesUnflatten)
+{
+  check_all_indices<StorageOrder::RowMajor>(std::array<size_type, 1>{ 7 });
+  check_all_indices<StorageOrder::RowMajor>(std::array<size_type, 2>{ 3, 6 });
+  check_all_indices<StorageOrder::ColMajor>(std::array<size_type, 2>{ 3, 6 });
+  check_all_indices<StorageOrder::RowMajor>(
+    std::array<size_type, 4>{ 3, 1, 8, 1 });
+  check_all_indices<StorageOrder::ColMajor>(
+    std::array<size_type, 4>{ 3, 1, 8, 1 });
+  check_all_indices<StorageOrder::RowMajor>(
+    std::array<size_type, 3>{ 17, 31, 64 });
+  check_all_indices<StorageOrder::ColMajor>(
+    std::array<size_type, 3>{ 17, 31, 64 });
+  check_all_indices<StorageOrder::RowMajor>(extents<index_type, 5, 9, 13>{});
+}
+
+TEST(FastDivisionTest, BatchedUnflatten)
+{
+  using dimension = std::array<size_type, 3>;
+  dimension dim{ 11, 7, 5 };
+  auto fast = make_unflattener<StorageOrder::RowMajor>(dim);
+
+  std::vector<index_type> flat(fast.size());
+  std::iota(flat.begin(), flat.end(), 0);
+  std::reverse(flat.begin(), flat.end());
+  std::vector<std::array<index_type, 3>> out(flat.size());
+
+  fast(span<const index_type>(flat), span<std::array<index_type, 3>>(out));
+  for (std::size_t k = 0; k < flat.size(); ++k)
+    EXPECT_EQ(out[k], (unflatten<StorageOrder::RowMajor>(flat[k], dim)));
+}
@@ -1,6 +1,8 @@
 
 #include <gtest/gtest.h>
 
+#include <cstdint>
+
 #include "nanda/index_algos.hh"
 
 using namespace nanda;
@@ -274,3 +276,43 @@ TEST(IndexAlgosTest, TestUnflatten4D)
   EXPECT_ANY_THROW((flatten<StorageOrder::ColMajor>(pos, dim)));
 #endif
 }
+
+TEST(IndexAlgosTest, TestStaticShape)
+{
+  using position = std::array<index_type, 3>;
+
+  // shifts, flat and unflattened indices all form at compile time
+  static_assert(static_shifts<StorageOrder::RowMajor, 4, 1, 6>[0] == 6);
+  static_assert(static_shifts<StorageOrder::ColMajor, 4, 1, 6>[2] == 4);
+  static_assert(flatten<StorageOrder::RowMajor, 4, 1, 6>(position{ 1, 0, 3 }) ==
+                9);
+  static_assert(flatten<StorageOrder::ColMajor, 4, 1, 6>(position{ 1, 0, 3 }) ==
+                13);
+  static_assert(unflatten<StorageOrder::RowMajor, 3, 1, 8>(23)[2] == 7);
+  constexpr auto idx =
+    unflatten<StorageOrder::ColMajor, 3, 1, 8>(index_type(6));
+  EXPECT_EQ(idx, (position{ 0, 0, 2 }));
+
+  // the same values as the runtime shape
+  const std::array<size_type, 3> dim{ 8, 2, 16 };
+  for (index_type i = 0; i < 256; ++i) {
+    const auto row = unflatten<StorageOrder::RowMajor, 8, 2, 16>(i);
+    const auto col = unflatten<StorageOrder::ColMajor, 8, 2, 16>(i);
+    EXPECT_EQ(row, (unflatten<StorageOrder::RowMajor>(i, dim)));
+    EXPECT_EQ(col, (unflatten<StorageOrder::ColMajor>(i, dim)));
+    EXPECT_EQ((flatten<StorageOrder::RowMajor, 8, 2, 16>(row)), i);
+    EXPECT_EQ((flatten<StorageOrder::ColMajor, 8, 2, 16>(col)), i);
+  }
+
+  // the flat index takes the type of the indices
+  const std::array<std::int64_t, 2> wide{ 70000, 70000 };
+  EXPECT_EQ((flatten<StorageOrder::RowMajor, 70001, 70001>(wide)),
+            std::int64_t(70000) * 70001 + 70000);
+
+#ifdef DEBUG
+  EXPECT_ANY_THROW(
+    (flatten<StorageOrder::RowMajor, 4, 1, 6>(position{ 1, 1, 3 })));
+  EXPECT_ANY_THROW(
+    (flatten<StorageOrder::RowMajor, 4, 1, 6>(position{ -1, 0, 3 })));
+#endif
+}
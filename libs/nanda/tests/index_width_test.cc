@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <type_traits>
+
+#include "nanda/fast_division.hh"
+#include "nanda/layouts.hh"
+#include "nanda/multi_index.hh"
+
+using namespace nanda;
+
+TEST(IndexWidthTest, IndexTypeForStaticSize)
+{
+  using std::is_same_v;
+  static_assert(is_same_v<index_type_for_t<3, 4, 5>, index32_type>);
+  static_assert(is_same_v<index_type_for_t<1024, 1024, 1024>, index32_type>);
+  static_assert(is_same_v<index_type_for_t<2048, 1024, 1024>, index64_type>);
+  static_assert(is_same_v<index_type_for_t<4096, 0, 4096>, index32_type>);
+  static_assert(is_same_v<index_type_for_t<3, dynamic_extent>, index64_type>);
+  static_assert(is_same_v<index_type_for_t<>, index32_type>);
+}
+
+TEST(IndexWidthTest, DefaultIndexType)
+{
+  using std::is_same_v;
+  static_assert(is_same_v<index_type, index64_type>);
+  static_assert(is_same_v<dims<3>::index_type, index64_type>);
+  static_assert(is_same_v<dims<2, index32_type>, dextents<index32_type, 2>>);
+  static_assert(is_same_v<extents_for<64, 64>::index_type, index32_type>);
+  static_assert(
+    is_same_v<extents_for<4096, 4096, 4096>::index_type, index64_type>);
+  static_assert(
+    is_same_v<extents_for<16, dynamic_extent>::index_type, index64_type>);
+
+  extents ext(4096, 4096, 4096);
+  static_assert(is_same_v<decltype(ext), dims<3>>);
+  EXPECT_EQ(ext.size(), std::size_t(1) << 36);
+}
+
+TEST(IndexWidthTest, FlattenInIndexType)
+{
+  using dimension = std::array<size_type, 3>;
+  dimension dim{ 4096, 4096, 4096 };
+
+  std::array<index64_type, 3> pos{ 4095, 4095, 4095 };
+  auto flat = flatten<StorageOrder::RowMajor>(pos, dim);
+  static_assert(std::is_same_v<decltype(flat), index64_type>);
+  EXPECT_EQ(flat, index64_type(4096) * 4096 * 4096 - 1);
+
+  auto md = unflatten<StorageOrder::RowMajor>(flat, dim);
+  static_assert(std::is_same_v<decltype(md), std::array<index64_type, 3>>);
+  EXPECT_EQ(md, pos);
+
+  pos = { 4095, 17, 3 };
+  flat = flatten<StorageOrder::ColMajor>(pos, dim);
+  EXPECT_EQ(flat, 4095 + 17 * 4096 + 3 * index64_type(4096) * 4096);
+  EXPECT_EQ((unflatten<StorageOrder::ColMajor>(flat, dim)), pos);
+
+  // 32 bit indices keep 32 bit arithmetic
+  std::array<index32_type, 3> small{ 1, 2, 3 };
+  auto small_flat = flatten<StorageOrder::RowMajor>(small, dim);
+  static_assert(std::is_same_v<decltype(small_flat), index32_type>);
+  EXPECT_EQ(small_flat, 1 * 4096 * 4096 + 2 * 4096 + 3);
+}
+
+TEST(IndexWidthTest, LargeMapping)
+{
+  using dimension = dextents<index64_type, 3>;
+  layout_right::mapping<dimension> right(dimension{ 4096, 4096, 4096 });
+  layout_left::mapping<dimension> left(dimension{ 4096, 4096, 4096 });
+
+  EXPECT_EQ(right.required_span_size(), index64_type(1) << 36);
+  EXPECT_EQ(right(4095, 4095, 4095), (index64_type(1) << 36) - 1);
+  EXPECT_EQ(left.stride(2), index64_type(1) << 24);
+  EXPECT_EQ(left(0, 0, 4095), index64_type(4095) << 24);
+}
+
+TEST(IndexWidthTest, NarrowIndexOverflow)
+{
+  using dimension = dextents<index32_type, 3>;
+#ifdef DEBUG
+  EXPECT_ANY_THROW(
+    (layout_right::mapping<dimension>(dimension{ 4096, 4096, 4096 })));
+  EXPECT_ANY_THROW(
+    (layout_left::mapping<dimension>(dimension{ 4096, 4096, 4096 })));
+#endif
+  EXPECT_NO_THROW(
+    (layout_right::mapping<dimension>(dimension{ 1024, 1024, 1024 })));
+}
+
+TEST(IndexWidthTest, IteratorsCarryIndexType)
+{
+  extents<index64_type, 2, dynamic_extent> ext(3);
+  auto range = multi_indices<StorageOrder::RowMajor>(ext);
+  static_assert(
+    std::is_same_v<decltype((*range.begin()).offset), index64_type>);
+  EXPECT_EQ(range.size(), 6);
+
+  auto fast = make_unflattener<StorageOrder::RowMajor>(
+    dextents<index64_type, 2>{ 65536, 65536 });
+  static_assert(std::is_same_v<decltype(fast)::index_type, index64_type>);
+  const index64_type flat = (index64_type(1) << 32) - 1;
+  EXPECT_EQ(fast(flat), (std::array<index64_type, 2>{ 65535, 65535 }));
+}
+
+TEST(IndexWidthTest, StaticExtentsFit)
+{
+  static_assert(detail::static_extents_fit<extents<index32_type, 1024, 1024>>);
+  static_assert(
+    !detail::static_extents_fit<extents<index32_type, 4096, 4096, 4096>>);
+  static_assert(
+    detail::static_extents_fit<extents<index64_type, 4096, 4096, 4096>>);
+  static_assert(!detail::static_extents_fit<extents<std::int8_t, 16, 16>>);
+}
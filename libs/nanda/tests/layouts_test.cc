@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <vector>
+
+#include "nanda/layouts.hh"
+#include "nanda/ndarray.hh"
+#include "nanda/ndspan.hh"
+
+using namespace nanda;
+
+TEST(LayoutsTest, LayoutForStorageOrder)
+{
+  static_assert(
+    std::is_same_v<layout_for_t<StorageOrder::RowMajor>, layout_right>);
+  static_assert(
+    std::is_same_v<layout_for_t<StorageOrder::ColMajor>, layout_left>);
+}
+
+TEST(LayoutsTest, PackedMappingsMatchFlatten)
+{
+  using dimension = std::array<size_type, 3>;
+  using position = std::array<index_type, 3>;
+  dimension dim{ 4, 1, 6 };
+  dextents<index_type, 3> ext(4, 1, 6);
+
+  layout_right::mapping<decltype(ext)> right(ext);
+  layout_left::mapping<decltype(ext)> left(ext);
+
+  EXPECT_EQ(right.required_span_size(), 24);
+  EXPECT_EQ(left.required_span_size(), 24);
+  EXPECT_EQ(right.stride(0), 6);
+  EXPECT_EQ(right.stride(2), 1);
+  EXPECT_EQ(left.stride(0), 1);
+  EXPECT_EQ(left.stride(2), 4);
+
+  position pos{ 1, 0, 3 };
+  EXPECT_EQ(right(pos), (flatten<StorageOrder::RowMajor>(pos, dim)));
+  EXPECT_EQ(left(pos), (flatten<StorageOrder::ColMajor>(pos, dim)));
+  EXPECT_EQ(right(1, 0, 3), 9);
+  EXPECT_EQ(left(1, 0, 3), 13);
+}
+
+TEST(LayoutsTest, PackedMappingProperties)
+{
+  using mapping = layout_right::mapping<extents<index_type, 3, 3>>;
+  static_assert(mapping::is_always_unique());
+  static_assert(mapping::is_always_exhaustive());
+  static_assert(mapping::is_always_contiguous());
+  static_assert(mapping::is_always_strided());
+
+  constexpr mapping map;
+  static_assert(map.required_span_size() == 9);
+  static_assert(map(2, 1) == 7);
+  static_assert(layout_left::mapping<extents<index_type, 3, 3>>{}(2, 1) == 5);
+}
+
+TEST(LayoutsTest, StrideMapping)
+{
+  using ext_t = dextents<index_type, 2>;
+  // every other column of a 4x8 row-major array
+  layout_stride::mapping<ext_t> map(ext_t(4, 4), { 8, 2 });
+
+  EXPECT_EQ(map(0, 0), 0);
+  EXPECT_EQ(map(1, 3), 14);
+  EXPECT_EQ(map.required_span_size(), 31);
+  EXPECT_TRUE(map.is_unique());
+  EXPECT_FALSE(map.is_exhaustive());
+  EXPECT_FALSE(map.is_contiguous());
+  static_assert(!layout_stride::mapping<ext_t>::is_always_contiguous());
+
+  layout_stride::mapping<ext_t> from_left(
+    layout_left::mapping<ext_t>(ext_t(4, 8)));
+  EXPECT_EQ(from_left.stride(0), 1);
+  EXPECT_EQ(from_left.stride(1), 4);
+  EXPECT_TRUE(from_left.is_exhaustive());
+  EXPECT_TRUE(from_left.is_contiguous());
+  EXPECT_EQ(from_left, (layout_left::mapping<ext_t>(ext_t(4, 8))));
+
+  layout_stride::mapping<ext_t> overlapping(ext_t(4, 4), { 1, 1 });
+  EXPECT_FALSE(overlapping.is_unique());
+  EXPECT_FALSE(overlapping.is_contiguous());
+}
+
+TEST(LayoutsTest, NonContiguousView)
+{
+  using ext_t = dextents<index_type, 2>;
+  std::vector<int> data(32);
+  std::iota(data.begin(), data.end(), 0);
+
+  ndspan<int, ext_t> full(data.data(), ext_t(4, 8));
+  ndspan<int, ext_t, layout_stride> odd_columns(
+    data.data() + 1, layout_stride::mapping<ext_t>(ext_t(4, 4), { 8, 2 }));
+
+  for (index_type j = 0; j < 4; ++j)
+    for (index_type i = 0; i < 4; ++i)
+      EXPECT_EQ(odd_columns(j, i), full(j, 2 * i + 1));
+
+  ndspan<int, ext_t, layout_stride> strided = full;
+  EXPECT_TRUE(strided.is_contiguous());
+  EXPECT_EQ(&strided(3, 7), &full(3, 7));
+}
+
+TEST(LayoutsTest, CopyTakesTheRightPath)
+{
+  using ext_t = dextents<index_type, 2>;
+  ndarray<int, ext_t> src(ext_t(3, 4));
+  std::iota(src.begin(), src.end(), 0);
+
+  // contiguous, same layout
+  ndarray<int, ext_t> same(ext_t(3, 4));
+  copy(src.view(), same.view());
+  EXPECT_TRUE(std::equal(src.begin(), src.end(), same.begin()));
+
+  // contiguous, different element order
+  ndarray<int, ext_t, layout_left> transposed(ext_t(3, 4));
+  copy(src.view(), transposed.view());
+  for (index_type j = 0; j < 3; ++j)
+    for (index_type i = 0; i < 4; ++i)
+      EXPECT_EQ(transposed(j, i), src(j, i));
+
+  // strided destination
+  std::vector<int> wide(3 * 8, -1);
+  ndspan<int, ext_t, layout_stride> every_other(
+    wide.data(), layout_stride::mapping<ext_t>(ext_t(3, 4), { 8, 2 }));
+  copy(src.view(), every_other);
+  for (index_type j = 0; j < 3; ++j)
+    for (index_type i = 0; i < 4; ++i) {
+      EXPECT_EQ(wide[j * 8 + 2 * i], src(j, i));
+      EXPECT_EQ(wide[j * 8 + 2 * i + 1], -1);
+    }
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <string>
+
+#include "nanda/mapped_array.hh"
+#include "nanda/ndarray.hh"
+#include "nanda/subndspan.hh"
+
+#include "test_utils.hh"
+
+using namespace nanda;
+using namespace nanda::test;
+
+namespace {
+
+using cube = dextents<index_type, 3>;
+using matrix = dextents<index_type, 2>;
+
+///@brief 'header' bytes then the floats 0, 1, 2, ...
+std::string
+float_file(std::size_t header, std::size_t count)
+{
+  std::string bytes(header + count * sizeof(float), 'h');
+  for (std::size_t k = 0; k < count; ++k) {
+    const float value = float(k);
+    std::memcpy(
+      bytes.data() + header + k * sizeof(float), &value, sizeof(float));
+  }
+  return bytes;
+}
+
+} // namespace
+
+TEST(MappedArrayTest, ReadOnly)
+{
+  const temp_path file("read_only");
+  file.write(float_file(0, 4 * 5 * 6));
+  const mapped_ndarray<const float, cube> arr(file.path, cube{ 4, 5, 6 });
+  static_assert(decltype(arr)::mode == map_mode::read_only);
+  static_assert(
+    std::is_same_v<decltype(arr.view()), ndspan<const float, cube>>);
+  EXPECT_EQ(arr.size(), 120u);
+  EXPECT_EQ(arr(0, 0, 0), 0.0f);
+  EXPECT_EQ(arr(3, 4, 5), 119.0f);
+  EXPECT_EQ(arr(std::array<index_type, 3>{ 1, 2, 3 }), 45.0f);
+  EXPECT_EQ(arr.as_span().size(), 120u);
+
+  // nanda algorithms take the view as any other
+  const ndarray<float, cube> twice = arr.view() * 2.0f;
+  EXPECT_EQ(twice(2, 2, 2), 2.0f * arr(2, 2, 2));
+
+  arr.advise(access_advice::sequential);
+  arr.advise(access_advice::random);
+  arr.prefetch();
+  arr.prefetch(
+    subndspan(arr.view(), 2, std::pair{ 1, 4 }, std::pair{ 2, 5 }));
+  arr.prefetch(subndspan(arr.view(), full_extent, full_extent, 3));
+}
+
+TEST(MappedArrayTest, CopyOnWriteAndOffsets)
+{
+  // a 16 byte header before the elements, an unaligned page offset
+  const auto bytes = float_file(16, 3 * 7);
+  const temp_path file("copy_on_write");
+  file.write(bytes);
+  mapped_ndarray<float, matrix, layout_left> arr(
+    file.path, matrix{ 3, 7 }, 16);
+  static_assert(decltype(arr)::mode == map_mode::copy_on_write);
+  EXPECT_EQ(arr(2, 0), 2.0f);
+  EXPECT_EQ(arr(0, 1), 3.0f);
+
+  for (auto& x : arr)
+    x = -x;
+  EXPECT_EQ(arr(2, 6), -20.0f);
+  // the file never changes
+  EXPECT_EQ(file.read(), bytes);
+
+  // moves keep the mapping
+  mapped_ndarray<float, matrix, layout_left> moved = std::move(arr);
+  EXPECT_EQ(moved(2, 6), -20.0f);
+  EXPECT_EQ(arr.data(), nullptr);
+
+  // the private copies dropped, the pages read the file again
+  moved.advise(access_advice::dont_need);
+  EXPECT_EQ(moved(2, 6), 20.0f);
+}
+
+TEST(MappedArrayTest, Errors)
+{
+  const temp_path file("short");
+  file.write(float_file(0, 10));
+  EXPECT_THROW(
+    (mapped_ndarray<const float, matrix>(file.path, matrix{ 3, 4 })),
+    std::out_of_range);
+  EXPECT_THROW(
+    (mapped_ndarray<const float, matrix>(file.path, matrix{ 2, 2 }, 2)),
+    std::invalid_argument);
+  EXPECT_THROW((mapped_ndarray<const float, matrix>(
+                 file.path.string() + ".missing", matrix{ 1, 1 })),
+               std::system_error);
+
+  // nothing to map
+  const mapped_ndarray<const float, matrix> empty(file.path, matrix{ 0, 4 });
+  EXPECT_TRUE(empty.empty());
+  empty.prefetch();
+}
+
+TEST(MappedArrayTest, SparseFileOpensWithoutReading)
+{
+  // 4 GiB of holes, mapping reads none of it
+  const temp_path file("sparse");
+  file.write({});
+  std::filesystem::resize_file(file.path, std::uintmax_t(1) << 32);
+  const mapped_ndarray<const std::int32_t, matrix> arr(
+    file.path, matrix{ 1 << 15, 1 << 15 });
+  EXPECT_EQ(arr((1 << 15) - 1, 12345), 0);
+  EXPECT_EQ(arr.file().size(), std::size_t(1) << 32);
+}
@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#include "nanda/multi_index.hh"
+
+using namespace nanda;
+
+TEST(MultiIndexTest, MatchesUnflattenRowMajor)
+{
+  using dimension = std::array<size_type, 4>;
+  dimension dim{ 3, 1, 4, 2 };
+
+  index_type expected = 0;
+  for (const auto& [idx, offset] : multi_indices<StorageOrder::RowMajor>(dim)) {
+    EXPECT_EQ(offset, expected);
+    EXPECT_EQ(idx, (unflatten<StorageOrder::RowMajor>(offset, dim)));
+    EXPECT_EQ(offset, (flatten<StorageOrder::RowMajor>(idx, dim)));
+    ++expected;
+  }
+  EXPECT_EQ(expected, 24);
+}
+
+TEST(MultiIndexTest, MatchesUnflattenColMajor)
+{
+  using dimension = std::array<size_type, 3>;
+  dimension dim{ 3, 5, 2 };
+
+  index_type expected = 0;
+  for (const auto& [idx, offset] : multi_indices<StorageOrder::ColMajor>(dim)) {
+    EXPECT_EQ(offset, expected);
+    EXPECT_EQ(idx, (unflatten<StorageOrder::ColMajor>(offset, dim)));
+    ++expected;
+  }
+  EXPECT_EQ(expected, 30);
+}
+
+TEST(MultiIndexTest, WorksWithExtents)
+{
+  extents<index_type, 2, dynamic_extent> ext(3);
+  auto range = multi_indices<StorageOrder::RowMajor>(ext);
+  EXPECT_EQ(range.size(), 6);
+
+  auto it = range.begin();
+  EXPECT_EQ((*it).index, (std::array<index_type, 2>{ 0, 0 }));
+  ++it;
+  ++it;
+  ++it;
+  EXPECT_EQ((*it).index, (std::array<index_type, 2>{ 1, 0 }));
+  EXPECT_EQ((*it).offset, 3);
+}
+
+TEST(MultiIndexTest, StdAlgorithms)
+{
+  using dimension = std::array<size_type, 3>;
+  auto range = multi_indices<StorageOrder::RowMajor>(dimension{ 4, 3, 5 });
+
+  EXPECT_EQ(std::distance(range.begin(), range.end()), 60);
+
+  auto diagonal =
+    std::count_if(range.begin(), range.end(), [](const auto& md) {
+      return md.index[0] == md.index[1] && md.index[1] == md.index[2];
+    });
+  EXPECT_EQ(diagonal, 3);
+
+  auto found = std::find_if(range.begin(), range.end(), [](const auto& md) {
+    return md.index == std::array<index_type, 3>{ 2, 1, 4 };
+  });
+  ASSERT_NE(found, range.end());
+  EXPECT_EQ((*found).offset, 2 * 15 + 1 * 5 + 4);
+}
+
+TEST(MultiIndexTest, EmptyRange)
+{
+  using dimension = std::array<size_type, 2>;
+  auto range = multi_indices<StorageOrder::RowMajor>(dimension{ 4, 0 });
+  EXPECT_TRUE(range.empty());
+  EXPECT_EQ(range.begin(), range.end());
+}
+
+TEST(MultiIndexTest, MultiPass)
+{
+  using dimension = std::array<size_type, 2>;
+  auto range = multi_indices<StorageOrder::RowMajor>(dimension{ 2, 3 });
+  static_assert(std::is_same_v<decltype(*range.begin()), md_index<2>>);
+  static_assert(std::is_same_v<std::iterator_traits<decltype(
+                                 range.begin())>::iterator_category,
+                               std::input_iterator_tag>);
+
+  // equal iterators yield equal values, which outlive the iterators
+  auto a = range.begin();
+  auto b = a;
+  const auto first = *a;
+  ++a;
+  ++b;
+  EXPECT_EQ((*a).index, (*b).index);
+  EXPECT_EQ(first.offset, 0);
+
+  const std::vector<md_index<2>> all(range.begin(), range.end());
+  ASSERT_EQ(all.size(), 6u);
+  EXPECT_EQ(all[4].index, (std::array<index_type, 2>{ 1, 1 }));
+  EXPECT_EQ(all[4].offset, 4);
+}
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "nanda/ndarray.hh"
+
+using namespace nanda;
+
+TEST(NdarrayTest, DefaultConstructor)
+{
+  ndarray<double, dextents<index_type, 2>> arr;
+  EXPECT_EQ(nullptr, arr.data());
+  EXPECT_EQ(0u, arr.size());
+  EXPECT_TRUE(arr.empty());
+}
+
+TEST(NdarrayTest, ConstructFromExtents)
+{
+  using dimension = dextents<index_type, 3>;
+  ndarray<double, dimension> arr(dimension{ 3, 4, 5 });
+
+  EXPECT_EQ(3u, arr.rank());
+  EXPECT_EQ(60u, arr.size());
+  EXPECT_EQ(4, arr.extent(1));
+  EXPECT_TRUE(is_aligned(arr.data()));
+  EXPECT_TRUE(std::all_of(
+    arr.begin(), arr.end(), [](double v) { return v == 0.0; }));
+
+  ndarray<float, dimension> filled(dimension{ 2, 2, 3 }, 1.5f);
+  EXPECT_EQ(12u, filled.size());
+  EXPECT_TRUE(is_aligned(filled.data()));
+  EXPECT_TRUE(std::all_of(
+    filled.begin(), filled.end(), [](float v) { return v == 1.5f; }));
+}
+
+TEST(NdarrayTest, StridesMatchGetShifts)
+{
+  using dimension = std::array<size_type, 3>;
+  dimension dim{ 4, 1, 6 };
+  dextents<index_type, 3> ext(4, 1, 6);
+
+  ndarray<int, dextents<index_type, 3>, layout_right> row(ext);
+  ndarray<int, dextents<index_type, 3>, layout_left> col(ext);
+
+  auto row_shifts = get_shifts<StorageOrder::RowMajor>(dim);
+  auto col_shifts = get_shifts<StorageOrder::ColMajor>(dim);
+  for (std::size_t r = 0; r < 3; ++r) {
+    EXPECT_EQ(size_type(row.stride(r)), row_shifts[r]);
+    EXPECT_EQ(size_type(col.stride(r)), col_shifts[r]);
+  }
+}
+
+TEST(NdarrayTest, IndexingMatchesFlatten)
+{
+  using dimension = std::array<size_type, 3>;
+  using position = std::array<index_type, 3>;
+  dimension dim{ 3, 4, 5 };
+  extents<index_type, 3, 4, 5> ext;
+
+  ndarray<int, decltype(ext), layout_right> row(ext);
+  ndarray<int, decltype(ext), layout_left> col(ext);
+  std::iota(row.begin(), row.end(), 0);
+  std::iota(col.begin(), col.end(), 0);
+
+  for (index_type k = 0; k < 3; ++k)
+    for (index_type j = 0; j < 4; ++j)
+      for (index_type i = 0; i < 5; ++i) {
+        position pos{ k, j, i };
+        EXPECT_EQ(row(k, j, i), (flatten<StorageOrder::RowMajor>(pos, dim)));
+        EXPECT_EQ(col(k, j, i), (flatten<StorageOrder::ColMajor>(pos, dim)));
+        EXPECT_EQ(&row(pos), &row(k, j, i));
+      }
+
+  row(1, 2, 3) = -1;
+  EXPECT_EQ(row[flatten<StorageOrder::RowMajor>(position{ 1, 2, 3 }, dim)],
+            -1);
+}
+
+TEST(NdarrayTest, CopyAndMove)
+{
+  using dimension = extents<index_type, 2, 3>;
+  ndarray<std::string, dimension> arr(dimension{}, "a");
+  arr(1, 2) = "b";
+
+  auto copy = arr;
+  EXPECT_NE(copy.data(), arr.data());
+  EXPECT_EQ(copy.extents(), arr.extents());
+  EXPECT_EQ(copy(1, 2), "b");
+  EXPECT_TRUE(is_aligned(copy.data()));
+
+  const auto* data = arr.data();
+  auto moved = std::move(arr);
+  EXPECT_EQ(moved.data(), data);
+  EXPECT_EQ(moved(0, 0), "a");
+  EXPECT_EQ(moved(1, 2), "b");
+
+  copy = moved;
+  EXPECT_EQ(copy(1, 2), "b");
+
+  // static extents stay, the storage goes
+  EXPECT_EQ(arr.storage_size(), 0u);
+  EXPECT_EQ(arr.begin(), arr.end());
+  arr = std::move(copy);
+  EXPECT_EQ(arr(1, 2), "b");
+  EXPECT_EQ(copy.storage_size(), 0u);
+}
+
+TEST(NdarrayTest, MovedFromIsEmpty)
+{
+  using dimension = dextents<index_type, 2>;
+  ndarray<int, dimension> arr(dimension{ 3, 4 }, 7);
+  ndarray<int, dimension> moved(std::move(arr));
+  EXPECT_EQ(moved.size(), 12u);
+  EXPECT_EQ(moved(2, 3), 7);
+
+  EXPECT_TRUE(arr.empty());
+  EXPECT_EQ(arr.extents(), dimension{});
+  EXPECT_EQ(arr.data(), nullptr);
+  EXPECT_EQ(arr.begin(), arr.end());
+
+  arr = std::move(moved);
+  EXPECT_EQ(arr.extent(1), 4);
+  EXPECT_TRUE(moved.empty());
+  EXPECT_EQ(moved.storage_size(), 0u);
+
+  // usable again once assigned
+  moved = ndarray<int, dimension>(dimension{ 1, 2 }, 5);
+  EXPECT_EQ(moved(0, 1), 5);
+}
+
+TEST(NdarrayTest, AsSpanAndView)
+{
+  using dimension = dextents<index_type, 2>;
+  ndarray<int, dimension> arr(dimension{ 2, 3 }, 7);
+
+  span<int> s = arr.as_span();
+  EXPECT_EQ(s.data(), arr.data());
+  EXPECT_EQ(s.size(), arr.size());
+  s[4] = 3;
+  EXPECT_EQ(arr(1, 1), 3);
+
+  auto v = arr.view();
+  EXPECT_EQ(v.data(), arr.data());
+  EXPECT_EQ(&v(1, 2), &arr(1, 2));
+  EXPECT_EQ(v.extents(), arr.extents());
+}
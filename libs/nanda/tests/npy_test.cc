@@ -0,0 +1,300 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "nanda/binary_io.hh"
+#include "nanda/ndarray.hh"
+#include "nanda/npy.hh"
+#include "nanda/subndspan.hh"
+
+#include "test_utils.hh"
+
+using namespace nanda;
+using namespace nanda::test;
+
+namespace {
+
+using vector = dextents<index_type, 1>;
+using matrix = dextents<index_type, 2>;
+using cube = dextents<index_type, 3>;
+
+///@brief An NPY file as numpy writes it, version 1
+std::string
+npy_bytes(const std::string& dict, const std::string& data)
+{
+  std::string header = dict;
+  header.append(64 - (10 + header.size() + 1) % 64, ' ');
+  header += '\n';
+  std::string bytes("\x93NUMPY\x01\x00", 8);
+  bytes += char(header.size() & 0xff);
+  bytes += char(header.size() >> 8);
+  return bytes + header + data;
+}
+
+} // namespace
+
+TEST(NpyTest, Header)
+{
+  EXPECT_EQ(npy_descr<float>(), "<f4");
+  EXPECT_EQ(npy_descr<const double>(), "<f8");
+  EXPECT_EQ(npy_descr<std::int16_t>(), "<i2");
+  EXPECT_EQ(npy_descr<std::uint64_t>(), "<u8");
+  EXPECT_EQ(npy_descr<std::uint8_t>(), "|u1");
+  EXPECT_EQ(npy_descr<bool>(), "|b1");
+
+  const temp_path file("header.npy");
+  ndarray<float, cube> arr(cube{ 2, 3, 4 });
+  write_npy(file.path, arr);
+  const auto header = read_npy_header(file.path);
+  EXPECT_EQ(header.descr, "<f4");
+  EXPECT_FALSE(header.fortran_order);
+  EXPECT_EQ(header.storage_order(), StorageOrder::RowMajor);
+  EXPECT_EQ(header.shape, (std::vector<std::size_t>{ 2, 3, 4 }));
+  EXPECT_EQ(header.size(), 24u);
+  // the elements start aligned, the file is the header and the elements
+  EXPECT_EQ(header.data_offset % 64, 0u);
+  EXPECT_EQ(file.read().size(), header.data_offset + 24 * sizeof(float));
+  EXPECT_EQ(file.read().substr(header.data_offset - 1, 1), "\n");
+
+  // the one element tuple of Python
+  write_npy(file.path, ndarray<int, vector>(vector{ 5 }));
+  EXPECT_NE(file.read().find("'shape': (5,)"), std::string::npos);
+  EXPECT_EQ(read_npy_header(file.path).shape,
+            (std::vector<std::size_t>{ 5 }));
+}
+
+TEST(NpyTest, RoundTrip)
+{
+  const temp_path file("round_trip.npy");
+  ndarray<double, cube> arr(cube{ 5, 6, 7 });
+  iota_fill(arr);
+  write_npy(file.path, arr);
+
+  EXPECT_TRUE(same_elements((read_npy<double, 3>(file.path)), arr));
+  // into an existing array or view, in bounded reads
+  ndarray<double, cube> out(arr.extents());
+  read_npy(file.path, out, 64);
+  EXPECT_TRUE(same_elements(out, arr));
+  // C order into a layout_left array goes through the staging buffer
+  EXPECT_TRUE(
+    same_elements((read_npy<double, 3, layout_left>(file.path, 100)), arr));
+
+  ndarray<float, cube> floats(arr.extents());
+  EXPECT_THROW(read_npy(file.path, floats), std::runtime_error);
+  EXPECT_THROW((read_npy<float, 3>(file.path)), std::runtime_error);
+  EXPECT_THROW((read_npy<double, 2>(file.path)), std::runtime_error);
+  ndarray<double, cube> wrong(cube{ 5, 6, 8 });
+  EXPECT_THROW(read_npy(file.path, wrong), std::runtime_error);
+}
+
+TEST(NpyTest, FortranOrder)
+{
+  const temp_path file("fortran.npy");
+  ndarray<std::int32_t, matrix, layout_left> arr(matrix{ 9, 13 });
+  iota_fill(arr);
+  write_npy(file.path, arr);
+  const auto header = read_npy_header(file.path);
+  EXPECT_TRUE(header.fortran_order);
+  EXPECT_EQ(header.storage_order(), StorageOrder::ColMajor);
+
+  // the column major elements as they are in memory
+  std::string data(reinterpret_cast<const char*>(arr.data()),
+                   arr.size() * sizeof(std::int32_t));
+  EXPECT_EQ(file.read().substr(header.data_offset), data);
+
+  const auto left = read_npy<std::int32_t, 2, layout_left>(file.path);
+  const auto right = read_npy<std::int32_t, 2>(file.path);
+  for (index_type i = 0; i < 9; ++i)
+    for (index_type j = 0; j < 13; ++j) {
+      ASSERT_EQ(left(i, j), arr(i, j));
+      ASSERT_EQ(right(i, j), arr(i, j));
+    }
+}
+
+TEST(NpyTest, StridedSource)
+{
+  const temp_path file("strided.npy");
+  ndarray<float, cube> arr(cube{ 6, 7, 8 });
+  iota_fill(arr);
+  const auto box =
+    subndspan(arr, std::pair{ 1, 5 }, 3, strided_slice{ 1, 4, 2 });
+  write_npy(file.path, box, 8);
+  const auto back = read_npy<float, 2>(file.path);
+  EXPECT_EQ(back.extents(), (matrix{ 4, 2 }));
+  EXPECT_TRUE(same_elements(back, box));
+}
+
+TEST(NpyTest, Hyperslab)
+{
+  const temp_path file("slab.npy");
+  ndarray<std::int64_t, cube> arr(cube{ 64, 50, 40 });
+  iota_fill(arr);
+  write_npy(file.path, arr);
+
+  const auto check = [&](const auto& box, std::array<std::size_t, 3> first) {
+    for (index_type i = 0; i < box.extent(0); ++i)
+      for (index_type j = 0; j < box.extent(1); ++j)
+        for (index_type k = 0; k < box.extent(2); ++k)
+          ASSERT_EQ(box(i, j, k),
+                    arr(index_type(first[0]) + i,
+                        index_type(first[1]) + j,
+                        index_type(first[2]) + k));
+  };
+
+  // whole planes, read straight into the array
+  ndarray<std::int64_t, cube> planes(cube{ 10, 50, 40 });
+  read_npy(file.path, { 20, 0, 0 }, planes);
+  check(planes, { 20, 0, 0 });
+
+  // short runs, grouped through the staging buffer
+  ndarray<std::int64_t, cube> box(cube{ 7, 9, 11 });
+  read_npy(file.path, { 3, 17, 29 }, box);
+  check(box, { 3, 17, 29 });
+  read_npy(file.path, { 3, 17, 29 }, box, 256);
+  check(box, { 3, 17, 29 });
+
+  // into a column major array and a strided view of a larger one
+  ndarray<std::int64_t, cube, layout_left> left(cube{ 5, 50, 40 });
+  read_npy(file.path, { 59, 0, 0 }, left, 1000);
+  check(left, { 59, 0, 0 });
+  ndarray<std::int64_t, cube> big(cube{ 8, 60, 40 }, -1);
+  auto view = subndspan(
+    big, strided_slice{ 0, 4, 2 }, std::pair{ 5, 55 }, full_extent);
+  read_npy(file.path, { 1, 0, 0 }, view, 4096);
+  check(view, { 1, 0, 0 });
+  EXPECT_EQ(big(1, 10, 0), -1);
+  EXPECT_EQ(big(0, 4, 0), -1);
+
+  EXPECT_THROW((read_npy(file.path, { 60, 0, 0 }, planes)), std::out_of_range);
+  EXPECT_THROW((read_npy(file.path, { 0, 0, 30 }, box)), std::out_of_range);
+}
+
+TEST(NpyTest, NumpyFiles)
+{
+  const temp_path file("numpy.npy");
+  // big endian doubles in Fortran order, as numpy writes them
+  const double values[] = { 1.5, -2.0, 3.25, 4.0, 5.5, -6.75 };
+  std::string data;
+  for (double v : values) {
+    char bytes[sizeof(double)];
+    std::memcpy(bytes, &v, sizeof(double));
+    std::reverse(bytes, bytes + sizeof(double));
+    data.append(bytes, sizeof(double));
+  }
+  file.write(npy_bytes(
+    "{'descr': '>f8', 'fortran_order': True, 'shape': (2, 3), }", data));
+  const auto arr = read_npy<double, 2>(file.path);
+  EXPECT_EQ(arr(0, 0), 1.5);
+  EXPECT_EQ(arr(1, 0), -2.0);
+  EXPECT_EQ(arr(0, 1), 3.25);
+  EXPECT_EQ(arr(1, 2), -6.75);
+
+  // a scalar
+  const std::int32_t answer = 42;
+  file.write(npy_bytes(
+    "{'descr': '<i4', 'fortran_order': False, 'shape': (), }",
+    std::string(reinterpret_cast<const char*>(&answer), 4)));
+  EXPECT_EQ((read_npy<std::int32_t, 0>(file.path)()), 42);
+
+  file.write("not an npy file");
+  EXPECT_THROW(read_npy_header(file.path), std::runtime_error);
+  file.write(npy_bytes("{'descr': '<i4', 'shape': (3,), }", ""));
+  EXPECT_THROW(read_npy_header(file.path), std::runtime_error);
+  file.write(npy_bytes(
+    "{'descr': '<i4', 'fortran_order': False, 'shape': (3,), }",
+    std::string(8, '\0')));
+  EXPECT_THROW((read_npy<std::int32_t, 1>(file.path)), std::runtime_error);
+  EXPECT_THROW(read_npy_header(file.path.string() + ".missing"),
+               std::system_error);
+}
+
+TEST(NpyTest, RawBinary)
+{
+  const temp_path file("raw.bin");
+  ndarray<std::uint16_t, matrix> arr(matrix{ 30, 20 });
+  iota_fill(arr);
+
+  write_raw(file.path, arr);
+  EXPECT_EQ(file.read().size(), arr.size() * sizeof(std::uint16_t));
+  ndarray<std::uint16_t, matrix> out(arr.extents());
+  read_raw(file.path, out);
+  EXPECT_TRUE(same_elements(out, arr));
+
+  // column major on disk, read back as a box after a header
+  write_raw<StorageOrder::ColMajor>(file.path, arr);
+  ndarray<std::uint16_t, matrix, layout_left> left(arr.extents());
+  read_raw<StorageOrder::ColMajor>(file.path, left);
+  const auto bytes = file.read();
+  EXPECT_EQ(std::memcmp(left.data(), bytes.data(), bytes.size()), 0);
+
+  file.write(std::string(6, 'h') + file.read());
+  ndarray<std::uint16_t, matrix> box(matrix{ 4, 5 });
+  read_raw<StorageOrder::ColMajor>(file.path, arr.extents(), { 10, 7 }, box, 6);
+  for (index_type i = 0; i < 4; ++i)
+    for (index_type j = 0; j < 5; ++j)
+      EXPECT_EQ(box(i, j), arr(10 + i, 7 + j));
+
+  ndarray<std::uint16_t, matrix> too_big(matrix{ 40, 20 });
+  EXPECT_THROW(read_raw(file.path, too_big), std::runtime_error);
+}
+
+TEST(NpyTest, StreamSlabs)
+{
+  const temp_path file("stream.npy");
+  ndarray<float, cube> arr(cube{ 37, 11, 5 });
+  iota_fill(arr);
+  write_npy(file.path, arr);
+
+  std::vector<index_type> firsts;
+  index_type rows = 0;
+  for_each_npy_slab<float, 3>(
+    file.path, 8, [&](index_type first, const auto& slab) {
+      firsts.push_back(first);
+      for (index_type i = 0; i < slab.extent(0); ++i)
+        for (index_type j = 0; j < 11; ++j)
+          for (index_type k = 0; k < 5; ++k)
+            ASSERT_EQ(slab(i, j, k), arr(first + i, j, k));
+      rows += slab.extent(0);
+    });
+  EXPECT_EQ(firsts, (std::vector<index_type>{ 0, 8, 16, 24, 32 }));
+  EXPECT_EQ(rows, 37);
+
+  // column major slabs along the last axis
+  index_type planes = 0;
+  for_each_npy_slab<float, 3, layout_left>(
+    file.path, 2, [&](index_type first, const auto& slab) {
+      EXPECT_EQ(slab.extent(0), 37);
+      for (index_type k = 0; k < slab.extent(2); ++k)
+        ASSERT_EQ(slab(36, 10, k), arr(36, 10, first + k));
+      planes += slab.extent(2);
+    });
+  EXPECT_EQ(planes, 5);
+
+  // an explicit pool, a single thread one reads ahead synchronously
+  for (std::size_t threads : { 1, 3 }) {
+    thread_pool pool(threads);
+    index_type sum = 0;
+    for_each_npy_slab<float, 3>(
+      pool, file.path, 5, [&](index_type first, const auto& slab) {
+        EXPECT_EQ(slab(0, 0, 0), arr(first, 0, 0));
+        sum += slab.extent(0);
+      });
+    EXPECT_EQ(sum, 37);
+  }
+
+  // an exception of the processing stops the stream
+  int calls = 0;
+  const auto stop = [&](index_type, const auto&) {
+    if (++calls == 3)
+      throw std::logic_error("stop");
+  };
+  EXPECT_THROW((for_each_npy_slab<float, 3>(file.path, 4, stop)),
+               std::logic_error);
+  EXPECT_EQ(calls, 3);
+}
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <new>
+
+#include "nanda/arena.hh"
+#include "nanda/ndarray.hh"
+#include "nanda/numa.hh"
+#include "nanda/tiled_layout.hh"
+
+using namespace nanda;
+
+namespace {
+
+using matrix = dextents<index_type, 2>;
+
+template<class Array, class T>
+bool
+all_equal(const Array& arr, const T& value)
+{
+  for (const auto& x : arr)
+    if (x != value)
+      return false;
+  return true;
+}
+
+} // namespace
+
+TEST(NumaTest, PageResourceMapsLargeBlocks)
+{
+  page_resource resource(huge_pages::transparent, 1 << 16);
+  const auto huge = detail::huge_page_size();
+
+  // small blocks come from upstream
+  void* small = resource.allocate(1000, 64);
+  EXPECT_EQ(resource.stats().upstream_bytes, 1000u);
+
+  // large ones are fresh, zero and huge page aligned mappings
+  auto* large = static_cast<unsigned char*>(resource.allocate(huge + 1, 64));
+  EXPECT_TRUE(is_aligned(large, huge));
+  EXPECT_EQ(large[0], 0);
+  EXPECT_EQ(large[huge], 0);
+  EXPECT_EQ(resource.stats().upstream_allocations, 2u);
+  EXPECT_EQ(resource.stats().upstream_bytes, 1000u + 2 * huge);
+  EXPECT_EQ(resource.stats().bytes_in_use, 1001u + huge);
+
+  resource.deallocate(large, huge + 1, 64);
+  resource.deallocate(small, 1000, 64);
+  EXPECT_EQ(resource.stats().bytes_in_use, 0u);
+
+  page_resource base(huge_pages::none, 1 << 16);
+  void* p = base.allocate(100000, 4096);
+  EXPECT_TRUE(is_aligned(static_cast<char*>(p), detail::page_size()));
+  EXPECT_EQ(base.stats().upstream_bytes,
+            detail::round_up(100000, detail::page_size()));
+  base.deallocate(p, 100000, 4096);
+
+  // explicit huge pages need a reserved pool, which may be empty
+  page_resource reserved(huge_pages::reserved);
+  try {
+    void* q = reserved.allocate(huge, 64);
+    EXPECT_TRUE(is_aligned(static_cast<char*>(q), huge));
+    reserved.deallocate(q, huge, 64);
+  } catch (const std::bad_alloc&) {
+    EXPECT_EQ(reserved.stats().allocations, 0u);
+  }
+}
+
+TEST(NumaTest, FirstTouchFillsEveryLayout)
+{
+  thread_pool pool(4);
+  page_resource resource(huge_pages::transparent, 1 << 12);
+  const resource_allocator<double> alloc(&resource);
+
+  const auto right =
+    make_first_touch(pool, matrix{ 300, 70 }, 1.5, alloc, 1000);
+  EXPECT_TRUE(all_equal(right, 1.5));
+  EXPECT_EQ(right.get_allocator().resource(), &resource);
+  EXPECT_EQ(resource.stats().upstream_allocations, 1u);
+
+  const auto left = make_first_touch<layout_left>(pool, matrix{ 33, 91 }, 2);
+  EXPECT_TRUE(all_equal(left, 2));
+
+  const auto padded =
+    make_first_touch<layout_right_padded<16>>(pool, matrix{ 45, 7 }, 3.0f);
+  EXPECT_GT(padded.storage_size(), padded.size());
+  EXPECT_TRUE(all_equal(padded, 3.0f));
+
+  using tiled = layout_tiled<8, 8>;
+  const auto tiles = make_first_touch<tiled>(pool, matrix{ 20, 13 }, 4);
+  EXPECT_TRUE(all_equal(tiles, 4));
+  EXPECT_EQ(tiles(19, 12), 4);
+
+  const auto empty = make_first_touch(pool, matrix{ 0, 5 }, 0);
+  EXPECT_EQ(empty.size(), 0u);
+}
+
+TEST(NumaTest, DefaultInitLeavesThePagesUntouched)
+{
+  page_resource resource(huge_pages::none);
+  const resource_allocator<float> alloc(&resource);
+  ndarray<float, matrix, layout_right, resource_allocator<float>> arr(
+    matrix{ 1024, 1024 }, default_init, alloc);
+
+  const auto untouched = page_placement(arr);
+  const auto pages = arr.storage_size() * sizeof(float) / detail::page_size();
+  EXPECT_EQ(untouched.not_present, pages);
+  EXPECT_EQ(untouched.resident(), 0u);
+  EXPECT_EQ(untouched.page_bytes, detail::page_size());
+
+  // the first rows only
+  for (index_type j = 0; j < 1024 * 16; ++j)
+    arr[j] = 1.0f;
+  const auto touched = page_placement(arr);
+  EXPECT_EQ(touched.resident(),
+            16 * 1024 * sizeof(float) / detail::page_size());
+  EXPECT_EQ(touched.not_present + touched.resident(), pages);
+  EXPECT_FALSE(touched.pages_per_node.empty());
+  EXPECT_NE(touched.to_string().find("node "), std::string::npos);
+  EXPECT_EQ(touched.huge_bytes, 0u);
+
+  EXPECT_EQ(page_placement(nullptr, 0).resident(), 0u);
+}
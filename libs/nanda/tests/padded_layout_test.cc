@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <set>
+
+#include "nanda/ndarray.hh"
+
+using namespace nanda;
+
+TEST(PaddedLayoutTest, PitchIsRoundedUp)
+{
+  using dimension = dextents<index_type, 3>;
+  layout_right_padded<16>::mapping<dimension> map(dimension{ 3, 5, 20 });
+
+  EXPECT_EQ(map.pitch(), 32);
+  EXPECT_EQ(map.strides(), (std::array<index_type, 3>{ 5 * 32, 32, 1 }));
+  EXPECT_EQ(map.required_span_size(), 3 * 5 * 32);
+  EXPECT_FALSE(map.is_exhaustive());
+  static_assert(decltype(map)::row_alignment() == 16);
+  static_assert(row_alignment_v<decltype(map)> == 16);
+  static_assert(row_alignment_v<layout_right::mapping<dimension>> == 1);
+
+  // an exact multiple needs no padding
+  layout_right_padded<16>::mapping<dimension> exact(dimension{ 3, 5, 48 });
+  EXPECT_EQ(exact.pitch(), 48);
+  EXPECT_TRUE(exact.is_exhaustive());
+}
+
+TEST(PaddedLayoutTest, RankOnePadsItsRow)
+{
+  using dimension = dims<1>;
+  layout_right_padded<16>::mapping<dimension> map(dimension{ 10 });
+  EXPECT_EQ(map.pitch(), 16);
+  EXPECT_EQ(map.required_span_size(), 16);
+  EXPECT_FALSE(map.is_exhaustive());
+
+  layout_right_padded<16>::mapping<dimension> exact(dimension{ 32 });
+  EXPECT_EQ(exact.required_span_size(), 32);
+  EXPECT_TRUE(exact.is_exhaustive());
+
+  // the whole row is stored, a full vector may read its end
+  ndarray<float, dimension, layout_right_padded<16>> arr(dimension{ 10 });
+  EXPECT_EQ(arr.storage_size(), 16u);
+}
+
+TEST(PaddedLayoutTest, AntiAliasPadOnPowerOfTwoPitch)
+{
+  using dimension = dextents<index_type, 2>;
+  using layout = layout_right_padded<16, 1>;
+
+  layout::mapping<dimension> aliasing(dimension{ 4, 64 });
+  EXPECT_EQ(aliasing.pitch(), 64 + 16);
+
+  // 48 is not a power of two, left alone
+  layout::mapping<dimension> other(dimension{ 4, 40 });
+  EXPECT_EQ(other.pitch(), 48);
+}
+
+TEST(PaddedLayoutTest, PaddingIsHiddenFromIndexing)
+{
+  using dimension = extents<index_type, 4, 3, 7>;
+  layout_right_padded<8>::mapping<dimension> map;
+
+  std::set<index_type> offsets;
+  detail::for_each_index(map.extents(), [&](const auto& idx) {
+    const auto offset = map(idx);
+    // never lands in the padding of a row
+    EXPECT_LT(offset % map.pitch(), 7);
+    EXPECT_EQ(offset, fast_flatten(idx, map.extents(), get_shifts(map)));
+    offsets.insert(offset);
+  });
+  EXPECT_EQ(offsets.size(), map.extents().size());
+  EXPECT_EQ(get_shifts(map), (std::array<std::size_t, 3>{ 24, 8, 1 }));
+
+  layout_stride::mapping<dimension> strided(map);
+  EXPECT_EQ(strided(3, 2, 6), map(3, 2, 6));
+}
+
+TEST(PaddedLayoutTest, NdarrayRowsAreAligned)
+{
+  using dimension = dextents<index_type, 2>;
+  ndarray<float, dimension, layout_aligned_rows<float>> arr(dimension{ 5, 13 });
+
+  EXPECT_EQ(arr.size(), 5 * 13);
+  EXPECT_EQ(arr.storage_size(), 5 * 16);
+  EXPECT_TRUE(rows_aligned(arr.view()));
+  for (index_type i = 0; i < 5; ++i)
+    EXPECT_TRUE(is_aligned(&arr(i, 0)));
+
+  for (index_type i = 0; i < 5; ++i)
+    for (index_type j = 0; j < 13; ++j)
+      arr(i, j) = float(i * 13 + j);
+
+  ndarray<float, dimension> packed(dimension{ 5, 13 });
+  copy(arr.view(), packed.view());
+  for (index_type k = 0; k < 5 * 13; ++k)
+    EXPECT_EQ(packed.data()[k], float(k));
+
+  // packed rows of 13 floats are not
+  EXPECT_FALSE(rows_aligned(packed.view()));
+}
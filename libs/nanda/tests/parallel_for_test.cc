@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+#include "nanda/ndarray.hh"
+#include "nanda/parallel_for.hh"
+
+using namespace nanda;
+
+TEST(ParallelForTest, VisitsEveryIndexOnce)
+{
+  thread_pool pool(4);
+  using dimension = std::array<size_type, 3>;
+  dimension dim{ 7, 5, 11 };
+  std::vector<std::atomic<int>> visits(7 * 5 * 11);
+
+  // small grain, many blocks for the four threads to share
+  parallel_for(
+    pool,
+    dim,
+    [&](const auto& idx, index_type offset) {
+      EXPECT_EQ(offset, (flatten<StorageOrder::RowMajor>(idx, dim)));
+      ++visits[std::size_t(offset)];
+    },
+    16);
+  for (const auto& v : visits)
+    EXPECT_EQ(v.load(), 1);
+
+  // the pool is reused
+  std::atomic<int> calls{ 0 };
+  parallel_for(pool, dim, [&](const auto&) { ++calls; }, 1);
+  EXPECT_EQ(calls.load(), 7 * 5 * 11);
+}
+
+TEST(ParallelForTest, ColMajorOffsets)
+{
+  thread_pool pool(3);
+  extents<index_type, 4, dynamic_extent> ext(9);
+  std::vector<std::atomic<int>> visits(36);
+
+  parallel_for<StorageOrder::ColMajor>(
+    pool,
+    ext,
+    [&](const std::array<index_type, 2>& idx, index_type offset) {
+      EXPECT_EQ(offset, idx[0] + 4 * idx[1]);
+      ++visits[std::size_t(offset)];
+    },
+    4);
+  for (const auto& v : visits)
+    EXPECT_EQ(v.load(), 1);
+}
+
+TEST(ParallelForTest, RankOneAndEmpty)
+{
+  thread_pool pool(2);
+  std::vector<std::atomic<int>> visits(1000);
+  parallel_for(
+    pool,
+    std::array<size_type, 1>{ 1000 },
+    [&](const auto& idx) { ++visits[std::size_t(idx[0])]; },
+    64);
+  for (const auto& v : visits)
+    EXPECT_EQ(v.load(), 1);
+
+  parallel_for(pool, std::array<size_type, 2>{ 3, 0 }, [](const auto&) {
+    FAIL() << "no index to visit";
+  });
+}
+
+TEST(ParallelForTest, Blocks)
+{
+  thread_pool pool(4);
+  using dimension = dextents<index_type, 3>;
+  ndarray<int, dimension> arr(dimension{ 6, 5, 7 }, 0);
+
+  // one call per block of whole rows, strides taken once per block
+  std::atomic<int> blocks{ 0 };
+  parallel_for(
+    pool,
+    arr.extents(),
+    [&](const std::array<index_type, 3>& first,
+        index_type offset,
+        index_type rows) {
+      ++blocks;
+      EXPECT_EQ(first[2], 0);
+      EXPECT_EQ(offset, (flatten<StorageOrder::RowMajor>(first, arr.extents())));
+      int* row = &arr(first);
+      for (index_type r = 0; r < rows; ++r, row += arr.stride(1))
+        for (index_type j = 0; j < arr.extent(2); ++j)
+          row[j] += int(offset + r * arr.extent(2) + j);
+    },
+    14);
+  EXPECT_EQ(blocks.load(), 15);
+  for (const auto& [idx, offset] : multi_indices<StorageOrder::RowMajor>(
+         arr.extents()))
+    EXPECT_EQ(arr[offset], int(offset));
+
+  // a rank 1 block is a run of elements
+  std::vector<std::atomic<int>> visits(100);
+  parallel_for(
+    pool,
+    std::array<size_type, 1>{ 100 },
+    [&](const auto& first, index_type offset, index_type count) {
+      EXPECT_EQ(first[0], offset);
+      for (index_type i = 0; i < count; ++i)
+        ++visits[std::size_t(offset + i)];
+    },
+    8);
+  for (const auto& v : visits)
+    EXPECT_EQ(v.load(), 1);
+}
+
+TEST(ParallelForTest, FillsAnArray)
+{
+  using dimension = dextents<index_type, 3>;
+  ndarray<float, dimension> arr(dimension{ 16, 17, 18 });
+
+  parallel_for(arr.extents(), [&](const auto& idx) {
+    arr(idx) = float(idx[0] * 10000 + idx[1] * 100 + idx[2]);
+  });
+  for (const auto& [idx, offset] : multi_indices<StorageOrder::RowMajor>(
+         arr.extents()))
+    EXPECT_EQ(arr[offset], float(idx[0] * 10000 + idx[1] * 100 + idx[2]));
+}
+
+TEST(ParallelForTest, ExceptionsPropagate)
+{
+  thread_pool pool(4);
+  std::array<size_type, 2> dim{ 64, 64 };
+  EXPECT_THROW(parallel_for(
+                 pool,
+                 dim,
+                 [](const auto& idx) {
+                   if (idx[0] == 40)
+                     throw std::runtime_error("failed");
+                 },
+                 64),
+               std::runtime_error);
+
+  // nested loops run serially on the calling thread
+  std::atomic<int> calls{ 0 };
+  pool.run(8, [&](std::size_t) {
+    parallel_for(pool, dim, [&](const auto&) { ++calls; });
+  });
+  EXPECT_EQ(calls.load(), 8 * 64 * 64);
+}
+
+TEST(ParallelForTest, SubmittedJobs)
+{
+  thread_pool pool(3);
+  std::atomic<int> calls{ 0 };
+  std::vector<std::future<void>> jobs;
+  for (int k = 0; k < 16; ++k)
+    jobs.push_back(pool.submit([&] { ++calls; }));
+
+  // a loop runs alongside the jobs
+  std::array<size_type, 2> dim{ 32, 32 };
+  parallel_for(pool, dim, [&](const auto&) { ++calls; });
+  for (auto& job : jobs)
+    job.get();
+  EXPECT_EQ(calls.load(), 16 + 32 * 32);
+
+  auto failed = pool.submit([] { throw std::runtime_error("failed"); });
+  EXPECT_THROW(failed.get(), std::runtime_error);
+
+  // without workers the job runs on the calling thread
+  thread_pool single(1);
+  auto inline_job = single.submit([&] { ++calls; });
+  EXPECT_EQ(inline_job.wait_for(std::chrono::seconds(0)),
+            std::future_status::ready);
+}
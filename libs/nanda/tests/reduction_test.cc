@@ -0,0 +1,253 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "nanda/ndarray.hh"
+#include "nanda/reduction.hh"
+#include "nanda/subndspan.hh"
+
+using namespace nanda;
+
+namespace {
+
+using cube = dextents<index_type, 3>;
+using matrix = dextents<index_type, 2>;
+
+///@brief Small integers of both signs in a pattern without runs
+template<class Array>
+void
+scrambled_fill(Array& arr)
+{
+  int k = 0;
+  detail::for_each_index(arr.extents(), [&](const auto& idx) {
+    arr(idx) = typename Array::value_type((k * 37) % 101 - 50);
+    ++k;
+  });
+}
+
+///@brief Brute-force sum of 'arr' over the axes flagged in 'reduced'
+template<class Array, class Result>
+void
+expect_sums(const Array& arr, const std::array<bool, 3>& reduced, const Result& got)
+{
+  std::vector<double> expected(got.size(), 0.0);
+  detail::for_each_index(arr.extents(), [&](const auto& idx) {
+    std::size_t out = 0;
+    for (std::size_t a = 0; a < 3; ++a)
+      if (!reduced[a])
+        out = out * std::size_t(arr.extent(a)) + std::size_t(idx[a]);
+    expected[out] += double(arr(idx));
+  });
+  std::size_t out = 0;
+  detail::for_each_index(got.extents(), [&](const auto& idx) {
+    EXPECT_EQ(double(got(idx)), expected[out++]);
+  });
+}
+
+template<class Layout>
+void
+check_every_axis_set(thread_pool& pool)
+{
+  ndarray<int, cube, Layout> arr(cube{ 5, 7, 3 });
+  scrambled_fill(arr);
+
+  expect_sums(arr, { true, false, false }, sum(arr, axes<0>));
+  expect_sums(arr, { false, true, false }, sum(arr, 1));
+  expect_sums(arr, { false, false, true }, sum(arr, axes<2>, summation::naive, pool));
+  expect_sums(arr, { true, false, true }, sum(arr, axes<2, 0>));
+  expect_sums(arr,
+              { false, true, true },
+              sum(arr, std::array<int, 2>{ 1, 2 }, summation::naive, pool));
+  expect_sums(arr, { true, true, false }, sum(arr.view(), axes<0, 1>));
+
+  const auto total = sum(arr, axes<0, 1, 2>);
+  static_assert(decltype(total)::rank() == 0);
+  expect_sums(arr, { true, true, true }, total);
+}
+
+} // namespace
+
+TEST(ReductionTest, SumAlongEveryAxisSet)
+{
+  thread_pool pool(3);
+  check_every_axis_set<layout_right>(pool);
+  check_every_axis_set<layout_left>(pool);
+  check_every_axis_set<layout_right_padded<16>>(pool);
+  // no strides, reduced index by index
+  check_every_axis_set<layout_tiled<2, 4, 2>>(pool);
+
+  // 64 bit accumulation by default
+  ndarray<std::int32_t, matrix> big(matrix{ 2, 3 }, 2000000000);
+  const auto s = sum(big, 1);
+  static_assert(std::is_same_v<decltype(s)::value_type, std::int64_t>);
+  EXPECT_EQ(s(0), 6000000000);
+}
+
+TEST(ReductionTest, StridedViews)
+{
+  ndarray<float, matrix> arr(matrix{ 6, 8 });
+  scrambled_fill(arr);
+
+  // every second column, the smallest stride is 2
+  ndspan<const float, matrix, layout_stride> odd(
+    arr.data() + 1, layout_stride::mapping<matrix>(matrix{ 6, 4 }, { 8, 2 }));
+  const auto rows = sum(odd, 1);
+  const auto cols = sum(odd, 0);
+  for (index_type i = 0; i < 6; ++i) {
+    float expected = 0;
+    for (index_type j = 0; j < 4; ++j)
+      expected += arr(i, 2 * j + 1);
+    EXPECT_EQ(rows(i), expected);
+  }
+  for (index_type j = 0; j < 4; ++j) {
+    float expected = 0;
+    for (index_type i = 0; i < 6; ++i)
+      expected += arr(i, 2 * j + 1);
+    EXPECT_EQ(cols(j), expected);
+  }
+
+  // into a column of a caller-owned array
+  ndarray<double, matrix> out(matrix{ 6, 2 }, -1.0);
+  ndspan<double, dextents<index_type, 1>, layout_stride> column(
+    out.data() + 1,
+    layout_stride::mapping<dextents<index_type, 1>>(
+      dextents<index_type, 1>{ 6 }, { 2 }));
+  reduce(arr, axes<1>, column, max_reducer<float>{});
+  for (index_type i = 0; i < 6; ++i) {
+    EXPECT_EQ(out(i, 0), -1.0);
+    float expected = arr(i, 0);
+    for (index_type j = 1; j < 8; ++j)
+      expected = std::max(expected, arr(i, j));
+    EXPECT_EQ(out(i, 1), expected);
+  }
+}
+
+TEST(ReductionTest, MinMaxArgAndMean)
+{
+  ndarray<float, matrix> arr(matrix{ 3, 5 });
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  const float values[3][5] = { { 1, 4, 4, 0, 2 },
+                               { nan, -3, 7, -3, 7 },
+                               { 2, 2, 2, 2, 2 } };
+  for (index_type i = 0; i < 3; ++i)
+    for (index_type j = 0; j < 5; ++j)
+      arr(i, j) = values[i][j];
+
+  const auto lo = amin(arr, 1);
+  const auto hi = amax(arr, 1);
+  const auto first_lo = argmin(arr, 1);
+  const auto first_hi = argmax(arr, 1);
+  const index_type expected_lo[] = { 3, 1, 0 };
+  const index_type expected_hi[] = { 1, 2, 0 };
+  const float lo_values[] = { 0, -3, 2 };
+  const float hi_values[] = { 4, 7, 2 };
+  for (index_type i = 0; i < 3; ++i) {
+    EXPECT_EQ(lo(i), lo_values[i]);
+    EXPECT_EQ(hi(i), hi_values[i]);
+    EXPECT_EQ(first_lo(i), expected_lo[i]);
+    EXPECT_EQ(first_hi(i), expected_hi[i]);
+  }
+
+  // column-wise, positions are the row indices
+  const auto column_hi = argmax(arr, 0);
+  EXPECT_EQ(column_hi(0), 2);
+  EXPECT_EQ(column_hi(2), 1);
+  EXPECT_EQ(column_hi(3), 2);
+
+  // flat positions within several axes
+  EXPECT_EQ(argmax(arr, axes<0, 1>)(), 7);
+
+  const auto m = mean(arr, 0);
+  EXPECT_FLOAT_EQ(m(1), 1.0f);
+  EXPECT_TRUE(std::isnan(m(0)));
+
+  // empty reductions
+  ndarray<float, matrix> empty(matrix{ 4, 0 });
+  EXPECT_EQ(sum(empty, 1)(2), 0.0f);
+  EXPECT_EQ(argmax(empty, 1)(2), -1);
+  EXPECT_EQ(amin(empty, 1)(2), std::numeric_limits<float>::infinity());
+  EXPECT_EQ(sum(empty, 0).size(), 0u);
+}
+
+TEST(ReductionTest, AccurateSummation)
+{
+  // 1 followed by many values below half its ulp, the naive running sum
+  // rounds every addition
+  constexpr index_type n = 1 << 18;
+  constexpr float small = 1e-7f;
+  const double exact = 1.0 + double(n - 1) * double(small);
+
+  // column-wise, one running sum per output
+  ndarray<float, matrix> columns(matrix{ n, 2 }, small);
+  columns(0, 0) = columns(0, 1) = 1.0f;
+  const auto naive = sum(columns, 0);
+  const auto pairwise = sum(columns, 0, summation::pairwise);
+  const auto kahan = sum(columns, 0, summation::kahan);
+  EXPECT_GT(std::abs(naive(0) - exact), 1e-3);
+  EXPECT_LT(std::abs(pairwise(0) - exact), 1e-5);
+  EXPECT_LT(std::abs(kahan(0) - exact), 1e-6);
+  EXPECT_EQ(kahan(0), kahan(1));
+
+  // along contiguous runs
+  ndarray<float, dextents<index_type, 1>> row(dextents<index_type, 1>{ n },
+                                              small);
+  row(0) = 1.0f;
+  EXPECT_LT(std::abs(sum(row, 0, summation::pairwise)() - exact), 1e-5);
+  EXPECT_LT(std::abs(sum(row, 0, summation::kahan)() - exact), 1e-6);
+
+  // the mean of doubles in double, integers in double
+  ndarray<int, matrix> ints(matrix{ 2, 3 }, 1);
+  ints(1, 2) = 2;
+  const auto m = mean(ints, axes<0, 1>, summation::kahan);
+  static_assert(std::is_same_v<decltype(m)::value_type, double>);
+  EXPECT_DOUBLE_EQ(m(), 7.0 / 6.0);
+}
+
+TEST(ReductionTest, PairwiseWithShortInnerAxis)
+{
+  // runs of 4 along the unit axis, pairwise over the runs as well
+  constexpr index_type n = 1 << 20;
+  const double exact = double(n) * 4 * double(0.1f);
+  ndarray<float, matrix> arr(matrix{ n, 4 }, 0.1f);
+  const auto naive = sum(arr, axes<0, 1>);
+  EXPECT_GT(std::abs(naive() - exact), 1.0);
+  EXPECT_LT(std::abs(sum(arr, axes<0, 1>, summation::pairwise)() - exact),
+            0.1);
+
+  // the runs cannot join: 4 columns of 8, and a layout_left position order
+  ndarray<float, matrix> wide(matrix{ n, 8 }, 0.1f);
+  const auto left4 = subndspan(wide, full_extent, std::pair{ 0, 4 });
+  EXPECT_LT(std::abs(sum(left4, axes<0, 1>, summation::pairwise)() - exact),
+            0.1);
+  ndarray<float, matrix, layout_left> tall(matrix{ 4, n }, 0.1f);
+  EXPECT_LT(std::abs(sum(tall, axes<0, 1>, summation::pairwise)() - exact),
+            0.1);
+}
+
+TEST(ReductionTest, ThreadCountDoesNotChangeResults)
+{
+  thread_pool serial(1), parallel(4);
+  ndarray<float, cube> arr(cube{ 9, 33, 70 });
+  scrambled_fill(arr);
+  for (auto& x : arr)
+    x *= 0.37f;
+
+  // a grain small enough to chunk every reduction
+  constexpr std::size_t grain = 64;
+  const auto check = [&](auto axes_to_reduce) {
+    const auto ext = detail::reduced_extents(
+      arr.extents(), detail::axes_array(axes_to_reduce));
+    ndarray<float, remove_cvref_t<decltype(ext)>> one(ext), four(ext);
+    reduce(arr, axes_to_reduce, one.view(), sum_reducer<float>{}, serial, grain);
+    reduce(
+      arr, axes_to_reduce, four.view(), sum_reducer<float>{}, parallel, grain);
+    for (size_type k = 0; k < one.size(); ++k)
+      EXPECT_EQ(one[index_type(k)], four[index_type(k)]);
+  };
+  check(axes<2>);
+  check(axes<0>);
+  check(axes<0, 2>);
+  check(axes<0, 1, 2>);
+}
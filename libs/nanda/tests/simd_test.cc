@@ -0,0 +1,257 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "nanda/ndarray.hh"
+#include "nanda/simd.hh"
+#include "nanda/subndspan.hh"
+#include "nanda/tiled_layout.hh"
+
+#include "test_utils.hh"
+
+using namespace nanda;
+using namespace nanda::test;
+
+namespace {
+
+template<class T>
+std::vector<T>
+ramp(std::size_t n, T start, T step)
+{
+  std::vector<T> v(n);
+  for (std::size_t k = 0; k < n; ++k)
+    v[k] = T(start + T(k) * step);
+  return v;
+}
+
+} // namespace
+
+// every instruction set, with offsets so that the heads are misaligned
+// differently and lengths that leave a tail
+TEST(SimdTest, BinaryMatchesScalar)
+{
+  for (auto isa : supported_isas()) {
+    for (std::size_t offset : { 0, 1, 3 }) {
+      for (std::size_t n : { 0, 1, 7, 33, 100 }) {
+        SCOPED_TRACE(simd_isa_name(isa));
+        auto a = ramp<float>(n + offset, -10.0f, 0.37f);
+        auto b = ramp<float>(n + offset, 5.0f, -0.21f);
+        std::vector<float> out(n + 1, 0.0f);
+        span<const float> sa(a.data() + offset, n);
+        span<const float> sb(b.data(), n);
+        span<float> so(out.data() + 1, n);
+
+        simd::add(sa, sb, so, isa);
+        for (std::size_t k = 0; k < n; ++k)
+          EXPECT_EQ(so[k], sa[k] + sb[k]);
+        simd::mul(sa, sb, so, isa);
+        for (std::size_t k = 0; k < n; ++k)
+          EXPECT_EQ(so[k], sa[k] * sb[k]);
+        simd::min(sa, sb, so, isa);
+        for (std::size_t k = 0; k < n; ++k)
+          EXPECT_EQ(so[k], std::min(sa[k], sb[k]));
+        simd::max(sa, sb, so, isa);
+        for (std::size_t k = 0; k < n; ++k)
+          EXPECT_EQ(so[k], std::max(sa[k], sb[k]));
+        EXPECT_EQ(out[0], 0.0f);
+      }
+    }
+  }
+}
+
+TEST(SimdTest, IntegerKernels)
+{
+  for (auto isa : supported_isas()) {
+    SCOPED_TRACE(simd_isa_name(isa));
+    const std::size_t n = 45;
+    auto a = ramp<std::int32_t>(n, -20000, 917);
+    auto b = ramp<std::int32_t>(n, 70000, -3001);
+    std::vector<std::int32_t> out(n);
+
+    simd::mul(a, b, out, isa);
+    for (std::size_t k = 0; k < n; ++k)
+      EXPECT_EQ(out[k], std::int32_t(std::int64_t(a[k]) * b[k]));
+    simd::sub(a, b, out, isa);
+    for (std::size_t k = 0; k < n; ++k)
+      EXPECT_EQ(out[k], a[k] - b[k]);
+    simd::min(a, b, out, isa);
+    for (std::size_t k = 0; k < n; ++k)
+      EXPECT_EQ(out[k], std::min(a[k], b[k]));
+    simd::abs(a, out, isa);
+    for (std::size_t k = 0; k < n; ++k)
+      EXPECT_EQ(out[k], std::abs(a[k]));
+    simd::select<simd_cmp::ge>(a, b, a, b, out, isa);
+    for (std::size_t k = 0; k < n; ++k)
+      EXPECT_EQ(out[k], std::max(a[k], b[k]));
+  }
+}
+
+TEST(SimdTest, FmaSelectAndAbs)
+{
+  for (auto isa : supported_isas()) {
+    SCOPED_TRACE(simd_isa_name(isa));
+    const std::size_t n = 37;
+    auto a = ramp<double>(n, -3.0, 0.25);
+    auto b = ramp<double>(n, 1.0, 0.5);
+    auto c = ramp<double>(n, 2.0, -1.0);
+    std::vector<double> out(n);
+
+    simd::fma(a, b, c, out, isa);
+    for (std::size_t k = 0; k < n; ++k)
+      EXPECT_DOUBLE_EQ(out[k], a[k] * b[k] + c[k]);
+
+    simd::abs(a, out, isa);
+    for (std::size_t k = 0; k < n; ++k)
+      EXPECT_EQ(out[k], std::fabs(a[k]));
+
+    // every comparison, choosing between b and c
+    auto check = [&](auto cmp, auto ref) {
+      simd::select<decltype(cmp)::value>(a, b, b, c, out, isa);
+      for (std::size_t k = 0; k < n; ++k)
+        EXPECT_EQ(out[k], ref(a[k], b[k]) ? b[k] : c[k]);
+    };
+    using cmp = simd_cmp;
+    check(std::integral_constant<cmp, cmp::lt>{}, std::less<>{});
+    check(std::integral_constant<cmp, cmp::le>{}, std::less_equal<>{});
+    check(std::integral_constant<cmp, cmp::gt>{}, std::greater<>{});
+    check(std::integral_constant<cmp, cmp::ge>{}, std::greater_equal<>{});
+    check(std::integral_constant<cmp, cmp::eq>{}, std::equal_to<>{});
+    check(std::integral_constant<cmp, cmp::ne>{}, std::not_equal_to<>{});
+  }
+}
+
+// on the fused instruction sets the head and tail round once too, so every
+// element gets the same result wherever it falls relative to the alignment
+TEST(SimdTest, FmaFusedAtEveryOffset)
+{
+  const float x = 1.0f + std::ldexp(1.0f, -12);
+  const float y = -(1.0f + std::ldexp(1.0f, -11));
+  const float fused = std::fma(x, x, y);
+  ASSERT_NE(fused, x * x + y);
+
+  for (auto isa : { simd_isa::avx2, simd_isa::avx512 }) {
+    if (!simd_isa_supported(isa))
+      continue;
+    SCOPED_TRACE(simd_isa_name(isa));
+    for (std::size_t offset : { 0, 1, 3 }) {
+      const std::size_t n = 53;
+      std::vector<float> a(n, x), c(n, y), out(n + offset);
+      span<float> so(out.data() + offset, n);
+      simd::fma(a, a, c, so, isa);
+      for (std::size_t k = 0; k < n; ++k)
+        EXPECT_EQ(so[k], fused);
+    }
+  }
+}
+
+TEST(SimdTest, Casts)
+{
+  for (auto isa : supported_isas()) {
+    SCOPED_TRACE(simd_isa_name(isa));
+    const std::size_t n = 29;
+    auto f = ramp<float>(n, -7.3f, 0.61f);
+    std::vector<std::int32_t> i(n);
+    std::vector<double> d(n);
+    std::vector<float> back(n);
+
+    simd::cast(f, i, isa);
+    for (std::size_t k = 0; k < n; ++k)
+      EXPECT_EQ(i[k], std::int32_t(f[k]));
+    simd::cast(i, back, isa);
+    for (std::size_t k = 0; k < n; ++k)
+      EXPECT_EQ(back[k], float(i[k]));
+    simd::cast(f, d, isa);
+    for (std::size_t k = 0; k < n; ++k)
+      EXPECT_EQ(d[k], double(f[k]));
+    simd::cast(d, back, isa);
+    for (std::size_t k = 0; k < n; ++k)
+      EXPECT_EQ(back[k], f[k]);
+  }
+}
+
+TEST(SimdTest, ArraysAndInPlace)
+{
+  using dimension = dextents<index_type, 2>;
+  ndarray<float, dimension> a(dimension{ 5, 9 }, 2.0f);
+  ndarray<float, dimension> b(dimension{ 5, 9 }, 3.0f);
+
+  EXPECT_EQ(set_simd_isa(active_simd_isa()), detect_simd_isa());
+  simd::fma(a, b, b, b);
+  for (auto x : b)
+    EXPECT_EQ(x, 9.0f);
+  simd::sub(b, a.view(), b);
+  for (auto x : b)
+    EXPECT_EQ(x, 7.0f);
+}
+
+TEST(SimdTest, TiledAndRowMajorOperands)
+{
+  // the storage orders differ, elements pair up by index, not by offset
+  using dimension = dextents<index_type, 2>;
+  using tiled = layout_tiled<4, 4>;
+  ndarray<float, dimension> a(dimension{ 8, 8 });
+  iota_fill(a);
+  ndarray<float, dimension, tiled> t(dimension{ 8, 8 });
+
+  simd::add(a, 0.0f, t);
+  EXPECT_EQ(t(0, 4), 4.0f);
+  EXPECT_TRUE(same_elements(t, a));
+
+  ndarray<float, dimension> back(dimension{ 8, 8 });
+  simd::mul(t, a.view(), back);
+  EXPECT_EQ(back(1, 5), 13.0f * 13.0f);
+
+  // same mapping, flat, and partial tiles
+  ndarray<float, dimension, tiled> u(dimension{ 5, 9 }, 1.0f);
+  ndarray<float, dimension, tiled> v(dimension{ 5, 9 }, 2.0f);
+  simd::sub(u, v, u);
+  ndarray<float, dimension> w(dimension{ 5, 9 });
+  iota_fill(w);
+  simd::add(w, u, v);
+  EXPECT_EQ(v(4, 8), 43.0f);
+  EXPECT_EQ(v(0, 0), -1.0f);
+}
+
+TEST(SimdTest, MixedLayoutsAndStridedOutput)
+{
+  // operands pair up by index whatever their storage order
+  using dimension = dextents<index_type, 2>;
+  const dimension ext{ 2, 3 };
+  ndarray<float, dimension, layout_left> a(ext);
+  iota_fill(a, -3);
+  ndarray<float, dimension, layout_left> b(ext, 2.0f);
+  ndarray<float, dimension> c(ext, 1.0f);
+  ndarray<float, dimension> o(ext);
+
+  simd::abs(a, o);
+  EXPECT_EQ(o(0, 1), 2.0f);
+  EXPECT_EQ(o(1, 2), 2.0f);
+
+  simd::fma(a, b, c, o);
+  EXPECT_EQ(o(0, 1), -3.0f);
+  EXPECT_EQ(o(1, 0), 1.0f);
+
+  simd::select<simd_cmp::lt>(a, c, b, c, o);
+  EXPECT_EQ(o(0, 2), 2.0f);
+  EXPECT_EQ(o(1, 2), 1.0f);
+
+  ndarray<std::int32_t, dimension> n(ext);
+  simd::cast(a, n);
+  EXPECT_EQ(n(0, 1), -2);
+  EXPECT_EQ(n(1, 0), 0);
+
+  // a strided output is written through its strides only
+  ndarray<float, dimension> m(dimension{ 4, 4 }, -1.0f);
+  ndarray<float, dims<1>> v(dims<1>{ 4 }, 5.0f);
+  const auto column = subndspan(m, full_extent, 1);
+  simd::abs(v, column);
+  simd::fma(v, v, v, column);
+  simd::select<simd_cmp::gt>(v, v, v, v, column);
+  ndarray<std::int32_t, dims<1>> iv(dims<1>{ 4 }, 7);
+  simd::cast(iv, column);
+  detail::for_each_index(m.extents(), [&](const auto& idx) {
+    EXPECT_EQ(m(idx), idx[1] == 1 ? 7.0f : -1.0f);
+  });
+}
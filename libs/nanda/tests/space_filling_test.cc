@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <set>
+
+#include "nanda/ndarray.hh"
+#include "nanda/space_filling.hh"
+
+using namespace nanda;
+
+TEST(SpaceFillingTest, PortableBitDepositAndExtract)
+{
+  EXPECT_EQ(detail::pdep_portable(0b101, 0b11010), 0b10010u);
+  EXPECT_EQ(detail::pext_portable(0b10010, 0b11010), 0b101u);
+
+  std::mt19937_64 rng(42);
+  for (int i = 0; i < 1000; ++i) {
+    const std::uint64_t x = rng();
+    const std::uint64_t mask = rng();
+    EXPECT_EQ(detail::pdep(x, mask), detail::pdep_portable(x, mask));
+    EXPECT_EQ(detail::pext(x, mask), detail::pext_portable(x, mask));
+
+    // pext undoes pdep for the low popcount(mask) bits
+    const int bits = __builtin_popcountll(mask);
+    const std::uint64_t low =
+      bits == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << bits) - 1;
+    EXPECT_EQ(detail::pext_portable(detail::pdep_portable(x, mask), mask),
+              x & low);
+  }
+}
+
+TEST(SpaceFillingTest, MortonEncodeDecode)
+{
+  // the last index owns the lowest bit
+  EXPECT_EQ((morton_encode(std::array<int, 2>{ 0, 1 })), 1u);
+  EXPECT_EQ((morton_encode(std::array<int, 2>{ 1, 0 })), 2u);
+  EXPECT_EQ((morton_encode(std::array<int, 2>{ 3, 3 })), 15u);
+  EXPECT_EQ((morton_encode(std::array<int, 3>{ 1, 0, 0 })), 4u);
+  EXPECT_EQ((morton_encode(std::array<int, 3>{ 0, 2, 0 })), 16u);
+  static_assert(morton_encode(std::array<int, 2>{ 5, 3 }) == 0b100111);
+
+  std::mt19937 rng(7);
+  auto below = [&](int bits) { return index64_type(rng() % (1u << bits)); };
+  for (int i = 0; i < 1000; ++i) {
+    std::array<index64_type, 3> idx3{ below(21), below(21), below(21) };
+    EXPECT_EQ((morton_decode<3, index64_type>(morton_encode(idx3))), idx3);
+
+    std::array<index64_type, 4> idx4{
+      below(16), below(16), below(16), below(4)
+    };
+    EXPECT_EQ((morton_decode<4, index64_type>(morton_encode(idx4))), idx4);
+  }
+}
+
+template<std::size_t N>
+void
+check_hilbert_curve(int bits)
+{
+  const std::uint64_t size = std::uint64_t(1) << (bits * int(N));
+  std::set<std::array<index_type, N>> seen;
+  auto prev = hilbert_decode<N>(0, bits);
+  EXPECT_EQ(prev, (std::array<index_type, N>{}));
+  for (std::uint64_t h = 0; h < size; ++h) {
+    auto idx = hilbert_decode<N>(h, bits);
+    ASSERT_EQ(hilbert_encode(idx, bits), h);
+    seen.insert(idx);
+
+    // consecutive positions are direct neighbours
+    if (h > 0) {
+      int distance = 0;
+      for (std::size_t r = 0; r < N; ++r)
+        distance += std::abs(idx[r] - prev[r]);
+      ASSERT_EQ(distance, 1) << h;
+    }
+    prev = idx;
+  }
+  EXPECT_EQ(seen.size(), size);
+}
+
+TEST(SpaceFillingTest, HilbertCurveIsContinuous)
+{
+  check_hilbert_curve<1>(4);
+  check_hilbert_curve<2>(1);
+  check_hilbert_curve<2>(4);
+  check_hilbert_curve<3>(3);
+  check_hilbert_curve<4>(2);
+}
+
+template<class Layout>
+void
+check_padded_mapping(std::array<index_type, 3> shape, index_type span)
+{
+  using dimension = dextents<index_type, 3>;
+  typename Layout::template mapping<dimension> map(dimension{ shape });
+  EXPECT_EQ(map.required_span_size(), span);
+  EXPECT_FALSE(map.is_exhaustive());
+
+  std::set<index_type> offsets;
+  detail::for_each_index(map.extents(), [&](const auto& idx) {
+    const auto offset = map(idx);
+    EXPECT_GE(offset, 0);
+    EXPECT_LT(offset, span);
+    EXPECT_EQ(map.unflatten(offset), idx);
+    offsets.insert(offset);
+
+    for (std::size_t r = 0; r < 3; ++r) {
+      auto up = idx;
+      ++up[r];
+      if (up[r] < map.extents().extent(r)) {
+        EXPECT_EQ(map.next(offset, r), map(up));
+        EXPECT_EQ(map.prev(map(up), r), offset);
+      }
+      if (idx[r] >= 2) {
+        auto down = idx;
+        down[r] -= 2;
+        EXPECT_EQ(map.step(offset, r, -2), map(down));
+        EXPECT_EQ(map.step(map(down), r, 2), offset);
+      }
+    }
+  });
+  EXPECT_EQ(offsets.size(), map.extents().size());
+}
+
+TEST(SpaceFillingTest, MortonMappingPadsEachDirection)
+{
+  check_padded_mapping<layout_morton>({ 5, 9, 6 }, 8 * 16 * 8);
+  check_padded_mapping<layout_morton>({ 3, 17, 2 }, 4 * 32 * 2);
+
+  // anisotropic powers of two are exhaustive
+  using dimension = dextents<index_type, 2>;
+  layout_morton::mapping<dimension> flat(dimension{ 4, 16 });
+  EXPECT_TRUE(flat.is_exhaustive());
+  EXPECT_EQ(flat.mask(0), 0b001010u);
+  EXPECT_EQ(flat.mask(1), 0b110101u);
+
+  // equal powers of two give the plain Morton code
+  layout_morton::mapping<extents<index_type, 8, 8, 8>> cube;
+  detail::for_each_index(cube.extents(), [&](const auto& idx) {
+    EXPECT_EQ(cube(idx), index_type(morton_encode(idx)));
+  });
+}
+
+TEST(SpaceFillingTest, HilbertMappingPadsToCube)
+{
+  check_padded_mapping<layout_hilbert>({ 5, 9, 6 }, 16 * 16 * 16);
+
+  layout_hilbert::mapping<extents<index_type, 4, 4>> square;
+  EXPECT_TRUE(square.is_exhaustive());
+  EXPECT_EQ(square.bits(), 2);
+}
+
+TEST(SpaceFillingTest, NdarrayWithCurveLayouts)
+{
+  using dimension = dextents<index_type, 3>;
+  dimension ext{ 3, 5, 7 };
+
+  ndarray<int, dimension> row(ext);
+  std::iota(row.begin(), row.end(), 0);
+  ndarray<int, dimension, layout_morton> morton(ext);
+  ndarray<int, dimension, layout_hilbert> hilbert(ext);
+  EXPECT_EQ(morton.storage_size(), 4u * 8 * 8);
+  EXPECT_EQ(hilbert.storage_size(), 8u * 8 * 8);
+
+  copy(row.view(), morton.view());
+  copy(morton.view(), hilbert.view());
+  detail::for_each_index(ext, [&](const auto& idx) {
+    EXPECT_EQ(morton(idx), row(idx));
+    EXPECT_EQ(hilbert(idx), row(idx));
+  });
+}
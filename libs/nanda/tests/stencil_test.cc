@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <stdexcept>
+
+#include "nanda/ndarray.hh"
+#include "nanda/stencil.hh"
+#include "nanda/thread_pool.hh"
+
+#include "test_utils.hh"
+
+using namespace nanda;
+using namespace nanda::test;
+
+namespace {
+
+using matrix = dextents<index_type, 2>;
+using cube = dextents<index_type, 3>;
+
+///@brief The neighbourhood of a point of a plain array, outside points
+/// following the boundary condition, the reference of stencil_point
+template<class Array>
+struct reference_point
+{
+  using T = typename Array::value_type;
+  static constexpr std::size_t N = Array::rank();
+
+  const Array& arr;
+  std::array<index_type, N> idx;
+  boundary kind;
+  T value;
+
+  template<class... D>
+  T operator()(D... d) const
+  {
+    static_assert(sizeof...(D) == N, "One offset per axis");
+    // the neighbour in 64 bit, whatever the index type of the array
+    const std::array<std::int64_t, N> offsets{ std::int64_t(d)... };
+    std::array<index_type, N> at{};
+    for (std::size_t r = 0; r < N; ++r) {
+      const auto n = std::int64_t(arr.extent(r));
+      auto x = std::int64_t(idx[r]) + offsets[r];
+      if (x < 0 || x >= n) {
+        if (kind == boundary::constant)
+          return value;
+        x = kind == boundary::clamp ? std::clamp(x, std::int64_t(0), n - 1)
+                                    : (x % n + n) % n;
+      }
+      at[r] = index_type(x);
+    }
+    return arr(at);
+  }
+
+  T center() const { return arr(idx); }
+  const std::array<index_type, N>& index() const { return idx; }
+};
+
+template<class Array, class F>
+Array
+reference_steps(Array arr, int steps, boundary kind, F f)
+{
+  using T = typename Array::value_type;
+  for (int s = 0; s < steps; ++s) {
+    Array next(arr.extents());
+    detail::for_each_index(arr.extents(), [&](const auto& idx) {
+      next(idx) = f(reference_point<Array>{ arr, idx, kind, T(7) });
+    });
+    arr = next;
+  }
+  return arr;
+}
+
+template<class Array>
+void
+pseudo_random_fill(Array& arr)
+{
+  std::uint32_t state = 12345;
+  for (auto& x : arr) {
+    state = state * 1664525u + 1013904223u;
+    x = typename Array::value_type(state >> 22);
+  }
+}
+
+///@brief A non-linear 7-point update, exact in integers so redundant
+/// computation must give the same bits
+struct integer_update
+{
+  template<class P>
+  std::int64_t operator()(const P& p) const
+  {
+    const std::int64_t sum =
+      p(-1, 0, 0) + p(1, 0, 0) + p(0, -1, 0) + p(0, 1, 0) + p(0, 0, -1) +
+      2 * p(0, 0, 1);
+    return (3 * p.center() + sum * sum + p.index()[2]) % 1000003;
+  }
+};
+
+} // namespace
+
+TEST(StencilTest, Shapes)
+{
+  using seven = star_stencil<3>;
+  static_assert(seven::size == 7 && seven::radius == 1);
+  EXPECT_EQ(seven::offsets[0], (std::array<int, 3>{ 0, 0, 0 }));
+  EXPECT_EQ(seven::offsets[1], (std::array<int, 3>{ -1, 0, 0 }));
+  EXPECT_EQ(seven::offsets[6], (std::array<int, 3>{ 0, 0, 1 }));
+
+  using twenty_seven = box_stencil<3>;
+  static_assert(twenty_seven::size == 27 && twenty_seven::radius == 1);
+  EXPECT_EQ(twenty_seven::offsets[0], (std::array<int, 3>{ -1, -1, -1 }));
+  EXPECT_EQ(twenty_seven::offsets[13], (std::array<int, 3>{ 0, 0, 0 }));
+
+  static_assert(star_stencil<2, 2>::size == 9);
+  static_assert(box_stencil<2, 2>::size == 25);
+
+  using upwind = stencil_shape<offset<0, 0>, offset<-2, 0>, offset<0, -1>>;
+  static_assert(upwind::rank == 2 && upwind::size == 3);
+  static_assert(upwind::radius == 2);
+}
+
+TEST(StencilTest, EveryBoundaryAndBlocking)
+{
+  thread_pool pool(3);
+  ndarray<std::int64_t, cube> initial(cube{ 11, 9, 13 });
+  pseudo_random_fill(initial);
+
+  for (auto kind : { boundary::periodic, boundary::clamp, boundary::constant })
+    for (index_type time_block : { 1, 2, 3 }) {
+      SCOPED_TRACE(int(kind) * 10 + time_block);
+      stencil_grid<std::int64_t, star_stencil<3>> grid(
+        initial.extents(), kind, 7, { 4, time_block, 5 });
+      EXPECT_EQ(grid.halo(), time_block);
+      copy(initial.view(), grid.field());
+
+      // 7 steps do not divide into time blocks of 2 or 3
+      grid.run(7, integer_update{}, pool);
+      const auto expected =
+        reference_steps(initial, 7, kind, integer_update{});
+      EXPECT_TRUE(same_elements(grid.field(), expected));
+    }
+}
+
+TEST(StencilTest, BoxStencilMatchesTheReference)
+{
+  ndarray<double, matrix> initial(matrix{ 40, 35 });
+  pseudo_random_fill(initial);
+  const auto smooth = [](const auto& p) {
+    double sum = 0;
+    for (int i = -1; i <= 1; ++i)
+      for (int j = -1; j <= 1; ++j)
+        sum += p(i, j);
+    return sum / 9.0;
+  };
+
+  for (index_type time_block : { 1, 4 }) {
+    stencil_grid<double, box_stencil<2>> grid(
+      initial.extents(), boundary::clamp, 0.0, { 16, time_block, 16 });
+    copy(initial.view(), grid.field());
+    grid.run(9, smooth);
+    const auto expected =
+      reference_steps(initial, 9, boundary::clamp, smooth);
+    detail::for_each_index(expected.extents(), [&](const auto& idx) {
+      EXPECT_DOUBLE_EQ(grid.field()(idx), expected(idx));
+    });
+  }
+
+  // a wider neighbourhood, read by position
+  stencil_grid<double, star_stencil<2, 2>> wide(
+    initial.extents(), boundary::periodic, 0.0, { 0, 2 });
+  copy(initial.view(), wide.field());
+  wide.run(1, [](const auto& p) {
+    return p.template get<0>() - p.template get<3>() + p(0, 2);
+  });
+  EXPECT_DOUBLE_EQ(wide.field()(0, 34),
+                   initial(0, 34) - initial(38, 34) + initial(0, 1));
+}
+
+TEST(StencilTest, Errors)
+{
+  using grid = stencil_grid<float, star_stencil<2, 2>>;
+  // the halo of a periodic grid wraps once at most
+  EXPECT_THROW(grid(matrix{ 1, 10 }), std::invalid_argument);
+  EXPECT_THROW(grid(matrix{ 5, 10 }, boundary::periodic, 0.0f, { 0, 3 }),
+               std::invalid_argument);
+  EXPECT_NO_THROW(grid(matrix{ 3, 10 }, boundary::clamp, 0.0f, { 0, 3 }));
+  EXPECT_THROW(grid(matrix{ 10, 10 }, boundary::clamp, 0.0f, { 0, 0 }),
+               std::invalid_argument);
+  EXPECT_THROW(grid(matrix{ 10, 0 }), std::invalid_argument);
+}
@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+
+#include <tuple>
+#include <utility>
+
+#include "nanda/ndarray.hh"
+#include "nanda/subndspan.hh"
+
+#include "test_utils.hh"
+
+using namespace nanda;
+using namespace nanda::test;
+
+namespace {
+
+using cube = dextents<index_type, 3>;
+
+template<class View, class E, class L>
+inline constexpr bool is_view_v =
+  std::is_same_v<typename View::extents_type, E> &&
+  std::is_same_v<typename View::layout_type, L>;
+
+} // namespace
+
+TEST(SubndspanTest, RankAndLayoutAtCompileTime)
+{
+  using fixed = extents<index_type, 4, 5, 6>;
+  ndarray<int, fixed> arr;
+  iota_fill(arr);
+
+  // indices along the leading axes, a range, then full extents: packed
+  const auto plane = subndspan(arr, 1, full_extent, full_extent);
+  static_assert(is_view_v<decltype(plane), extents<index_type, 5, 6>, layout_right>);
+  const auto rows = subndspan(arr, 1, std::pair{ 1, 3 }, full_extent);
+  static_assert(
+    is_view_v<decltype(rows), extents<index_type, dynamic_extent, 6>, layout_right>);
+  const auto block = subndspan(arr, std::tuple{ 0, 2 }, full_extent, full_extent);
+  static_assert(is_view_v<decltype(block),
+                          extents<index_type, dynamic_extent, 5, 6>,
+                          layout_right>);
+  const auto element = subndspan(arr, 3, 4, 5);
+  static_assert(decltype(element)::rank() == 0);
+  EXPECT_EQ(element(), arr(3, 4, 5));
+
+  // anything else is strided
+  const auto column = subndspan(arr, full_extent, 2, full_extent);
+  static_assert(is_view_v<decltype(column), extents<index_type, 4, 6>, layout_stride>);
+  const auto box = subndspan(arr, 1, std::array<int, 2>{ 1, 3 }, std::pair{ 2, 4 });
+  static_assert(std::is_same_v<decltype(box)::layout_type, layout_stride>);
+
+  // mirrored for layout_left
+  ndarray<int, cube, layout_left> left(cube{ 4, 5, 6 });
+  static_assert(std::is_same_v<
+                decltype(subndspan(left, full_extent, std::pair{ 1, 2 }, 3))::layout_type,
+                layout_left>);
+  static_assert(
+    std::is_same_v<decltype(subndspan(left, 1, full_extent, 3))::layout_type,
+                   layout_stride>);
+  static_assert(
+    std::is_same_v<decltype(subndspan(std::as_const(left), full_extent, 0, 0)),
+                   ndspan<const int, dextents<index_type, 1>, layout_left>>);
+}
+
+TEST(SubndspanTest, SameElementsNoCopy)
+{
+  ndarray<int, cube> arr(cube{ 4, 5, 6 });
+  iota_fill(arr);
+
+  const auto rows = subndspan(arr, 2, std::pair{ 1, 4 }, full_extent);
+  EXPECT_EQ(rows.extent(0), 3);
+  EXPECT_EQ(rows.data(), &arr(2, 1, 0));
+  EXPECT_TRUE(rows.is_contiguous());
+  for (index_type i = 0; i < 3; ++i)
+    for (index_type j = 0; j < 6; ++j)
+      EXPECT_EQ(rows(i, j), arr(2, i + 1, j));
+
+  // writes go to the array
+  subndspan(arr, 0, 0, full_extent)(5) = -1;
+  EXPECT_EQ(arr(0, 0, 5), -1);
+
+  // ranges, strided slices and indices mixed
+  const auto odd = subndspan(
+    arr, strided_slice{ 1, 3, 2 }, 4, strided_slice{ 0, 6, 4 });
+  EXPECT_EQ(odd.extent(0), 2);
+  EXPECT_EQ(odd.extent(1), 2);
+  for (index_type i = 0; i < 2; ++i)
+    for (index_type j = 0; j < 2; ++j)
+      EXPECT_EQ(odd(i, j), arr(1 + 2 * i, 4, 4 * j));
+
+  // slices of slices, of strided views
+  const auto corner = subndspan(odd, std::pair{ 1, 2 }, 1);
+  EXPECT_EQ(corner.extent(0), 1);
+  EXPECT_EQ(corner(0), arr(3, 4, 4));
+  const auto back =
+    subndspan(arr, full_extent, strided_slice{ 0, 5, 2 }, std::pair{ 3, 6 });
+  const auto inner = subndspan(back, 3, full_extent, strided_slice{ 1, 2, 1 });
+  for (index_type i = 0; i < 3; ++i)
+    for (index_type j = 0; j < 2; ++j)
+      EXPECT_EQ(inner(i, j), arr(3, 2 * i, 4 + j));
+
+  // empty slices
+  const auto none = subndspan(arr, std::pair{ 4, 4 }, full_extent, 0);
+  EXPECT_EQ(none.size(), 0u);
+  EXPECT_EQ(subndspan(arr, 1, strided_slice{ 2, 0, 0 }, 1).size(), 0u);
+}
+
+TEST(SubndspanTest, PackedSlicesKeepFastPaths)
+{
+  ndarray<float, cube> arr(cube{ 3, 8, 16 });
+  iota_fill(arr);
+  ndarray<float, dextents<index_type, 2>> dst(dextents<index_type, 2>{ 4, 16 });
+
+  // a sub-block copied straight from the array, no scratch buffer
+  copy(subndspan(arr, 1, std::pair{ 2, 6 }, full_extent), dst.view());
+  for (index_type i = 0; i < 4; ++i)
+    for (index_type j = 0; j < 16; ++j)
+      EXPECT_EQ(dst(i, j), arr(1, i + 2, j));
+
+  // a strided window into a window of the array
+  ndarray<float, dextents<index_type, 2>> window(dextents<index_type, 2>{ 8, 4 });
+  copy(subndspan(arr, 2, full_extent, std::pair{ 10, 14 }), window.view());
+  for (index_type i = 0; i < 8; ++i)
+    for (index_type j = 0; j < 4; ++j)
+      EXPECT_EQ(window(i, j), arr(2, i, 10 + j));
+}
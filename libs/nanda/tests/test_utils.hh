@@ -0,0 +1,101 @@
+#ifndef NANDA_TEST_UTILS_HEADER
+#define NANDA_TEST_UTILS_HEADER
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+#include "nanda/ndspan.hh"
+#include "nanda/simd.hh"
+
+namespace nanda::test {
+
+///@brief A path in the temporary directory, whatever is there removed with
+/// the object
+struct temp_path
+{
+  std::filesystem::path path;
+
+  explicit temp_path(const std::string& name)
+    : path{ std::filesystem::temp_directory_path() /
+            ("nanda_" + std::to_string(::getpid()) + "_" + name) }
+  {
+    std::filesystem::remove_all(path);
+  }
+
+  ~temp_path()
+  {
+    std::error_code ignored;
+    std::filesystem::remove_all(path, ignored);
+  }
+
+  temp_path(const temp_path&) = delete;
+  temp_path& operator=(const temp_path&) = delete;
+
+  void write(const std::string& bytes) const
+  {
+    std::ofstream out(path, std::ios::binary);
+    out.write(bytes.data(), std::streamsize(bytes.size()));
+  }
+
+  std::string read() const
+  {
+    std::ifstream in(path, std::ios::binary);
+    return { std::istreambuf_iterator<char>(in), {} };
+  }
+};
+
+///@brief Writes start, start + step, ... to 'arr' in row-major index order
+template<class Array>
+void
+iota_fill(Array& arr, int start = 0, int step = 1)
+{
+  int k = start;
+  detail::for_each_index(arr.extents(), [&](const auto& idx) {
+    arr(idx) = typename Array::value_type(k);
+    k += step;
+  });
+}
+
+///@brief Whether a and b have the same extents and equal elements at every
+/// index
+template<class A, class B>
+bool
+same_elements(const A& a, const B& b)
+{
+  if (a.extents() != b.extents())
+    return false;
+  bool same = true;
+  detail::for_each_index(a.extents(), [&](const auto& idx) {
+    same = same && a(idx) == b(idx);
+  });
+  return same;
+}
+
+///@brief The instruction sets this machine runs, scalar included
+inline std::vector<simd_isa>
+supported_isas()
+{
+  std::vector<simd_isa> isas;
+  for (auto isa :
+       { simd_isa::scalar, simd_isa::sse2, simd_isa::avx2, simd_isa::avx512 })
+    if (simd_isa_supported(isa))
+      isas.push_back(isa);
+  return isas;
+}
+
+///@brief Restores the detected instruction set when a test is done
+struct isa_guard
+{
+  simd_isa saved = active_simd_isa();
+  ~isa_guard() { set_simd_isa(saved); }
+};
+
+} // namespace nanda::test
+
+#endif // NANDA_TEST_UTILS_HEADER
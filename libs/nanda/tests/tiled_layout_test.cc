@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+
+#include <iterator>
+#include <numeric>
+#include <set>
+#include <type_traits>
+#include <vector>
+
+#include "nanda/ndarray.hh"
+#include "nanda/tiled_layout.hh"
+
+using namespace nanda;
+
+TEST(TiledLayoutTest, OffsetsOfFullTiles)
+{
+  using dimension = extents<index_type, 8, 8>;
+  layout_tiled<4, 4>::mapping<dimension> map;
+
+  static_assert(decltype(map)::is_always_exhaustive());
+  EXPECT_EQ(map.required_span_size(), 64);
+  EXPECT_EQ(map.tiles(), (std::array<index_type, 2>{ 2, 2 }));
+
+  // first tile row-major, then the tile to its right
+  EXPECT_EQ(map(0, 0), 0);
+  EXPECT_EQ(map(0, 3), 3);
+  EXPECT_EQ(map(1, 0), 4);
+  EXPECT_EQ(map(3, 3), 15);
+  EXPECT_EQ(map(0, 4), 16);
+  EXPECT_EQ(map(4, 0), 32);
+  EXPECT_EQ(map(7, 7), 63);
+}
+
+TEST(TiledLayoutTest, UnflattenInvertsMapping3D)
+{
+  using dimension = dextents<index_type, 3>;
+  layout_tiled<4, 4, 4>::mapping<dimension> map(dimension{ 5, 9, 6 });
+
+  EXPECT_FALSE(map.is_exhaustive());
+  EXPECT_EQ(map.tiles(), (std::array<index_type, 3>{ 2, 3, 2 }));
+  EXPECT_EQ(map.required_span_size(), 2 * 3 * 2 * 64);
+
+  std::set<index_type> offsets;
+  detail::for_each_index(map.extents(), [&](const auto& idx) {
+    const auto offset = map(idx);
+    EXPECT_LT(offset, map.required_span_size());
+    EXPECT_EQ(map.unflatten(offset), idx);
+    offsets.insert(offset);
+  });
+  EXPECT_EQ(offsets.size(), map.extents().size());
+
+  using dims = std::array<size_type, 3>;
+  std::array<index_type, 3> idx{ 4, 7, 5 };
+  const auto flat = tiled_flatten<4, 4, 4>(idx, dims{ 5, 9, 6 });
+  EXPECT_EQ(flat, map(idx));
+  EXPECT_EQ((tiled_unflatten<4, 4, 4>(flat, dims{ 5, 9, 6 })), idx);
+}
+
+TEST(TiledLayoutTest, IteratorVisitsTilesInMemoryOrder)
+{
+  using dimension = dextents<index_type, 2>;
+  layout_tiled<8, 8>::mapping<dimension> map(dimension{ 19, 13 });
+
+  auto range = tiled_indices(map);
+  EXPECT_EQ(range.size(), 19 * 13);
+
+  index_type count = 0;
+  index_type last = -1;
+  std::array<index_type, 2> last_tile{ 0, 0 };
+  for (auto it = range.begin(); it != range.end(); ++it, ++count) {
+    const auto& [idx, offset] = *it;
+    EXPECT_LT(idx[0], 19);
+    EXPECT_LT(idx[1], 13);
+    EXPECT_EQ(offset, map(idx));
+    EXPECT_GT(offset, last);
+    last = offset;
+
+    // a tile is finished before the next one starts
+    if (it.tile() != last_tile) {
+      EXPECT_EQ(idx[0] % 8, 0);
+      EXPECT_EQ(idx[1] % 8, 0);
+      last_tile = it.tile();
+    }
+  }
+  EXPECT_EQ(count, 19 * 13);
+}
+
+TEST(TiledLayoutTest, IteratorIsMultiPass)
+{
+  using dimension = extents<index_type, 8, 8>;
+  layout_tiled<4, 4>::mapping<dimension> map;
+  auto range = tiled_indices(map);
+  static_assert(
+    std::is_same_v<decltype(*range.begin()), md_index<2, index_type>>);
+  static_assert(std::is_same_v<std::iterator_traits<decltype(
+                                 range.begin())>::iterator_category,
+                               std::input_iterator_tag>);
+
+  // equal iterators yield equal values, which outlive the iterators
+  auto a = range.begin();
+  auto b = a;
+  const auto first = *a;
+  ++a;
+  ++b;
+  EXPECT_EQ((*a).index, (*b).index);
+  EXPECT_EQ(first.offset, 0);
+
+  const std::vector<md_index<2, index_type>> all(range.begin(), range.end());
+  ASSERT_EQ(all.size(), 64u);
+  EXPECT_EQ(all[16].index, (std::array<index_type, 2>{ 0, 4 }));
+  EXPECT_EQ(all[16].offset, 16);
+}
+
+TEST(TiledLayoutTest, ConvertToAndFromRowMajor)
+{
+  using dimension = dextents<index_type, 3>;
+  dimension ext{ 6, 7, 9 };
+
+  ndarray<int, dimension> row(ext);
+  std::iota(row.begin(), row.end(), 0);
+
+  ndarray<int, dimension, layout_tiled<4, 4, 4>> tiled(ext, -1);
+  EXPECT_EQ(tiled.size(), row.size());
+  EXPECT_EQ(tiled.storage_size(), 2 * 2 * 3 * 64u);
+
+  copy(row.view(), tiled.view());
+  detail::for_each_index(ext, [&](const auto& idx) {
+    EXPECT_EQ(tiled(idx), row(idx));
+  });
+
+  ndarray<int, dimension> back(ext);
+  copy(tiled.view(), back.view());
+  EXPECT_TRUE(std::equal(row.begin(), row.end(), back.begin()));
+
+  // the generic index by index copy agrees with the tiled rows
+  ndarray<int, dimension, layout_left> col(ext);
+  copy(tiled.view(), col.view());
+  detail::for_each_index(ext, [&](const auto& idx) {
+    EXPECT_EQ(col(idx), row(idx));
+  });
+}
+
+TEST(TiledLayoutTest, FlatAccessCoversPadding)
+{
+  using dimension = dextents<index_type, 2>;
+  ndarray<int, dimension, layout_tiled<4, 4>> tiled(dimension{ 5, 6 });
+  ASSERT_EQ(tiled.storage_size(), 2 * 2 * 16u);
+
+  // operator[] reaches every stored element, the padding of the edge tiles
+  // included
+  for (std::size_t i = 0; i < tiled.storage_size(); ++i)
+    tiled[index_type(i)] = int(i);
+  const auto& ctiled = tiled;
+  for (std::size_t i = 0; i < ctiled.storage_size(); ++i)
+    EXPECT_EQ(ctiled[index_type(i)], int(i));
+}
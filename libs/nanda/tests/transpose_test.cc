@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include "nanda/ndarray.hh"
+#include "nanda/simd.hh"
+#include "nanda/transpose.hh"
+
+#include "test_utils.hh"
+
+using namespace nanda;
+using namespace nanda::test;
+
+namespace {
+
+using matrix = dextents<index_type, 2>;
+using cube = dextents<index_type, 3>;
+
+} // namespace
+
+TEST(TransposeTest, ZeroCopyViews)
+{
+  ndarray<int, extents<index_type, 3, dynamic_extent>> arr(
+    extents<index_type, 3, dynamic_extent>(5));
+  iota_fill(arr);
+
+  // packed layouts swap, the static extents follow the axes
+  auto t = transpose(arr);
+  static_assert(
+    std::is_same_v<decltype(t),
+                   ndspan<int,
+                          extents<index_type, dynamic_extent, 3>,
+                          layout_left>>);
+  EXPECT_EQ(t.data(), arr.data());
+  for (index_type i = 0; i < 3; ++i)
+    for (index_type j = 0; j < 5; ++j)
+      EXPECT_EQ(t(j, i), arr(i, j));
+  EXPECT_EQ(transpose(t).extents(), arr.extents());
+
+  ndarray<int, cube> vol(cube{ 2, 3, 4 });
+  iota_fill(vol);
+  const auto p = permute_axes(vol, { 2, 0, 1 });
+  EXPECT_EQ(p.extent(0), 4);
+  EXPECT_EQ(p.extent(1), 2);
+  EXPECT_EQ(p.extent(2), 3);
+  detail::for_each_index(vol.extents(), [&](const auto& idx) {
+    EXPECT_EQ(p(idx[2], idx[0], idx[1]), vol(idx));
+  });
+
+  // other strided layouts reverse their strides
+  const auto pt = transpose(p);
+  static_assert(std::is_same_v<decltype(pt)::layout_type, layout_stride>);
+  detail::for_each_index(p.extents(), [&](const auto& idx) {
+    EXPECT_EQ(pt(idx[2], idx[1], idx[0]), p(idx));
+  });
+}
+
+template<class T>
+void
+check_layout_conversion(index_type rows, index_type cols)
+{
+  ndarray<T, matrix> src(matrix{ rows, cols });
+  iota_fill(src);
+  ndarray<T, matrix, layout_left> dst(matrix{ rows, cols });
+  copy(src.view(), dst.view());
+  for (index_type i = 0; i < rows; ++i)
+    for (index_type j = 0; j < cols; ++j)
+      ASSERT_EQ(dst(i, j), src(i, j)) << i << ", " << j;
+
+  const auto t = transpose_copy(src);
+  static_assert(std::is_same_v<typename decltype(t)::layout_type, layout_right>);
+  for (index_type i = 0; i < rows; ++i)
+    for (index_type j = 0; j < cols; ++j)
+      ASSERT_EQ(t(j, i), src(i, j)) << i << ", " << j;
+}
+
+TEST(TransposeTest, BlockedCopyEveryIsa)
+{
+  isa_guard guard;
+  for (auto isa : { simd_isa::scalar, simd_isa::sse2, simd_isa::avx2 }) {
+    set_simd_isa(isa);
+    SCOPED_TRACE(simd_isa_name(active_simd_isa()));
+    check_layout_conversion<float>(64, 64);
+    check_layout_conversion<float>(37, 101);
+    check_layout_conversion<double>(70, 45);
+    check_layout_conversion<std::int64_t>(9, 8);
+    check_layout_conversion<std::int16_t>(33, 17);
+  }
+
+  // a conversion to a different element type
+  ndarray<float, matrix> src(matrix{ 19, 23 });
+  iota_fill(src);
+  ndarray<double, matrix, layout_left> dst(src.extents());
+  copy(src.view(), dst.view());
+  EXPECT_EQ(dst(18, 22), double(src(18, 22)));
+}
+
+TEST(TransposeTest, PermutedCopies)
+{
+  ndarray<float, dextents<index_type, 4>> arr(
+    dextents<index_type, 4>{ 3, 10, 1, 12 });
+  iota_fill(arr);
+
+  for (const auto& perm : { std::array<std::size_t, 4>{ 3, 1, 2, 0 },
+                            std::array<std::size_t, 4>{ 0, 3, 2, 1 },
+                            std::array<std::size_t, 4>{ 1, 0, 2, 3 },
+                            std::array<std::size_t, 4>{ 2, 3, 0, 1 } }) {
+    const auto p = permute_axes_copy(arr, perm);
+    detail::for_each_index(arr.extents(), [&](const auto& idx) {
+      std::array<index_type, 4> at{};
+      for (std::size_t k = 0; k < 4; ++k)
+        at[k] = idx[perm[k]];
+      ASSERT_EQ(p(at), arr(idx));
+    });
+  }
+
+  // between a strided sub-view and a packed array
+  ndarray<double, matrix> wide(matrix{ 40, 50 });
+  iota_fill(wide);
+  ndspan<const double, matrix, layout_stride> every_other(
+    wide.data() + 1,
+    layout_stride::mapping<matrix>(matrix{ 40, 24 }, { 50, 2 }));
+  const auto m = materialize(transpose(every_other));
+  for (index_type i = 0; i < 40; ++i)
+    for (index_type j = 0; j < 24; ++j)
+      ASSERT_EQ(m(j, i), wide(i, 2 * j + 1));
+}
+
+TEST(TransposeTest, InPlaceSquare)
+{
+  for (index_type n : { 1, 7, 8, 33, 64, 100 }) {
+    SCOPED_TRACE(n);
+    ndarray<float, matrix> a(matrix{ n, n });
+    iota_fill(a);
+    ndarray<float, matrix> expected = transpose_copy(a);
+    transpose_in_place(a);
+    for (index_type k = 0; k < n * n; ++k)
+      ASSERT_EQ(a[k], expected[k]);
+
+    ndarray<double, matrix, layout_left> b(matrix{ n, n });
+    iota_fill(b);
+    ndarray<double, matrix, layout_left> original = b;
+    transpose_in_place(b);
+    for (index_type i = 0; i < n; ++i)
+      for (index_type j = 0; j < n; ++j)
+        ASSERT_EQ(b(i, j), original(j, i));
+  }
+
+  // the top-left square of a wider matrix
+  ndarray<int, matrix> wide(matrix{ 20, 31 });
+  iota_fill(wide);
+  const ndarray<int, matrix> before = wide;
+  ndspan<int, matrix, layout_stride> square(
+    wide.data(), layout_stride::mapping<matrix>(matrix{ 20, 20 }, { 31, 1 }));
+  transpose_in_place(square);
+  for (index_type i = 0; i < 20; ++i) {
+    for (index_type j = 0; j < 20; ++j)
+      ASSERT_EQ(wide(i, j), before(j, i));
+    for (index_type j = 20; j < 31; ++j)
+      ASSERT_EQ(wide(i, j), before(i, j));
+  }
+}